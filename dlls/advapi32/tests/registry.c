@@ -1579,6 +1579,99 @@ static void test_reg_unload_key(void)
     DeleteFileA("saved_key.LOG");
 }
 
+static void test_reg_reload_key(void)
+{
+    FILETIME time, reload_time;
+    DWORD ret, type, size, value;
+    char buffer[16];
+    HKEY key, reloaded, subkey, volatile_key, hkey, hkey2;
+
+    ret = RegCreateKeyA(hkey_main, "Reload", &key);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    /* a key without values whose only subkey is volatile */
+    ret = RegCreateKeyA(key, "Empty", &subkey);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    ret = RegCreateKeyExA(subkey, "Volatile", 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &volatile_key, NULL);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    value = 1;
+    ret = RegSetValueExA(key, "a", 0, REG_DWORD, (BYTE *)&value, sizeof(value));
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    ret = RegSetValueExA(key, "b", 0, REG_SZ, (BYTE *)"deleted", 8);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    Sleep(20);
+    value = 2;
+    ret = RegSetValueExA(key, "a", 0, REG_DWORD, (BYTE *)&value, sizeof(value));
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    ret = RegSetValueExA(key, "c", 0, REG_SZ, (BYTE *)"kept", 5);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    Sleep(20);
+    ret = RegDeleteValueA(key, "b");
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &time);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+
+    if (!set_privileges(SE_BACKUP_NAME, TRUE) ||
+        !set_privileges(SE_RESTORE_NAME, TRUE))
+    {
+        win_skip("Failed to set SE_BACKUP_NAME and SE_RESTORE_NAME privileges, skipping tests\n");
+        goto done;
+    }
+
+    DeleteFileA("reload_key");
+    ret = RegSaveKeyA(key, "reload_key", NULL);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    ret = RegLoadKeyA(HKEY_LOCAL_MACHINE, "TestReload", "reload_key");
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+
+    ret = RegOpenKeyA(HKEY_LOCAL_MACHINE, "TestReload", &reloaded);
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    if (!ret)
+    {
+        size = sizeof(value);
+        ret = RegQueryValueExA(reloaded, "a", NULL, &type, (BYTE *)&value, &size);
+        ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+        ok(type == REG_DWORD && value == 2, "got type %u value %u\n", type, value);
+        ret = RegQueryValueExA(reloaded, "b", NULL, NULL, NULL, NULL);
+        ok(ret == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", ret);
+        size = sizeof(buffer);
+        ret = RegQueryValueExA(reloaded, "c", NULL, &type, (BYTE *)buffer, &size);
+        ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+        ok(type == REG_SZ && !strcmp(buffer, "kept"), "got type %u value %s\n", type, buffer);
+
+        ret = RegOpenKeyA(reloaded, "Empty", &hkey);
+        ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+        if (!ret)
+        {
+            ret = RegOpenKeyA(hkey, "Volatile", &hkey2);
+            ok(ret == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", ret);
+            if (!ret) RegCloseKey(hkey2);
+            RegCloseKey(hkey);
+        }
+
+        ret = RegQueryInfoKeyA(reloaded, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &reload_time);
+        ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+        ok(!CompareFileTime(&time, &reload_time), "got time %08x%08x, expected %08x%08x\n",
+           reload_time.dwHighDateTime, reload_time.dwLowDateTime, time.dwHighDateTime, time.dwLowDateTime);
+        RegCloseKey(reloaded);
+    }
+
+    ret = RegUnLoadKeyA(HKEY_LOCAL_MACHINE, "TestReload");
+    ok(ret == ERROR_SUCCESS, "expected ERROR_SUCCESS, got %d\n", ret);
+    DeleteFileA("reload_key");
+    DeleteFileA("reload_key.LOG");
+    DeleteFileA("reload_key.cache");  /* written by Wine when WINEREGCACHE is set */
+
+done:
+    set_privileges(SE_BACKUP_NAME, FALSE);
+    set_privileges(SE_RESTORE_NAME, FALSE);
+    RegDeleteKeyA(volatile_key, "");
+    RegCloseKey(volatile_key);
+    RegDeleteKeyA(subkey, "");
+    RegCloseKey(subkey);
+    RegDeleteKeyA(key, "");
+    RegCloseKey(key);
+}
+
 /* tests that show that RegConnectRegistry and 
    OpenSCManager accept computer names without the
    \\ prefix (what MSDN says).   */
@@ -2307,6 +2400,83 @@ static void test_rw_order(void)
     ok(!RegDeleteKeyA(HKEY_CURRENT_USER, keyname), "Failed to delete key\n");
 }
 
+static void test_enum_key_order(void)
+{
+    static const unsigned int count = 300;
+    char name[32], expected[32];
+    HKEY key, subkey;
+    DWORD i, j, len, subkeys;
+    LONG ret;
+
+    ret = RegCreateKeyA( hkey_main, "enum_key_order", &key );
+    ok( !ret, "RegCreateKeyA failed: %d\n", ret );
+
+    /* insert the subkeys out of order and with mixed case */
+    for (i = 0; i < count; i++)
+    {
+        j = (i * 7) % count;
+        sprintf( name, j & 1 ? "KEY%03u" : "key%03u", j );
+        ret = RegCreateKeyA( key, name, &subkey );
+        ok( !ret, "RegCreateKeyA %s failed: %d\n", name, ret );
+        RegCloseKey( subkey );
+    }
+
+    ret = RegQueryInfoKeyA( key, NULL, NULL, NULL, &subkeys, NULL, NULL, NULL, NULL, NULL, NULL, NULL );
+    ok( !ret, "RegQueryInfoKeyA failed: %d\n", ret );
+    ok( subkeys == count, "got %u subkeys\n", subkeys );
+
+    /* subkeys are sorted by name, case insensitively, in both directions */
+    for (i = 0; i < count; i++)
+    {
+        len = sizeof(name);
+        ret = RegEnumKeyExA( key, i, name, &len, NULL, NULL, NULL, NULL );
+        ok( !ret, "RegEnumKeyExA %u failed: %d\n", i, ret );
+        sprintf( expected, i & 1 ? "KEY%03u" : "key%03u", i );
+        ok( !strcmp( name, expected ), "%u: got %s\n", i, name );
+    }
+    len = sizeof(name);
+    ret = RegEnumKeyExA( key, count, name, &len, NULL, NULL, NULL, NULL );
+    ok( ret == ERROR_NO_MORE_ITEMS, "got %d\n", ret );
+
+    for (i = count; i > 0; i--)
+    {
+        len = sizeof(name);
+        ret = RegEnumKeyExA( key, i - 1, name, &len, NULL, NULL, NULL, NULL );
+        ok( !ret, "RegEnumKeyExA %u failed: %d\n", i - 1, ret );
+        sprintf( expected, (i - 1) & 1 ? "KEY%03u" : "key%03u", i - 1 );
+        ok( !strcmp( name, expected ), "%u: got %s\n", i - 1, name );
+    }
+
+    /* delete every third subkey while enumerating */
+    for (i = j = 0; i < count; i++)
+    {
+        if (i % 3) continue;
+        sprintf( name, "Key%03u", i );
+        ret = RegDeleteKeyA( key, name );
+        ok( !ret, "RegDeleteKeyA %s failed: %d\n", name, ret );
+        len = sizeof(name);
+        ret = RegEnumKeyExA( key, j++, name, &len, NULL, NULL, NULL, NULL );
+        ok( !ret || ret == ERROR_NO_MORE_ITEMS, "RegEnumKeyExA failed: %d\n", ret );
+    }
+
+    ret = RegQueryInfoKeyA( key, NULL, NULL, NULL, &subkeys, NULL, NULL, NULL, NULL, NULL, NULL, NULL );
+    ok( !ret, "RegQueryInfoKeyA failed: %d\n", ret );
+    ok( subkeys == count - count / 3, "got %u subkeys\n", subkeys );
+
+    for (i = j = 0; i < count; i++)
+    {
+        if (!(i % 3)) continue;
+        len = sizeof(name);
+        ret = RegEnumKeyExA( key, j++, name, &len, NULL, NULL, NULL, NULL );
+        ok( !ret, "RegEnumKeyExA %u failed: %d\n", j - 1, ret );
+        sprintf( expected, i & 1 ? "KEY%03u" : "key%03u", i );
+        ok( !strcmp( name, expected ), "%u: got %s\n", j - 1, name );
+    }
+
+    delete_key( key );
+    RegCloseKey( key );
+}
+
 static void test_symlinks(void)
 {
     static const WCHAR targetW[] = {'\\','S','o','f','t','w','a','r','e','\\','W','i','n','e',
@@ -4159,9 +4329,11 @@ START_TEST(registry)
     test_reg_save_key();
     test_reg_load_key();
     test_reg_unload_key();
+    test_reg_reload_key();
     test_reg_copy_tree();
     test_reg_delete_tree();
     test_rw_order();
+    test_enum_key_order();
     test_deleted_key();
     test_delete_value();
     test_delete_key_value();
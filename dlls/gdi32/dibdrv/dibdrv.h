@@ -224,6 +224,19 @@ extern const primitive_funcs funcs_4    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_1    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_null DECLSPEC_HIDDEN;
 
+/* SIMD versions of some 32bpp row operations; they return the number of pixels processed */
+struct simd_primitives
+{
+    int (*fill_32)( DWORD *dst, int len, DWORD and, DWORD xor );
+    int (*blend_argb)( DWORD *dst, const DWORD *src, int len );
+    int (*blend_argb_alpha)( DWORD *dst, const DWORD *src, int len, BYTE alpha );
+    int (*blend_argb_constant_alpha)( DWORD *dst, const DWORD *src, int len, BYTE alpha, DWORD src_or );
+    int (*draw_glyph_8888)( DWORD *dst, const BYTE *glyph, int len, DWORD text_pixel );
+    int (*draw_subpixel_glyph_8888)( DWORD *dst, const DWORD *glyph, int len, DWORD text_pixel );
+};
+
+extern const struct simd_primitives *get_simd_primitives(void) DECLSPEC_HIDDEN;
+
 struct rop_codes
 {
     DWORD a1, a2, x1, x2;
@@ -266,21 +266,33 @@ static inline void memset_16( WORD *start, WORD val, DWORD size )
 
 static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
 {
+    const struct simd_primitives *simd = get_simd_primitives();
     DWORD *ptr, *start;
-    int x, y, i;
+    int x, y, i, len;
 
     for(i = 0; i < num; i++, rc++)
     {
         assert( !is_rect_empty( rc ));
 
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
-        if (and)
+        len = rc->right - rc->left;
+        if (simd)
+            for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
+            {
+                x = simd->fill_32( start, len, and, xor );
+                if (and)
+                    for(ptr = start + x; x < len; x++)
+                        do_rop_32(ptr++, and, xor);
+                else
+                    memset_32( start + x, xor, len - x );
+            }
+        else if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 for(x = rc->left, ptr = start; x < rc->right; x++)
                     do_rop_32(ptr++, and, xor);
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
-                memset_32( start, xor, rc->right - rc->left );
+                memset_32( start, xor, len );
     }
 }
 
@@ -4654,28 +4666,33 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
+    const struct simd_primitives *simd = get_simd_primitives();
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int x, y, len = rc->right - rc->left;
 
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = simd ? simd->blend_argb( dst_ptr, src_ptr, len ) : 0; x < len; x++)
 		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = simd ? simd->blend_argb_alpha( dst_ptr, src_ptr, len, blend.SourceConstantAlpha ) : 0;
+                     x < len; x++)
 		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     }
     else if (src->compression == BI_RGB)
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = simd ? simd->blend_argb_constant_alpha( dst_ptr, src_ptr, len, blend.SourceConstantAlpha, 0 ) : 0;
+                 x < len; x++)
 		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     else
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = simd ? simd->blend_argb_constant_alpha( dst_ptr, src_ptr, len, blend.SourceConstantAlpha,
+                                                             0xff000000 ) : 0;
+                 x < len; x++)
 		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
 }
 
@@ -6069,17 +6086,23 @@ static inline DWORD aa_rgb( BYTE r_dst, BYTE g_dst, BYTE b_dst, DWORD text, cons
 static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                              const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
+    const struct simd_primitives *simd = get_simd_primitives();
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, end, len = rect->right - rect->left;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = 0; x < len; )
         {
-            if (glyph_ptr[x] <= 1) continue;
-            if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
-            dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
+            /* the SIMD version stops at the next block of 16 pixels that needs anti-aliasing */
+            if (simd) x += simd->draw_glyph_8888( dst_ptr + x, glyph_ptr + x, len - x, text_pixel );
+            for (end = simd ? min( x + 16, len ) : len; x < end; x++)
+            {
+                if (glyph_ptr[x] <= 1) continue;
+                if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
+                dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
+            }
         }
         dst_ptr += dib->stride / 4;
         glyph_ptr += glyph->stride;
@@ -6302,13 +6325,17 @@ static void draw_subpixel_glyph_8888( const dib_info *dib, const RECT *rect, con
                                       const POINT *origin, DWORD text_pixel,
                                       const struct font_gamma_ramp *gamma_ramp )
 {
+    const struct simd_primitives *simd = get_simd_primitives();
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const DWORD *glyph_ptr = get_pixel_ptr_32( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, len = rect->right - rect->left;
+
+    /* the SIMD version doesn't support gamma correction */
+    if (gamma_ramp != NULL && gamma_ramp->gamma != 1000) simd = NULL;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = simd ? simd->draw_subpixel_glyph_8888( dst_ptr, glyph_ptr, len, text_pixel ) : 0; x < len; x++)
         {
             if (glyph_ptr[x] == 0) continue;
             dst_ptr[x] = blend_subpixel( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x],
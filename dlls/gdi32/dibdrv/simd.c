@@ -0,0 +1,406 @@
+/*
+ * DIB driver SIMD primitives.
+ *
+ * Copyright 2020 the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Each kernel handles the beginning of a row and returns the number of
+ * pixels it processed; the caller finishes the row with the scalar code.
+ * The results must be bit-identical to the scalar primitives. Divisions
+ * by 255 use the identity x / 255 == (x + 1 + (x >> 8)) >> 8, which is
+ * exact for all x <= 65152, i.e. for any (a * b + 127) with 8-bit a and b.
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "gdi_private.h"
+#include "dibdrv.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && (__GNUC__ >= 5 || defined(__clang__))
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SSE2_FUNC __attribute__((target("sse2")))
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+/* (x + 127) / 255 for each 16-bit element, x <= 65025 */
+static inline SSE2_FUNC __m128i div255_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ));
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 )), _mm_srli_epi16( x, 8 )), 8 );
+}
+
+/* replicate the alpha channel of two unpacked pixels */
+static inline SSE2_FUNC __m128i alpha_sse2( __m128i x )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, 0xff ), 0xff );
+}
+
+/* pack the 9-bit channel sums of four pixels; like in the scalar code the
+ * overflow of each channel ends up in the low bit of the next one */
+static inline SSE2_FUNC __m128i pack_sums_sse2( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i low = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ));
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+    return _mm_or_si128( low, _mm_slli_epi32( carry, 8 ));
+}
+
+/* src + dst * (255 - src_alpha) / 255 on two unpacked pixels */
+static inline SSE2_FUNC __m128i blend_argb_pixels_sse2( __m128i dst, __m128i src )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha_sse2( src ));
+    return _mm_add_epi16( src, div255_sse2( _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+/* (src * alpha + dst * (255 - alpha)) / 255 on two unpacked pixels */
+static inline SSE2_FUNC __m128i blend_color_sse2( __m128i dst, __m128i src, __m128i alpha )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    return div255_sse2( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+static int SSE2_FUNC fill_32_sse2( DWORD *dst, int len, DWORD and, DWORD xor )
+{
+    const __m128i and_mask = _mm_set1_epi32( and ), xor_mask = _mm_set1_epi32( xor );
+    int x;
+
+    if (and)
+        for (x = 0; x + 4 <= len; x += 4)
+        {
+            __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+            _mm_storeu_si128( (__m128i *)(dst + x), _mm_xor_si128( _mm_and_si128( d, and_mask ), xor_mask ));
+        }
+    else
+        for (x = 0; x + 4 <= len; x += 4)
+            _mm_storeu_si128( (__m128i *)(dst + x), xor_mask );
+    return x;
+}
+
+static int SSE2_FUNC blend_argb_sse2( DWORD *dst, const DWORD *src, int len )
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_argb_pixels_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ));
+        __m128i hi = blend_argb_pixels_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_sums_sse2( lo, hi ));
+    }
+    return x;
+}
+
+static int SSE2_FUNC blend_argb_alpha_sse2( DWORD *dst, const DWORD *src, int len, BYTE alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), src_alpha = _mm_set1_epi16( alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s_lo = div255_sse2( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), src_alpha ));
+        __m128i s_hi = div255_sse2( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), src_alpha ));
+        __m128i lo = blend_argb_pixels_sse2( _mm_unpacklo_epi8( d, zero ), s_lo );
+        __m128i hi = blend_argb_pixels_sse2( _mm_unpackhi_epi8( d, zero ), s_hi );
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_sums_sse2( lo, hi ));
+    }
+    return x;
+}
+
+static int SSE2_FUNC blend_argb_constant_alpha_sse2( DWORD *dst, const DWORD *src, int len,
+                                                     BYTE alpha, DWORD src_or )
+{
+    const __m128i zero = _mm_setzero_si128(), blend_alpha = _mm_set1_epi16( alpha );
+    const __m128i or_mask = _mm_set1_epi32( src_or );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), or_mask );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_color_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ), blend_alpha );
+        __m128i hi = blend_color_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ), blend_alpha );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+/* handle the runs of 16 glyph pixels that are fully transparent or opaque;
+ * stop at the first run that needs anti-aliasing */
+static int SSE2_FUNC draw_glyph_8888_sse2( DWORD *dst, const BYTE *glyph, int len, DWORD text_pixel )
+{
+    const __m128i one = _mm_set1_epi8( 1 ), sixteen = _mm_set1_epi8( 16 );
+    const __m128i text = _mm_set1_epi32( text_pixel );
+    int x, i;
+
+    for (x = 0; x + 16 <= len; x += 16)
+    {
+        __m128i g = _mm_loadu_si128( (const __m128i *)(glyph + x) );
+        __m128i skip = _mm_cmpeq_epi8( _mm_max_epu8( g, one ), one );
+        __m128i solid = _mm_cmpeq_epi8( _mm_min_epu8( g, sixteen ), sixteen );
+        int skip_bits = _mm_movemask_epi8( skip ), solid_bits = _mm_movemask_epi8( solid );
+
+        if (skip_bits == 0xffff) continue;
+        if ((skip_bits | solid_bits) != 0xffff) break;
+
+        for (i = 0; i < 4; i++)
+        {
+            __m128i *ptr = (__m128i *)(dst + x + 4 * i);
+            __m128i mask = _mm_unpacklo_epi8( solid, solid );
+
+            mask = _mm_unpacklo_epi16( mask, mask );
+            _mm_storeu_si128( ptr, _mm_or_si128( _mm_and_si128( mask, text ),
+                                                 _mm_andnot_si128( mask, _mm_loadu_si128( ptr ))));
+            solid = _mm_srli_si128( solid, 4 );
+        }
+    }
+    return x;
+}
+
+static int SSE2_FUNC draw_subpixel_glyph_8888_sse2( DWORD *dst, const DWORD *glyph, int len, DWORD text_pixel )
+{
+    const __m128i zero = _mm_setzero_si128(), rgb_mask = _mm_set1_epi32( 0x00ffffff );
+    const __m128i text = _mm_unpacklo_epi8( _mm_set1_epi32( text_pixel ), zero );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i g = _mm_loadu_si128( (const __m128i *)(glyph + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_color_sse2( _mm_unpacklo_epi8( d, zero ), text, _mm_unpacklo_epi8( g, zero ));
+        __m128i hi = blend_color_sse2( _mm_unpackhi_epi8( d, zero ), text, _mm_unpackhi_epi8( g, zero ));
+        __m128i res = _mm_and_si128( _mm_packus_epi16( lo, hi ), rgb_mask );
+        __m128i keep = _mm_cmpeq_epi32( g, zero );
+
+        res = _mm_or_si128( _mm_and_si128( keep, d ), _mm_andnot_si128( keep, res ));
+        _mm_storeu_si128( (__m128i *)(dst + x), res );
+    }
+    return x;
+}
+
+static const struct simd_primitives sse2_primitives =
+{
+    fill_32_sse2,
+    blend_argb_sse2,
+    blend_argb_alpha_sse2,
+    blend_argb_constant_alpha_sse2,
+    draw_glyph_8888_sse2,
+    draw_subpixel_glyph_8888_sse2
+};
+
+/* AVX2 versions of the above, processing eight pixels at a time. Unpacking and
+ * packing both work within 128-bit lanes, so the pixel order is preserved. */
+
+static inline AVX2_FUNC __m256i div255_avx2( __m256i x )
+{
+    x = _mm256_add_epi16( x, _mm256_set1_epi16( 127 ));
+    return _mm256_srli_epi16( _mm256_add_epi16( _mm256_add_epi16( x, _mm256_set1_epi16( 1 )),
+                                                _mm256_srli_epi16( x, 8 )), 8 );
+}
+
+static inline AVX2_FUNC __m256i alpha_avx2( __m256i x )
+{
+    return _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( x, 0xff ), 0xff );
+}
+
+static inline AVX2_FUNC __m256i pack_sums_avx2( __m256i lo, __m256i hi )
+{
+    const __m256i mask = _mm256_set1_epi16( 0xff );
+    __m256i low = _mm256_packus_epi16( _mm256_and_si256( lo, mask ), _mm256_and_si256( hi, mask ));
+    __m256i carry = _mm256_packus_epi16( _mm256_srli_epi16( lo, 8 ), _mm256_srli_epi16( hi, 8 ));
+    return _mm256_or_si256( low, _mm256_slli_epi32( carry, 8 ));
+}
+
+static inline AVX2_FUNC __m256i blend_argb_pixels_avx2( __m256i dst, __m256i src )
+{
+    __m256i inv_alpha = _mm256_sub_epi16( _mm256_set1_epi16( 255 ), alpha_avx2( src ));
+    return _mm256_add_epi16( src, div255_avx2( _mm256_mullo_epi16( dst, inv_alpha )));
+}
+
+static inline AVX2_FUNC __m256i blend_color_avx2( __m256i dst, __m256i src, __m256i alpha )
+{
+    __m256i inv_alpha = _mm256_sub_epi16( _mm256_set1_epi16( 255 ), alpha );
+    return div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( src, alpha ), _mm256_mullo_epi16( dst, inv_alpha )));
+}
+
+static int AVX2_FUNC fill_32_avx2( DWORD *dst, int len, DWORD and, DWORD xor )
+{
+    const __m256i and_mask = _mm256_set1_epi32( and ), xor_mask = _mm256_set1_epi32( xor );
+    int x;
+
+    if (and)
+        for (x = 0; x + 8 <= len; x += 8)
+        {
+            __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+            _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_xor_si256( _mm256_and_si256( d, and_mask ), xor_mask ));
+        }
+    else
+        for (x = 0; x + 8 <= len; x += 8)
+            _mm256_storeu_si256( (__m256i *)(dst + x), xor_mask );
+    return x;
+}
+
+static int AVX2_FUNC blend_argb_avx2( DWORD *dst, const DWORD *src, int len )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i lo = blend_argb_pixels_avx2( _mm256_unpacklo_epi8( d, zero ), _mm256_unpacklo_epi8( s, zero ));
+        __m256i hi = blend_argb_pixels_avx2( _mm256_unpackhi_epi8( d, zero ), _mm256_unpackhi_epi8( s, zero ));
+        _mm256_storeu_si256( (__m256i *)(dst + x), pack_sums_avx2( lo, hi ));
+    }
+    return x;
+}
+
+static int AVX2_FUNC blend_argb_alpha_avx2( DWORD *dst, const DWORD *src, int len, BYTE alpha )
+{
+    const __m256i zero = _mm256_setzero_si256(), src_alpha = _mm256_set1_epi16( alpha );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i s_lo = div255_avx2( _mm256_mullo_epi16( _mm256_unpacklo_epi8( s, zero ), src_alpha ));
+        __m256i s_hi = div255_avx2( _mm256_mullo_epi16( _mm256_unpackhi_epi8( s, zero ), src_alpha ));
+        __m256i lo = blend_argb_pixels_avx2( _mm256_unpacklo_epi8( d, zero ), s_lo );
+        __m256i hi = blend_argb_pixels_avx2( _mm256_unpackhi_epi8( d, zero ), s_hi );
+        _mm256_storeu_si256( (__m256i *)(dst + x), pack_sums_avx2( lo, hi ));
+    }
+    return x;
+}
+
+static int AVX2_FUNC blend_argb_constant_alpha_avx2( DWORD *dst, const DWORD *src, int len,
+                                                     BYTE alpha, DWORD src_or )
+{
+    const __m256i zero = _mm256_setzero_si256(), blend_alpha = _mm256_set1_epi16( alpha );
+    const __m256i or_mask = _mm256_set1_epi32( src_or );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_or_si256( _mm256_loadu_si256( (const __m256i *)(src + x) ), or_mask );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i lo = blend_color_avx2( _mm256_unpacklo_epi8( d, zero ), _mm256_unpacklo_epi8( s, zero ), blend_alpha );
+        __m256i hi = blend_color_avx2( _mm256_unpackhi_epi8( d, zero ), _mm256_unpackhi_epi8( s, zero ), blend_alpha );
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+static int AVX2_FUNC draw_subpixel_glyph_8888_avx2( DWORD *dst, const DWORD *glyph, int len, DWORD text_pixel )
+{
+    const __m256i zero = _mm256_setzero_si256(), rgb_mask = _mm256_set1_epi32( 0x00ffffff );
+    const __m256i text = _mm256_unpacklo_epi8( _mm256_set1_epi32( text_pixel ), zero );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i g = _mm256_loadu_si256( (const __m256i *)(glyph + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i lo = blend_color_avx2( _mm256_unpacklo_epi8( d, zero ), text, _mm256_unpacklo_epi8( g, zero ));
+        __m256i hi = blend_color_avx2( _mm256_unpackhi_epi8( d, zero ), text, _mm256_unpackhi_epi8( g, zero ));
+        __m256i res = _mm256_and_si256( _mm256_packus_epi16( lo, hi ), rgb_mask );
+
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_blendv_epi8( res, d, _mm256_cmpeq_epi32( g, zero )));
+    }
+    return x;
+}
+
+static const struct simd_primitives avx2_primitives =
+{
+    fill_32_avx2,
+    blend_argb_avx2,
+    blend_argb_alpha_avx2,
+    blend_argb_constant_alpha_avx2,
+    draw_glyph_8888_sse2,
+    draw_subpixel_glyph_8888_avx2
+};
+
+static BOOL have_avx2(void)
+{
+    unsigned int eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+
+    if (__get_cpuid_max( 0, NULL ) < 7) return FALSE;
+    __cpuid( 1, eax, ebx, ecx, edx );
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) return FALSE;
+    /* make sure that the OS saves the ymm registers */
+    __asm__ __volatile__( "xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0) );
+    if ((xcr0_lo & 6) != 6) return FALSE;
+    __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+    return !!(ebx & bit_AVX2);
+}
+
+static const struct simd_primitives *init_simd_primitives(void)
+{
+    if (have_avx2())
+    {
+        TRACE( "using AVX2 primitives\n" );
+        return &avx2_primitives;
+    }
+    if (IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE ))
+    {
+        TRACE( "using SSE2 primitives\n" );
+        return &sse2_primitives;
+    }
+    return NULL;
+}
+
+#else  /* __GNUC__ && (__i386__ || __x86_64__) */
+
+static const struct simd_primitives *init_simd_primitives(void)
+{
+    return NULL;
+}
+
+#endif  /* __GNUC__ && (__i386__ || __x86_64__) */
+
+/***********************************************************************
+ *           get_simd_primitives
+ *
+ * Return the SIMD kernels supported by the CPU, or NULL if there are none.
+ */
+const struct simd_primitives *get_simd_primitives(void)
+{
+    static const struct simd_primitives *simd;
+    static BOOL initialized;
+
+    if (!initialized)
+    {
+        simd = init_simd_primitives();
+        initialized = TRUE;
+    }
+    return simd;
+}
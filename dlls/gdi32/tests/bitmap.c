@@ -4093,6 +4093,190 @@ static void test_32bit_ddb(void)
     DeleteDC(hdcScreen);
 }
 
+/* blending and filling whole rows must give the same result as doing it one pixel at a time */
+static void test_32bpp_rows(void)
+{
+    static const BYTE constant_alpha[] = { 255, 128, 1 };
+    static const BYTE alpha_format[] = { AC_SRC_ALPHA, 0 };
+    char buffer[sizeof(BITMAPINFOHEADER) + sizeof(DWORD)];
+    BITMAPINFO *bi = (BITMAPINFO *)buffer;
+    DWORD dst_init[40], expect[40], *dst_bits, *src_bits;
+    HBITMAP bmp_dst, bmp_src, old_dst, old_src;
+    HBRUSH brush, old_brush;
+    BLENDFUNCTION blend;
+    HDC hdc_dst, hdc_src;
+    int i, j, x, width;
+
+    memset( bi, 0, sizeof(BITMAPINFOHEADER) );
+    bi->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi->bmiHeader.biWidth = 40;
+    bi->bmiHeader.biHeight = -1;
+    bi->bmiHeader.biPlanes = 1;
+    bi->bmiHeader.biBitCount = 32;
+    bi->bmiHeader.biCompression = BI_RGB;
+
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, bi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    old_dst = SelectObject( hdc_dst, bmp_dst );
+    hdc_src = CreateCompatibleDC( 0 );
+    bmp_src = CreateDIBSection( hdc_src, bi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    old_src = SelectObject( hdc_src, bmp_src );
+
+    for (x = 0; x < 40; x++)
+    {
+        BYTE alpha = x * 37 + 11, level = x * 29 + 100;
+
+        dst_init[x] = (BYTE)(x * 73 + 5) << 24 | level << 16 | level << 8 | level;
+        /* premultiplied source, with a few fully transparent and opaque pixels */
+        src_bits[x] = (DWORD)alpha << 24 | (alpha * x / 40) << 16 | (alpha * (40 - x) / 40) << 8 | alpha / 2;
+    }
+    src_bits[3] = 0;
+    src_bits[17] = 0xff102030;
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+    if (pGdiAlphaBlend)
+    {
+        for (i = 0; i < ARRAY_SIZE(alpha_format) * ARRAY_SIZE(constant_alpha); i++)
+        {
+            j = i % ARRAY_SIZE(constant_alpha);
+            blend.AlphaFormat = alpha_format[i / ARRAY_SIZE(constant_alpha)];
+            blend.SourceConstantAlpha = constant_alpha[j];
+
+            memcpy( dst_bits, dst_init, sizeof(dst_init) );
+            for (x = 0; x < 40; x++)
+                pGdiAlphaBlend( hdc_dst, x, 0, 1, 1, hdc_src, x, 0, 1, 1, blend );
+            memcpy( expect, dst_bits, sizeof(expect) );
+
+            for (width = 1; width <= 37; width++)
+            {
+                memcpy( dst_bits, dst_init, sizeof(dst_init) );
+                pGdiAlphaBlend( hdc_dst, 3, 0, width, 1, hdc_src, 3, 0, width, 1, blend );
+                for (x = 0; x < 40; x++)
+                {
+                    DWORD color = (x >= 3 && x < 3 + width) ? expect[x] : dst_init[x];
+                    if (dst_bits[x] != color) break;
+                }
+                ok( x == 40, "format %x alpha %u width %d: got %08x instead of %08x at %d\n",
+                    blend.AlphaFormat, blend.SourceConstantAlpha, width, dst_bits[x],
+                    (x >= 3 && x < 3 + width) ? expect[x] : dst_init[x], x );
+            }
+        }
+    }
+    else win_skip( "GdiAlphaBlend() is not implemented\n" );
+
+    brush = CreateSolidBrush( RGB( 0x12, 0x34, 0x56 ));
+    old_brush = SelectObject( hdc_dst, brush );
+    for (width = 1; width <= 37; width++)
+    {
+        memcpy( dst_bits, dst_init, sizeof(dst_init) );
+        PatBlt( hdc_dst, 2, 0, width, 1, PATINVERT );
+        for (x = 0; x < 40; x++)
+        {
+            DWORD color = (x >= 2 && x < 2 + width) ? dst_init[x] ^ 0x123456 : dst_init[x];
+            ok( dst_bits[x] == color, "width %d: got %08x instead of %08x at %d\n", width, dst_bits[x], color, x );
+            if (dst_bits[x] != color) break;
+        }
+
+        memcpy( dst_bits, dst_init, sizeof(dst_init) );
+        PatBlt( hdc_dst, 1, 0, width, 1, PATCOPY );
+        for (x = 0; x < 40; x++)
+        {
+            DWORD color = (x >= 1 && x < 1 + width) ? 0x123456 : dst_init[x];
+            ok( dst_bits[x] == color, "width %d: got %08x instead of %08x at %d\n", width, dst_bits[x], color, x );
+            if (dst_bits[x] != color) break;
+        }
+    }
+    SelectObject( hdc_dst, old_brush );
+    DeleteObject( brush );
+
+    SelectObject( hdc_dst, old_dst );
+    DeleteObject( bmp_dst );
+    DeleteDC( hdc_dst );
+    SelectObject( hdc_src, old_src );
+    DeleteObject( bmp_src );
+    DeleteDC( hdc_src );
+}
+
+/* drawing glyphs on whole rows must give the same result as doing it one column at a time */
+static void test_32bpp_glyph_rows(void)
+{
+    static const BYTE qualities[] = { ANTIALIASED_QUALITY, CLEARTYPE_QUALITY };
+    static const char text[] = "Wine @#MW";
+    char buffer[sizeof(BITMAPINFOHEADER) + sizeof(DWORD)];
+    BITMAPINFO *bi = (BITMAPINFO *)buffer;
+    DWORD *dst_init, *expect, *dst_bits;
+    HBITMAP bmp, old_bmp;
+    HFONT font, old_font;
+    LOGFONTA lf;
+    HRGN rgn;
+    HDC hdc;
+    int i, x, count, size = 160 * 48;
+
+    memset( bi, 0, sizeof(BITMAPINFOHEADER) );
+    bi->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi->bmiHeader.biWidth = 160;
+    bi->bmiHeader.biHeight = -48;
+    bi->bmiHeader.biPlanes = 1;
+    bi->bmiHeader.biBitCount = 32;
+    bi->bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC( 0 );
+    bmp = CreateDIBSection( hdc, bi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    old_bmp = SelectObject( hdc, bmp );
+    dst_init = HeapAlloc( GetProcessHeap(), 0, size * sizeof(DWORD) );
+    expect = HeapAlloc( GetProcessHeap(), 0, size * sizeof(DWORD) );
+    for (i = 0; i < size; i++) dst_init[i] = (i * 0x010305) ^ (i % 160 * 0x1f0d07);
+
+    SetTextColor( hdc, RGB( 0x20, 0xc0, 0x80 ));
+    SetBkMode( hdc, TRANSPARENT );
+    rgn = CreateRectRgn( 0, 0, 1, 48 );
+
+    for (i = 0; i < ARRAY_SIZE(qualities); i++)
+    {
+        memset( &lf, 0, sizeof(lf) );
+        lf.lfHeight = -40;
+        lf.lfWeight = FW_BOLD;
+        lf.lfQuality = qualities[i];
+        strcpy( lf.lfFaceName, "Tahoma" );
+        font = CreateFontIndirectA( &lf );
+        old_font = SelectObject( hdc, font );
+
+        /* a column is too narrow for the SIMD versions */
+        memcpy( dst_bits, dst_init, size * sizeof(DWORD) );
+        for (x = 0; x < 160; x++)
+        {
+            SetRectRgn( rgn, x, 0, x + 1, 48 );
+            SelectClipRgn( hdc, rgn );
+            TextOutA( hdc, 2, 2, text, strlen(text) );
+        }
+        SelectClipRgn( hdc, NULL );
+        memcpy( expect, dst_bits, size * sizeof(DWORD) );
+        ok( memcmp( expect, dst_init, size * sizeof(DWORD) ), "quality %u: nothing drawn\n", qualities[i] );
+
+        memcpy( dst_bits, dst_init, size * sizeof(DWORD) );
+        TextOutA( hdc, 2, 2, text, strlen(text) );
+        for (x = count = 0; x < size; x++)
+        {
+            if (dst_bits[x] == expect[x]) continue;
+            if (!count++)
+                ok( 0, "quality %u: got %08x instead of %08x at %d,%d\n",
+                    qualities[i], dst_bits[x], expect[x], x % 160, x / 160 );
+        }
+        ok( !count, "quality %u: %d pixels differ\n", qualities[i], count );
+
+        SelectObject( hdc, old_font );
+        DeleteObject( font );
+    }
+
+    DeleteObject( rgn );
+    HeapFree( GetProcessHeap(), 0, dst_init );
+    HeapFree( GetProcessHeap(), 0, expect );
+    SelectObject( hdc, old_bmp );
+    DeleteObject( bmp );
+    DeleteDC( hdc );
+}
+
 /*
  * Used by test_GetDIBits_top_down to create the bitmap to test against.
  */
@@ -5967,6 +6151,8 @@ START_TEST(bitmap)
     test_GdiAlphaBlend();
     test_GdiGradientFill();
     test_32bit_ddb();
+    test_32bpp_rows();
+    test_32bpp_glyph_rows();
     test_bitmapinfoheadersize();
     test_get16dibits();
     test_clipping();
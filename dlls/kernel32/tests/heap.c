@@ -889,6 +889,112 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+#define HEAP_THREAD_COUNT  4
+#define HEAP_THREAD_BLOCKS 64
+#define HEAP_THREAD_LOOPS  10000
+
+struct heap_thread_params
+{
+    HANDLE heap;
+    BYTE   pattern;
+    BOOL   failed;
+};
+
+static DWORD WINAPI heap_thread_proc( void *arg )
+{
+    struct heap_thread_params *params = arg;
+    BYTE *blocks[HEAP_THREAD_BLOCKS] = { 0 };
+    SIZE_T sizes[HEAP_THREAD_BLOCKS];
+    unsigned int i, j, seed = params->pattern;
+
+    for (i = 0; i < HEAP_THREAD_LOOPS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        j = (seed >> 16) % HEAP_THREAD_BLOCKS;
+        if (blocks[j])
+        {
+            if (blocks[j][0] != params->pattern || blocks[j][sizes[j] - 1] != params->pattern)
+                params->failed = TRUE;
+            HeapFree( params->heap, 0, blocks[j] );
+            blocks[j] = NULL;
+        }
+        else
+        {
+            sizes[j] = 1 + (seed >> 8) % 300;
+            if (!(blocks[j] = HeapAlloc( params->heap, 0, sizes[j] )))
+            {
+                params->failed = TRUE;
+                break;
+            }
+            memset( blocks[j], params->pattern, sizes[j] );
+        }
+    }
+    for (j = 0; j < HEAP_THREAD_BLOCKS; j++) HeapFree( params->heap, 0, blocks[j] );
+    return 0;
+}
+
+static void test_heap_threads(void)
+{
+    struct heap_thread_params params[HEAP_THREAD_COUNT];
+    HANDLE threads[HEAP_THREAD_COUNT];
+    PROCESS_HEAP_ENTRY entry;
+    ULONG info = 2;
+    DWORD count;
+    HANDLE heap;
+    BOOL ret;
+    void *p;
+    int i;
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    if (!heap) return;
+
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( ret, "HeapSetInformation failed %u\n", GetLastError() );
+    info = 0xdeadbeef;
+    ret = HeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation failed %u\n", GetLastError() );
+    ok( info == 2, "got %u\n", info );
+
+    for (i = 0; i < HEAP_THREAD_COUNT; i++)
+    {
+        params[i].heap = heap;
+        params[i].pattern = 0x11 * (i + 1);
+        params[i].failed = FALSE;
+        threads[i] = CreateThread( NULL, 0, heap_thread_proc, &params[i], 0, NULL );
+        ok( threads[i] != NULL, "CreateThread failed %u\n", GetLastError() );
+    }
+    WaitForMultipleObjects( HEAP_THREAD_COUNT, threads, TRUE, INFINITE );
+    for (i = 0; i < HEAP_THREAD_COUNT; i++)
+    {
+        ok( !params[i].failed, "thread %u failed\n", i );
+        CloseHandle( threads[i] );
+    }
+    ret = HeapValidate( heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+
+    p = HeapAlloc( heap, 0, 20 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+    ret = HeapValidate( heap, 0, p );
+    ok( ret, "HeapValidate failed\n" );
+    ret = HeapFree( heap, 0, p );
+    ok( ret, "HeapFree failed\n" );
+
+    count = 0;
+    memset( &entry, 0, sizeof(entry) );
+    while (HeapWalk( heap, &entry ))
+        if (entry.wFlags & PROCESS_HEAP_ENTRY_BUSY) count++;
+    ok( GetLastError() == ERROR_NO_MORE_ITEMS, "HeapWalk failed %u\n", GetLastError() );
+    ok( count < HEAP_THREAD_COUNT * HEAP_THREAD_BLOCKS, "got %u busy blocks\n", count );
+
+    /* release the cached blocks and the subheaps grown by the threads */
+    HeapCompact( heap, 0 );
+    ret = HeapValidate( heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+    ret = HeapDestroy( heap );
+    ok( ret, "HeapDestroy failed\n" );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1351,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_heap_threads();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
@@ -59,6 +59,7 @@ static NTSTATUS (WINAPI *pNtCreateSection)(HANDLE *, ACCESS_MASK, const OBJECT_A
 static NTSTATUS (WINAPI *pNtQuerySection)(HANDLE, SECTION_INFORMATION_CLASS, void *, SIZE_T, SIZE_T *);
 static NTSTATUS (WINAPI *pNtMapViewOfSection)(HANDLE, HANDLE, PVOID *, ULONG_PTR, SIZE_T, const LARGE_INTEGER *, SIZE_T *, ULONG, ULONG, ULONG);
 static NTSTATUS (WINAPI *pNtUnmapViewOfSection)(HANDLE, PVOID);
+static NTSTATUS (WINAPI *pNtQueryVirtualMemory)(HANDLE, LPCVOID, MEMORY_INFORMATION_CLASS, PVOID, SIZE_T, SIZE_T *);
 static NTSTATUS (WINAPI *pNtQueryInformationProcess)(HANDLE, PROCESSINFOCLASS, PVOID, ULONG, PULONG);
 static NTSTATUS (WINAPI *pNtSetInformationProcess)(HANDLE, PROCESSINFOCLASS, PVOID, ULONG);
 static NTSTATUS (WINAPI *pNtTerminateProcess)(HANDLE, DWORD);
@@ -2214,6 +2215,498 @@ static void test_import_resolution(void)
     }
 }
 
+#define RELOC_IMAGE_BASE 0x12340000
+
+struct relocs
+{
+    IMAGE_BASE_RELOCATION rel;
+    WORD relocs[2];
+    char *ptr;
+    char target[8];
+};
+
+/* check that a page of a module is mapped from a file and not private to the process */
+static void check_shared_page( void *addr, BOOL other_process )
+{
+    MEMORY_WORKING_SET_EX_INFORMATION info;
+    NTSTATUS status;
+
+    info.VirtualAddress = addr;
+    status = pNtQueryVirtualMemory( GetCurrentProcess(), NULL, MemoryWorkingSetExInformation,
+                                    &info, sizeof(info), NULL );
+    ok( !status, "NtQueryVirtualMemory failed %x\n", status );
+    ok( info.VirtualAttributes.s.Valid, "page %p not valid\n", addr );
+    ok( info.VirtualAttributes.s.Shared, "page %p not shared\n", addr );
+    ok( info.VirtualAttributes.s.ShareCount >= (other_process ? 2 : 1), "page %p share count %u\n",
+        addr, (UINT)info.VirtualAttributes.s.ShareCount );
+}
+
+static void check_relocated_module( HMODULE mod )
+{
+    struct relocs *ptr = (struct relocs *)((char *)mod + page_size);
+    ULONG_PTR *tail = (ULONG_PTR *)((char *)mod + 2 * page_size) - 1;
+    IMAGE_NT_HEADERS *nt = pRtlImageNtHeader( mod );
+
+    ok( nt->OptionalHeader.ImageBase == (ULONG_PTR)mod, "wrong image base %p\n",
+        (void *)nt->OptionalHeader.ImageBase );
+    ok( ptr->ptr == ptr->target, "pointer not relocated, got %p instead of %p\n", ptr->ptr, ptr->target );
+    ok( !strcmp( ptr->ptr, "target" ), "wrong data %s\n", debugstr_a(ptr->ptr) );
+    ok( *tail == (ULONG_PTR)mod - RELOC_IMAGE_BASE, "end of section not relocated, got %p\n", (void *)*tail );
+}
+
+/* load the relocated dll in a child process at the same base as its parent */
+static void relocations_child( const char *dll_name, HMODULE parent_mod )
+{
+    HANDLE loaded_event, done_event;
+    void *reserved;
+    HMODULE mod;
+
+    loaded_event = OpenEventA( EVENT_ALL_ACCESS, FALSE, "winetest_loader_reloc_loaded" );
+    done_event = OpenEventA( EVENT_ALL_ACCESS, FALSE, "winetest_loader_reloc_done" );
+    reserved = VirtualAlloc( (void *)RELOC_IMAGE_BASE, 2 * page_size, MEM_RESERVE, PAGE_NOACCESS );
+
+    mod = LoadLibraryA( dll_name );
+    ok( mod != NULL, "failed to load err %u\n", GetLastError() );
+    if (mod)
+    {
+        check_relocated_module( mod );
+        if (mod == parent_mod) check_shared_page( (char *)mod + page_size, TRUE );
+        else skip( "loaded at %p instead of %p\n", mod, parent_mod );
+    }
+    SetEvent( loaded_event );
+    WaitForSingleObject( done_event, 10000 );
+
+    if (mod) FreeLibrary( mod );
+    VirtualFree( reserved, 0, MEM_RELEASE );
+    CloseHandle( loaded_event );
+    CloseHandle( done_event );
+}
+
+static void test_relocations(void)
+{
+    char temp_path[MAX_PATH];
+    char dll_name[MAX_PATH];
+    char cmdline[MAX_PATH * 2];
+    char **argv;
+    DWORD dummy;
+    void *reserved;
+    HANDLE hfile, loaded_event, done_event;
+    HMODULE mod;
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    struct relocs data;
+    IMAGE_NT_HEADERS nt;
+    IMAGE_SECTION_HEADER section;
+    BOOL ret;
+
+#define DATA_RVA(ptr) (page_size + ((char *)(ptr) - (char *)&data))
+    nt = nt_header_template;
+    nt.FileHeader.NumberOfSections = 1;
+    nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+    nt.OptionalHeader.SectionAlignment = page_size;
+    nt.OptionalHeader.FileAlignment = 0x200;
+    nt.OptionalHeader.ImageBase = RELOC_IMAGE_BASE;
+    nt.OptionalHeader.SizeOfImage = 2 * page_size;
+    nt.OptionalHeader.SizeOfHeaders = nt.OptionalHeader.FileAlignment;
+    /* relocated pages are only shared between processes for ASLR images on Windows */
+    nt.OptionalHeader.DllCharacteristics |= IMAGE_DLLCHARACTERISTICS_DYNAMIC_BASE;
+    nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    memset( nt.OptionalHeader.DataDirectory, 0, sizeof(nt.OptionalHeader.DataDirectory) );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size = sizeof(data.rel) + sizeof(data.relocs);
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress = DATA_RVA( &data.rel );
+
+    memset( &data, 0, sizeof(data) );
+    data.rel.VirtualAddress = page_size;
+    data.rel.SizeOfBlock = sizeof(data.rel) + sizeof(data.relocs);
+    /* the second relocation is in the end of the section, past its raw data */
+#ifdef _WIN64
+    data.relocs[0] = (IMAGE_REL_BASED_DIR64 << 12) | (DATA_RVA( &data.ptr ) - page_size);
+    data.relocs[1] = (IMAGE_REL_BASED_DIR64 << 12) | (page_size - sizeof(ULONG_PTR));
+#else
+    data.relocs[0] = (IMAGE_REL_BASED_HIGHLOW << 12) | (DATA_RVA( &data.ptr ) - page_size);
+    data.relocs[1] = (IMAGE_REL_BASED_HIGHLOW << 12) | (page_size - sizeof(ULONG_PTR));
+#endif
+    data.ptr = (char *)nt.OptionalHeader.ImageBase + DATA_RVA( data.target );
+    strcpy( data.target, "target" );
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "ldr", 0, dll_name);
+
+    hfile = CreateFileA(dll_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, 0);
+    ok( hfile != INVALID_HANDLE_VALUE, "creation failed\n" );
+
+    memset( &section, 0, sizeof(section) );
+    memcpy( section.Name, ".data", sizeof(".data") );
+    section.PointerToRawData = nt.OptionalHeader.FileAlignment;
+    section.VirtualAddress = nt.OptionalHeader.SectionAlignment;
+    section.Misc.VirtualSize = page_size;
+    section.SizeOfRawData = sizeof(data);
+    section.Characteristics = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE;
+
+    WriteFile(hfile, &dos_header, sizeof(dos_header), &dummy, NULL);
+    WriteFile(hfile, &nt, sizeof(nt), &dummy, NULL);
+    WriteFile(hfile, &section, sizeof(section), &dummy, NULL);
+
+    SetFilePointer( hfile, section.PointerToRawData, NULL, SEEK_SET );
+    WriteFile(hfile, &data, sizeof(data), &dummy, NULL);
+
+    CloseHandle( hfile );
+
+    /* make sure the dll can't be loaded at its preferred base */
+    reserved = VirtualAlloc( (void *)nt.OptionalHeader.ImageBase, nt.OptionalHeader.SizeOfImage,
+                             MEM_RESERVE, PAGE_NOACCESS );
+    ok( reserved != NULL, "VirtualAlloc failed err %u\n", GetLastError() );
+
+    mod = LoadLibraryA( dll_name );
+    ok( mod != NULL, "failed to load err %u\n", GetLastError() );
+    if (mod)
+    {
+        ok( mod != reserved, "loaded at preferred base %p\n", mod );
+        check_relocated_module( mod );
+        check_shared_page( (char *)mod + page_size, FALSE );
+
+        /* the relocated pages are shared with a process loading the dll at the same base */
+        loaded_event = CreateEventA( NULL, FALSE, FALSE, "winetest_loader_reloc_loaded" );
+        done_event = CreateEventA( NULL, FALSE, FALSE, "winetest_loader_reloc_done" );
+        winetest_get_mainargs( &argv );
+        sprintf( cmdline, "\"%s\" loader relocations %s %p", argv[0], dll_name, mod );
+        ret = CreateProcessA( argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+        ok( ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError() );
+        if (ret)
+        {
+            ok( !WaitForSingleObject( loaded_event, 10000 ), "child process didn't load the dll\n" );
+            check_shared_page( (char *)mod + page_size, TRUE );
+            SetEvent( done_event );
+            wait_child_process( pi.hProcess );
+            CloseHandle( pi.hThread );
+            CloseHandle( pi.hProcess );
+        }
+        CloseHandle( loaded_event );
+        CloseHandle( done_event );
+        FreeLibrary( mod );
+    }
+
+    VirtualFree( reserved, 0, MEM_RELEASE );
+    DeleteFileA( dll_name );
+#undef DATA_RVA
+}
+
+/* write the init order of the modules of the process, check that the imports of the exe are attached */
+static void prefetch_child( int index )
+{
+    PEB_LDR_DATA *ldr = NtCurrentTeb()->Peb->LdrData;
+    LIST_ENTRY *entry, *mark;
+    LDR_DATA_TABLE_ENTRY *module;
+    const IMAGE_IMPORT_DESCRIPTOR *imports;
+    HMODULE exe = GetModuleHandleA( NULL ), mod;
+    HANDLE mapping;
+    WCHAR *view, *order, *end;
+    ULONG size;
+
+    mapping = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, "winetest_loader_prefetch" );
+    ok( mapping != 0, "OpenFileMapping failed err %u\n", GetLastError() );
+    view = MapViewOfFile( mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 );
+    ok( view != NULL, "MapViewOfFile failed err %u\n", GetLastError() );
+    if (!view) return;
+    order = view + index * page_size / sizeof(WCHAR);
+    end = order + page_size / sizeof(WCHAR) - 1;
+
+    imports = pRtlImageDirectoryEntryToData( exe, TRUE, IMAGE_DIRECTORY_ENTRY_IMPORT, &size );
+    for ( ; imports && imports->Name; imports++)
+    {
+        const char *name = (const char *)exe + imports->Name;
+
+        mod = GetModuleHandleA( name );
+        ok( mod != NULL, "%s not loaded\n", name );
+        mark = &ldr->InLoadOrderModuleList;
+        for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+        {
+            module = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
+            if (module->DllBase != mod) continue;
+            ok( module->Flags & LDR_PROCESS_ATTACHED, "%s not attached, flags %#x\n", name, module->Flags );
+            break;
+        }
+        ok( entry != mark, "%s not in the load order list\n", name );
+    }
+
+    mark = &ldr->InInitializationOrderModuleList;
+    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    {
+        module = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InInitializationOrderLinks );
+        size = module->BaseDllName.Length / sizeof(WCHAR);
+        if (order + size + 1 > end) break;
+        memcpy( order, module->BaseDllName.Buffer, size * sizeof(WCHAR) );
+        order += size;
+        *order++ = ' ';
+    }
+    ok( entry == mark, "init order list too long\n" );
+    *order = 0;
+
+    UnmapViewOfFile( view );
+    CloseHandle( mapping );
+}
+
+/* count the thread notifications received by a dll imported by an exe, the exe exits with the count */
+static void test_import_prefetch_threads(void)
+{
+#if defined(__i386__) || defined(__x86_64__) || defined(__aarch64__)
+#ifdef __x86_64__
+    static const BYTE dll_code[] =
+    {
+        0x8d, 0x42, 0xfe,                   /* lea -2(%rdx),%eax */
+        0x83, 0xf8, 0x01,                   /* cmp $1,%eax */
+        0x77, 0x07,                         /* ja 1f */
+        0xf0, 0xff, 0x05, 0, 0, 0, 0,       /* lock incl count(%rip) */
+        0xb8, 0x01, 0x00, 0x00, 0x00,       /* 1: mov $1,%eax */
+        0xc3,                               /* ret */
+    };
+    static const BYTE exe_code[] =
+    {
+        0x48, 0x83, 0xec, 0x28,             /* sub $0x28,%rsp */
+        0x48, 0x8b, 0x05, 0, 0, 0, 0,       /* mov count_thunk(%rip),%rax */
+        0x8b, 0x08,                         /* mov (%rax),%ecx */
+        0xff, 0x15, 0, 0, 0, 0,             /* call *exit_thunk(%rip) */
+    };
+    const DWORD dll_count_offset = 11, exe_count_offset = 7, exe_exit_offset = 15;
+#elif defined(__i386__)
+    static const BYTE dll_code[] =
+    {
+        0x8b, 0x44, 0x24, 0x08,             /* mov 8(%esp),%eax */
+        0x83, 0xe8, 0x02,                   /* sub $2,%eax */
+        0x83, 0xf8, 0x01,                   /* cmp $1,%eax */
+        0x77, 0x07,                         /* ja 1f */
+        0xf0, 0xff, 0x05, 0, 0, 0, 0,       /* lock incl count */
+        0xb8, 0x01, 0x00, 0x00, 0x00,       /* 1: mov $1,%eax */
+        0xc2, 0x0c, 0x00,                   /* ret $12 */
+    };
+    static const BYTE exe_code[] =
+    {
+        0xa1, 0, 0, 0, 0,                   /* mov count_thunk,%eax */
+        0xff, 0x30,                         /* push (%eax) */
+        0xff, 0x15, 0, 0, 0, 0,             /* call *exit_thunk */
+    };
+    const DWORD dll_count_offset = 15, exe_count_offset = 1, exe_exit_offset = 9;
+#else
+    static const DWORD dll_code[] =
+    {
+        0x51000829,                         /* sub w9, w1, #2 */
+        0x7100053f,                         /* cmp w9, #1 */
+        0x540000a8,                         /* b.hi 1f */
+        0x1000000a,                         /* adr x10, count */
+        0xb940014b,                         /* ldr w11, [x10] */
+        0x1100056b,                         /* add w11, w11, #1 */
+        0xb900014b,                         /* str w11, [x10] */
+        0x52800020,                         /* 1: mov w0, #1 */
+        0xd65f03c0,                         /* ret */
+    };
+    static const DWORD exe_code[] =
+    {
+        0x58000010,                         /* ldr x16, count_thunk */
+        0xb9400200,                         /* ldr w0, [x16] */
+        0x58000010,                         /* ldr x16, exit_thunk */
+        0xd63f0200,                         /* blr x16 */
+    };
+    const DWORD dll_count_offset = 12, exe_count_offset = 0, exe_exit_offset = 8;
+#endif
+    struct prefetch_dll
+    {
+        BYTE code[64];
+        IMAGE_EXPORT_DIRECTORY exports;
+        DWORD functions[1];
+        char name[MAX_PATH];
+        LONG count;
+    } dll;
+    struct prefetch_exe
+    {
+        BYTE code[64];
+        IMAGE_IMPORT_DESCRIPTOR descr[3];
+        IMAGE_THUNK_DATA original_thunks[4];
+        IMAGE_THUNK_DATA thunks[4];
+        char module[MAX_PATH];
+        char kernel32[16];
+        struct { WORD hint; char name[16]; } function;
+    } exe;
+    char temp_path[MAX_PATH], dll_name[MAX_PATH], exe_name[MAX_PATH];
+    DWORD dummy, ret, rva;
+    HANDLE hfile;
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    IMAGE_NT_HEADERS nt;
+    IMAGE_SECTION_HEADER section;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "ldr", 0, dll_name );
+    GetTempFileNameA( temp_path, "ldr", 0, exe_name );
+
+    nt = nt_header_template;
+    nt.FileHeader.NumberOfSections = 1;
+    nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL | IMAGE_FILE_RELOCS_STRIPPED;
+    nt.OptionalHeader.SectionAlignment = page_size;
+    nt.OptionalHeader.FileAlignment = 0x200;
+    nt.OptionalHeader.ImageBase = 0x12340000;
+    nt.OptionalHeader.SizeOfImage = 2 * page_size;
+    nt.OptionalHeader.SizeOfHeaders = nt.OptionalHeader.FileAlignment;
+    nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    memset( nt.OptionalHeader.DataDirectory, 0, sizeof(nt.OptionalHeader.DataDirectory) );
+
+    memset( &section, 0, sizeof(section) );
+    memcpy( section.Name, ".text", sizeof(".text") );
+    section.PointerToRawData = nt.OptionalHeader.FileAlignment;
+    section.VirtualAddress = nt.OptionalHeader.SectionAlignment;
+    section.Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE;
+
+    /* the dll exports its notification count as ordinal 1 */
+#define DATA_RVA(ptr) (page_size + ((char *)(ptr) - (char *)&dll))
+    memset( &dll, 0, sizeof(dll) );
+    memcpy( dll.code, dll_code, sizeof(dll_code) );
+#ifdef __x86_64__
+    rva = DATA_RVA( &dll.count ) - DATA_RVA( dll.code + dll_count_offset + 4 );
+#elif defined(__i386__)
+    rva = nt.OptionalHeader.ImageBase + DATA_RVA( &dll.count );
+#else
+    rva = DATA_RVA( &dll.count ) - DATA_RVA( dll.code + dll_count_offset );
+    rva = ((rva & 3) << 29) | (((rva >> 2) & 0x7ffff) << 5);
+    rva |= *(DWORD *)(dll.code + dll_count_offset);
+#endif
+    memcpy( dll.code + dll_count_offset, &rva, sizeof(rva) );
+    strcpy( dll.name, strrchr( dll_name, '\\' ) + 1 );
+    dll.exports.Name = DATA_RVA( dll.name );
+    dll.exports.Base = 1;
+    dll.exports.NumberOfFunctions = 1;
+    dll.exports.AddressOfFunctions = DATA_RVA( dll.functions );
+    dll.functions[0] = DATA_RVA( &dll.count );
+    nt.OptionalHeader.AddressOfEntryPoint = DATA_RVA( dll.code );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size = sizeof(dll.exports);
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress = DATA_RVA( &dll.exports );
+#undef DATA_RVA
+
+    hfile = CreateFileA( dll_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( hfile != INVALID_HANDLE_VALUE, "creation failed\n" );
+    section.Misc.VirtualSize = sizeof(dll);
+    section.SizeOfRawData = sizeof(dll);
+    WriteFile( hfile, &dos_header, sizeof(dos_header), &dummy, NULL );
+    WriteFile( hfile, &nt, sizeof(nt), &dummy, NULL );
+    WriteFile( hfile, &section, sizeof(section), &dummy, NULL );
+    SetFilePointer( hfile, section.PointerToRawData, NULL, SEEK_SET );
+    WriteFile( hfile, &dll, sizeof(dll), &dummy, NULL );
+    CloseHandle( hfile );
+
+    /* the exe exits with the count, imported from the dll */
+#define DATA_RVA(ptr) (page_size + ((char *)(ptr) - (char *)&exe))
+    nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_RELOCS_STRIPPED;
+    nt.OptionalHeader.ImageBase = 0x10000000;
+    memset( &exe, 0, sizeof(exe) );
+    memcpy( exe.code, exe_code, sizeof(exe_code) );
+#ifdef __x86_64__
+    rva = DATA_RVA( &exe.thunks[0] ) - DATA_RVA( exe.code + exe_count_offset + 4 );
+    memcpy( exe.code + exe_count_offset, &rva, sizeof(rva) );
+    rva = DATA_RVA( &exe.thunks[2] ) - DATA_RVA( exe.code + exe_exit_offset + 4 );
+    memcpy( exe.code + exe_exit_offset, &rva, sizeof(rva) );
+#elif defined(__i386__)
+    rva = nt.OptionalHeader.ImageBase + DATA_RVA( &exe.thunks[0] );
+    memcpy( exe.code + exe_count_offset, &rva, sizeof(rva) );
+    rva = nt.OptionalHeader.ImageBase + DATA_RVA( &exe.thunks[2] );
+    memcpy( exe.code + exe_exit_offset, &rva, sizeof(rva) );
+#else
+    rva = DATA_RVA( &exe.thunks[0] ) - DATA_RVA( exe.code + exe_count_offset );
+    *(DWORD *)(exe.code + exe_count_offset) |= ((rva >> 2) & 0x7ffff) << 5;
+    rva = DATA_RVA( &exe.thunks[2] ) - DATA_RVA( exe.code + exe_exit_offset );
+    *(DWORD *)(exe.code + exe_exit_offset) |= ((rva >> 2) & 0x7ffff) << 5;
+#endif
+    strcpy( exe.module, dll.name );
+    U(exe.descr[0]).OriginalFirstThunk = DATA_RVA( &exe.original_thunks[0] );
+    exe.descr[0].FirstThunk = DATA_RVA( &exe.thunks[0] );
+    exe.descr[0].Name = DATA_RVA( exe.module );
+    exe.original_thunks[0].u1.Ordinal = exe.thunks[0].u1.Ordinal = IMAGE_ORDINAL_FLAG | 1;
+    strcpy( exe.kernel32, "kernel32.dll" );
+    strcpy( exe.function.name, "ExitProcess" );
+    U(exe.descr[1]).OriginalFirstThunk = DATA_RVA( &exe.original_thunks[2] );
+    exe.descr[1].FirstThunk = DATA_RVA( &exe.thunks[2] );
+    exe.descr[1].Name = DATA_RVA( exe.kernel32 );
+    exe.original_thunks[2].u1.AddressOfData = exe.thunks[2].u1.AddressOfData = DATA_RVA( &exe.function );
+    nt.OptionalHeader.AddressOfEntryPoint = DATA_RVA( exe.code );
+    nt.OptionalHeader.SizeOfStackReserve = 0x100000;
+    nt.OptionalHeader.SizeOfStackCommit = 0x1000;
+    nt.OptionalHeader.SizeOfHeapReserve = 0x100000;
+    nt.OptionalHeader.SizeOfHeapCommit = 0x1000;
+    memset( nt.OptionalHeader.DataDirectory, 0, sizeof(nt.OptionalHeader.DataDirectory) );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].Size = sizeof(exe.descr);
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress = DATA_RVA( exe.descr );
+#undef DATA_RVA
+
+    hfile = CreateFileA( exe_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( hfile != INVALID_HANDLE_VALUE, "creation failed\n" );
+    section.Misc.VirtualSize = sizeof(exe);
+    section.SizeOfRawData = sizeof(exe);
+    WriteFile( hfile, &dos_header, sizeof(dos_header), &dummy, NULL );
+    WriteFile( hfile, &nt, sizeof(nt), &dummy, NULL );
+    WriteFile( hfile, &section, sizeof(section), &dummy, NULL );
+    SetFilePointer( hfile, section.PointerToRawData, NULL, SEEK_SET );
+    WriteFile( hfile, &exe, sizeof(exe), &dummy, NULL );
+    CloseHandle( hfile );
+
+    /* the import search threads are not attached to the dlls */
+    ret = CreateProcessA( exe_name, NULL, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    ok( ret, "CreateProcess(%s) error %d\n", exe_name, GetLastError() );
+    if (ret)
+    {
+        ret = WaitForSingleObject( pi.hProcess, 10000 );
+        ok( ret == WAIT_OBJECT_0, "child process failed to terminate\n" );
+        if (ret != WAIT_OBJECT_0) TerminateProcess( pi.hProcess, 0xdead );
+        GetExitCodeProcess( pi.hProcess, &ret );
+        ok( !ret, "got %u thread notifications\n", ret );
+        CloseHandle( pi.hThread );
+        CloseHandle( pi.hProcess );
+    }
+    DeleteFileA( exe_name );
+    DeleteFileA( dll_name );
+#else
+    skip( "no thread notification test on this platform\n" );
+#endif
+}
+
+/* the dlls are initialized in the same order when the imports can't be searched in parallel */
+static void test_import_prefetch(void)
+{
+    char cmdline[MAX_PATH * 2];
+    char **argv;
+    WCHAR *order;
+    HANDLE mapping;
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    BOOL ret;
+    int i;
+
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, 2 * page_size,
+                                  "winetest_loader_prefetch" );
+    ok( mapping != 0, "CreateFileMapping failed\n" );
+    order = MapViewOfFile( mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 );
+    winetest_get_mainargs( &argv );
+    for (i = 0; i < 2; i++)
+    {
+        sprintf( cmdline, "\"%s\" loader prefetch %d", argv[0], i );
+        ret = CreateProcessA( argv[0], cmdline, NULL, NULL, FALSE, CREATE_SUSPENDED, NULL, NULL, &si, &pi );
+        ok( ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError() );
+        if (!ret) continue;
+        if (!i)
+        {
+            ret = SetProcessAffinityMask( pi.hProcess, 1 );
+            ok( ret, "SetProcessAffinityMask failed err %u\n", GetLastError() );
+        }
+        ResumeThread( pi.hThread );
+        wait_child_process( pi.hProcess );
+        CloseHandle( pi.hThread );
+        CloseHandle( pi.hProcess );
+    }
+    ok( order[0], "no modules initialized\n" );
+    ok( !lstrcmpW( order, order + page_size / sizeof(WCHAR) ), "init order %s / %s\n",
+        wine_dbgstr_w(order), wine_dbgstr_w(order + page_size / sizeof(WCHAR)) );
+    UnmapViewOfFile( order );
+    CloseHandle( mapping );
+}
+
 #define MAX_COUNT 10
 static HANDLE attached_thread[MAX_COUNT];
 static DWORD attached_thread_count;
@@ -3983,6 +4476,7 @@ START_TEST(loader)
     pNtQuerySection = (void *)GetProcAddress(ntdll, "NtQuerySection");
     pNtMapViewOfSection = (void *)GetProcAddress(ntdll, "NtMapViewOfSection");
     pNtUnmapViewOfSection = (void *)GetProcAddress(ntdll, "NtUnmapViewOfSection");
+    pNtQueryVirtualMemory = (void *)GetProcAddress(ntdll, "NtQueryVirtualMemory");
     pNtTerminateProcess = (void *)GetProcAddress(ntdll, "NtTerminateProcess");
     pNtQueryInformationProcess = (void *)GetProcAddress(ntdll, "NtQueryInformationProcess");
     pNtSetInformationProcess = (void *)GetProcAddress(ntdll, "NtSetInformationProcess");
@@ -4026,6 +4520,19 @@ START_TEST(loader)
         *child_failures = -1;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc > 4 && !strcmp( argv[2], "relocations" ))
+    {
+        void *parent_mod;
+
+        sscanf( argv[4], "%p", &parent_mod );
+        relocations_child( argv[3], parent_mod );
+        return;
+    }
+    if (argc > 3 && !strcmp( argv[2], "prefetch" ))
+    {
+        prefetch_child( atoi( argv[3] ));
+        return;
+    }
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -4038,6 +4545,9 @@ START_TEST(loader)
     test_ImportDescriptors();
     test_section_access();
     test_import_resolution();
+    test_relocations();
+    test_import_prefetch();
+    test_import_prefetch_threads();
     test_ExitProcess();
     test_InMemoryOrderModuleList();
     test_LoadPackagedLibrary();
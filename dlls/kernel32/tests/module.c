@@ -310,6 +310,53 @@ static void testGetProcAddress_Wrong(void)
     ok( GetLastError() == ERROR_MOD_NOT_FOUND, "Expected ERROR_MOD_NOT_FOUND, got %d\n", GetLastError() );
 }
 
+static void testGetProcAddress_exports(const char *dll)
+{
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    const IMAGE_NT_HEADERS *nt;
+    const DWORD *functions, *names;
+    const WORD *ordinals;
+    DWORD i, size, count = 0;
+    HMODULE module;
+    char buffer[256];
+    FARPROC fp;
+
+    module = GetModuleHandleA(dll);
+    ok(module != NULL, "%s not loaded\n", dll);
+    if (!module) return;
+
+    nt = (const IMAGE_NT_HEADERS *)((const char *)module + ((const IMAGE_DOS_HEADER *)module)->e_lfanew);
+    size = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size;
+    exports = (const IMAGE_EXPORT_DIRECTORY *)((const char *)module +
+              nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress);
+    functions = (const DWORD *)((const char *)module + exports->AddressOfFunctions);
+    names = (const DWORD *)((const char *)module + exports->AddressOfNames);
+    ordinals = (const WORD *)((const char *)module + exports->AddressOfNameOrdinals);
+
+    /* every named export is found, whatever the lookup order */
+    for (i = exports->NumberOfNames; i > 0; i--)
+    {
+        const char *name = (const char *)module + names[i - 1];
+        const char *proc = (const char *)module + functions[ordinals[i - 1]];
+
+        /* skip forwarded exports */
+        if (proc >= (const char *)exports && proc < (const char *)exports + size) continue;
+
+        fp = GetProcAddress(module, name);
+        ok(fp == (FARPROC)proc, "%s.%s: got %p, expected %p\n", dll, name, fp, proc);
+        count++;
+
+        if (strlen(name) < sizeof(buffer) - 1)
+        {
+            sprintf(buffer, "%s\x7f", name);
+            SetLastError(0xdeadbeef);
+            fp = GetProcAddress(module, buffer);
+            ok(!fp, "%s.%s should not be found\n", dll, buffer);
+        }
+    }
+    ok(count > 0, "no exports found in %s\n", dll);
+}
+
 static void testLoadLibraryEx(void)
 {
     CHAR path[MAX_PATH];
@@ -1176,6 +1223,8 @@ START_TEST(module)
     testNestedLoadLibraryA();
     testLoadLibraryA_Wrong();
     testGetProcAddress_Wrong();
+    testGetProcAddress_exports("ntdll.dll");
+    testGetProcAddress_exports("kernel32.dll");
     testLoadLibraryEx();
     test_LoadLibraryEx_search_flags();
     testGetModuleHandleEx();
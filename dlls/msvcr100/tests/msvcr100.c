@@ -148,10 +148,20 @@ typedef struct {
     char pad[64];
 } event;
 
+struct ContextVtbl;
 typedef struct {
-    void *vtable;
+    struct ContextVtbl *vtable;
 } Context;
 
+struct ContextVtbl {
+    unsigned int (__thiscall *GetId)(Context*);
+    unsigned int (__thiscall *GetVirtualProcessorId)(Context*);
+    unsigned int (__thiscall *GetScheduleGroupId)(Context*);
+    void (__thiscall *Unblock)(Context*);
+    MSVCRT_bool (__thiscall *IsSynchronouslyBlocked)(Context*);
+    Context* (__thiscall *vector_dtor)(Context*, unsigned int);
+};
+
 typedef struct {
     void *policy_container;
 } SchedulerPolicy;
@@ -170,8 +180,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*, void (__cdecl*)(void*), void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -223,6 +233,8 @@ static int (__cdecl *p_event_wait_for_multiple)(event**, size_t, MSVCRT_bool, un
 
 static Context* (__cdecl *p_Context_CurrentContext)(void);
 static unsigned int (__cdecl *p_Context_Id)(void);
+static void (__cdecl *p_Context_Block)(void);
+static unsigned int (__cdecl *p_Context_VirtualProcessorId)(void);
 static SchedulerPolicy* (__thiscall *p_SchedulerPolicy_ctor)(SchedulerPolicy*);
 static void (__thiscall *p_SchedulerPolicy_SetConcurrencyLimits)(SchedulerPolicy*, unsigned int, unsigned int);
 static void (__thiscall *p_SchedulerPolicy_dtor)(SchedulerPolicy*);
@@ -230,6 +242,7 @@ static Scheduler* (__cdecl *p_Scheduler_Create)(SchedulerPolicy*);
 static Scheduler* (__cdecl *p_CurrentScheduler_Get)(void);
 static void (__cdecl *p_CurrentScheduler_Detach)(void);
 static unsigned int (__cdecl *p_CurrentScheduler_Id)(void);
+static void (__cdecl *p_CurrentScheduler_ScheduleTask)(void (__cdecl*)(void*), void*);
 
 static int (__cdecl *p__memicmp)(const char*, const char*, size_t);
 static int (__cdecl *p__memicmp_l)(const char*, const char*, size_t,_locale_t);
@@ -274,6 +287,8 @@ static BOOL init(void)
     SET(p___strncnt, "__strncnt");
 
     SET(p_Context_Id, "?Id@Context@Concurrency@@SAIXZ");
+    SET(p_Context_Block, "?Block@Context@Concurrency@@SAXXZ");
+    SET(p_Context_VirtualProcessorId, "?VirtualProcessorId@Context@Concurrency@@SAIXZ");
     SET(p_CurrentScheduler_Detach, "?Detach@CurrentScheduler@Concurrency@@SAXXZ");
     SET(p_CurrentScheduler_Id, "?Id@CurrentScheduler@Concurrency@@SAIXZ");
 
@@ -318,6 +333,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QEAA@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPEAV12@AEBVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPEAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
     } else {
         SET(pSpinWait_ctor_yield, "??0?$_SpinWait@$00@details@Concurrency@@QAE@P6AXXZ@Z");
         SET(pSpinWait_dtor, "??_F?$_SpinWait@$00@details@Concurrency@@QAEXXZ");
@@ -359,6 +375,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QAE@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPAV12@ABVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
     }
 
     init_thiscall_thunk();
@@ -989,6 +1006,90 @@ static void test_Scheduler(void)
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
+static LONG chore_count;
+static HANDLE chores_done, chore_blocked, chore_unblocked;
+
+static void __cdecl count_chore(void *arg)
+{
+    unsigned int id = p_Context_VirtualProcessorId();
+
+    ok(id < 2, "Context::VirtualProcessorId() = %u\n", id);
+    if(InterlockedIncrement(&chore_count) == 100)
+        SetEvent(chores_done);
+}
+
+static void __cdecl block_chore(void *arg)
+{
+    Context **ctx = arg;
+
+    *ctx = p_Context_CurrentContext();
+    SetEvent(chore_blocked);
+    p_Context_Block();
+    SetEvent(chore_unblocked);
+}
+
+static void __cdecl signal_chore(void *arg)
+{
+    SetEvent(arg);
+}
+
+static void test_ScheduleTask(void)
+{
+    Scheduler *scheduler;
+    SchedulerPolicy policy;
+    Context *ctx = NULL;
+    HANDLE event;
+    DWORD ret;
+    int i;
+
+    chores_done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    chore_blocked = CreateEventW(NULL, TRUE, FALSE, NULL);
+    chore_unblocked = CreateEventW(NULL, TRUE, FALSE, NULL);
+    event = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    call_func1(p_SchedulerPolicy_ctor, &policy);
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 2, 2);
+    scheduler = p_Scheduler_Create(&policy);
+    call_func1(scheduler->vtable->Attach, scheduler);
+
+    for(i=0; i<100; i++)
+        p_CurrentScheduler_ScheduleTask(count_chore, NULL);
+    ret = WaitForSingleObject(chores_done, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    ok(chore_count == 100, "chore_count = %d\n", chore_count);
+
+    p_CurrentScheduler_Detach();
+    call_func1(scheduler->vtable->Release, scheduler);
+
+    /* a blocked chore doesn't keep its virtual processor */
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 1, 1);
+    scheduler = p_Scheduler_Create(&policy);
+    call_func1(scheduler->vtable->Attach, scheduler);
+
+    p_CurrentScheduler_ScheduleTask(block_chore, &ctx);
+    ret = WaitForSingleObject(chore_blocked, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    p_CurrentScheduler_ScheduleTask(signal_chore, event);
+    ret = WaitForSingleObject(event, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+
+    ret = WaitForSingleObject(chore_unblocked, 100);
+    ok(ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret);
+    ok(call_func1(ctx->vtable->IsSynchronouslyBlocked, ctx), "context is not blocked\n");
+    call_func1(ctx->vtable->Unblock, ctx);
+    ret = WaitForSingleObject(chore_unblocked, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+
+    p_CurrentScheduler_Detach();
+    call_func1(scheduler->vtable->Release, scheduler);
+    call_func1(p_SchedulerPolicy_dtor, &policy);
+
+    CloseHandle(chores_done);
+    CloseHandle(chore_blocked);
+    CloseHandle(chore_unblocked);
+    CloseHandle(event);
+}
+
 static void test__memicmp(void)
 {
     static const char *s1 = "abc";
@@ -1113,6 +1214,7 @@ START_TEST(msvcr100)
 
     test_ExternalContextBase();
     test_Scheduler();
+    test_ScheduleTask();
     test_wmemcpy_s();
     test_wmemmove_s();
     test_fread_s();
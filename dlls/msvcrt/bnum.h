@@ -133,4 +133,35 @@ static inline void bnum_mult(struct bnum *b, int mult)
     }
 }
 
+/* 128-bit approximations of 5^q normalized to [2^127, 2^128), most
+ * significant half first, used by the fast conversion paths */
+#define POW5_MIN (-342)
+#define POW5_MAX 308
+extern const ULONGLONG pow5_128[POW5_MAX - POW5_MIN + 1][2] DECLSPEC_HIDDEN;
+
+/* Returns floor(log2(5^q)) for POW5_MIN <= q <= POW5_MAX */
+static inline int pow5_log2(int q)
+{
+    return ((q * 217706) >> 16) - q;
+}
+
+/* Returns low 64 bits of a*b, stores the high ones in hi */
+static inline ULONGLONG mul_64x64(ULONGLONG a, ULONGLONG b, ULONGLONG *hi)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+
+    *hi = r >> 64;
+    return r;
+#else
+    ULONGLONG lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+    ULONGLONG hi_lo = (a >> 32) * (b & 0xffffffff);
+    ULONGLONG lo_hi = (a & 0xffffffff) * (b >> 32);
+    ULONGLONG mid = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+
+    *hi = (a >> 32) * (b >> 32) + (hi_lo >> 32) + (mid >> 32);
+    return (mid << 32) | (lo_lo & 0xffffffff);
+#endif
+}
+
 #endif /* __WINE_BNUM_H */
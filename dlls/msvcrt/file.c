@@ -115,12 +115,22 @@ ioinfo * MSVCRT___pioinfo[MSVCRT_MAX_FILES/MSVCRT_FD_BLOCK_SIZE] = { 0 };
  */
 ioinfo MSVCRT___badioinfo = { INVALID_HANDLE_VALUE, WX_TEXT };
 
+/* The first thread that locks a stream owns it, and doesn't take the lock
+ * until another thread uses the stream. */
+typedef struct {
+    DWORD owner;                /* stream owner id of the owning thread, or 0 */
+    volatile LONG shared;       /* set once another thread used the stream */
+    volatile LONG owner_depth;  /* locks held by the owner without taking the lock */
+} file_owner;
+
 typedef struct {
     MSVCRT_FILE file;
     CRITICAL_SECTION crit;
+    file_owner owner;
 } file_crit;
 
 MSVCRT_FILE MSVCRT__iob[_IOB_ENTRIES] = { { 0 } };
+static file_owner MSVCRT_iob_owner[_IOB_ENTRIES];
 static file_crit* MSVCRT_fstream[MSVCRT_MAX_FILES/MSVCRT_FD_BLOCK_SIZE];
 static int MSVCRT_max_streams = 512, MSVCRT_stream_idx;
 
@@ -379,6 +389,13 @@ static inline MSVCRT_FILE* msvcrt_get_file(int i)
     return &ret->file;
 }
 
+static inline file_owner* msvcrt_get_file_owner(MSVCRT_FILE *file)
+{
+    if(file>=MSVCRT__iob && file<MSVCRT__iob+_IOB_ENTRIES)
+        return &MSVCRT_iob_owner[file-MSVCRT__iob];
+    return &((file_crit*)file)->owner;
+}
+
 /* INTERNAL: free a file entry fd */
 static void msvcrt_free_fd(int fd)
 {
@@ -443,6 +460,8 @@ static int msvcrt_alloc_fd(HANDLE hand, int flag)
     return fd;
 }
 
+static void msvcrt_reset_file_owner(MSVCRT_FILE *file);
+
 /* INTERNAL: Allocate a FILE* for an fd slot */
 /* caller must hold the files lock */
 static MSVCRT_FILE* msvcrt_alloc_fp(void)
@@ -467,6 +486,8 @@ static MSVCRT_FILE* msvcrt_alloc_fp(void)
           }
           MSVCRT_stream_idx++;
       }
+      else
+          msvcrt_reset_file_owner(file);
       return file;
     }
   }
@@ -1310,10 +1331,18 @@ LONG CDECL MSVCRT__lseek(int fd, LONG offset, int whence)
     return MSVCRT__lseeki64(fd, offset, whence);
 }
 
-/*********************************************************************
- *              _lock_file (MSVCRT.@)
- */
-void CDECL MSVCRT__lock_file(MSVCRT_FILE *file)
+/* INTERNAL: Returns the id used to own streams, unlike thread ids it is never reused */
+static inline DWORD msvcrt_get_stream_owner_id(void)
+{
+    static LONG last_id;
+    thread_data_t *data = msvcrt_get_thread_data();
+
+    while(!data->stream_owner_id)
+        data->stream_owner_id = InterlockedIncrement(&last_id);
+    return data->stream_owner_id;
+}
+
+static inline void msvcrt_enter_file_lock(MSVCRT_FILE *file)
 {
     if(file>=MSVCRT__iob && file<MSVCRT__iob+_IOB_ENTRIES)
         _lock(_STREAM_LOCKS+(file-MSVCRT__iob));
@@ -1321,10 +1350,7 @@ void CDECL MSVCRT__lock_file(MSVCRT_FILE *file)
         EnterCriticalSection(&((file_crit*)file)->crit);
 }
 
-/*********************************************************************
- *              _unlock_file (MSVCRT.@)
- */
-void CDECL MSVCRT__unlock_file(MSVCRT_FILE *file)
+static inline void msvcrt_leave_file_lock(MSVCRT_FILE *file)
 {
     if(file>=MSVCRT__iob && file<MSVCRT__iob+_IOB_ENTRIES)
         _unlock(_STREAM_LOCKS+(file-MSVCRT__iob));
@@ -1332,6 +1358,114 @@ void CDECL MSVCRT__unlock_file(MSVCRT_FILE *file)
         LeaveCriticalSection(&((file_crit*)file)->crit);
 }
 
+/* INTERNAL: Leaves a section where the owner didn't take the stream lock */
+/* the interlocked decrement orders it against the shared flag, see msvcrt_share_file */
+static inline void msvcrt_owner_leave(file_owner *owner)
+{
+    if(owner->owner_depth > 1)
+        owner->owner_depth--;
+    else if(!InterlockedDecrement(&owner->owner_depth) && owner->shared)
+        RtlWakeAddressAll((const void *)&owner->owner_depth);
+}
+
+/* INTERNAL: Makes the owner of a stream take its lock from now on */
+/* caller must hold the stream lock */
+static void msvcrt_share_file(file_owner *owner)
+{
+    LONG depth;
+
+    /* The owner enters and leaves with interlocked operations on the depth,
+     * so either it sees the flag before entering, or we see its depth and
+     * it sees the flag when leaving, and wakes us up. */
+    InterlockedExchange(&owner->shared, TRUE);
+
+    /* wait until the owner is done with the stream */
+    while((depth = owner->owner_depth))
+        RtlWaitOnAddress((const void *)&owner->owner_depth, &depth, sizeof(depth), NULL);
+}
+
+/* INTERNAL: Forgets the owner of a stream, so that the next thread that uses it can own it */
+/* caller must hold the stream lock, and not own it without taking the lock */
+static void msvcrt_disown_file(file_owner *owner)
+{
+    if(!owner->shared)
+    {
+        if(owner->owner == msvcrt_get_stream_owner_id())
+            InterlockedExchange(&owner->shared, TRUE);
+        else
+            msvcrt_share_file(owner);
+    }
+    owner->owner = 0;
+}
+
+/* INTERNAL: Resets the owner of a stream slot that is being reused */
+/* caller must hold the files lock */
+static void msvcrt_reset_file_owner(MSVCRT_FILE *file)
+{
+    file_owner *owner = msvcrt_get_file_owner(file);
+
+    if(owner->owner)  /* closed without fclose */
+    {
+        if(owner->owner == msvcrt_get_stream_owner_id() && owner->owner_depth)
+            return;
+        msvcrt_enter_file_lock(file);
+        msvcrt_disown_file(owner);
+        msvcrt_leave_file_lock(file);
+    }
+    owner->owner_depth = 0;
+    InterlockedExchange(&owner->shared, FALSE);
+}
+
+/*********************************************************************
+ *              _lock_file (MSVCRT.@)
+ */
+void CDECL MSVCRT__lock_file(MSVCRT_FILE *file)
+{
+    file_owner *owner = msvcrt_get_file_owner(file);
+    DWORD id = msvcrt_get_stream_owner_id();
+
+    if(!owner->owner)
+        InterlockedCompareExchange((LONG*)&owner->owner, id, 0);
+
+    if(owner->owner == id)
+    {
+        if(owner->owner_depth)
+        {
+            owner->owner_depth++;
+            return;
+        }
+        if(!owner->shared)
+        {
+            InterlockedIncrement(&owner->owner_depth);
+            if(!owner->shared)
+                return;
+            /* another thread started to use the stream in the meantime */
+            msvcrt_owner_leave(owner);
+        }
+    }
+
+    msvcrt_enter_file_lock(file);
+
+    if(!owner->shared)
+        msvcrt_share_file(owner);
+}
+
+/*********************************************************************
+ *              _unlock_file (MSVCRT.@)
+ */
+void CDECL MSVCRT__unlock_file(MSVCRT_FILE *file)
+{
+    file_owner *owner = msvcrt_get_file_owner(file);
+
+    if(owner->owner == msvcrt_get_stream_owner_id() && owner->owner_depth)
+    {
+        msvcrt_owner_leave(owner);
+        return;
+    }
+
+    msvcrt_leave_file_lock(file);
+}
+
 /*********************************************************************
  *		_locking (MSVCRT.@)
  *
@@ -3641,11 +3775,22 @@ int CDECL MSVCRT__putw(int val, MSVCRT_FILE* file)
  */
 int CDECL MSVCRT_fclose(MSVCRT_FILE* file)
 {
+  file_owner *owner = msvcrt_get_file_owner(file);
   int ret;
 
-  MSVCRT__lock_file(file);
+  if(owner->owner == msvcrt_get_stream_owner_id() && owner->owner_depth)
+  {
+      /* closed while we hold it without the lock, the slot can't be reset yet */
+      MSVCRT__lock_file(file);
+      ret = MSVCRT__fclose_nolock(file);
+      MSVCRT__unlock_file(file);
+      return ret;
+  }
+
+  msvcrt_enter_file_lock(file);
+  msvcrt_disown_file(owner);
   ret = MSVCRT__fclose_nolock(file);
-  MSVCRT__unlock_file(file);
+  msvcrt_leave_file_lock(file);
 
   return ret;
 }
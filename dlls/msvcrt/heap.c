@@ -25,6 +25,7 @@
 #include "msvcrt.h"
 #include "mtdll.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(msvcrt);
 
@@ -53,8 +54,435 @@ static unsigned int MSVCRT_amblksiz = 16;
 /* FIXME - According to documentation it should be 480 bytes, at runtime default is 0 */
 static MSVCRT_size_t MSVCRT_sbh_threshold = 0;
 
+/* Small blocks pool
+ *
+ * Blocks of up to POOL_CLASSES * POOL_GRANULARITY bytes are carved out of
+ * chunks of a separately reserved memory range, each chunk holding blocks
+ * of a single size class. The requested size of every block is kept in an
+ * array at the start of its chunk, it is zero for free blocks. Free blocks
+ * are linked through their first pointer, in per-thread caches and in the
+ * free list of their chunk. Chunks with free blocks are listed per class,
+ * under pool_cs, so malloc and free usually don't take any lock. Chunks
+ * whose blocks are all free are decommitted, except for the last one of
+ * their class, and reused for any class.
+ *
+ * Like the small-block heap of native, pool blocks are not part of the heap
+ * returned by _get_heap_handle(), so the pool is only used when it's
+ * selected by setting __MSVCRT_HEAP_SELECT to __GLOBAL_HEAP_SELECTED,2 or
+ * __GLOBAL_HEAP_SELECTED,3.
+ */
+#define POOL_GRANULARITY 16
+#define POOL_MAX_SIZE (POOL_CLASSES * POOL_GRANULARITY)
+#define POOL_CHUNK_SIZE 0x4000
+#ifdef _WIN64
+#define POOL_RESERVE_SIZE 0x40000000
+#else
+#define POOL_RESERVE_SIZE 0x1000000
+#endif
+#define POOL_CACHE_SIZE 32
+#define POOL_CHUNK_FREE 0xff  /* class of decommitted chunks */
+
+struct pool_chunk
+{
+    struct list     entry;       /* entry in pool_partial while the chunk has free blocks */
+    void           *free;        /* free blocks not cached by any thread */
+    unsigned int    free_count;
+    unsigned short  sizes[1];    /* requested size + 1 of each block, 0 if free */
+};
+
+static CRITICAL_SECTION pool_cs;
+static CRITICAL_SECTION_DEBUG pool_cs_debug =
+{
+    0, 0, &pool_cs,
+    { &pool_cs_debug.ProcessLocksList, &pool_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": pool_cs") }
+};
+static CRITICAL_SECTION pool_cs = { &pool_cs_debug, -1, 0, 0, 0, 0 };
+
+static BOOL pool_enabled;
+static char *pool_base;
+static unsigned int pool_trim_gen;  /* incremented to make threads empty their caches */
+static DWORD_PTR pool_committed;  /* end of the used chunks, some of them may be decommitted */
+static unsigned int pool_free_chunks;
+static unsigned char pool_chunk_class[POOL_RESERVE_SIZE / POOL_CHUNK_SIZE];
+static unsigned short pool_block_count[POOL_CLASSES];
+static unsigned short pool_block_offset[POOL_CLASSES];
+static struct list pool_partial[POOL_CLASSES];
+
+static inline BOOL pool_contains(const void *ptr)
+{
+    return (DWORD_PTR)((const char*)ptr - pool_base) < pool_committed;
+}
+
+static inline struct pool_chunk *pool_get_chunk(const void *ptr)
+{
+    return (struct pool_chunk*)(pool_base +
+            ((const char*)ptr - pool_base) / POOL_CHUNK_SIZE * POOL_CHUNK_SIZE);
+}
+
+/* returns NULL if ptr doesn't point to the start of a block */
+static inline unsigned short *pool_block_size(const void *ptr, unsigned int *class)
+{
+    struct pool_chunk *chunk = pool_get_chunk(ptr);
+    MSVCRT_size_t block_size;
+    DWORD_PTR offset;
+
+    *class = pool_chunk_class[((char*)chunk - pool_base) / POOL_CHUNK_SIZE];
+    if(*class == POOL_CHUNK_FREE)
+        return NULL;
+    block_size = (*class + 1) * POOL_GRANULARITY;
+    offset = (const char*)ptr - (const char*)chunk - pool_block_offset[*class];
+    if(offset % block_size || offset / block_size >= pool_block_count[*class])
+        return NULL;
+    return &chunk->sizes[offset / block_size];
+}
+
+/* called with pool_cs held */
+static BOOL pool_add_chunk(unsigned int class)
+{
+    MSVCRT_size_t block_size = (class + 1) * POOL_GRANULARITY;
+    struct pool_chunk *chunk;
+    DWORD_PTR index;
+    int i;
+
+    if(!pool_base)
+    {
+        if(!pool_enabled) return FALSE;
+        pool_base = VirtualAlloc(NULL, POOL_RESERVE_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+        if(!pool_base)
+        {
+            pool_enabled = FALSE;
+            return FALSE;
+        }
+    }
+
+    if(pool_free_chunks)
+        index = (unsigned char*)memchr(pool_chunk_class, POOL_CHUNK_FREE,
+                pool_committed / POOL_CHUNK_SIZE) - pool_chunk_class;
+    else if(pool_committed == POOL_RESERVE_SIZE)
+        return FALSE;
+    else
+        index = pool_committed / POOL_CHUNK_SIZE;
+
+    chunk = (struct pool_chunk*)(pool_base + index * POOL_CHUNK_SIZE);
+    if(!VirtualAlloc(chunk, POOL_CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE))
+        return FALSE;
+    pool_chunk_class[index] = class;
+
+    chunk->free = NULL;
+    for(i = pool_block_count[class] - 1; i >= 0; i--)
+    {
+        void **block = (void**)((char*)chunk + pool_block_offset[class] + i * block_size);
+        *block = chunk->free;
+        chunk->free = block;
+    }
+    chunk->free_count = pool_block_count[class];
+    list_add_head(&pool_partial[class], &chunk->entry);
+
+    if(pool_free_chunks)
+        pool_free_chunks--;
+    else
+        pool_committed += POOL_CHUNK_SIZE;
+    return TRUE;
+}
+
+/* called with pool_cs held */
+static void pool_decommit_chunk(struct pool_chunk *chunk)
+{
+    list_remove(&chunk->entry);
+    pool_chunk_class[((char*)chunk - pool_base) / POOL_CHUNK_SIZE] = POOL_CHUNK_FREE;
+    VirtualFree(chunk, POOL_CHUNK_SIZE, MEM_DECOMMIT);
+    pool_free_chunks++;
+}
+
+/* called with pool_cs held; gives a block back to its chunk, and decommits
+ * the chunk once all its blocks are free */
+static void pool_release_block(void *ptr, unsigned int class)
+{
+    struct pool_chunk *chunk = pool_get_chunk(ptr);
+
+    *(void**)ptr = chunk->free;
+    chunk->free = ptr;
+    if(!chunk->free_count++)
+        list_add_tail(&pool_partial[class], &chunk->entry);
+
+    /* keep an empty chunk if it's the only one with free blocks,
+     * so that a class doesn't keep committing and decommitting the same chunk */
+    if(chunk->free_count == pool_block_count[class] &&
+            list_head(&pool_partial[class]) != list_tail(&pool_partial[class]))
+        pool_decommit_chunk(chunk);
+}
+
+/* moves free blocks from the thread cache back to their chunks */
+static void pool_trim_cache(struct pool_cache *cache, unsigned int class, unsigned int keep)
+{
+    EnterCriticalSection(&pool_cs);
+    while(cache->count > keep)
+    {
+        void **block = cache->head;
+
+        cache->head = *block;
+        pool_release_block(block, class);
+        cache->count--;
+    }
+    LeaveCriticalSection(&pool_cs);
+}
+
+static void* pool_alloc(MSVCRT_size_t size)
+{
+    unsigned int class = size ? (size - 1) / POOL_GRANULARITY : 0;
+    struct pool_cache *cache = &msvcrt_get_thread_data()->pool_cache[class];
+    unsigned short *block_size;
+    void **block;
+
+    if(!cache->head)
+    {
+        EnterCriticalSection(&pool_cs);
+        if(!list_empty(&pool_partial[class]) || pool_add_chunk(class))
+        {
+            struct list *entry;
+
+            while(cache->count < POOL_CACHE_SIZE / 2 && (entry = list_head(&pool_partial[class])))
+            {
+                struct pool_chunk *chunk = LIST_ENTRY(entry, struct pool_chunk, entry);
+
+                block = chunk->free;
+                chunk->free = *block;
+                if(!--chunk->free_count)
+                    list_remove(&chunk->entry);
+                *block = cache->head;
+                cache->head = block;
+                cache->count++;
+            }
+        }
+        LeaveCriticalSection(&pool_cs);
+        if(!cache->head) return NULL;
+    }
+
+    block = cache->head;
+    cache->head = *block;
+    cache->count--;
+
+    block_size = pool_block_size(block, &class);
+    *block_size = size + 1;
+    return block;
+}
+
+static BOOL pool_free(void *ptr)
+{
+    DWORD err = GetLastError();
+    thread_data_t *data = TlsGetValue(msvcrt_tls_index);
+    unsigned short *size;
+    unsigned int class;
+
+    /* don't put a block twice in the lists */
+    if(!(size = pool_block_size(ptr, &class)) || !*size)
+    {
+        WARN("invalid or already freed block %p\n", ptr);
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    SetLastError(err);
+    *size = 0;
+
+    if(!data)
+    {
+        EnterCriticalSection(&pool_cs);
+        pool_release_block(ptr, class);
+        LeaveCriticalSection(&pool_cs);
+        return TRUE;
+    }
+
+    *(void**)ptr = data->pool_cache[class].head;
+    data->pool_cache[class].head = ptr;
+    if(data->pool_cache[class].trim_gen != pool_trim_gen)
+    {
+        /* _heapmin was called since the cache was last trimmed */
+        data->pool_cache[class].trim_gen = pool_trim_gen;
+        data->pool_cache[class].count++;
+        pool_trim_cache(&data->pool_cache[class], class, 0);
+    }
+    else if(++data->pool_cache[class].count > POOL_CACHE_SIZE)
+        pool_trim_cache(&data->pool_cache[class], class, POOL_CACHE_SIZE / 2);
+    return TRUE;
+}
+
+static MSVCRT_size_t pool_size(void *ptr)
+{
+    unsigned int class;
+    unsigned short *size = pool_block_size(ptr, &class);
+
+    return size && *size ? *size - 1 : ~(MSVCRT_size_t)0;
+}
+
+static void* msvcrt_heap_alloc(DWORD flags, MSVCRT_size_t size);
+static BOOL msvcrt_heap_free(void *ptr);
+
+static void* pool_realloc(DWORD flags, void *ptr, MSVCRT_size_t size)
+{
+    MSVCRT_size_t old_size;
+    unsigned short *block_size;
+    unsigned int class;
+    void *ret;
+
+    block_size = pool_block_size(ptr, &class);
+    if(!block_size || !*block_size)
+        return NULL;
+    if(size <= (class + 1) * POOL_GRANULARITY)
+    {
+        *block_size = size + 1;
+        return ptr;
+    }
+    if(flags & HEAP_REALLOC_IN_PLACE_ONLY)
+        return NULL;
+
+    old_size = *block_size - 1;
+    if(!(ret = msvcrt_heap_alloc(flags, size)))
+        return NULL;
+    memcpy(ret, ptr, old_size);
+    pool_free(ptr);
+    return ret;
+}
+
+/* returns the next used block of the pool, after next->_pentry if it's in the pool */
+static int pool_walk(struct MSVCRT__heapinfo *next)
+{
+    DWORD_PTR chunk = 0, chunks;
+    unsigned int class, i = 0;
+
+    EnterCriticalSection(&pool_cs);
+    chunks = pool_committed / POOL_CHUNK_SIZE;
+    if(pool_contains(next->_pentry))
+    {
+        unsigned short *size = pool_block_size(next->_pentry, &class);
+
+        if(!size)
+        {
+            LeaveCriticalSection(&pool_cs);
+            return MSVCRT__HEAPBADNODE;
+        }
+        chunk = ((char*)next->_pentry - pool_base) / POOL_CHUNK_SIZE;
+        i = size - pool_get_chunk(next->_pentry)->sizes + 1;
+    }
+
+    for(; chunk < chunks; chunk++, i = 0)
+    {
+        struct pool_chunk *c = (struct pool_chunk*)(pool_base + chunk * POOL_CHUNK_SIZE);
+
+        class = pool_chunk_class[chunk];
+        if(class == POOL_CHUNK_FREE) continue;
+        for(; i < pool_block_count[class]; i++)
+        {
+            if(!c->sizes[i]) continue;
+            next->_pentry = (int*)((char*)c + pool_block_offset[class] +
+                    i * (class + 1) * POOL_GRANULARITY);
+            next->_size = c->sizes[i] - 1;
+            next->_useflag = MSVCRT__USEDENTRY;
+            LeaveCriticalSection(&pool_cs);
+            return MSVCRT__HEAPOK;
+        }
+    }
+    LeaveCriticalSection(&pool_cs);
+    return MSVCRT__HEAPEND;
+}
+
+/* checks the free lists of the chunks, and the cache of the current thread */
+static BOOL pool_check(void)
+{
+    thread_data_t *data = TlsGetValue(msvcrt_tls_index);
+    DWORD_PTR chunk, chunks;
+    unsigned int class, count;
+    unsigned short *size;
+    void **block;
+    BOOL ret = TRUE;
+
+    EnterCriticalSection(&pool_cs);
+    chunks = pool_committed / POOL_CHUNK_SIZE;
+    for(chunk = 0; chunk < chunks && ret; chunk++)
+    {
+        struct pool_chunk *c = (struct pool_chunk*)(pool_base + chunk * POOL_CHUNK_SIZE);
+
+        if(pool_chunk_class[chunk] == POOL_CHUNK_FREE) continue;
+        for(count = 0, block = c->free; block && count <= c->free_count; block = *block, count++)
+        {
+            if(!pool_contains(block) || pool_get_chunk(block) != c ||
+                    !(size = pool_block_size(block, &class)) || *size)
+                break;
+        }
+        if(block || count != c->free_count)
+        {
+            WARN("corrupted free list in chunk %p\n", c);
+            ret = FALSE;
+        }
+    }
+
+    for(class = 0; data && class < POOL_CLASSES && ret; class++)
+    {
+        unsigned int c;
+
+        for(count = 0, block = data->pool_cache[class].head;
+                block && count <= data->pool_cache[class].count; block = *block, count++)
+        {
+            if(!pool_contains(block) || !(size = pool_block_size(block, &c)) || c != class || *size)
+                break;
+        }
+        if(block || count != data->pool_cache[class].count)
+        {
+            WARN("corrupted cache for class %u\n", class);
+            ret = FALSE;
+        }
+    }
+    LeaveCriticalSection(&pool_cs);
+    return ret;
+}
+
+/* empties the cache of the current thread, and asks the other ones to do the same
+ * the next time they free a block; then decommits the chunks that are entirely free */
+static void pool_minimize(void)
+{
+    thread_data_t *data = TlsGetValue(msvcrt_tls_index);
+    struct pool_chunk *chunk, *next;
+    unsigned int class;
+
+    InterlockedIncrement((LONG*)&pool_trim_gen);
+    if(data) msvcrt_free_pool_cache(data);
+
+    EnterCriticalSection(&pool_cs);
+    for(class = 0; class < POOL_CLASSES; class++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE(chunk, next, &pool_partial[class], struct pool_chunk, entry)
+        {
+            if(chunk->free_count == pool_block_count[class])
+                pool_decommit_chunk(chunk);
+        }
+    }
+    LeaveCriticalSection(&pool_cs);
+}
+
+void msvcrt_free_pool_cache(thread_data_t *data)
+{
+    unsigned int i;
+
+    for(i = 0; i < POOL_CLASSES; i++)
+    {
+        if(data->pool_cache[i].count)
+            pool_trim_cache(&data->pool_cache[i], i, 0);
+    }
+}
+
 static void* msvcrt_heap_alloc(DWORD flags, MSVCRT_size_t size)
 {
+    if(size >= MSVCRT_sbh_threshold && size <= POOL_MAX_SIZE && pool_enabled)
+    {
+        void *memblock = pool_alloc(size);
+
+        if(memblock)
+        {
+            if(flags & HEAP_ZERO_MEMORY) memset(memblock, 0, size);
+            return memblock;
+        }
+    }
+
     if(size < MSVCRT_sbh_threshold)
     {
         void *memblock, *temp, **saved;
@@ -73,6 +501,9 @@ static void* msvcrt_heap_alloc(DWORD flags, MSVCRT_size_t size)
 
 static void* msvcrt_heap_realloc(DWORD flags, void *ptr, MSVCRT_size_t size)
 {
+    if(pool_contains(ptr))
+        return pool_realloc(flags, ptr, size);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         /* TODO: move data to normal heap if it exceeds sbh_threshold limit */
@@ -105,6 +536,9 @@ static void* msvcrt_heap_realloc(DWORD flags, void *ptr, MSVCRT_size_t size)
 
 static BOOL msvcrt_heap_free(void *ptr)
 {
+    if(pool_contains(ptr))
+        return pool_free(ptr);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         void **saved = SAVED_PTR(ptr);
@@ -116,6 +550,9 @@ static BOOL msvcrt_heap_free(void *ptr)
 
 static MSVCRT_size_t msvcrt_heap_size(void *ptr)
 {
+    if(pool_contains(ptr))
+        return pool_size(ptr);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         void **saved = SAVED_PTR(ptr);
@@ -249,6 +686,8 @@ int CDECL _heapchk(void)
     msvcrt_set_errno(GetLastError());
     return MSVCRT__HEAPBADNODE;
   }
+  if (pool_base && !pool_check())
+    return MSVCRT__HEAPBADNODE;
   return MSVCRT__HEAPOK;
 }
 
@@ -257,6 +696,8 @@ int CDECL _heapchk(void)
  */
 int CDECL _heapmin(void)
 {
+  if (pool_base) pool_minimize();
+
   if (!HeapCompact( heap, 0 ) ||
           (sb_heap && !HeapCompact( sb_heap, 0 )))
   {
@@ -277,6 +718,10 @@ int CDECL _heapwalk(struct MSVCRT__heapinfo* next)
   if (sb_heap)
       FIXME("small blocks heap not supported\n");
 
+  /* blocks of the pool are listed after the ones of the heap */
+  if (pool_contains(next->_pentry))
+    return pool_walk(next);
+
   LOCK_HEAP;
   phe.lpData = next->_pentry;
   phe.cbData = next->_size;
@@ -296,7 +741,7 @@ int CDECL _heapwalk(struct MSVCRT__heapinfo* next)
     {
       UNLOCK_HEAP;
       if (GetLastError() == ERROR_NO_MORE_ITEMS)
-         return MSVCRT__HEAPEND;
+         return pool_walk(next);
       msvcrt_set_errno(GetLastError());
       if (!phe.lpData)
         return MSVCRT__HEAPBADBEGIN;
@@ -867,6 +1312,28 @@ int CDECL MSVCRT_strncpy_s(char *dest, MSVCRT_size_t numberOfElements,
 
 BOOL msvcrt_init_heap(void)
 {
+    char heap_select[32];
+    unsigned int i, count;
+
+    for(i = 0; i < POOL_CLASSES; i++)
+    {
+        MSVCRT_size_t block_size = (i + 1) * POOL_GRANULARITY;
+        MSVCRT_size_t header = FIELD_OFFSET(struct pool_chunk, sizes);
+
+        count = (POOL_CHUNK_SIZE - header) / (block_size + sizeof(unsigned short));
+        while(((header + count * sizeof(unsigned short) + POOL_GRANULARITY - 1) & ~(POOL_GRANULARITY - 1))
+                + count * block_size > POOL_CHUNK_SIZE)
+            count--;
+        pool_block_count[i] = count;
+        pool_block_offset[i] = (header + count * sizeof(unsigned short) + POOL_GRANULARITY - 1) & ~(POOL_GRANULARITY - 1);
+        list_init(&pool_partial[i]);
+    }
+
+    if(GetEnvironmentVariableA("__MSVCRT_HEAP_SELECT", heap_select, sizeof(heap_select)) &&
+            (!strcmp(heap_select, "__GLOBAL_HEAP_SELECTED,2") ||
+             !strcmp(heap_select, "__GLOBAL_HEAP_SELECTED,3")))
+        pool_enabled = TRUE;
+
     heap = HeapCreate(0, 0, 0);
     return heap != NULL;
 }
@@ -876,4 +1343,6 @@ void msvcrt_destroy_heap(void)
     HeapDestroy(heap);
     if(sb_heap)
         HeapDestroy(sb_heap);
+    if(pool_base)
+        VirtualFree(pool_base, 0, MEM_RELEASE);
 }
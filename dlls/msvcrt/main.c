@@ -79,8 +79,10 @@ static inline void msvcrt_free_tls_mem(void)
         free_locinfo(tls->locinfo);
         free_mbcinfo(tls->mbcinfo);
     }
+    msvcrt_free_pool_cache(tls);
   }
   HeapFree(GetProcessHeap(), 0, tls);
+  TlsSetValue(msvcrt_tls_index, NULL);
 }
 
 /*********************************************************************
@@ -111,6 +113,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
         return FALSE;
     }
     msvcrt_init_math();
+    msvcrt_init_simd();
     msvcrt_init_io();
     msvcrt_init_console();
     msvcrt_init_args();
@@ -255,6 +255,14 @@ void CDECL __DestructExceptionObject(EXCEPTION_RECORD*);
 /* TLS data */
 extern DWORD msvcrt_tls_index DECLSPEC_HIDDEN;
 
+/* per-thread cache of free small blocks, see heap.c */
+#define POOL_CLASSES 64
+struct pool_cache {
+    void                           *head;
+    unsigned int                    count;
+    unsigned int                    trim_gen;
+};
+
 /* Keep in sync with msvcr90/tests/msvcr90.c */
 struct __thread_data {
     DWORD                           tid;
@@ -301,6 +309,8 @@ struct __thread_data {
 #if _MSVCR_VER >= 140
     MSVCRT_invalid_parameter_handler invalid_parameter_handler;
 #endif
+    struct pool_cache               pool_cache[POOL_CLASSES];
+    DWORD                           stream_owner_id;
 };
 
 typedef struct __thread_data thread_data_t;
@@ -374,7 +384,32 @@ extern void msvcrt_free_signals(void) DECLSPEC_HIDDEN;
 extern void msvcrt_free_popen_data(void) DECLSPEC_HIDDEN;
 extern BOOL msvcrt_init_heap(void) DECLSPEC_HIDDEN;
 extern void msvcrt_destroy_heap(void) DECLSPEC_HIDDEN;
+extern void msvcrt_free_pool_cache(thread_data_t*) DECLSPEC_HIDDEN;
 extern void msvcrt_init_clock(void) DECLSPEC_HIDDEN;
+extern void msvcrt_init_simd(void) DECLSPEC_HIDDEN;
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && (__GNUC__ >= 5 || defined(__clang__))
+#define MSVCRT_HAVE_SIMD
+#define SSE2_FUNC __attribute__((target("sse2")))
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+/* instruction sets used by the vector versions of the string functions */
+enum msvcrt_simd_level
+{
+    MSVCRT_SIMD_NONE,
+    MSVCRT_SIMD_SSE2,
+    MSVCRT_SIMD_AVX2
+};
+
+extern enum msvcrt_simd_level msvcrt_simd_level DECLSPEC_HIDDEN;
+
+/* check if reading size bytes at ptr would touch the next page; the vector
+ * string functions must not, since the string may end just before it */
+static inline BOOL msvcrt_crosses_page( const void *ptr, unsigned int size )
+{
+    return ((ULONG_PTR)ptr & 0xfff) > 0x1000 - size;
+}
+#endif
 
 #if _MSVCR_VER >= 100
 extern void msvcrt_init_scheduler(void*) DECLSPEC_HIDDEN;
@@ -139,6 +139,81 @@ static inline int mbstowcs_len(MSVCRT_wchar_t *wcstr, const char *mbstr,
     }
     return wlen;
 }
+
+/* Fast path for pf_output_fp: rounds v to the requested precision using a
+ * 128-bit approximation of v*10^q and stores the digits in b. Fails for
+ * subnormals, when the digits don't fit in 64 bits or when v*10^q is too
+ * close to a rounding boundary. */
+static inline BOOL pf_fast_fp_digits(double v, const pf_flags *flags, struct bnum *b, int *e10)
+{
+    ULONGLONG m = *(ULONGLONG*)&v, lo, hi, hi2, d, frac, lim = 0;
+    int e2, e10_min, q, sh, len, radix_pos, first_limb_len, pad, i;
+
+    if(flags->Precision < 0) return FALSE;
+
+    e2 = (m >> (MANT_BITS - 1)) & ((1 << EXP_BITS) - 1);
+    if(!e2 || e2 == (1 << EXP_BITS) - 1) return FALSE;
+    m = (m & (((ULONGLONG)1 << (MANT_BITS - 1)) - 1)) | ((ULONGLONG)1 << (MANT_BITS - 1));
+    e2 -= (1 << (EXP_BITS - 1)) - 1 + MANT_BITS - 1;
+    /* floor(log10(v)) is e10_min or e10_min+1 */
+    e10_min = ((e2 + MANT_BITS - 1) * 78913) >> 18;
+
+    if(flags->Format == 'f' || flags->Format == 'F') {
+        q = flags->Precision;
+        if(q > 16 - e10_min) return FALSE;
+    } else {
+        len = flags->Precision;
+        if(!len || flags->Format == 'e' || flags->Format == 'E') len++;
+        if(len > 17) return FALSE;
+        q = len - 1 - e10_min;
+        for(lim = 1; len; len--) lim *= 10;
+    }
+
+    m <<= 64 - MANT_BITS;
+    for(;;) {
+        if(q < POW5_MIN || q > POW5_MAX) return FALSE;
+
+        lo = mul_64x64(m, pow5_128[q - POW5_MIN][0], &hi);
+        mul_64x64(m, pow5_128[q - POW5_MIN][1], &hi2);
+        lo += hi2;
+        if(lo < hi2) hi++;
+
+        /* v*10^q ~ (hi:lo) / 2^sh */
+        sh = 74 - e2 - pow5_log2(q) - q;
+        if(sh <= 64 || sh >= 128) return FALSE;
+        d = hi >> (sh - 64);
+        if(!lim || d < lim) break;
+        q--;
+    }
+
+    /* The computed value is below the exact one by less than 2 units of
+     * frac, or above it by less than 1. */
+    frac = (hi << (128 - sh)) | (lo >> (sh - 64));
+    if(frac - (((ULONGLONG)1 << 63) - 4) <= 8) return FALSE;
+    if(frac >> 63) d++;
+    if(!d) return FALSE;
+
+    for(len = 1, lim = 10; len < 19 && d >= lim; len++) lim *= 10;
+    radix_pos = len - q;
+    first_limb_len = (radix_pos - 1) % LIMB_DIGITS;
+    if(first_limb_len < 0) first_limb_len += LIMB_DIGITS;
+    first_limb_len++;
+
+    /* decimal point needs to be on limb boundary */
+    b->e = len <= first_limb_len ? 1 : 2 + (len - first_limb_len - 1) / LIMB_DIGITS;
+    pad = first_limb_len + LIMB_DIGITS * (b->e - 1) - len;
+    lim = pad ? p10s[LIMB_DIGITS - pad] : LIMB_MAX;
+    b->data[0] = d % lim * p10s[pad];
+    d /= lim;
+    for(i = 1; i < b->e; i++) {
+        b->data[i] = d % LIMB_MAX;
+        d /= LIMB_MAX;
+    }
+    for(b->b = 0; !b->data[b->b]; b->b++);
+
+    *e10 = radix_pos - first_limb_len - LIMB_DIGITS;
+    return TRUE;
+}
 #endif
 
 static inline int FUNC_NAME(pf_output_wstr)(FUNC_NAME(puts_clbk) pf_puts, void *puts_ctx,
@@ -590,8 +665,13 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
     if(flags->Precision == -1)
         flags->Precision = 6;
 
-    v = frexp(v, &e2);
-    if(v) {
+    if(!v) {
+        b.b = 0;
+        b.e = 1;
+        b.data[0] = 0;
+        e10 = -LIMB_DIGITS;
+    } else if(!pf_fast_fp_digits(v, flags, &b, &e10)) {
+        v = frexp(v, &e2);
         m = (ULONGLONG)1 << (MANT_BITS - 1);
         m |= (*(ULONGLONG*)&v & (((ULONGLONG)1 << (MANT_BITS - 1)) - 1));
         b.data[0] = m % LIMB_MAX;
@@ -610,11 +690,6 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
             if(bnum_rshift(&b, shift)) e10 -= LIMB_DIGITS;
             e2 += shift;
         }
-    } else {
-        b.b = 0;
-        b.e = 1;
-        b.data[0] = 0;
-        e10 = -LIMB_DIGITS;
     }
 
     if(!b.data[BNUM_IDX(b.e-1)])
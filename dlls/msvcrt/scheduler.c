@@ -84,14 +84,39 @@ struct scheduler_list {
     struct scheduler_list *next;
 };
 
+struct scheduled_chore {
+    void (__cdecl *proc)(void*);
+    void *data;
+};
+
+/* The worker running on a virtual processor pushes and pops chores at the
+ * tail of its queue, other workers steal them from the head. */
+struct chore_queue {
+    SRWLOCK lock;
+    struct scheduled_chore *chores;
+    volatile unsigned int head;
+    volatile unsigned int tail;
+    unsigned int size;
+};
+
+typedef struct {
+    struct ThreadScheduler *scheduler;
+    unsigned int id;
+    LONG owned;
+    struct chore_queue queue;
+} virtual_processor;
+
 typedef struct {
     Context context;
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    virtual_processor *vproc;
+    struct ThreadScheduler *worker;  /* scheduler that started this thread, or NULL */
+    LONG blocked;
 } ExternalContextBase;
 extern const vtable_ptr MSVCRT_ExternalContextBase_vtable;
-static void ExternalContextBase_ctor(ExternalContextBase*);
+static void ExternalContextBase_ctor(ExternalContextBase*, struct Scheduler*);
 
 typedef struct Scheduler {
     const vtable_ptr *vtable;
@@ -120,7 +145,7 @@ typedef struct Scheduler {
         void, (Scheduler*,void (__cdecl*)(void*),void*), (this,proc,data))
 #endif
 
-typedef struct {
+typedef struct ThreadScheduler {
     Scheduler scheduler;
     LONG ref;
     unsigned int id;
@@ -130,6 +155,15 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    virtual_processor *vprocs;
+    LONG next_vproc;
+    LONG pending;
+    LONG idle;
+    LONG wakeups;
+    LONG workers;
+    BOOL shutdown;
+    BOOL destroy;
+    CONDITION_VARIABLE cv;
 } ThreadScheduler;
 extern const vtable_ptr MSVCRT_ThreadScheduler_vtable;
 
@@ -142,6 +176,11 @@ typedef struct {
 } _CurrentScheduler;
 
 static int context_tls_index = TLS_OUT_OF_INDEXES;
+static HMODULE scheduler_module;
+static HANDLE keyed_event;
+
+/* idle workers exit after this many milliseconds */
+#define WORKER_IDLE_TIMEOUT 1000
 
 static CRITICAL_SECTION default_scheduler_cs;
 static CRITICAL_SECTION_DEBUG default_scheduler_cs_debug =
@@ -155,6 +194,8 @@ static SchedulerPolicy default_scheduler_policy;
 static ThreadScheduler *default_scheduler;
 
 static void create_default_scheduler(void);
+static virtual_processor* ThreadScheduler_claim_vproc(ThreadScheduler*);
+static void ThreadScheduler_wake(ThreadScheduler*);
 
 static Context* try_get_current_context(void)
 {
@@ -163,26 +204,30 @@ static Context* try_get_current_context(void)
     return TlsGetValue(context_tls_index);
 }
 
-static Context* get_current_context(void)
+static void alloc_context_tls(void)
 {
-    Context *ret;
-
     if (context_tls_index == TLS_OUT_OF_INDEXES) {
         int tls_index = TlsAlloc();
         if (tls_index == TLS_OUT_OF_INDEXES) {
             throw_exception(EXCEPTION_SCHEDULER_RESOURCE_ALLOCATION_ERROR,
                     HRESULT_FROM_WIN32(GetLastError()), NULL);
-            return NULL;
+            return;
         }
 
         if(InterlockedCompareExchange(&context_tls_index, tls_index, TLS_OUT_OF_INDEXES) != TLS_OUT_OF_INDEXES)
             TlsFree(tls_index);
     }
+}
+
+static Context* get_current_context(void)
+{
+    Context *ret;
 
+    alloc_context_tls();
     ret = TlsGetValue(context_tls_index);
     if (!ret) {
         ExternalContextBase *context = MSVCRT_operator_new(sizeof(ExternalContextBase));
-        ExternalContextBase_ctor(context);
+        ExternalContextBase_ctor(context, NULL);
         TlsSetValue(context_tls_index, context);
         ret = &context->context;
     }
@@ -233,7 +278,32 @@ unsigned int __cdecl Context_Id(void)
 /* ?Block@Context@Concurrency@@SAXXZ */
 void __cdecl Context_Block(void)
 {
-    FIXME("()\n");
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    virtual_processor *vproc;
+
+    TRACE("()\n");
+
+    if (context->context.vtable != &MSVCRT_ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    /* Unblock was called first */
+    if (InterlockedDecrement(&context->blocked) >= 0)
+        return;
+
+    /* let another worker run the chores queued on our virtual processor */
+    if ((vproc = context->vproc)) {
+        context->vproc = NULL;
+        InterlockedExchange(&vproc->owned, 0);
+        if (vproc->scheduler->pending > 0)
+            ThreadScheduler_wake(vproc->scheduler);
+    }
+
+    NtWaitForKeyedEvent(keyed_event, &context->blocked, 0, NULL);
+
+    if (vproc)
+        context->vproc = ThreadScheduler_claim_vproc(vproc->scheduler);
 }
 
 /* ?Yield@Context@Concurrency@@SAXXZ */
@@ -288,8 +358,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->vproc ? this->vproc->id : -1;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -302,14 +372,17 @@ unsigned int __thiscall ExternalContextBase_GetScheduleGroupId(const ExternalCon
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Unblock, 4)
 void __thiscall ExternalContextBase_Unblock(ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
+    TRACE("(%p)->()\n", this);
+
+    if (!InterlockedIncrement(&this->blocked))
+        NtReleaseKeyedEvent(keyed_event, &this->blocked, 0, NULL);
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_IsSynchronouslyBlocked, 4)
 MSVCRT_bool __thiscall ExternalContextBase_IsSynchronouslyBlocked(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return FALSE;
+    TRACE("(%p)->()\n", this);
+    return this->blocked < 0;
 }
 
 static void ExternalContextBase_dtor(ExternalContextBase *this)
@@ -357,14 +430,29 @@ Context* __thiscall ExternalContextBase_vector_dtor(ExternalContextBase *this, u
     return &this->context;
 }
 
-static void ExternalContextBase_ctor(ExternalContextBase *this)
+/* Contexts of worker threads don't hold a reference to their scheduler,
+ * it waits for the workers to exit when it's destroyed. */
+static void ExternalContextBase_ctor(ExternalContextBase *this, Scheduler *worker_scheduler)
 {
-    TRACE("(%p)->()\n", this);
+    TRACE("(%p)->(%p)\n", this, worker_scheduler);
 
     memset(this, 0, sizeof(*this));
     this->context.vtable = &MSVCRT_ExternalContextBase_vtable;
     this->id = InterlockedIncrement(&context_id);
 
+    if(!keyed_event) {
+        HANDLE event;
+
+        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
+        if(InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
+            NtClose(event);
+    }
+
+    if(worker_scheduler) {
+        this->scheduler.scheduler = worker_scheduler;
+        return;
+    }
+
     create_default_scheduler();
     this->scheduler.scheduler = &default_scheduler->scheduler;
     call_Scheduler_Reference(&default_scheduler->scheduler);
@@ -600,9 +688,22 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
 
 static void ThreadScheduler_dtor(ThreadScheduler *this)
 {
-    int i;
+    unsigned int i;
 
     if(this->ref != 0) WARN("ref = %d\n", this->ref);
+
+    /* workers exit once all the queued chores are done */
+    EnterCriticalSection(&this->cs);
+    this->shutdown = TRUE;
+    WakeAllConditionVariable(&this->cv);
+    while(this->workers)
+        SleepConditionVariableCS(&this->cv, &this->cs, INFINITE);
+    LeaveCriticalSection(&this->cs);
+
+    for(i=0; i<this->virt_proc_no; i++)
+        MSVCRT_free(this->vprocs[i].queue.chores);
+    MSVCRT_operator_delete(this->vprocs);
+
     SchedulerPolicy_dtor(&this->policy);
 
     for(i=0; i<this->shutdown_count; i++)
@@ -613,6 +714,24 @@ static void ThreadScheduler_dtor(ThreadScheduler *this)
     DeleteCriticalSection(&this->cs);
 }
 
+/* A worker can't wait for itself to exit: when the scheduler is destroyed
+ * by one of its chores, the last worker to exit frees it. */
+static BOOL ThreadScheduler_defer_delete(ThreadScheduler *this)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+
+    if(!context || context->context.vtable != &MSVCRT_ExternalContextBase_vtable ||
+            context->worker != this)
+        return FALSE;
+
+    EnterCriticalSection(&this->cs);
+    this->shutdown = TRUE;
+    this->destroy = TRUE;
+    WakeAllConditionVariable(&this->cv);
+    LeaveCriticalSection(&this->cs);
+    return TRUE;
+}
+
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_Id, 4)
 unsigned int __thiscall ThreadScheduler_Id(const ThreadScheduler *this)
 {
@@ -649,7 +768,7 @@ unsigned int __thiscall ThreadScheduler_Release(ThreadScheduler *this)
 
     TRACE("(%p)\n", this);
 
-    if(!ret) {
+    if(!ret && !ThreadScheduler_defer_delete(this)) {
         ThreadScheduler_dtor(this);
         MSVCRT_operator_delete(this);
     }
@@ -717,18 +836,218 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup, 4)
     return NULL;
 }
 
-DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
-void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
-        void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
+static BOOL chore_queue_push(struct chore_queue *queue, void (__cdecl *proc)(void*), void *data)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    AcquireSRWLockExclusive(&queue->lock);
+    if(queue->tail - queue->head == queue->size) {
+        unsigned int i, size = queue->size ? queue->size * 2 : 16;
+        struct scheduled_chore *chores = MSVCRT_malloc(size * sizeof(*chores));
+
+        if(!chores) {
+            ReleaseSRWLockExclusive(&queue->lock);
+            return FALSE;
+        }
+        for(i=0; i<queue->size; i++)
+            chores[i] = queue->chores[(queue->head + i) & (queue->size - 1)];
+        MSVCRT_free(queue->chores);
+        queue->chores = chores;
+        queue->head = 0;
+        queue->tail = queue->size;
+        queue->size = size;
+    }
+    queue->chores[queue->tail & (queue->size - 1)].proc = proc;
+    queue->chores[queue->tail & (queue->size - 1)].data = data;
+    queue->tail++;
+    ReleaseSRWLockExclusive(&queue->lock);
+    return TRUE;
+}
+
+static BOOL chore_queue_pop(struct chore_queue *queue, BOOL steal, struct scheduled_chore *chore)
+{
+    BOOL ret = FALSE;
+
+    if(queue->head == queue->tail)
+        return FALSE;
+
+    AcquireSRWLockExclusive(&queue->lock);
+    if(queue->head != queue->tail) {
+        if(steal)
+            *chore = queue->chores[queue->head++ & (queue->size - 1)];
+        else
+            *chore = queue->chores[--queue->tail & (queue->size - 1)];
+        ret = TRUE;
+    }
+    ReleaseSRWLockExclusive(&queue->lock);
+    return ret;
+}
+
+static virtual_processor* ThreadScheduler_claim_vproc(ThreadScheduler *this)
+{
+    unsigned int i;
+
+    for(i=0; i<this->virt_proc_no; i++) {
+        if(!InterlockedCompareExchange(&this->vprocs[i].owned, 1, 0))
+            return &this->vprocs[i];
+    }
+    return NULL;
+}
+
+static BOOL ThreadScheduler_get_chore(ThreadScheduler *this,
+        virtual_processor *vproc, struct scheduled_chore *chore)
+{
+    unsigned int i;
+
+    if(chore_queue_pop(&vproc->queue, FALSE, chore))
+        goto done;
+    for(i=1; i<this->virt_proc_no; i++) {
+        if(chore_queue_pop(&this->vprocs[(vproc->id + i) % this->virt_proc_no].queue, TRUE, chore))
+            goto done;
+    }
+    return FALSE;
+
+done:
+    InterlockedDecrement(&this->pending);
+    return TRUE;
+}
+
+static DWORD WINAPI ThreadScheduler_worker_proc(void *arg)
+{
+    virtual_processor *vproc = arg;
+    ThreadScheduler *scheduler = vproc->scheduler;
+    ExternalContextBase *context;
+    struct scheduled_chore chore;
+    BOOL exit, destroy;
+
+    context = MSVCRT_operator_new(sizeof(*context));
+    ExternalContextBase_ctor(context, &scheduler->scheduler);
+    context->vproc = vproc;
+    context->worker = scheduler;
+    TlsSetValue(context_tls_index, context);
+
+    for(;;) {
+        /* a context that got unblocked may have lost its virtual processor */
+        if(!context->vproc && !(context->vproc = ThreadScheduler_claim_vproc(scheduler)))
+            break;
+
+        if(ThreadScheduler_get_chore(scheduler, context->vproc, &chore)) {
+            chore.proc(chore.data);
+            continue;
+        }
+
+        EnterCriticalSection(&scheduler->cs);
+        InterlockedIncrement(&scheduler->idle);
+        while(!scheduler->pending && !scheduler->shutdown &&
+                SleepConditionVariableCS(&scheduler->cv, &scheduler->cs, WORKER_IDLE_TIMEOUT));
+        exit = !scheduler->pending;
+        /* release the virtual processor before we stop being counted as idle,
+         * ThreadScheduler_wake relies on it */
+        if(exit) {
+            InterlockedExchange(&context->vproc->owned, 0);
+            context->vproc = NULL;
+        }
+        /* ThreadScheduler_wake already took us off the idle count if it woke us up */
+        if(scheduler->wakeups)
+            scheduler->wakeups--;
+        else
+            InterlockedDecrement(&scheduler->idle);
+        LeaveCriticalSection(&scheduler->cs);
+        if(exit) break;
+    }
+
+    if(context->vproc)
+        InterlockedExchange(&context->vproc->owned, 0);
+    if(context->scheduler.scheduler == &scheduler->scheduler)
+        context->scheduler.scheduler = NULL;
+    call_Context_dtor(&context->context, 1);
+    TlsSetValue(context_tls_index, NULL);
+
+    EnterCriticalSection(&scheduler->cs);
+    destroy = FALSE;
+    if(!InterlockedDecrement(&scheduler->workers)) {
+        WakeAllConditionVariable(&scheduler->cv);
+        destroy = scheduler->destroy;
+    }
+    LeaveCriticalSection(&scheduler->cs);
+
+    if(destroy) {
+        ThreadScheduler_dtor(scheduler);
+        MSVCRT_operator_delete(scheduler);
+    }
+
+    FreeLibraryAndExitThread(scheduler_module, 0);
+}
+
+/* Wakes an idle worker, or starts a new one if a virtual processor is free.
+ * Otherwise all the workers are busy and will find the chore in the queues.
+ * Each idle worker is only woken up once, so that a burst of chores also
+ * starts new workers. */
+static void ThreadScheduler_wake(ThreadScheduler *this)
+{
+    virtual_processor *vproc;
+    HMODULE module;
+    HANDLE thread;
+
+    if(this->idle) {
+        EnterCriticalSection(&this->cs);
+        if(this->idle) {
+            InterlockedDecrement(&this->idle);
+            this->wakeups++;
+            WakeConditionVariable(&this->cv);
+            LeaveCriticalSection(&this->cs);
+            return;
+        }
+        LeaveCriticalSection(&this->cs);
+    }
+
+    if(!(vproc = ThreadScheduler_claim_vproc(this)))
+        return;
+
+    alloc_context_tls();
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (const WCHAR*)scheduler_module, &module);
+    InterlockedIncrement(&this->workers);
+    thread = CreateThread(NULL, 0, ThreadScheduler_worker_proc, vproc, 0, NULL);
+    if(!thread) {
+        ERR("failed to create worker thread: %u\n", GetLastError());
+        InterlockedDecrement(&this->workers);
+        InterlockedExchange(&vproc->owned, 0);
+        FreeLibrary(module);
+        return;
+    }
+    CloseHandle(thread);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    virtual_processor *vproc;
+
+    TRACE("(%p %p %p)\n", this, proc, data);
+
+    if(context && context->context.vtable == &MSVCRT_ExternalContextBase_vtable &&
+            context->vproc && context->vproc->scheduler == this)
+        vproc = context->vproc;
+    else
+        vproc = &this->vprocs[(unsigned int)InterlockedIncrement(&this->next_vproc) % this->virt_proc_no];
+
+    /* count the chore first, a worker may run it before the push returns */
+    InterlockedIncrement(&this->pending);
+    if(!chore_queue_push(&vproc->queue, proc, data)) {
+        InterlockedDecrement(&this->pending);
+        throw_exception(EXCEPTION_BAD_ALLOC, 0, "bad allocation");
+        return;
+    }
+    ThreadScheduler_wake(this);
+}
+
+DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
+void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
+        void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
+{
+    TRACE("(%p %p %p %p)\n", this, proc, data, placement);
+    /* the placement is only a hint */
+    ThreadScheduler_ScheduleTask(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -750,7 +1069,7 @@ Scheduler* __thiscall ThreadScheduler_vector_dtor(ThreadScheduler *this, unsigne
         for(i=*ptr-1; i>=0; i--)
             ThreadScheduler_dtor(this+i);
         MSVCRT_operator_delete(ptr);
-    } else {
+    } else if(!(flags & 1) || !ThreadScheduler_defer_delete(this)) {
         ThreadScheduler_dtor(this);
         if(flags & 1)
             MSVCRT_operator_delete(this);
@@ -763,6 +1082,7 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
         const SchedulerPolicy *policy)
 {
     SYSTEM_INFO si;
+    unsigned int i;
 
     TRACE("(%p)->()\n", this);
 
@@ -775,10 +1095,24 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
     this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MaxConcurrency);
     if(this->virt_proc_no > si.dwNumberOfProcessors)
         this->virt_proc_no = si.dwNumberOfProcessors;
+    if(this->virt_proc_no < SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency))
+        this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
 
+    this->vprocs = MSVCRT_operator_new(this->virt_proc_no * sizeof(*this->vprocs));
+    memset(this->vprocs, 0, this->virt_proc_no * sizeof(*this->vprocs));
+    for(i=0; i<this->virt_proc_no; i++) {
+        this->vprocs[i].scheduler = this;
+        this->vprocs[i].id = i;
+        InitializeSRWLock(&this->vprocs[i].queue.lock);
+    }
+    this->next_vproc = -1;
+    this->pending = this->idle = this->wakeups = this->workers = 0;
+    this->shutdown = this->destroy = FALSE;
+    InitializeConditionVariable(&this->cv);
+
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
     return this;
@@ -1127,6 +1461,7 @@ __ASM_BLOCK_END
 
 void msvcrt_init_scheduler(void *base)
 {
+    scheduler_module = base;
 #ifdef __x86_64__
     init_Context_rtti(base);
     init_ContextBase_rtti(base);
@@ -1147,6 +1482,8 @@ void msvcrt_free_scheduler(void)
         ThreadScheduler_dtor(default_scheduler);
         MSVCRT_operator_delete(default_scheduler);
     }
+    if(keyed_event)
+        NtClose(keyed_event);
 }
 
 void msvcrt_free_scheduler_thread(void)
@@ -52,6 +52,8 @@ static int (__cdecl *p_fopen_s)(FILE**, const char*, const char*);
 static int (__cdecl *p__wfopen_s)(FILE**, const wchar_t*, const wchar_t*);
 static errno_t (__cdecl *p__get_fmode)(int*);
 static errno_t (__cdecl *p__set_fmode)(int);
+static void (__cdecl *p__lock_file)(FILE*);
+static void (__cdecl *p__unlock_file)(FILE*);
 
 static const char* get_base_name(const char *path)
 {
@@ -76,6 +78,8 @@ static void init(void)
     __pioinfo = (void*)GetProcAddress(hmod, "__pioinfo");
     p__get_fmode = (void*)GetProcAddress(hmod, "_get_fmode");
     p__set_fmode = (void*)GetProcAddress(hmod, "_set_fmode");
+    p__lock_file = (void*)GetProcAddress(hmod, "_lock_file");
+    p__unlock_file = (void*)GetProcAddress(hmod, "_unlock_file");
 }
 
 static void test_filbuf( void )
@@ -2624,6 +2628,78 @@ static void test_lseek(void)
     DeleteFileA("_creat.tst");
 }
 
+static DWORD WINAPI lock_file_thread(void *arg)
+{
+    FILE *file = arg;
+
+    p__lock_file(file);
+    fputc('b', file);
+    p__unlock_file(file);
+    return 0;
+}
+
+static void test_lock_file(void)
+{
+    char buf[8];
+    FILE *file;
+    HANDLE thread;
+    DWORD ret;
+
+    if (!p__lock_file || !p__unlock_file)
+    {
+        win_skip("_lock_file not available\n");
+        return;
+    }
+
+    file = fopen("lock_file.tst", "w+");
+    ok(file != NULL, "fopen failed\n");
+    fputc('a', file);
+
+    p__lock_file(file);
+    thread = CreateThread(NULL, 0, lock_file_thread, file, 0, NULL);
+    ok(thread != NULL, "CreateThread failed\n");
+    ret = WaitForSingleObject(thread, 100);
+    ok(ret == WAIT_TIMEOUT, "thread didn't wait for the stream lock, ret %u\n", ret);
+    fputc('a', file);
+    p__unlock_file(file);
+
+    ret = WaitForSingleObject(thread, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    CloseHandle(thread);
+    fputc('c', file);
+
+    rewind(file);
+    memset(buf, 0, sizeof(buf));
+    ret = fread(buf, 1, sizeof(buf), file);
+    ok(ret == 4, "fread returned %u\n", ret);
+    ok(!strcmp(buf, "aabc"), "buf = %s\n", buf);
+    fclose(file);
+
+    /* the stream slot is reused, with a new owner */
+    file = fopen("lock_file.tst", "w+");
+    ok(file != NULL, "fopen failed\n");
+    p__lock_file(file);
+    thread = CreateThread(NULL, 0, lock_file_thread, file, 0, NULL);
+    ok(thread != NULL, "CreateThread failed\n");
+    ret = WaitForSingleObject(thread, 100);
+    ok(ret == WAIT_TIMEOUT, "thread didn't wait for the stream lock, ret %u\n", ret);
+    fputc('a', file);
+    p__unlock_file(file);
+
+    ret = WaitForSingleObject(thread, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    CloseHandle(thread);
+
+    rewind(file);
+    memset(buf, 0, sizeof(buf));
+    ret = fread(buf, 1, sizeof(buf), file);
+    ok(ret == 2, "fread returned %u\n", ret);
+    ok(!strcmp(buf, "ab"), "buf = %s\n", buf);
+
+    fclose(file);
+    unlink("lock_file.tst");
+}
+
 START_TEST(file)
 {
     int arg_c;
@@ -2696,6 +2772,7 @@ START_TEST(file)
     test_close();
     test__creat();
     test_lseek();
+    test_lock_file();
 
     /* Wait for the (_P_NOWAIT) spawned processes to finish to make sure the report
      * file contains lines in the correct order
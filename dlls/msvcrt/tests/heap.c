@@ -483,6 +483,90 @@ static void test_calloc(void)
     free(ptr);
 }
 
+static void *shared_blocks[256];
+
+static DWORD WINAPI small_blocks_thread(void *arg)
+{
+    unsigned char *blocks[64];
+    unsigned int i, j, k, size;
+
+    for (i = 0; i < 100; i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(blocks); j++)
+        {
+            size = (i * 37 + j * 13) % 1100;
+            blocks[j] = malloc(size);
+            ok(blocks[j] != NULL, "malloc(%u) failed\n", size);
+            ok(!((UINT_PTR)blocks[j] & (sizeof(void*) * 2 - 1)), "incorrect alignment (%p)\n", blocks[j]);
+            ok(_msize(blocks[j]) == size, "_msize returned %d, expected %u\n", (int)_msize(blocks[j]), size);
+            memset(blocks[j], j, size);
+        }
+        for (j = 0; j < ARRAY_SIZE(blocks); j += 2)
+        {
+            size = _msize(blocks[j]);
+            blocks[j] = realloc(blocks[j], size + 20);
+            ok(blocks[j] != NULL, "realloc(%u) failed\n", size + 20);
+            ok(_msize(blocks[j]) == size + 20, "_msize returned %d, expected %u\n", (int)_msize(blocks[j]), size + 20);
+            for (k = 0; k < size; k++)
+                if (blocks[j][k] != j) break;
+            ok(k == size, "block content changed at %u\n", k);
+        }
+        for (j = 0; j < ARRAY_SIZE(blocks); j++)
+            free(blocks[j]);
+    }
+
+    /* free blocks allocated by another thread */
+    for (i = 0; i < ARRAY_SIZE(shared_blocks); i++)
+    {
+        if (i % 4 != (UINT_PTR)arg) continue;
+        ok(_msize(shared_blocks[i]) == i, "_msize returned %d, expected %u\n", (int)_msize(shared_blocks[i]), i);
+        free(shared_blocks[i]);
+    }
+    return 0;
+}
+
+static void test_small_blocks(void)
+{
+    struct _heapinfo info;
+    HANDLE threads[4];
+    void *mem;
+    int i, ret;
+
+    for (i = 0; i < ARRAY_SIZE(shared_blocks); i++)
+    {
+        shared_blocks[i] = malloc(i);
+        ok(shared_blocks[i] != NULL, "malloc(%d) failed\n", i);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread(NULL, 0, small_blocks_thread, (void*)(UINT_PTR)i, 0, NULL);
+    WaitForMultipleObjects(ARRAY_SIZE(threads), threads, TRUE, INFINITE);
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        CloseHandle(threads[i]);
+
+    mem = calloc(3, 8);
+    ok(mem != NULL, "calloc failed\n");
+    for (i = 0; i < 24; i++)
+        if (((unsigned char*)mem)[i]) break;
+    ok(i == 24, "calloc didn't zero the block\n");
+
+    memset(&info, 0, sizeof(info));
+    while ((ret = _heapwalk(&info)) == _HEAPOK)
+    {
+        if (info._pentry == mem) break;
+    }
+    ok(ret == _HEAPOK, "_heapwalk returned %d\n", ret);
+    ok(info._pentry == mem, "block not found\n");
+    ok(info._useflag == _USEDENTRY, "_useflag = %d\n", info._useflag);
+    free(mem);
+
+    ret = _heapchk();
+    ok(ret == _HEAPOK, "_heapchk returned %d\n", ret);
+    _heapmin();
+    ret = _heapchk();
+    ok(ret == _HEAPOK, "_heapchk returned %d\n", ret);
+}
+
 START_TEST(heap)
 {
     void *mem;
@@ -508,4 +592,5 @@ START_TEST(heap)
     test_aligned();
     test_sbheap();
     test_calloc();
+    test_small_blocks();
 }
@@ -251,6 +251,18 @@ static void test_sprintf( void )
         { "%.0f", "-1", 0, DOUBLE_ARG, 0, 0, -0.5 },
         { "%.0f", "1", 0, DOUBLE_ARG, 0, 0, 0.5 },
         { "%.0f", "2", 0, DOUBLE_ARG, 0, 0, 1.5 },
+        { "%.2f", "0.13", 0, DOUBLE_ARG, 0, 0, 0.125 },
+        { "%.1f", "0.1", 0, DOUBLE_ARG, 0, 0, 0.05 },
+        { "%.3f", "1000.000", 0, DOUBLE_ARG, 0, 0, 999.9996 },
+        { "%f", "1234567.000000", 0, DOUBLE_ARG, 0, 0, 1234567.0 },
+        { "%g", "123.456", 0, DOUBLE_ARG, 0, 0, 123.456 },
+        { "%e", "1.234560e+002", 0, DOUBLE_ARG, 0, 0, 123.456 },
+        { "%g", "1e+006", 0, DOUBLE_ARG, 0, 0, 1e6 },
+        { "%.0e", "1e+000", 0, DOUBLE_ARG, 0, 0, 0.96 },
+        { "%.15g", "0.1", 0, DOUBLE_ARG, 0, 0, 0.1 },
+        { "%.17g", "0.10000000000000001", 0, DOUBLE_ARG, 0, 0, 0.1 },
+        { "%.16e", "9.9999999999999992e+022", 0, DOUBLE_ARG, 0, 0, 1e23 },
+        { "%.3e", "-2.225e-308", 0, DOUBLE_ARG, 0, 0, -2.2250738585072014e-308 },
         { "%.30f", "0.333333333333333310000000000000", 0, TODO_FLAG | DOUBLE_ARG, 0, 0, 1.0/3.0 },
         { "%.30lf", "1.414213562373095100000000000000", 0, TODO_FLAG | DOUBLE_ARG, 0, 0, sqrt(2) },
     };
@@ -1961,6 +1961,11 @@ static void test__strtod(void)
         { ".00", 3, 0 },
         { "-0.", 3, 0 },
         { "0e13", 4, 0 },
+        { "9007199254740993", 16, 9007199254740992.0 },
+        { "9007199254740995", 16, 9007199254740996.0 },
+        { "9007199254740993.0000000000000000001", 36, 9007199254740994.0 },
+        { "2.2250738585072014e-308", 23, DBL_MIN },
+        { "123456789012345678901234567890e-30", 34, 0.12345678901234568 },
     };
     const char overflow[] = "1d9999999999999999999";
 
@@ -2024,6 +2029,41 @@ static void test__strtod(void)
     ok(errno == ERANGE, "errno = %x\n", errno);
 }
 
+static void test_strtod_roundtrip(void)
+{
+    static const double tests[] = { 0.1, 1.0 / 3.0, 123.456, 1e23, 8.589973e9, 0.3,
+            DBL_MAX, DBL_MIN, DBL_EPSILON, 9007199254740991.0, 5e-300, 1.5e300 };
+    ULONGLONG bits = 0x3ff0000000000000;
+    char buf[64];
+    double d, r;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        sprintf(buf, "%.16e", tests[i]);
+        d = strtod(buf, NULL);
+        ok(d == tests[i], "%d) %s: d = %.16e\n", i, buf, d);
+        sprintf(buf, "%.16e", -tests[i]);
+        d = strtod(buf, NULL);
+        ok(d == -tests[i], "%d) %s: d = %.16e\n", i, buf, d);
+    }
+
+    /* values spread over the whole range of normal numbers */
+    for (i = 0; i < 2000; i++)
+    {
+        bits = bits * 0x5851f42d4c957f2d + 0x14057b7ef767814f;
+        memcpy(&r, &bits, sizeof(r));
+        if (!_finite(r) || fabs(r) < DBL_MIN) continue;
+
+        sprintf(buf, "%.16e", r);
+        d = strtod(buf, NULL);
+        ok(d == r, "%s: d = %.16e\n", buf, d);
+        sprintf(buf, "%.16g", r);
+        d = strtod(buf, NULL);
+        ok(fabs(d - r) <= fabs(r) * 4 * DBL_EPSILON, "%s: d = %.16e\n", buf, d);
+    }
+}
+
 static void test_mbstowcs(void)
 {
     static const wchar_t wSimple[] = { 't','e','x','t',0 };
@@ -4224,6 +4264,73 @@ static void test_wcscmp(void)
     ok(!r, "wcscmp returned %d\n", r);
 }
 
+static void test_string_page_boundary(void)
+{
+    wchar_t *buf, *str, *str2;
+    char *abuf, *astr, *astr2;
+    DWORD old_prot;
+    int len, i, r;
+
+    buf = VirtualAlloc(NULL, 2 * 4096, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok(buf != NULL, "VirtualAlloc failed\n");
+    abuf = VirtualAlloc(NULL, 2 * 4096, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok(abuf != NULL, "VirtualAlloc failed\n");
+    VirtualProtect((char *)buf + 4096, 4096, PAGE_NOACCESS, &old_prot);
+    VirtualProtect(abuf + 4096, 4096, PAGE_NOACCESS, &old_prot);
+
+    /* strings of various lengths ending just before an inaccessible page */
+    for (len = 0; len < 80; len++)
+    {
+        str = buf + 2048 - len - 1;
+        str2 = buf + len + 17;
+        for (i = 0; i < len; i++) str[i] = str2[i] = 'a' + i % 7;
+        str[len] = str2[len] = 0;
+
+        ok(wcslen(str) == len, "%d: wcslen returned %d\n", len, (int)wcslen(str));
+        ok(wcschr(str, 'x') == NULL, "%d: wcschr returned %p\n", len, wcschr(str, 'x'));
+        ok(wcschr(str, 0) == str + len, "%d: wcschr returned %p\n", len, wcschr(str, 0));
+        ok(wcsrchr(str, 0) == str + len, "%d: wcsrchr returned %p\n", len, wcsrchr(str, 0));
+        ok(wcsrchr(str, 'a') == (len ? str + (len - 1) / 7 * 7 : NULL),
+           "%d: wcsrchr returned %p\n", len, wcsrchr(str, 'a'));
+        ok(!wcscmp(str, str2), "%d: wcscmp returned %d\n", len, wcscmp(str, str2));
+        ok(!wcsncmp(str, str2, len + 5), "%d: wcsncmp returned %d\n", len, wcsncmp(str, str2, len + 5));
+        ok(wcspbrk(str, L"xyz") == NULL, "%d: wcspbrk returned %p\n", len, wcspbrk(str, L"xyz"));
+        ok(wcspbrk(str, L"xgz") == (len > 6 ? str + 6 : NULL), "%d: wcspbrk returned %p\n",
+           len, wcspbrk(str, L"xgz"));
+        ok(wcsstr(str, L"fga") == (len > 7 ? str + 5 : NULL), "%d: wcsstr returned %p\n",
+           len, wcsstr(str, L"fga"));
+
+        if (len)
+        {
+            str2[len - 1] = 0xff00;
+            r = wcscmp(str, str2);
+            ok(r == -1, "%d: wcscmp returned %d\n", len, r);
+            r = wcsncmp(str, str2, len);
+            ok(r < 0, "%d: wcsncmp returned %d\n", len, r);
+            r = wcsncmp(str, str2, len - 1);
+            ok(!r, "%d: wcsncmp returned %d\n", len, r);
+        }
+
+        astr = abuf + 4096 - len - 1;
+        astr2 = abuf + len + 3;
+        for (i = 0; i < len; i++) astr[i] = astr2[i] = 'a' + i % 7;
+        astr[len] = astr2[len] = 0;
+        r = p_strcmp(astr, astr2);
+        ok(!r, "%d: strcmp returned %d\n", len, r);
+        if (len)
+        {
+            astr2[len - 1] = '\xa0';
+            r = p_strcmp(astr, astr2);
+            ok(r == -1, "%d: strcmp returned %d\n", len, r);
+            r = p_strcmp(astr2, astr);
+            ok(r == 1, "%d: strcmp returned %d\n", len, r);
+        }
+    }
+
+    VirtualFree(buf, 0, MEM_RELEASE);
+    VirtualFree(abuf, 0, MEM_RELEASE);
+}
+
 START_TEST(string)
 {
     char mem[100];
@@ -4336,6 +4443,7 @@ START_TEST(string)
     test_strnlen();
     test__strtoi64();
     test__strtod();
+    test_strtod_roundtrip();
     test_mbstowcs();
     test__wcstombs_s_l();
     test_gcvt();
@@ -4374,4 +4482,5 @@ START_TEST(string)
     test_strstr();
     test_iswdigit();
     test_wcscmp();
+    test_string_page_boundary();
 }
@@ -31,6 +31,10 @@
 #include "wine/unicode.h"
 #include "wine/debug.h"
 
+#ifdef MSVCRT_HAVE_SIMD
+#include <immintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(msvcrt);
 
 typedef struct
@@ -445,6 +449,204 @@ MSVCRT_wchar_t* CDECL MSVCRT__wcslwr( MSVCRT_wchar_t* str )
     return str;
 }
 
+#ifdef MSVCRT_HAVE_SIMD
+
+/*
+ * The vector scans of a single string only load aligned blocks, which never
+ * cross a page boundary, and ignore the characters before the start of the
+ * string. This requires the string to be aligned on a character boundary;
+ * the callers use the scalar code otherwise. Comparisons of two strings use
+ * unaligned loads and fall back to one character at a time near the end of
+ * a page. The kernels return where the scalar code has to resume, so that
+ * the results are always computed by the original code.
+ */
+
+#define WCS_ALIGNED(str) (!((ULONG_PTR)(str) & 1))
+
+/* find the terminator, or the first occurrence of ch if it is not zero */
+static const MSVCRT_wchar_t * SSE2_FUNC wcschr_sse2( const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch )
+{
+    const __m128i zero = _mm_setzero_si128(), c = _mm_set1_epi16( ch );
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    __m128i v = _mm_load_si128( (const __m128i *)p );
+    unsigned int mask = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi16( v, zero ), _mm_cmpeq_epi16( v, c )));
+
+    mask >>= (const char *)str - p;
+    if (mask) return (const MSVCRT_wchar_t *)((const char *)str + __builtin_ctz( mask ));
+    for (;;)
+    {
+        p += 16;
+        v = _mm_load_si128( (const __m128i *)p );
+        mask = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi16( v, zero ), _mm_cmpeq_epi16( v, c )));
+        if (mask) return (const MSVCRT_wchar_t *)(p + __builtin_ctz( mask ));
+    }
+}
+
+static const MSVCRT_wchar_t * AVX2_FUNC wcschr_avx2( const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch )
+{
+    const __m256i zero = _mm256_setzero_si256(), c = _mm256_set1_epi16( ch );
+    const char *p = (const char *)((ULONG_PTR)str & ~31);
+    __m256i v = _mm256_load_si256( (const __m256i *)p );
+    unsigned int mask = _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi16( v, zero ),
+                                                               _mm256_cmpeq_epi16( v, c )));
+
+    mask >>= (const char *)str - p;
+    if (mask) return (const MSVCRT_wchar_t *)((const char *)str + __builtin_ctz( mask ));
+    for (;;)
+    {
+        p += 32;
+        v = _mm256_load_si256( (const __m256i *)p );
+        mask = _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi16( v, zero ), _mm256_cmpeq_epi16( v, c )));
+        if (mask) return (const MSVCRT_wchar_t *)(p + __builtin_ctz( mask ));
+    }
+}
+
+static inline const MSVCRT_wchar_t *wcschr_simd( const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch )
+{
+    if (!WCS_ALIGNED( str )) return str;
+    if (msvcrt_simd_level >= MSVCRT_SIMD_AVX2) return wcschr_avx2( str, ch );
+    if (msvcrt_simd_level >= MSVCRT_SIMD_SSE2) return wcschr_sse2( str, ch );
+    return str;
+}
+
+/* find the last occurrence of ch up to the terminator */
+static const MSVCRT_wchar_t * SSE2_FUNC wcsrchr_sse2( const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch )
+{
+    const __m128i zero = _mm_setzero_si128(), c = _mm_set1_epi16( ch );
+    const MSVCRT_wchar_t *ret = NULL;
+    const char *base = (const char *)str, *p = (const char *)((ULONG_PTR)str & ~15);
+    unsigned int shift = base - p, zmask, cmask;
+    __m128i v;
+
+    for (;;)
+    {
+        v = _mm_load_si128( (const __m128i *)p );
+        zmask = (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi16( v, zero )) >> shift;
+        cmask = (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi16( v, c )) >> shift;
+        /* ignore the matches after the terminator */
+        if (zmask) cmask &= ((zmask & -zmask) << 2) - 1;
+        /* the highest bit of a match is the high byte of the character */
+        if (cmask) ret = (const MSVCRT_wchar_t *)(base + 30 - __builtin_clz( cmask ));
+        if (zmask) return ret;
+        p += 16;
+        base = p;
+        shift = 0;
+    }
+}
+
+/* find the first character that differs, or the terminator */
+static const MSVCRT_wchar_t * SSE2_FUNC wcscmp_sse2( const MSVCRT_wchar_t *str1, const MSVCRT_wchar_t *str2,
+                                                     MSVCRT_size_t *count )
+{
+    const __m128i zero = _mm_setzero_si128();
+    MSVCRT_size_t n = *count;
+
+    while (n >= 8)
+    {
+        __m128i a, b;
+        unsigned int mask;
+
+        if (msvcrt_crosses_page( str1, 16 ) || msvcrt_crosses_page( str2, 16 ))
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+            n--;
+            continue;
+        }
+        a = _mm_loadu_si128( (const __m128i *)str1 );
+        b = _mm_loadu_si128( (const __m128i *)str2 );
+        mask = (_mm_movemask_epi8( _mm_cmpeq_epi16( a, b )) ^ 0xffff) |
+               _mm_movemask_epi8( _mm_cmpeq_epi16( a, zero ));
+        if (mask)
+        {
+            n -= __builtin_ctz( mask ) / 2;
+            str1 += __builtin_ctz( mask ) / 2;
+            break;
+        }
+        str1 += 8;
+        str2 += 8;
+        n -= 8;
+    }
+    *count = n;
+    return str1;
+}
+
+static const MSVCRT_wchar_t * AVX2_FUNC wcscmp_avx2( const MSVCRT_wchar_t *str1, const MSVCRT_wchar_t *str2,
+                                                     MSVCRT_size_t *count )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    MSVCRT_size_t n = *count;
+
+    while (n >= 16)
+    {
+        __m256i a, b;
+        unsigned int mask;
+
+        if (msvcrt_crosses_page( str1, 32 ) || msvcrt_crosses_page( str2, 32 ))
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+            n--;
+            continue;
+        }
+        a = _mm256_loadu_si256( (const __m256i *)str1 );
+        b = _mm256_loadu_si256( (const __m256i *)str2 );
+        mask = ~(unsigned int)_mm256_movemask_epi8( _mm256_cmpeq_epi16( a, b )) |
+               (unsigned int)_mm256_movemask_epi8( _mm256_cmpeq_epi16( a, zero ));
+        if (mask)
+        {
+            n -= __builtin_ctz( mask ) / 2;
+            str1 += __builtin_ctz( mask ) / 2;
+            break;
+        }
+        str1 += 16;
+        str2 += 16;
+        n -= 16;
+    }
+    *count = n;
+    return str1;
+}
+
+/* skip the common prefix of two strings, comparing at most *count characters;
+ * the first character left is the difference or the terminator unless *count
+ * got too small for the vector code */
+static inline MSVCRT_size_t wcscmp_simd( const MSVCRT_wchar_t *str1, const MSVCRT_wchar_t *str2,
+                                         MSVCRT_size_t *count )
+{
+    const MSVCRT_wchar_t *end = str1;
+
+    if (msvcrt_simd_level >= MSVCRT_SIMD_AVX2) end = wcscmp_avx2( str1, str2, count );
+    else if (msvcrt_simd_level >= MSVCRT_SIMD_SSE2) end = wcscmp_sse2( str1, str2, count );
+    return end - str1;
+}
+
+/* find the first character of str that is in accept, or the terminator */
+static const MSVCRT_wchar_t * SSE2_FUNC wcspbrk_sse2( const MSVCRT_wchar_t *str, const MSVCRT_wchar_t *accept,
+                                                      unsigned int len )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const char *base = (const char *)str, *p = (const char *)((ULONG_PTR)str & ~15);
+    unsigned int i, mask, shift = base - p;
+    __m128i set[8], v, match;
+
+    for (i = 0; i < len; i++) set[i] = _mm_set1_epi16( accept[i] );
+    for (;;)
+    {
+        v = _mm_load_si128( (const __m128i *)p );
+        match = _mm_cmpeq_epi16( v, zero );
+        for (i = 0; i < len; i++) match = _mm_or_si128( match, _mm_cmpeq_epi16( v, set[i] ));
+        mask = (unsigned int)_mm_movemask_epi8( match ) >> shift;
+        if (mask) return (const MSVCRT_wchar_t *)(base + __builtin_ctz( mask ));
+        p += 16;
+        base = p;
+        shift = 0;
+    }
+}
+
+#endif  /* MSVCRT_HAVE_SIMD */
+
 /*********************************************************************
  *           wcsncmp    (MSVCRT.@)
  */
@@ -452,6 +654,14 @@ int CDECL MSVCRT_wcsncmp(const MSVCRT_wchar_t *str1, const MSVCRT_wchar_t *str2,
 {
     if (!n)
         return 0;
+#ifdef MSVCRT_HAVE_SIMD
+    {
+        MSVCRT_size_t skip = wcscmp_simd( str1, str2, &n );
+        str1 += skip;
+        str2 += skip;
+        if (!n) return 0;
+    }
+#endif
     while(--n && *str1 && (*str1 == *str2))
     {
         str1++;
@@ -1686,6 +1896,12 @@ int WINAPIV MSVCRT_swprintf_p_l(MSVCRT_wchar_t *buffer, MSVCRT_size_t length,
  */
 int CDECL MSVCRT_wcscmp(const MSVCRT_wchar_t *str1, const MSVCRT_wchar_t *str2)
 {
+#ifdef MSVCRT_HAVE_SIMD
+    MSVCRT_size_t n = ~(MSVCRT_size_t)0, skip = wcscmp_simd( str1, str2, &n );
+
+    str1 += skip;
+    str2 += skip;
+#endif
     while (*str1 && (*str1 == *str2))
     {
         str1++;
@@ -1731,6 +1947,15 @@ MSVCRT_wchar_t* CDECL MSVCRT_wcspbrk( const MSVCRT_wchar_t* str, const MSVCRT_wc
 {
     const MSVCRT_wchar_t* p;
 
+#ifdef MSVCRT_HAVE_SIMD
+    if (msvcrt_simd_level >= MSVCRT_SIMD_SSE2 && WCS_ALIGNED(str))
+    {
+        unsigned int len = 0;
+
+        while (len <= 8 && accept[len]) len++;
+        if (len <= 8) str = wcspbrk_sse2(str, accept, len);
+    }
+#endif
     while (*str)
     {
         for (p = accept; *p; p++) if (*p == *str) return (MSVCRT_wchar_t*)str;
@@ -2629,6 +2854,9 @@ int CDECL MSVCRT_towupper(MSVCRT_wint_t c)
  */
 MSVCRT_wchar_t* CDECL MSVCRT_wcschr(const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch)
 {
+#ifdef MSVCRT_HAVE_SIMD
+    str = wcschr_simd(str, ch);
+#endif
     return strchrW(str, ch);
 }
 
@@ -2637,6 +2865,10 @@ MSVCRT_wchar_t* CDECL MSVCRT_wcschr(const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch
  */
 MSVCRT_wchar_t* CDECL MSVCRT_wcsrchr(const MSVCRT_wchar_t *str, MSVCRT_wchar_t ch)
 {
+#ifdef MSVCRT_HAVE_SIMD
+    if (msvcrt_simd_level >= MSVCRT_SIMD_SSE2 && WCS_ALIGNED(str))
+        return (MSVCRT_wchar_t *)wcsrchr_sse2(str, ch);
+#endif
     return strrchrW(str, ch);
 }
 
@@ -2645,7 +2877,12 @@ MSVCRT_wchar_t* CDECL MSVCRT_wcsrchr(const MSVCRT_wchar_t *str, MSVCRT_wchar_t c
  */
 int CDECL MSVCRT_wcslen(const MSVCRT_wchar_t *str)
 {
+#ifdef MSVCRT_HAVE_SIMD
+    const MSVCRT_wchar_t *end = wcschr_simd(str, 0);
+    return end - str + strlenW(end);
+#else
     return strlenW(str);
+#endif
 }
 
 /*********************************************************************
@@ -2655,7 +2892,17 @@ MSVCRT_wchar_t* CDECL MSVCRT_wcsstr(const MSVCRT_wchar_t *str, const MSVCRT_wcha
 {
     while(*str)
     {
-        const MSVCRT_wchar_t *p1 = str, *p2 = sub;
+        const MSVCRT_wchar_t *p1, *p2;
+#ifdef MSVCRT_HAVE_SIMD
+        /* skip to the next occurrence of the first character */
+        if (*sub && *str != *sub)
+        {
+            str = wcschr_simd(str, *sub);
+            if (!*str) break;
+        }
+#endif
+        p1 = str;
+        p2 = sub;
         while(*p1 && *p2 && *p1 == *p2)
         {
             p1++;
@@ -77,6 +77,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_CACHED_MAGIC     0xcac4ed
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -126,6 +127,41 @@ typedef union
     void       *alignment[4];
 } FREE_LIST_ENTRY;
 
+/* Low fragmentation front end
+ *
+ * Freed blocks up to HEAP_LFH_MAX_SIZE are kept in per-size bins and reused
+ * for allocations of the same size without entering the heap critical
+ * section. The bins are replicated in several slots, selected from the
+ * thread id, each one protected by a simple try-lock; when a slot is busy
+ * the normal allocator is used instead. Cached blocks remain in-use arenas
+ * with the ARENA_CACHED_MAGIC magic, so that walking and validating the
+ * heap don't need to know about the front end.
+ */
+#define HEAP_LFH_MAX_SIZE     0x200  /* max size of cached blocks, including the arena offset */
+#define HEAP_LFH_NB_BINS      (HEAP_LFH_MAX_SIZE / ALIGNMENT + 1)
+#define HEAP_LFH_NB_SLOTS     8      /* must be a power of 2 */
+#define HEAP_LFH_MAX_DEPTH    16     /* max number of blocks cached in each bin */
+
+/* heap flags that disable the front end */
+#define HEAP_LFH_DISABLE_FLAGS (HEAP_VALIDATE | HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED)
+
+struct heap_lfh_bin
+{
+    ARENA_INUSE *head;   /* first cached block; each block stores the next one in its data */
+    LONG         count;  /* number of cached blocks */
+};
+
+struct heap_lfh_slot
+{
+    LONG                lock;   /* non-zero when the slot is in use */
+    struct heap_lfh_bin bins[HEAP_LFH_NB_BINS];
+};
+
+struct heap_lfh
+{
+    struct heap_lfh_slot slots[HEAP_LFH_NB_SLOTS];
+};
+
 struct tagHEAP;
 
 typedef struct tagSUBHEAP
@@ -158,6 +194,7 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    struct heap_lfh *lfh;           /* Low fragmentation front end, if enabled */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -290,7 +327,8 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_CACHED_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -662,10 +700,11 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
     if ((char *)pFree + size < (char *)subheap->base + subheap->size)
         return;  /* Not the last block, so nothing more to do */
 
-    /* Free the whole sub-heap if it's empty and not the original one */
+    /* Free the whole sub-heap if it's empty and not the original one, */
+    /* unless the front end may be looking it up without the heap lock */
 
     if (((char *)pFree == (char *)subheap->base + subheap->headerSize) &&
-        (subheap != &subheap->heap->subheap))
+        (subheap != &subheap->heap->subheap) && !subheap->heap->lfh)
     {
         void *addr = subheap->base;
 
@@ -909,7 +948,11 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         subheap->commitSize = commitSize;
         subheap->magic      = SUBHEAP_MAGIC;
         subheap->headerSize = ROUND_SIZE( sizeof(SUBHEAP) );
-        list_add_head( &heap->subheap_list, &subheap->entry );
+        /* the front end walks the list without holding the heap lock, publish the entry last */
+        subheap->entry.next = heap->subheap_list.next;
+        subheap->entry.prev = &heap->subheap_list;
+        heap->subheap_list.next->prev = &subheap->entry;
+        InterlockedExchangePointer( (void **)&heap->subheap_list.next, &subheap->entry );
     }
     else
     {
@@ -944,6 +987,16 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
             if (i) list_add_after( &pEntry[-1].arena.entry, &pEntry->arena.entry );
         }
 
+        /* Enable the low fragmentation front end */
+
+        if ((flags & HEAP_GROWABLE) && !(flags & (HEAP_NO_SERIALIZE | HEAP_SHARED)))
+        {
+            heap->lfh = (struct heap_lfh *)((char *)heap + subheap->headerSize);
+            subheap->headerSize += (sizeof(struct heap_lfh) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            memset( heap->lfh, 0, sizeof(struct heap_lfh) );
+        }
+        else heap->lfh = NULL;
+
         /* Initialize critical section */
 
         if (!processHeap)  /* do it by hand to avoid memory allocations */
@@ -1208,7 +1261,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_CACHED_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1351,6 +1405,10 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
             }
             else ret = validate_large_arena( heapPtr, large_arena, quiet );
         }
+        else if (arena->magic == ARENA_CACHED_MAGIC)
+        {
+            if (WARN_ON(heap)) WARN("Heap %p: block %p has been freed\n", heapPtr, block );
+        }
         else ret = HEAP_ValidateInUseArena( subheap, arena, quiet );
         goto done;
     }
@@ -1414,7 +1472,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_CACHED_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1432,6 +1490,121 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
 }
 
 
+/***********************************************************************
+ *           lfh_lock_slot
+ *
+ * Lock the front end slot of the current thread, or return NULL if it is busy.
+ */
+static inline struct heap_lfh_slot *lfh_lock_slot( HEAP *heap )
+{
+    ULONG_PTR tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    struct heap_lfh_slot *slot = &heap->lfh->slots[(tid >> 2) & (HEAP_LFH_NB_SLOTS - 1)];
+
+    if (InterlockedCompareExchange( &slot->lock, 1, 0 )) return NULL;
+    return slot;
+}
+
+static inline void lfh_unlock_slot( struct heap_lfh_slot *slot )
+{
+    InterlockedExchange( &slot->lock, 0 );
+}
+
+
+/***********************************************************************
+ *           lfh_alloc
+ *
+ * Take a block of the specified arena size from the front end.
+ */
+static ARENA_INUSE *lfh_alloc( HEAP *heap, SIZE_T size )
+{
+    struct heap_lfh_slot *slot;
+    struct heap_lfh_bin *bin;
+    ARENA_INUSE *arena;
+
+    if (!(slot = lfh_lock_slot( heap ))) return NULL;
+    bin = &slot->bins[size / ALIGNMENT];
+    if ((arena = bin->head))
+    {
+        bin->head = *(ARENA_INUSE **)(arena + 1);
+        bin->count--;
+        arena->magic = ARENA_INUSE_MAGIC;
+    }
+    lfh_unlock_slot( slot );
+    return arena;
+}
+
+
+/***********************************************************************
+ *           lfh_free
+ *
+ * Give a block back to the front end. Returns FALSE if it has to be freed normally.
+ */
+static BOOL lfh_free( HEAP *heap, ARENA_INUSE *arena )
+{
+    struct heap_lfh_slot *slot;
+    struct heap_lfh_bin *bin;
+    SUBHEAP *subheap;
+    SIZE_T size;
+    BOOL ret = FALSE;
+
+    /* only cache blocks that look valid, the slow path will report the others */
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return FALSE;
+    if (!(subheap = HEAP_FindSubHeap( heap, arena ))) return FALSE;
+    if ((char *)arena < (char *)subheap->base + subheap->headerSize) return FALSE;
+    if ((char *)(arena + 1) > (char *)subheap->base + subheap->commitSize) return FALSE;
+    if (arena->magic != ARENA_INUSE_MAGIC || (arena->size & ARENA_FLAG_FREE)) return FALSE;
+    size = arena->size & ARENA_SIZE_MASK;
+    if (size > HEAP_LFH_MAX_SIZE) return FALSE;
+    if ((char *)(arena + 1) + size > (char *)subheap->base + subheap->commitSize) return FALSE;
+
+    if (!(slot = lfh_lock_slot( heap ))) return FALSE;
+    bin = &slot->bins[size / ALIGNMENT];
+    if (bin->count < HEAP_LFH_MAX_DEPTH)
+    {
+        arena->magic = ARENA_CACHED_MAGIC;
+        *(ARENA_INUSE **)(arena + 1) = bin->head;
+        bin->head = arena;
+        bin->count++;
+        ret = TRUE;
+    }
+    lfh_unlock_slot( slot );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           lfh_flush
+ *
+ * Free all the blocks cached in the front end. The heap must be locked.
+ */
+static void lfh_flush( HEAP *heap )
+{
+    struct heap_lfh_slot *slot;
+    ARENA_INUSE *arena;
+    SUBHEAP *subheap;
+    unsigned int i, j;
+
+    if (!heap->lfh) return;
+
+    for (i = 0; i < HEAP_LFH_NB_SLOTS; i++)
+    {
+        slot = &heap->lfh->slots[i];
+        while (InterlockedCompareExchange( &slot->lock, 1, 0 )) NtYieldExecution();
+        for (j = 0; j < HEAP_LFH_NB_BINS; j++)
+        {
+            while ((arena = slot->bins[j].head))
+            {
+                slot->bins[j].head = *(ARENA_INUSE **)(arena + 1);
+                arena->magic = ARENA_INUSE_MAGIC;
+                if ((subheap = HEAP_FindSubHeap( heap, arena ))) HEAP_MakeInUseBlockFree( subheap, arena );
+            }
+            slot->bins[j].count = 0;
+        }
+        lfh_unlock_slot( slot );
+    }
+}
+
+
 /***********************************************************************
  *           heap_set_debug_flags
  */
@@ -1458,6 +1631,13 @@ void heap_set_debug_flags( HANDLE handle )
 
     if (RUNNING_ON_VALGRIND) flags = 0; /* no sense in validating since Valgrind catches accesses */
 
+    if (flags & HEAP_LFH_DISABLE_FLAGS)  /* the cached blocks have to be checked too */
+    {
+        RtlEnterCriticalSection( &heap->critSection );
+        lfh_flush( heap );
+        RtlLeaveCriticalSection( &heap->critSection );
+    }
+
     heap->flags |= flags;
     heap->force_flags |= flags & ~(HEAP_VALIDATE | HEAP_DISABLE_COALESCE_ON_FREE);
 
@@ -1658,6 +1838,16 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh && rounded_size <= HEAP_LFH_MAX_SIZE && !(flags & HEAP_LFH_DISABLE_FLAGS) &&
+        (pInUse = lfh_alloc( heapPtr, rounded_size )))
+    {
+        pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
+        notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
+        initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
+        return pInUse + 1;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1741,6 +1931,14 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
+    if (heapPtr->lfh && !(flags & HEAP_LFH_DISABLE_FLAGS) && lfh_free( heapPtr, (ARENA_INUSE *)ptr - 1 ))
+    {
+        notify_free( ptr );
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
@@ -1933,7 +2131,15 @@ error:
 ULONG WINAPI RtlCompactHeap( HANDLE heap, ULONG flags )
 {
     static BOOL reported;
+    HEAP *heapPtr = HEAP_GetPtr( heap );
+
     if (!reported++) FIXME( "(%p, 0x%x) stub\n", heap, flags );
+    if (!heapPtr) return 0;
+
+    /* at least give the cached blocks back so that they can be coalesced */
+    RtlEnterCriticalSection( &heapPtr->critSection );
+    lfh_flush( heapPtr );
+    RtlLeaveCriticalSection( &heapPtr->critSection );
     return 0;
 }
 
@@ -2108,7 +2314,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_CACHED_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2156,7 +2363,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
-        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
+        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC || pArena->magic == ARENA_CACHED_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
         and PROCESS_HEAP_ENTRY_DDESHARE yet */
@@ -2221,6 +2428,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2229,7 +2438,11 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        heapPtr = HEAP_GetPtr( heap );
+        if (heapPtr && heapPtr->lfh && !(heapPtr->flags & HEAP_LFH_DISABLE_FLAGS))
+            *(ULONG *)info = 2; /* low fragmentation heap */
+        else
+            *(ULONG *)info = 0; /* standard heap */
         return STATUS_SUCCESS;
 
     default:
@@ -2243,6 +2456,23 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        TRACE("%p compatibility %u\n", heap, *(ULONG *)info);
+        /* the front end is always enabled when the heap supports it, and cannot be disabled */
+        if (*(ULONG *)info == 2 && heapPtr->lfh && !(heapPtr->flags & HEAP_LFH_DISABLE_FLAGS))
+            return STATUS_SUCCESS;
+        if (*(ULONG *)info == 0 && !heapPtr->lfh) return STATUS_SUCCESS;
+        return STATUS_UNSUCCESSFUL;
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
@@ -35,6 +35,7 @@
 #include "wine/exception.h"
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 #include "wine/server.h"
 #include "ntdll_misc.h"
 #include "ddk/wdm.h"
@@ -126,8 +127,42 @@ typedef struct _wine_modref
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
+    struct _wine_modref  *hash_next;   /* next module in the base name hash chain */
+    struct wine_rb_entry  base_entry;  /* entry in the address index */
+    BOOL                  indexed;     /* module is in the hash table and address index */
+    DWORD                *export_hash; /* hash table of the export names, built on first use */
+    DWORD                 export_hash_mask;
 } WINE_MODREF;
 
+/* dll search done ahead of time by helper threads while the imports of the main exe are fixed up */
+enum prefetch_state
+{
+    PREFETCH_QUEUED,   /* waiting for a helper thread */
+    PREFETCH_RUNNING,  /* being searched for */
+    PREFETCH_DONE,     /* search complete */
+    PREFETCH_USED      /* result taken by the loader, or not waited for */
+};
+
+struct prefetch_job
+{
+    struct list          entry;
+    enum prefetch_state  state;
+    UNICODE_STRING       nt_name;  /* first file found in the search path, if any */
+    HANDLE               mapping;  /* image mapping for that file */
+    struct file_id       id;       /* file id of that file */
+    BOOL                 has_id;
+    WCHAR                name[1];  /* dll name to search for */
+};
+
+#define PREFETCH_MAX_THREADS 4
+
+static struct list prefetch_jobs = LIST_INIT( prefetch_jobs );
+static WCHAR *prefetch_path;           /* search path used by the helper threads */
+static unsigned int prefetch_threads;  /* number of running helper threads */
+static unsigned int prefetch_max_threads;  /* limit on the helper threads, from the process affinity */
+static BOOL prefetch_stopping;         /* set once the imports of the main exe are fixed up */
+static RTL_CONDITION_VARIABLE prefetch_cv = RTL_CONDITION_VARIABLE_INIT;
+
 static UINT tls_module_count;      /* number of modules with TLS directory */
 static IMAGE_TLS_DIRECTORY *tls_dirs;  /* array of TLS directories */
 LIST_ENTRY tls_links = { &tls_links, &tls_links };
@@ -159,6 +194,15 @@ static RTL_CRITICAL_SECTION_DEBUG peb_critsect_debug =
 };
 static RTL_CRITICAL_SECTION peb_lock = { &peb_critsect_debug, -1, 0, 0, 0, 0 };
 
+static RTL_CRITICAL_SECTION prefetch_section;
+static RTL_CRITICAL_SECTION_DEBUG prefetch_critsect_debug =
+{
+    0, 0, &prefetch_section,
+    { &prefetch_critsect_debug.ProcessLocksList, &prefetch_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": prefetch_section") }
+};
+static RTL_CRITICAL_SECTION prefetch_section = { &prefetch_critsect_debug, -1, 0, 0, 0, 0 };
+
 static PEB_LDR_DATA ldr = { sizeof(ldr), TRUE };
 static RTL_BITMAP tls_bitmap;
 static RTL_BITMAP tls_expansion_bitmap;
@@ -457,6 +501,101 @@ static void call_ldr_notifications( ULONG reason, LDR_DATA_TABLE_ENTRY *module )
     }
 }
 
+/* Index of the loaded modules by base name and by address range, kept in sync
+ * with the load and memory order lists. The loader_section must be locked
+ * while using them, except for address lookups which only need the
+ * module_index_lock, so that they can be done from exception handling. */
+#define MODULE_HASH_SIZE 64
+static WINE_MODREF *module_hash_table[MODULE_HASH_SIZE];
+
+static int module_base_compare( const void *addr, const struct wine_rb_entry *entry )
+{
+    const WINE_MODREF *wm = WINE_RB_ENTRY_VALUE( entry, const WINE_MODREF, base_entry );
+
+    if ((const char *)addr < (const char *)wm->ldr.DllBase) return -1;
+    if ((const char *)addr >= (const char *)wm->ldr.DllBase + wm->ldr.SizeOfImage) return 1;
+    return 0;
+}
+
+static struct wine_rb_tree module_base_index = { module_base_compare };
+static RTL_SRWLOCK module_index_lock = RTL_SRWLOCK_INIT;
+
+static inline ULONG hash_module_name( const UNICODE_STRING *name )
+{
+    ULONG hash = 0;
+
+    RtlHashUnicodeString( name, TRUE, HASH_STRING_ALGORITHM_X65599, &hash );
+    return hash;
+}
+
+/*************************************************************************
+ *		add_module_index
+ *
+ * Add a module to the base name hash table and the address index.
+ * The loader_section must be locked while calling this function.
+ */
+static void add_module_index( WINE_MODREF *wm )
+{
+    WINE_MODREF **bucket;
+    int ret;
+
+    RtlAcquireSRWLockExclusive( &module_index_lock );
+    ret = wine_rb_put( &module_base_index, wm->ldr.DllBase, &wm->base_entry );
+    RtlReleaseSRWLockExclusive( &module_index_lock );
+    if (ret)
+    {
+        WARN( "module %s at %p overlaps another module, not indexing it\n",
+              debugstr_w(wm->ldr.BaseDllName.Buffer), wm->ldr.DllBase );
+        return;
+    }
+
+    wm->ldr.BaseNameHashValue = hash_module_name( &wm->ldr.BaseDllName );
+    bucket = &module_hash_table[wm->ldr.BaseNameHashValue % MODULE_HASH_SIZE];
+    wm->hash_next = *bucket;
+    *bucket = wm;
+    wm->indexed = TRUE;
+}
+
+/*************************************************************************
+ *		remove_module_index
+ *
+ * Remove a module from the base name hash table and the address index.
+ * The loader_section must be locked while calling this function.
+ */
+static void remove_module_index( WINE_MODREF *wm )
+{
+    WINE_MODREF **next;
+
+    if (!wm->indexed) return;
+
+    RtlAcquireSRWLockExclusive( &module_index_lock );
+    wine_rb_remove( &module_base_index, &wm->base_entry );
+    RtlReleaseSRWLockExclusive( &module_index_lock );
+    for (next = &module_hash_table[wm->ldr.BaseNameHashValue % MODULE_HASH_SIZE]; *next; next = &(*next)->hash_next)
+    {
+        if (*next != wm) continue;
+        *next = wm->hash_next;
+        break;
+    }
+    wm->hash_next = NULL;
+    wm->indexed = FALSE;
+}
+
+/*************************************************************************
+ *		find_module_by_address
+ *
+ * Find the module containing an address.
+ */
+static WINE_MODREF *find_module_by_address( const void *addr )
+{
+    struct wine_rb_entry *entry;
+
+    RtlAcquireSRWLockShared( &module_index_lock );
+    entry = wine_rb_get( &module_base_index, addr );
+    RtlReleaseSRWLockShared( &module_index_lock );
+    return entry ? WINE_RB_ENTRY_VALUE( entry, WINE_MODREF, base_entry ) : NULL;
+}
+
 /*************************************************************************
  *		get_modref
  *
@@ -465,18 +604,12 @@ static void call_ldr_notifications( ULONG reason, LDR_DATA_TABLE_ENTRY *module )
  */
 static WINE_MODREF *get_modref( HMODULE hmod )
 {
-    PLIST_ENTRY mark, entry;
-    PLDR_DATA_TABLE_ENTRY mod;
+    WINE_MODREF *wm;
 
     if (cached_modref && cached_modref->ldr.DllBase == hmod) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
-        if (mod->DllBase == hmod)
-            return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-    }
+    if ((wm = find_module_by_address( hmod )) && wm->ldr.DllBase == hmod)
+        return cached_modref = wm;
     return NULL;
 }
 
@@ -489,23 +622,21 @@ static WINE_MODREF *get_modref( HMODULE hmod )
  */
 static WINE_MODREF *find_basename_module( LPCWSTR name )
 {
-    PLIST_ENTRY mark, entry;
     UNICODE_STRING name_str;
+    WINE_MODREF *wm;
+    ULONG hash;
 
     RtlInitUnicodeString( &name_str, name );
 
     if (cached_modref && RtlEqualUnicodeString( &name_str, &cached_modref->ldr.BaseDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    hash = hash_module_name( &name_str );
+    for (wm = module_hash_table[hash % MODULE_HASH_SIZE]; wm; wm = wm->hash_next)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name_str, &mod->BaseDllName, TRUE ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
+        if (wm->ldr.BaseNameHashValue == hash &&
+            RtlEqualUnicodeString( &name_str, &wm->ldr.BaseDllName, TRUE ))
+            return cached_modref = wm;
     }
     return NULL;
 }
@@ -519,8 +650,10 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
  */
 static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
 {
-    PLIST_ENTRY mark, entry;
-    UNICODE_STRING name = *nt_name;
+    UNICODE_STRING name = *nt_name, base_name;
+    WINE_MODREF *wm;
+    ULONG hash;
+    USHORT i;
 
     if (name.Length <= 4 * sizeof(WCHAR)) return NULL;
     name.Length -= 4 * sizeof(WCHAR);  /* for \??\ prefix */
@@ -529,15 +662,17 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    /* the base name of a module is the last component of its full name */
+    for (i = name.Length / sizeof(WCHAR); i; i--) if (name.Buffer[i - 1] == '\\') break;
+    base_name.Buffer = name.Buffer + i;
+    base_name.Length = base_name.MaximumLength = name.Length - i * sizeof(WCHAR);
+
+    hash = hash_module_name( &base_name );
+    for (wm = module_hash_table[hash % MODULE_HASH_SIZE]; wm; wm = wm->hash_next)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
+        if (wm->ldr.BaseNameHashValue == hash &&
+            RtlEqualUnicodeString( &name, &wm->ldr.FullDllName, TRUE ))
+            return cached_modref = wm;
     }
     return NULL;
 }
@@ -704,6 +839,46 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+static inline DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 0;
+
+    while (*name) hash = hash * 31 + (unsigned char)*name++;
+    return hash;
+}
+
+/*************************************************************************
+ *		get_export_hash
+ *
+ * Build the hash table of the export names of a module on first use.
+ * Entries are name table indexes plus one, zero marks a free slot.
+ * The loader_section must be locked while calling this function.
+ */
+static const DWORD *get_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    DWORD i, pos, size = 16;
+    DWORD *table;
+
+    if (wm->export_hash) return wm->export_hash;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(table = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*table) )))
+        return NULL;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( wm->ldr.DllBase, names[i] ) ) & (size - 1);
+        while (table[pos]) pos = (pos + 1) & (size - 1);
+        table[pos] = i + 1;
+    }
+
+    wm->export_hash = table;
+    wm->export_hash_mask = size - 1;
+    return table;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -716,6 +891,8 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int min = 0, max = exports->NumberOfNames - 1;
+    const DWORD *table;
+    WINE_MODREF *wm;
 
     /* first check the hint */
     if (hint >= 0 && hint <= max)
@@ -725,7 +902,21 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
+    /* then look up the export hash table of the module */
+    if ((wm = get_modref( module )) && (table = get_export_hash( wm, exports )))
+    {
+        DWORD pos = hash_export_name( name ) & wm->export_hash_mask;
+
+        for (; table[pos]; pos = (pos + 1) & wm->export_hash_mask)
+        {
+            char *ename = get_rva( module, names[table[pos] - 1] );
+            if (!strcmp( ename, name ))
+                return find_ordinal_export( module, exports, exp_size, ordinals[table[pos] - 1], load_path );
+        }
+        return NULL;
+    }
+
+    /* otherwise do a binary search */
     while (min <= max)
     {
         int res, pos = (min + max) / 2;
@@ -740,6 +931,84 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 }
 
 
+/*************************************************************************
+ *		is_bound_module_valid
+ *
+ * Check that a module that imports were bound to is loaded at its
+ * preferred base address with the expected time stamp.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL is_bound_module_valid( const WINE_MODREF *wm, DWORD timestamp )
+{
+    const IMAGE_NT_HEADERS *nt = RtlImageNtHeader( wm->ldr.DllBase );
+
+    /* the header image base is updated when the image is relocated, check the original one */
+    return nt && nt->FileHeader.TimeDateStamp == timestamp &&
+           wm->ldr.OriginalBase == (ULONG_PTR)wm->ldr.DllBase;
+}
+
+
+/*************************************************************************
+ *		is_import_binding_valid
+ *
+ * Check whether the addresses bound into the import address table when
+ * the module was linked or installed are still valid, in which case the
+ * imports don't need to be resolved again.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL is_import_binding_valid( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr,
+                                     const char *name, const WINE_MODREF *imp )
+{
+    const IMAGE_BOUND_IMPORT_DESCRIPTOR *bound;
+    const IMAGE_BOUND_FORWARDER_REF *ref;
+    const char *start, *end;
+    WCHAR buffer[32];
+    WINE_MODREF *wm;
+    DWORD size, len;
+    WORD i;
+
+    if (!descr->TimeDateStamp) return FALSE;
+    /* relay and snoop thunks have to be installed for each import */
+    if (TRACE_ON(relay) || TRACE_ON(snoop)) return FALSE;
+
+    /* old style binding, imports listed in the forwarder chain would need to be resolved */
+    if (descr->TimeDateStamp != ~0u)
+        return descr->ForwarderChain == ~0u && is_bound_module_valid( imp, descr->TimeDateStamp );
+
+    /* new style binding, the modules and forwarded modules are listed in the bound import directory */
+    if (!(start = RtlImageDirectoryEntryToData( module, TRUE, IMAGE_DIRECTORY_ENTRY_BOUND_IMPORT, &size )))
+        return FALSE;
+    end = start + size;
+
+    bound = (const IMAGE_BOUND_IMPORT_DESCRIPTOR *)start;
+    while ((const char *)(bound + 1) <= end && bound->OffsetModuleName)
+    {
+        ref = (const IMAGE_BOUND_FORWARDER_REF *)(bound + 1);
+        if ((const char *)(ref + bound->NumberOfModuleForwarderRefs) > end) return FALSE;
+        if (bound->OffsetModuleName >= size) return FALSE;
+
+        if (!_stricmp( start + bound->OffsetModuleName, name ))
+        {
+            if (!is_bound_module_valid( imp, bound->TimeDateStamp )) return FALSE;
+
+            for (i = 0; i < bound->NumberOfModuleForwarderRefs; i++)
+            {
+                if (ref[i].OffsetModuleName >= size) return FALSE;
+                len = strlen( start + ref[i].OffsetModuleName );
+                if (len >= ARRAY_SIZE(buffer)) return FALSE;
+                ascii_to_unicode( buffer, start + ref[i].OffsetModuleName, len );
+                buffer[len] = 0;
+                if (!(wm = find_basename_module( buffer ))) return FALSE;
+                if (!is_bound_module_valid( wm, ref[i].TimeDateStamp )) return FALSE;
+            }
+            return TRUE;
+        }
+        bound = (const IMAGE_BOUND_IMPORT_DESCRIPTOR *)(ref + bound->NumberOfModuleForwarderRefs);
+    }
+    return FALSE;
+}
+
+
 /*************************************************************************
  *		import_dll
  *
@@ -804,6 +1073,13 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         return FALSE;
     }
 
+    if (is_import_binding_valid( module, descr, name, wmImp ))
+    {
+        TRACE_(imports)("--- using bound imports from %s\n", name );
+        *pwm = wmImp;
+        return TRUE;
+    }
+
     /* unprotect the import address table since it can be located in
      * readonly section */
     while (import_list[protect_size].u1.Ordinal) protect_size++;
@@ -1051,6 +1327,370 @@ static void free_tls_slot( LDR_DATA_TABLE_ENTRY *mod )
 }
 
 
+/***********************************************************************
+ *           queue_prefetch_job
+ *
+ * Queue the search for a dll on the prefetch threads.
+ * The prefetch_section must be locked while calling this function.
+ */
+static void queue_prefetch_job( const char *name, BOOL first )
+{
+    struct prefetch_job *job;
+    WCHAR buffer[64];
+    DWORD len = strlen( name );
+
+    if (len >= ARRAY_SIZE(buffer) - ARRAY_SIZE(dllW)) return;
+    ascii_to_unicode( buffer, name, len );
+    buffer[len] = 0;
+    if (contains_path( buffer )) return;
+    if (!wcschr( buffer, '.' )) wcscat( buffer, dllW );
+
+    LIST_FOR_EACH_ENTRY( job, &prefetch_jobs, struct prefetch_job, entry )
+    {
+        if (wcsicmp( job->name, buffer )) continue;
+        if (first && job->state == PREFETCH_QUEUED)
+        {
+            /* the loader needs it next, move it to the front */
+            list_remove( &job->entry );
+            list_add_head( &prefetch_jobs, &job->entry );
+        }
+        return;
+    }
+
+    if (!(job = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                 offsetof( struct prefetch_job, name[wcslen( buffer ) + 1] ))))
+        return;
+    job->state = PREFETCH_QUEUED;
+    wcscpy( job->name, buffer );
+    if (first) list_add_head( &prefetch_jobs, &job->entry );
+    else list_add_tail( &prefetch_jobs, &job->entry );
+    RtlWakeConditionVariable( &prefetch_cv );
+}
+
+
+/***********************************************************************
+ *           read_image_rva
+ *
+ * Read data from an image file at a given rva. Helper for prefetch_file_imports.
+ */
+static BOOL read_image_rva( HANDLE file, const IMAGE_SECTION_HEADER *sec, UINT nb_sec,
+                            DWORD rva, void *buffer, ULONG size )
+{
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER offset;
+    UINT i;
+
+    for (i = 0; i < nb_sec; i++)
+    {
+        if (rva < sec[i].VirtualAddress || rva - sec[i].VirtualAddress >= sec[i].SizeOfRawData) continue;
+        /* file positions are rounded to sector boundaries like in the mapping code */
+        offset.QuadPart = (sec[i].PointerToRawData & ~0x1ff) + rva - sec[i].VirtualAddress;
+        if (NtReadFile( file, 0, NULL, NULL, &io, buffer, size, &offset, NULL )) return FALSE;
+        if (io.Information < size) memset( (char *)buffer + io.Information, 0, size - io.Information );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           prefetch_file_imports
+ *
+ * Queue the search for the dlls imported by an image file.
+ */
+static void prefetch_file_imports( HANDLE file )
+{
+    IMAGE_DOS_HEADER dos;
+    union
+    {
+        IMAGE_NT_HEADERS32 nt32;
+        IMAGE_NT_HEADERS64 nt64;
+    } nt;
+    IMAGE_SECTION_HEADER sec[96];
+    IMAGE_IMPORT_DESCRIPTOR descr;
+    const IMAGE_DATA_DIRECTORY *dir;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER offset;
+    char name[64];
+    DWORD rva, end;
+    UINT nb_sec;
+
+    offset.QuadPart = 0;
+    if (NtReadFile( file, 0, NULL, NULL, &io, &dos, sizeof(dos), &offset, NULL )) return;
+    if (io.Information < sizeof(dos) || dos.e_magic != IMAGE_DOS_SIGNATURE) return;
+    offset.QuadPart = dos.e_lfanew;
+    if (NtReadFile( file, 0, NULL, NULL, &io, &nt, sizeof(nt), &offset, NULL )) return;
+    if (io.Information < sizeof(nt.nt32) || nt.nt32.Signature != IMAGE_NT_SIGNATURE) return;
+
+    switch (nt.nt32.OptionalHeader.Magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        if (nt.nt32.OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_IMPORT) return;
+        dir = &nt.nt32.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        if (io.Information < sizeof(nt.nt64)) return;
+        if (nt.nt64.OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_IMPORT) return;
+        dir = &nt.nt64.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+        break;
+    default:
+        return;
+    }
+    if (!dir->VirtualAddress || !dir->Size) return;
+
+    nb_sec = min( nt.nt32.FileHeader.NumberOfSections, ARRAY_SIZE(sec) );
+    offset.QuadPart = dos.e_lfanew + offsetof( IMAGE_NT_HEADERS32, OptionalHeader ) +
+                      nt.nt32.FileHeader.SizeOfOptionalHeader;
+    if (NtReadFile( file, 0, NULL, NULL, &io, sec, nb_sec * sizeof(*sec), &offset, NULL )) return;
+    nb_sec = io.Information / sizeof(*sec);
+
+    for (rva = dir->VirtualAddress, end = rva + dir->Size; rva + sizeof(descr) <= end; rva += sizeof(descr))
+    {
+        if (!read_image_rva( file, sec, nb_sec, rva, &descr, sizeof(descr) )) break;
+        if (!descr.Name || !descr.FirstThunk) break;
+        if (!read_image_rva( file, sec, nb_sec, descr.Name, name, sizeof(name) )) continue;
+        name[sizeof(name) - 1] = 0;
+
+        RtlEnterCriticalSection( &prefetch_section );
+        queue_prefetch_job( name, FALSE );
+        RtlLeaveCriticalSection( &prefetch_section );
+    }
+}
+
+
+/***********************************************************************
+ *           prefetch_dll_file
+ *
+ * Search for a dll and open its image mapping, on a prefetch thread.
+ * Return the handle of the opened file.
+ */
+static HANDLE prefetch_dll_file( struct prefetch_job *job )
+{
+    OBJECT_ATTRIBUTES attr;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER size;
+    FILE_OBJECTID_BUFFER fid;
+    UNICODE_STRING nt_name;
+    const WCHAR *paths = prefetch_path, *ptr;
+    HANDLE handle = 0;
+    NTSTATUS status;
+    WCHAR *name;
+    ULONG len = wcslen( paths ) + wcslen( job->name ) + 2;
+
+    if (!(name = RtlAllocateHeap( GetProcessHeap(), 0, len * sizeof(WCHAR) ))) return 0;
+
+    while (*paths)
+    {
+        ptr = paths;
+        while (*ptr && *ptr != ';') ptr++;
+        len = ptr - paths;
+        if (*ptr == ';') ptr++;
+        memcpy( name, paths, len * sizeof(WCHAR) );
+        if (len && name[len - 1] != '\\') name[len++] = '\\';
+        wcscpy( name + len, job->name );
+        paths = ptr;
+
+        if (RtlDosPathNameToNtPathName_U_WithStatus( name, &nt_name, NULL, NULL )) break;
+        InitializeObjectAttributes( &attr, &nt_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+        status = NtOpenFile( &handle, GENERIC_READ | SYNCHRONIZE, &attr, &io,
+                             FILE_SHARE_READ | FILE_SHARE_DELETE,
+                             FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE );
+        if (status == STATUS_OBJECT_PATH_NOT_FOUND || status == STATUS_OBJECT_NAME_NOT_FOUND)
+        {
+            RtlFreeUnicodeString( &nt_name );
+            handle = 0;
+            continue;
+        }
+
+        /* if the file couldn't be opened, the loader will try again and report the error */
+        job->nt_name = nt_name;
+        if (status)
+        {
+            handle = 0;
+            break;
+        }
+
+        if (!NtFsControlFile( handle, 0, NULL, NULL, &io, FSCTL_GET_OBJECT_ID, NULL, 0, &fid, sizeof(fid) ))
+        {
+            memcpy( &job->id, fid.ObjectId, sizeof(job->id) );
+            job->has_id = TRUE;
+        }
+        size.QuadPart = 0;
+        if (NtCreateSection( &job->mapping, STANDARD_RIGHTS_REQUIRED | SECTION_QUERY |
+                             SECTION_MAP_READ | SECTION_MAP_EXECUTE,
+                             NULL, &size, PAGE_EXECUTE_READ, SEC_IMAGE, handle ))
+            job->mapping = 0;
+        else
+            prefetch_file_imports( handle );
+        break;
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, name );
+    return handle;
+}
+
+
+/***********************************************************************
+ *           prefetch_file_data
+ *
+ * Read a file to bring its pages into the cache before the loader maps it.
+ */
+static void prefetch_file_data( HANDLE file, void *buffer, ULONG size )
+{
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER offset;
+
+    offset.QuadPart = 0;
+    while (!prefetch_stopping)
+    {
+        if (NtReadFile( file, 0, NULL, NULL, &io, buffer, size, &offset, NULL )) break;
+        if (io.Information < size) break;
+        offset.QuadPart += size;
+    }
+}
+
+
+/***********************************************************************
+ *           prefetch_thread_proc
+ *
+ * Thread searching for the dlls in the prefetch queue. It doesn't take the
+ * loader lock, so it is not attached to the loaded dlls.
+ */
+static void CALLBACK prefetch_thread_proc( void *arg )
+{
+    static const ULONG buffer_size = 0x10000;
+    struct prefetch_job *job;
+    ULONG wow64_old_value = 0;
+    HANDLE file;
+    void *buffer;
+
+    /* same as find_dll_file */
+    if (is_wow64) RtlWow64EnableFsRedirectionEx( 0, &wow64_old_value );
+    buffer = RtlAllocateHeap( GetProcessHeap(), 0, buffer_size );
+
+    RtlEnterCriticalSection( &prefetch_section );
+    while (!prefetch_stopping)
+    {
+        LIST_FOR_EACH_ENTRY( job, &prefetch_jobs, struct prefetch_job, entry )
+            if (job->state == PREFETCH_QUEUED) break;
+
+        if (&job->entry == &prefetch_jobs)
+        {
+            RtlSleepConditionVariableCS( &prefetch_cv, &prefetch_section, NULL );
+            continue;
+        }
+
+        job->state = PREFETCH_RUNNING;
+        RtlLeaveCriticalSection( &prefetch_section );
+
+        file = prefetch_dll_file( job );
+
+        RtlEnterCriticalSection( &prefetch_section );
+        job->state = PREFETCH_DONE;
+        RtlWakeAllConditionVariable( &prefetch_cv );
+        if (!file) continue;
+        RtlLeaveCriticalSection( &prefetch_section );
+
+        if (buffer) prefetch_file_data( file, buffer, buffer_size );
+        NtClose( file );
+
+        RtlEnterCriticalSection( &prefetch_section );
+    }
+    prefetch_threads--;
+    RtlWakeAllConditionVariable( &prefetch_cv );
+    RtlLeaveCriticalSection( &prefetch_section );
+
+    RtlFreeHeap( GetProcessHeap(), 0, buffer );
+    RtlFreeThreadActivationContextStack();
+    for (;;) unix_funcs->exit_thread( 0 );
+}
+
+
+/***********************************************************************
+ *           prefetch_imports
+ *
+ * Start searching for the dlls imported by a module, and recursively for
+ * their own imports, on helper threads. This is only done while the imports
+ * of the main exe are fixed up; the dlls are still loaded and initialized
+ * by the loader in the usual order.
+ * The loader_section must be locked while calling this function.
+ */
+static void prefetch_imports( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *imports, int nb_imports,
+                              LPCWSTR load_path )
+{
+    ULONG_PTR affinity;
+    HANDLE thread;
+    int i;
+
+    if (prefetch_stopping || !load_path) return;
+
+    if (!prefetch_path)
+    {
+        /* the helper threads only help if they can run beside the loader */
+        if (NtQueryInformationProcess( GetCurrentProcess(), ProcessAffinityMask,
+                                       &affinity, sizeof(affinity), NULL ))
+            affinity = 0;
+        for ( ; affinity && prefetch_max_threads < PREFETCH_MAX_THREADS; affinity &= affinity - 1)
+            prefetch_max_threads++;
+        if (prefetch_max_threads < 2)
+        {
+            prefetch_stopping = TRUE;
+            return;
+        }
+        if (!(prefetch_path = RtlAllocateHeap( GetProcessHeap(), 0, (wcslen( load_path ) + 1) * sizeof(WCHAR) )))
+            return;
+        wcscpy( prefetch_path, load_path );
+    }
+    else if (wcscmp( load_path, prefetch_path )) return;
+
+    RtlEnterCriticalSection( &prefetch_section );
+
+    /* the loader resolves the imports in order, queue the first one at the front */
+    for (i = nb_imports - 1; i >= 0; i--)
+        queue_prefetch_job( get_rva( module, imports[i].Name ), TRUE );
+
+    while (prefetch_threads < prefetch_max_threads)
+    {
+        if (RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                 prefetch_thread_proc, NULL, &thread, NULL ))
+            break;
+        NtClose( thread );
+        prefetch_threads++;
+    }
+
+    RtlLeaveCriticalSection( &prefetch_section );
+}
+
+
+/***********************************************************************
+ *           stop_prefetch
+ *
+ * Stop the prefetch threads and release the results that weren't used.
+ */
+static void stop_prefetch(void)
+{
+    struct prefetch_job *job, *next;
+
+    if (!prefetch_path) return;
+
+    RtlEnterCriticalSection( &prefetch_section );
+    prefetch_stopping = TRUE;
+    RtlWakeAllConditionVariable( &prefetch_cv );
+    while (prefetch_threads) RtlSleepConditionVariableCS( &prefetch_cv, &prefetch_section, NULL );
+
+    LIST_FOR_EACH_ENTRY_SAFE( job, next, &prefetch_jobs, struct prefetch_job, entry )
+    {
+        list_remove( &job->entry );
+        if (job->mapping) NtClose( job->mapping );
+        RtlFreeUnicodeString( &job->nt_name );
+        RtlFreeHeap( GetProcessHeap(), 0, job );
+    }
+    RtlLeaveCriticalSection( &prefetch_section );
+
+    RtlFreeHeap( GetProcessHeap(), 0, prefetch_path );
+    prefetch_path = NULL;
+}
+
+
 /****************************************************************
  *       fixup_imports_ilonly
  *
@@ -1130,6 +1770,8 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     if (!create_module_activation_context( &wm->ldr ))
         RtlActivateActivationContext( 0, wm->ldr.ActivationContext, &cookie );
 
+    if (!imports_fixup_done) prefetch_imports( wm->ldr.DllBase, imports, nb_imports, load_path );
+
     /* load the imported modules. They are automatically
      * added to the modref list of the process.
      */
@@ -1170,6 +1812,7 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
 
     wm->ldr.DllBase       = hModule;
     wm->ldr.SizeOfImage   = nt->OptionalHeader.SizeOfImage;
+    wm->ldr.OriginalBase  = nt->OptionalHeader.ImageBase;
     wm->ldr.Flags         = LDR_DONT_RESOLVE_REFS | (builtin ? LDR_WINE_INTERNAL : 0);
     wm->ldr.TlsIndex      = -1;
     wm->ldr.LoadCount     = 1;
@@ -1198,6 +1841,7 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
                    &wm->ldr.InLoadOrderLinks);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderLinks);
+    add_module_index( wm );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -1557,26 +2201,14 @@ NTSTATUS WINAPI LdrDisableThreadCalloutsForDll(HMODULE hModule)
 
 /******************************************************************
  *              LdrFindEntryForAddress (NTDLL.@)
- *
- * The loader_section must be locked while calling this function
  */
 NTSTATUS WINAPI LdrFindEntryForAddress( const void *addr, PLDR_DATA_TABLE_ENTRY *pmod )
 {
-    PLIST_ENTRY mark, entry;
-    PLDR_DATA_TABLE_ENTRY mod;
+    WINE_MODREF *wm;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
-        if (mod->DllBase <= addr &&
-            (const char *)addr < (char*)mod->DllBase + mod->SizeOfImage)
-        {
-            *pmod = mod;
-            return STATUS_SUCCESS;
-        }
-    }
-    return STATUS_NO_MORE_ENTRIES;
+    if (!(wm = find_module_by_address( addr ))) return STATUS_NO_MORE_ENTRIES;
+    *pmod = &wm->ldr;
+    return STATUS_SUCCESS;
 }
 
 /******************************************************************
@@ -1784,6 +2416,18 @@ static void set_security_cookie( void *module, SIZE_T len )
     }
 }
 
+/* update the image base in the headers of a relocated module */
+static void set_image_base( IMAGE_NT_HEADERS *nt, void *module )
+{
+    void *addr = &nt->OptionalHeader.ImageBase;
+    SIZE_T size = sizeof(nt->OptionalHeader.ImageBase);
+    ULONG old_prot;
+
+    if (NtProtectVirtualMemory( NtCurrentProcess(), &addr, &size, PAGE_READWRITE, &old_prot )) return;
+    nt->OptionalHeader.ImageBase = (ULONG_PTR)module;
+    NtProtectVirtualMemory( NtCurrentProcess(), &addr, &size, old_prot, &old_prot );
+}
+
 static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T len )
 {
     char *base;
@@ -1856,6 +2500,8 @@ static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T
                                 &size, protect_old[i], &protect_old[i] );
     }
 
+    /* the header holds the actual base, as for images relocated by the server */
+    set_image_base( nt, module );
     return STATUS_SUCCESS;
 }
 
@@ -1883,6 +2529,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
         return STATUS_NO_MEMORY;
 
     if (id) wm->id = *id;
+    wm->ldr.OriginalBase = image_info->base;
     if (image_info->loader_flags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info->image_flags & IMAGE_FLAGS_ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
 
@@ -1903,6 +2550,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderLinks);
             RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+            remove_module_index( wm );
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -2207,6 +2855,38 @@ static NTSTATUS get_dll_load_path_search_flags( LPCWSTR module, DWORD flags, WCH
 }
 
 
+/***********************************************************************
+ *	map_dll_file
+ *
+ * Map the image mapping of a new dll. Helper for open_dll_file.
+ */
+static NTSTATUS map_dll_file( const UNICODE_STRING *nt_name, HANDLE mapping, void **module,
+                              pe_image_info_t *image_info )
+{
+    SIZE_T len = 0;
+    NTSTATUS status;
+
+    if (*module)
+    {
+        NtUnmapViewOfSection( NtCurrentProcess(), *module );
+        *module = NULL;
+    }
+    status = unix_funcs->virtual_map_section( mapping, module, 0, 0, NULL, &len,
+                                              0, PAGE_EXECUTE_READ, image_info );
+    if (status == STATUS_IMAGE_NOT_AT_BASE) status = STATUS_SUCCESS;
+    NtClose( mapping );
+
+    if (!status && !is_valid_binary( *module, image_info ))
+    {
+        TRACE( "%s is for arch %x, continuing search\n", debugstr_us(nt_name), image_info->machine );
+        NtUnmapViewOfSection( NtCurrentProcess(), *module );
+        *module = NULL;
+        status = STATUS_IMAGE_MACHINE_TYPE_MISMATCH;
+    }
+    return status;
+}
+
+
 /***********************************************************************
  *	open_dll_file
  *
@@ -2220,7 +2900,6 @@ static NTSTATUS open_dll_file( UNICODE_STRING *nt_name, WINE_MODREF **pwm,
     IO_STATUS_BLOCK io;
     LARGE_INTEGER size;
     FILE_OBJECTID_BUFFER fid;
-    SIZE_T len = 0;
     NTSTATUS status;
     HANDLE handle, mapping;
 
@@ -2272,26 +2951,61 @@ static NTSTATUS open_dll_file( UNICODE_STRING *nt_name, WINE_MODREF **pwm,
                               NULL, &size, PAGE_EXECUTE_READ, SEC_IMAGE, handle );
     NtClose( handle );
 
-    if (!status)
+    if (!status) status = map_dll_file( nt_name, mapping, module, image_info );
+    return status;
+}
+
+
+/***********************************************************************
+ *	open_prefetched_dll_file
+ *
+ * Open a new dll from the file found by a prefetch thread. Helper for find_dll_file.
+ */
+static NTSTATUS open_prefetched_dll_file( struct prefetch_job *job, UNICODE_STRING *nt_name,
+                                          WINE_MODREF **pwm, void **module,
+                                          pe_image_info_t *image_info, struct file_id *id )
+{
+    HANDLE mapping = job->mapping;
+
+    job->mapping = 0;
+    if (job->has_id) *id = job->id;
+
+    if ((*pwm = find_fullname_module( nt_name )) || (job->has_id && (*pwm = find_fileid_module( id ))))
     {
-        if (*module)
-        {
-            NtUnmapViewOfSection( NtCurrentProcess(), *module );
-            *module = NULL;
-        }
-        status = unix_funcs->virtual_map_section( mapping, module, 0, 0, NULL, &len,
-                                                  0, PAGE_EXECUTE_READ, image_info );
-        if (status == STATUS_IMAGE_NOT_AT_BASE) status = STATUS_SUCCESS;
         NtClose( mapping );
-    }
-    if (!status && !is_valid_binary( *module, image_info ))
-    {
-        TRACE( "%s is for arch %x, continuing search\n", debugstr_us(nt_name), image_info->machine );
         NtUnmapViewOfSection( NtCurrentProcess(), *module );
         *module = NULL;
-        status = STATUS_IMAGE_MACHINE_TYPE_MISMATCH;
+        return STATUS_SUCCESS;
     }
-    return status;
+    return map_dll_file( nt_name, mapping, module, image_info );
+}
+
+
+/***********************************************************************
+ *	get_prefetch_job
+ *
+ * Get the result of the prefetch thread search for a dll, waiting for it if
+ * it's in progress.
+ */
+static struct prefetch_job *get_prefetch_job( LPCWSTR paths, LPCWSTR search )
+{
+    struct prefetch_job *job, *ret = NULL;
+
+    if (!prefetch_path || wcscmp( paths, prefetch_path )) return NULL;
+
+    RtlEnterCriticalSection( &prefetch_section );
+    LIST_FOR_EACH_ENTRY( job, &prefetch_jobs, struct prefetch_job, entry )
+    {
+        if (wcsicmp( job->name, search )) continue;
+        while (job->state == PREFETCH_RUNNING)
+            RtlSleepConditionVariableCS( &prefetch_cv, &prefetch_section, NULL );
+        /* searching ourselves is faster than waiting for a queued job */
+        if (job->state == PREFETCH_DONE) ret = job;
+        job->state = PREFETCH_USED;
+        break;
+    }
+    RtlLeaveCriticalSection( &prefetch_section );
+    return ret;
 }
 
 
@@ -2490,6 +3204,7 @@ static NTSTATUS search_dll_file( LPCWSTR paths, LPCWSTR search, UNICODE_STRING *
                                  WINE_MODREF **pwm, void **module, pe_image_info_t *image_info,
                                  struct file_id *id )
 {
+    struct prefetch_job *job = get_prefetch_job( paths, search );
     WCHAR *name;
     BOOL found_image = FALSE;
     NTSTATUS status = STATUS_DLL_NOT_FOUND;
@@ -2515,7 +3230,15 @@ static NTSTATUS search_dll_file( LPCWSTR paths, LPCWSTR search, UNICODE_STRING *
         nt_name->Buffer = NULL;
         if ((status = RtlDosPathNameToNtPathName_U_WithStatus( name, nt_name, NULL, NULL ))) goto done;
 
-        status = open_dll_file( nt_name, pwm, module, image_info, id );
+        if (!job) status = open_dll_file( nt_name, pwm, module, image_info, id );
+        else if (!job->nt_name.Buffer || !RtlEqualUnicodeString( nt_name, &job->nt_name, TRUE ))
+            status = STATUS_DLL_NOT_FOUND;  /* the prefetch thread didn't find it there */
+        else
+        {
+            if (job->mapping) status = open_prefetched_dll_file( job, nt_name, pwm, module, image_info, id );
+            else status = open_dll_file( nt_name, pwm, module, image_info, id );
+            job = NULL;
+        }
         if (status == STATUS_IMAGE_MACHINE_TYPE_MISMATCH) found_image = TRUE;
         else if (status != STATUS_DLL_NOT_FOUND) goto done;
         RtlFreeUnicodeString( nt_name );
@@ -3241,6 +3964,7 @@ static void free_modref( WINE_MODREF *wm )
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
+    remove_module_index( wm );
 
     TRACE(" unloading %s\n", debugstr_w(wm->ldr.FullDllName.Buffer));
     if (!TRACE_ON(module))
@@ -3261,6 +3985,7 @@ static void free_modref( WINE_MODREF *wm )
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
@@ -3416,6 +4141,9 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, void **entry, ULONG_PTR unknow
     WINE_MODREF *wm;
     LPCWSTR load_path = NtCurrentTeb()->Peb->ProcessParameters->DllPath.Buffer;
 
+    /* the prefetch threads run while the loader lock is held, and don't call any dll code */
+    if (*entry == (void *)prefetch_thread_proc) return;
+
     if (process_detaching) return;
 
     RtlEnterCriticalSection( &loader_section );
@@ -3438,6 +4166,7 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, void **entry, ULONG_PTR unknow
             NtTerminateProcess( GetCurrentProcess(), status );
         }
         imports_fixup_done = TRUE;
+        stop_prefetch();
     }
 
     RtlAcquirePebLock();
@@ -4972,6 +4972,55 @@ static void test_file_readonly_access(void)
     DeleteFileW(path);
 }
 
+static void test_file_name_case(void)
+{
+    static const WCHAR fooW[] = {'f','o','o',0};
+    WCHAR dir[MAX_PATH], path[MAX_PATH], path2[MAX_PATH];
+    HANDLE handle;
+    BOOL ret;
+
+    GetTempPathW(MAX_PATH, dir);
+    GetTempFileNameW(dir, fooW, 0, dir);
+    DeleteFileW(dir);
+    ret = CreateDirectoryW(dir, NULL);
+    ok(ret, "CreateDirectory failed, error %u\n", GetLastError());
+
+    wsprintfW(path, L"%s\\Test.txt", dir);
+    handle = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0);
+    ok(handle != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    CloseHandle(handle);
+
+    wsprintfW(path, L"%s\\TEST.TXT", dir);
+    ok(GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES, "file not found, error %u\n", GetLastError());
+    wsprintfW(path, L"%s\\OTHER.TXT", dir);
+    ok(GetFileAttributesW(path) == INVALID_FILE_ATTRIBUTES, "file found\n");
+
+    /* the directory contents must not be cached across changes */
+    wsprintfW(path, L"%s\\Other.txt", dir);
+    handle = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0);
+    ok(handle != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    CloseHandle(handle);
+    wsprintfW(path, L"%s\\OTHER.TXT", dir);
+    ok(GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES, "file not found, error %u\n", GetLastError());
+
+    wsprintfW(path2, L"%s\\Renamed.txt", dir);
+    ret = MoveFileW(path, path2);
+    ok(ret, "MoveFile failed, error %u\n", GetLastError());
+    ok(GetFileAttributesW(path) == INVALID_FILE_ATTRIBUTES, "file found\n");
+    wsprintfW(path, L"%s\\RENAMED.TXT", dir);
+    ok(GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES, "file not found, error %u\n", GetLastError());
+
+    ret = DeleteFileW(path);
+    ok(ret, "DeleteFile failed, error %u\n", GetLastError());
+    ok(GetFileAttributesW(path) == INVALID_FILE_ATTRIBUTES, "file found\n");
+
+    wsprintfW(path, L"%s\\TEST.TXT", dir);
+    ret = DeleteFileW(path);
+    ok(ret, "DeleteFile failed, error %u\n", GetLastError());
+    ret = RemoveDirectoryW(dir);
+    ok(ret, "RemoveDirectory failed, error %u\n", GetLastError());
+}
+
 START_TEST(file)
 {
     HMODULE hkernel32 = GetModuleHandleA("kernel32.dll");
@@ -5038,6 +5087,7 @@ START_TEST(file)
     test_file_attribute_tag_information();
     test_file_mode();
     test_file_readonly_access();
+    test_file_name_case();
     test_query_volume_information_file();
     test_query_attribute_information_file();
     test_ioctl();
@@ -1583,6 +1583,57 @@ static void test_query_object(void)
 
 }
 
+static void test_query_object_handle_reuse(void)
+{
+    OBJECT_DATA_INFORMATION info;
+    HANDLE handle, handle2, dup;
+    NTSTATUS status;
+    ULONG len;
+
+    handle = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ok( handle != NULL, "CreateEvent failed %u\n", GetLastError() );
+    test_object_type( handle, "Event" );
+
+    status = pNtQueryObject( handle, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( !status, "NtQueryObject failed %x\n", status );
+    ok( !info.InheritHandle, "got inherit %d\n", info.InheritHandle );
+    ok( !info.ProtectFromClose, "got protect %d\n", info.ProtectFromClose );
+
+    ok( SetHandleInformation( handle, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT ),
+        "SetHandleInformation failed %u\n", GetLastError() );
+    status = pNtQueryObject( handle, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( !status, "NtQueryObject failed %x\n", status );
+    ok( info.InheritHandle, "got inherit %d\n", info.InheritHandle );
+
+    /* the handle value is reused for an object of a different type */
+    pNtClose( handle );
+    handle2 = CreateMutexA( NULL, FALSE, NULL );
+    ok( handle2 != NULL, "CreateMutex failed %u\n", GetLastError() );
+    test_object_type( handle2, "Mutant" );
+    status = pNtQueryObject( handle2, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( !status, "NtQueryObject failed %x\n", status );
+    ok( !info.InheritHandle, "got inherit %d\n", info.InheritHandle );
+    if (handle2 != handle)
+    {
+        status = pNtQueryObject( handle, ObjectTypeInformation, &info, sizeof(info), &len );
+        ok( status == STATUS_INVALID_HANDLE, "got %x\n", status );
+    }
+
+    ok( DuplicateHandle( GetCurrentProcess(), handle2, GetCurrentProcess(), &dup, 0, TRUE,
+                         DUPLICATE_SAME_ACCESS | DUPLICATE_CLOSE_SOURCE ),
+        "DuplicateHandle failed %u\n", GetLastError() );
+    status = pNtQueryObject( dup, ObjectDataInformation, &info, sizeof(info), &len );
+    ok( !status, "NtQueryObject failed %x\n", status );
+    ok( info.InheritHandle, "got inherit %d\n", info.InheritHandle );
+    test_object_type( dup, "Mutant" );
+    if (dup != handle2)
+    {
+        status = pNtQueryObject( handle2, ObjectDataInformation, &info, sizeof(info), &len );
+        ok( status == STATUS_INVALID_HANDLE, "got %x\n", status );
+    }
+    pNtClose( dup );
+}
+
 static void test_type_mismatch(void)
 {
     HANDLE h;
@@ -2215,6 +2266,7 @@ START_TEST(om)
     test_directory();
     test_symboliclink();
     test_query_object();
+    test_query_object_handle_reuse();
     test_type_mismatch();
     test_event();
     test_mutant();
@@ -80,6 +80,7 @@ static BOOL      (WINAPI *pRtlIsCriticalSectionLocked)(CRITICAL_SECTION *);
 static BOOL      (WINAPI *pRtlIsCriticalSectionLockedByThread)(CRITICAL_SECTION *);
 static NTSTATUS  (WINAPI *pRtlInitializeCriticalSectionEx)(CRITICAL_SECTION *, ULONG, ULONG);
 static NTSTATUS  (WINAPI *pLdrEnumerateLoadedModules)(void *, void *, void *);
+static NTSTATUS  (WINAPI *pLdrFindEntryForAddress)(const void *, PLDR_DATA_TABLE_ENTRY *);
 static NTSTATUS  (WINAPI *pLdrRegisterDllNotification)(ULONG, PLDR_DLL_NOTIFICATION_FUNCTION, void *, void **);
 static NTSTATUS  (WINAPI *pLdrUnregisterDllNotification)(void *);
 
@@ -120,6 +121,7 @@ static void InitFunctionPtrs(void)
         pRtlIsCriticalSectionLockedByThread = (void *)GetProcAddress(hntdll, "RtlIsCriticalSectionLockedByThread");
         pRtlInitializeCriticalSectionEx = (void *)GetProcAddress(hntdll, "RtlInitializeCriticalSectionEx");
         pLdrEnumerateLoadedModules = (void *)GetProcAddress(hntdll, "LdrEnumerateLoadedModules");
+        pLdrFindEntryForAddress = (void *)GetProcAddress(hntdll, "LdrFindEntryForAddress");
         pLdrRegisterDllNotification = (void *)GetProcAddress(hntdll, "LdrRegisterDllNotification");
         pLdrUnregisterDllNotification = (void *)GetProcAddress(hntdll, "LdrUnregisterDllNotification");
     }
@@ -3192,6 +3194,63 @@ static void test_LdrEnumerateLoadedModules(void)
     ok(status == STATUS_INVALID_PARAMETER, "expected STATUS_INVALID_PARAMETER, got 0x%08x\n", status);
 }
 
+static void WINAPI ldr_find_callback(LDR_DATA_TABLE_ENTRY *module, void *context, BOOLEAN *stop)
+{
+    const char *base = module->DllBase;
+    LDR_DATA_TABLE_ENTRY *found;
+    NTSTATUS status;
+    int *count = context;
+
+    found = NULL;
+    status = pLdrFindEntryForAddress(base, &found);
+    ok(!status, "%s: LdrFindEntryForAddress failed with %08x\n", wine_dbgstr_w(module->BaseDllName.Buffer), status);
+    ok(found == module, "%s: got %p, expected %p\n", wine_dbgstr_w(module->BaseDllName.Buffer), found, module);
+
+    found = NULL;
+    status = pLdrFindEntryForAddress(base + module->SizeOfImage - 1, &found);
+    ok(!status, "%s: LdrFindEntryForAddress failed with %08x\n", wine_dbgstr_w(module->BaseDllName.Buffer), status);
+    ok(found == module, "%s: got %p, expected %p\n", wine_dbgstr_w(module->BaseDllName.Buffer), found, module);
+
+    found = NULL;
+    status = pLdrFindEntryForAddress(base + module->SizeOfImage, &found);
+    ok(status || found != module, "%s: found module past its end\n", wine_dbgstr_w(module->BaseDllName.Buffer));
+
+    (*count)++;
+}
+
+static void test_LdrFindEntryForAddress(void)
+{
+    LDR_DATA_TABLE_ENTRY *found;
+    NTSTATUS status;
+    HMODULE module;
+    int count = 0;
+
+    if (!pLdrFindEntryForAddress || !pLdrEnumerateLoadedModules)
+    {
+        win_skip("LdrFindEntryForAddress not available\n");
+        return;
+    }
+
+    /* every loaded module is found at both ends of its image */
+    status = pLdrEnumerateLoadedModules(NULL, ldr_find_callback, &count);
+    ok(status == STATUS_SUCCESS, "LdrEnumerateLoadedModules failed with %08x\n", status);
+    ok(count > 1, "Expected more than one module, got %d\n", count);
+
+    module = GetModuleHandleA("ntdll.dll");
+    found = NULL;
+    status = pLdrFindEntryForAddress(pLdrFindEntryForAddress, &found);
+    ok(!status, "LdrFindEntryForAddress failed with %08x\n", status);
+    ok(found && found->DllBase == module, "got module %p, expected %p\n", found ? found->DllBase : NULL, module);
+
+    found = (void *)0xdeadbeef;
+    status = pLdrFindEntryForAddress(NULL, &found);
+    ok(status == STATUS_NO_MORE_ENTRIES, "expected STATUS_NO_MORE_ENTRIES, got %08x\n", status);
+    ok(found == (void *)0xdeadbeef, "got %p\n", found);
+
+    status = pLdrFindEntryForAddress(&count, &found);
+    ok(status == STATUS_NO_MORE_ENTRIES, "expected STATUS_NO_MORE_ENTRIES, got %08x\n", status);
+}
+
 static void test_RtlMakeSelfRelativeSD(void)
 {
     char buf[sizeof(SECURITY_DESCRIPTOR_RELATIVE) + 4];
@@ -3521,6 +3580,7 @@ START_TEST(rtl)
     test_RtlInitializeCriticalSectionEx();
     test_RtlLeaveCriticalSection();
     test_LdrEnumerateLoadedModules();
+    test_LdrFindEntryForAddress();
     test_RtlMakeSelfRelativeSD();
     test_LdrRegisterDllNotification();
 }
@@ -0,0 +1,562 @@
+/*
+ * Unit tests for NT synchronization objects
+ *
+ * Copyright (C) 2020 the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntdll_test.h"
+
+static NTSTATUS (WINAPI *pNtClose)( HANDLE );
+static NTSTATUS (WINAPI *pNtCreateIoCompletion)( HANDLE *, ACCESS_MASK, OBJECT_ATTRIBUTES *, ULONG );
+static NTSTATUS (WINAPI *pNtCreateEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, EVENT_TYPE, BOOLEAN );
+static NTSTATUS (WINAPI *pNtCreateMutant)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, BOOLEAN );
+static NTSTATUS (WINAPI *pNtCreateSemaphore)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, LONG, LONG );
+static NTSTATUS (WINAPI *pNtDuplicateObject)( HANDLE, HANDLE, HANDLE, HANDLE *, ACCESS_MASK, ULONG, ULONG );
+static NTSTATUS (WINAPI *pNtQueryIoCompletion)( HANDLE, IO_COMPLETION_INFORMATION_CLASS, void *, ULONG, ULONG * );
+static NTSTATUS (WINAPI *pNtQueryEvent)( HANDLE, EVENT_INFORMATION_CLASS, void *, ULONG, ULONG * );
+static NTSTATUS (WINAPI *pNtQueryMutant)( HANDLE, MUTANT_INFORMATION_CLASS, void *, ULONG, ULONG * );
+static NTSTATUS (WINAPI *pNtQuerySemaphore)( HANDLE, SEMAPHORE_INFORMATION_CLASS, void *, ULONG, ULONG * );
+static NTSTATUS (WINAPI *pNtRemoveIoCompletion)( HANDLE, ULONG_PTR *, ULONG_PTR *, IO_STATUS_BLOCK *, LARGE_INTEGER * );
+static NTSTATUS (WINAPI *pNtRemoveIoCompletionEx)( HANDLE, FILE_IO_COMPLETION_INFORMATION *, ULONG, ULONG *,
+                                                   LARGE_INTEGER *, BOOLEAN );
+static NTSTATUS (WINAPI *pNtReleaseMutant)( HANDLE, LONG * );
+static NTSTATUS (WINAPI *pNtReleaseSemaphore)( HANDLE, ULONG, ULONG * );
+static NTSTATUS (WINAPI *pNtResetEvent)( HANDLE, LONG * );
+static NTSTATUS (WINAPI *pNtSetEvent)( HANDLE, LONG * );
+static NTSTATUS (WINAPI *pNtSetIoCompletion)( HANDLE, ULONG_PTR, ULONG_PTR, NTSTATUS, SIZE_T );
+static NTSTATUS (WINAPI *pNtWaitForMultipleObjects)( ULONG, const HANDLE *, BOOLEAN, BOOLEAN, const LARGE_INTEGER * );
+static NTSTATUS (WINAPI *pNtWaitForSingleObject)( HANDLE, BOOLEAN, const LARGE_INTEGER * );
+
+static LARGE_INTEGER zero_timeout;
+
+static void test_event(void)
+{
+    EVENT_BASIC_INFORMATION info;
+    HANDLE event, event2, handles[2];
+    LONG prev_state = 0xdeadbeef;
+    NTSTATUS status;
+
+    status = pNtCreateEvent( &event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, TRUE );
+    ok( !status, "NtCreateEvent failed %08x\n", status );
+
+    status = pNtWaitForSingleObject( event, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    status = pNtWaitForSingleObject( event, FALSE, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+
+    status = pNtSetEvent( event, &prev_state );
+    ok( !status, "NtSetEvent failed %08x\n", status );
+    ok( !prev_state, "got prev_state %d\n", prev_state );
+    status = pNtSetEvent( event, &prev_state );
+    ok( !status, "NtSetEvent failed %08x\n", status );
+    ok( prev_state == 1, "got prev_state %d\n", prev_state );
+
+    status = pNtQueryEvent( event, EventBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryEvent failed %08x\n", status );
+    ok( info.EventType == SynchronizationEvent, "got type %d\n", info.EventType );
+    ok( info.EventState == 1, "got state %d\n", info.EventState );
+
+    status = pNtResetEvent( event, &prev_state );
+    ok( !status, "NtResetEvent failed %08x\n", status );
+    ok( prev_state == 1, "got prev_state %d\n", prev_state );
+
+    status = pNtCreateEvent( &event2, EVENT_ALL_ACCESS, NULL, NotificationEvent, TRUE );
+    ok( !status, "NtCreateEvent failed %08x\n", status );
+
+    /* the lowest signaled index is returned, and the other objects are left untouched */
+    handles[0] = event;
+    handles[1] = event2;
+    status = pNtWaitForMultipleObjects( 2, handles, TRUE, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0 + 1, "got %08x\n", status );
+    status = pNtSetEvent( event, NULL );
+    ok( !status, "NtSetEvent failed %08x\n", status );
+    status = pNtWaitForMultipleObjects( 2, handles, TRUE, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    status = pNtWaitForMultipleObjects( 2, handles, TRUE, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0 + 1, "got %08x\n", status );
+    status = pNtWaitForMultipleObjects( 2, handles, FALSE, FALSE, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+
+    status = pNtQueryEvent( event2, EventBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryEvent failed %08x\n", status );
+    ok( info.EventType == NotificationEvent, "got type %d\n", info.EventType );
+    ok( info.EventState == 1, "got state %d\n", info.EventState );
+
+    /* access rights are checked on the handle */
+    status = pNtDuplicateObject( GetCurrentProcess(), event, GetCurrentProcess(), &handles[0],
+                                 SYNCHRONIZE, 0, 0 );
+    ok( !status, "NtDuplicateObject failed %08x\n", status );
+    status = pNtSetEvent( handles[0], NULL );
+    ok( status == STATUS_ACCESS_DENIED, "got %08x\n", status );
+    status = pNtQueryEvent( handles[0], EventBasicInformation, &info, sizeof(info), NULL );
+    ok( status == STATUS_ACCESS_DENIED, "got %08x\n", status );
+    pNtClose( handles[0] );
+
+    status = pNtReleaseSemaphore( event, 1, NULL );
+    ok( status == STATUS_OBJECT_TYPE_MISMATCH, "got %08x\n", status );
+
+    pNtClose( event );
+    pNtClose( event2 );
+}
+
+static void test_semaphore(void)
+{
+    SEMAPHORE_BASIC_INFORMATION info;
+    ULONG prev = 0xdeadbeef;
+    NTSTATUS status;
+    HANDLE sem;
+
+    status = pNtCreateSemaphore( &sem, SEMAPHORE_ALL_ACCESS, NULL, 1, 2 );
+    ok( !status, "NtCreateSemaphore failed %08x\n", status );
+
+    status = pNtReleaseSemaphore( sem, 2, &prev );
+    ok( status == STATUS_SEMAPHORE_LIMIT_EXCEEDED, "got %08x\n", status );
+    ok( prev == 0xdeadbeef, "got prev %u\n", prev );
+    status = pNtReleaseSemaphore( sem, 1, &prev );
+    ok( !status, "NtReleaseSemaphore failed %08x\n", status );
+    ok( prev == 1, "got prev %u\n", prev );
+
+    status = pNtQuerySemaphore( sem, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQuerySemaphore failed %08x\n", status );
+    ok( info.CurrentCount == 2, "got count %d\n", info.CurrentCount );
+    ok( info.MaximumCount == 2, "got max %d\n", info.MaximumCount );
+
+    status = pNtWaitForSingleObject( sem, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    status = pNtWaitForSingleObject( sem, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    status = pNtWaitForSingleObject( sem, FALSE, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+
+    status = pNtQuerySemaphore( sem, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQuerySemaphore failed %08x\n", status );
+    ok( !info.CurrentCount, "got count %d\n", info.CurrentCount );
+
+    pNtClose( sem );
+}
+
+static DWORD WINAPI mutant_thread( void *arg )
+{
+    HANDLE mutant = arg;
+    NTSTATUS status;
+    LONG prev;
+
+    status = pNtReleaseMutant( mutant, &prev );
+    ok( status == STATUS_MUTANT_NOT_OWNED, "got %08x\n", status );
+
+    status = pNtWaitForSingleObject( mutant, FALSE, NULL );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    /* exit while owning it */
+    return 0;
+}
+
+static void test_mutant(void)
+{
+    MUTANT_BASIC_INFORMATION info;
+    NTSTATUS status;
+    HANDLE mutant, thread;
+    LONG prev;
+
+    status = pNtCreateMutant( &mutant, MUTANT_ALL_ACCESS, NULL, TRUE );
+    ok( !status, "NtCreateMutant failed %08x\n", status );
+
+    status = pNtWaitForSingleObject( mutant, FALSE, &zero_timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+
+    status = pNtQueryMutant( mutant, MutantBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryMutant failed %08x\n", status );
+    ok( info.CurrentCount == -1, "got count %d\n", info.CurrentCount );
+    ok( info.OwnedByCaller, "expected owned\n" );
+    ok( !info.AbandonedState, "expected not abandoned\n" );
+
+    thread = CreateThread( NULL, 0, mutant_thread, mutant, 0, NULL );
+
+    status = pNtReleaseMutant( mutant, &prev );
+    ok( !status, "NtReleaseMutant failed %08x\n", status );
+    ok( prev == -1, "got prev %d\n", prev );
+    status = pNtReleaseMutant( mutant, &prev );
+    ok( !status, "NtReleaseMutant failed %08x\n", status );
+    ok( !prev, "got prev %d\n", prev );
+    status = pNtReleaseMutant( mutant, &prev );
+    ok( status == STATUS_MUTANT_NOT_OWNED, "got %08x\n", status );
+
+    ok( !WaitForSingleObject( thread, 1000 ), "wait failed\n" );
+    CloseHandle( thread );
+
+    status = pNtQueryMutant( mutant, MutantBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryMutant failed %08x\n", status );
+    ok( info.CurrentCount == 1, "got count %d\n", info.CurrentCount );
+    ok( !info.OwnedByCaller, "expected not owned\n" );
+    ok( info.AbandonedState, "expected abandoned\n" );
+
+    status = pNtWaitForSingleObject( mutant, FALSE, &zero_timeout );
+    ok( status == STATUS_ABANDONED, "got %08x\n", status );
+    status = pNtReleaseMutant( mutant, NULL );
+    ok( !status, "NtReleaseMutant failed %08x\n", status );
+
+    pNtClose( mutant );
+}
+
+#define PING_PONG_COUNT 1000
+
+static DWORD WINAPI ping_pong_thread( void *arg )
+{
+    HANDLE *events = arg;
+    NTSTATUS status;
+    int i;
+
+    for (i = 0; i < PING_PONG_COUNT; i++)
+    {
+        status = pNtWaitForSingleObject( events[0], FALSE, NULL );
+        ok( status == STATUS_WAIT_0, "got %08x\n", status );
+        pNtSetEvent( events[1], NULL );
+    }
+    return 0;
+}
+
+static void test_signal_wait(void)
+{
+    HANDLE events[2], thread;
+    NTSTATUS status;
+    int i;
+
+    pNtCreateEvent( &events[0], EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    pNtCreateEvent( &events[1], EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+
+    /* ping-pong between two threads, each wakeup has to be seen exactly once */
+    thread = CreateThread( NULL, 0, ping_pong_thread, events, 0, NULL );
+    for (i = 0; i < PING_PONG_COUNT; i++)
+    {
+        pNtSetEvent( events[0], NULL );
+        status = pNtWaitForSingleObject( events[1], FALSE, NULL );
+        ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    }
+
+    ok( !WaitForSingleObject( thread, 1000 ), "wait failed\n" );
+    CloseHandle( thread );
+    status = pNtWaitForSingleObject( events[0], FALSE, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+    status = pNtWaitForSingleObject( events[1], FALSE, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+    pNtClose( events[0] );
+    pNtClose( events[1] );
+}
+
+static unsigned int apc_count;
+
+static void CALLBACK user_apc( ULONG_PTR arg )
+{
+    apc_count++;
+}
+
+static void test_alertable_wait(void)
+{
+    HANDLE event;
+    NTSTATUS status;
+
+    pNtCreateEvent( &event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, TRUE );
+
+    /* queued user APCs are run before the objects are even checked */
+    apc_count = 0;
+    QueueUserAPC( user_apc, GetCurrentThread(), 0 );
+    status = pNtWaitForSingleObject( event, TRUE, &zero_timeout );
+    ok( status == STATUS_USER_APC, "got %08x\n", status );
+    ok( apc_count == 1, "got %u APCs\n", apc_count );
+
+    status = pNtWaitForSingleObject( event, TRUE, &zero_timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    status = pNtWaitForSingleObject( event, TRUE, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+    ok( apc_count == 1, "got %u APCs\n", apc_count );
+
+    pNtClose( event );
+}
+
+static void test_other_process_child( const char *name )
+{
+    char event_name[64];
+    HANDLE events[2], sem;
+    LONG prev;
+    DWORD ret;
+
+    sprintf( event_name, "%s_event0", name );
+    events[0] = OpenEventA( EVENT_ALL_ACCESS, FALSE, event_name );
+    ok( events[0] != NULL, "OpenEvent failed %u\n", GetLastError() );
+    sprintf( event_name, "%s_event1", name );
+    events[1] = OpenEventA( EVENT_ALL_ACCESS, FALSE, event_name );
+    ok( events[1] != NULL, "OpenEvent failed %u\n", GetLastError() );
+    sprintf( event_name, "%s_sem", name );
+    sem = OpenSemaphoreA( SEMAPHORE_ALL_ACCESS, FALSE, event_name );
+    ok( sem != NULL, "OpenSemaphore failed %u\n", GetLastError() );
+
+    /* the count was changed by the parent without the server seeing it */
+    ok( ReleaseSemaphore( sem, 1, &prev ), "ReleaseSemaphore failed %u\n", GetLastError() );
+    ok( prev == 2, "got prev %d\n", prev );
+    ok( !WaitForSingleObject( sem, 0 ), "wait failed\n" );
+
+    SetEvent( events[0] );
+    ret = WaitForSingleObject( events[1], 5000 );
+    ok( !ret, "got %u\n", ret );
+
+    CloseHandle( events[0] );
+    CloseHandle( events[1] );
+    CloseHandle( sem );
+}
+
+/* objects created by another process go through the server */
+static void test_other_process( const char *argv0 )
+{
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    char name[64], event_name[64], cmdline[MAX_PATH * 2];
+    HANDLE events[2], sem;
+    LONG prev;
+    DWORD ret;
+
+    sprintf( name, "wine_test_sync_%u", GetCurrentProcessId() );
+    sprintf( event_name, "%s_event0", name );
+    events[0] = CreateEventA( NULL, FALSE, FALSE, event_name );
+    sprintf( event_name, "%s_event1", name );
+    events[1] = CreateEventA( NULL, FALSE, FALSE, event_name );
+    sprintf( event_name, "%s_sem", name );
+    sem = CreateSemaphoreA( NULL, 0, 4, event_name );
+
+    ok( ReleaseSemaphore( sem, 2, &prev ), "ReleaseSemaphore failed %u\n", GetLastError() );
+    ok( !prev, "got prev %d\n", prev );
+
+    sprintf( cmdline, "\"%s\" sync %s", argv0, name );
+    ok( CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi ),
+        "CreateProcess failed %u\n", GetLastError() );
+
+    ret = WaitForSingleObject( events[0], 5000 );
+    ok( !ret, "got %u\n", ret );
+    SetEvent( events[1] );
+    winetest_wait_child_process( pi.hProcess );
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+
+    ok( ReleaseSemaphore( sem, 1, &prev ), "ReleaseSemaphore failed %u\n", GetLastError() );
+    ok( prev == 2, "got prev %d\n", prev );
+
+    CloseHandle( events[0] );
+    CloseHandle( events[1] );
+    CloseHandle( sem );
+}
+
+/* more than what fits in the shared ring of the fast path */
+#define COMPLETION_COUNT 3000
+
+static DWORD WINAPI completion_wait_thread( void *arg )
+{
+    IO_STATUS_BLOCK io;
+    ULONG_PTR key, value;
+    NTSTATUS status;
+
+    status = pNtRemoveIoCompletion( arg, &key, &value, &io, NULL );
+    ok( !status, "NtRemoveIoCompletion failed %08x\n", status );
+    ok( key == 0xdead && value == 0xbeef, "got key %lx value %lx\n", key, value );
+    ok( U(io).Status == STATUS_END_OF_FILE && io.Information == 42,
+        "got status %08x information %lu\n", U(io).Status, io.Information );
+    return 0;
+}
+
+static void test_completion(void)
+{
+    FILE_IO_COMPLETION_INFORMATION info[16];
+    ULONG_PTR key, value;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+    HANDLE port, thread;
+    ULONG depth, count, i, j;
+
+    status = pNtCreateIoCompletion( &port, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( !status, "NtCreateIoCompletion failed %08x\n", status );
+
+    status = pNtRemoveIoCompletion( port, &key, &value, &io, &zero_timeout );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+
+    for (i = 0; i < COMPLETION_COUNT; i++)
+    {
+        status = pNtSetIoCompletion( port, i, ~i, i, i * 2 );
+        ok( !status, "NtSetIoCompletion failed %08x\n", status );
+    }
+    status = pNtQueryIoCompletion( port, IoCompletionBasicInformation, &depth, sizeof(depth), NULL );
+    ok( !status, "NtQueryIoCompletion failed %08x\n", status );
+    ok( depth == COMPLETION_COUNT, "got depth %u\n", depth );
+
+    /* packets are removed in order, including the ones that didn't fit in the ring */
+    for (i = 0; i < COMPLETION_COUNT / 2; i++)
+    {
+        status = pNtRemoveIoCompletion( port, &key, &value, &io, &zero_timeout );
+        ok( !status, "NtRemoveIoCompletion failed %08x\n", status );
+        ok( key == i && value == ~(ULONG_PTR)i, "%u: got key %lx value %lx\n", i, key, value );
+        ok( U(io).Status == i && io.Information == i * 2, "%u: got status %08x information %lu\n",
+            i, U(io).Status, io.Information );
+        if (key != i) break;
+    }
+    while (i < COMPLETION_COUNT)
+    {
+        status = pNtRemoveIoCompletionEx( port, info, ARRAY_SIZE(info), &count, &zero_timeout, FALSE );
+        ok( !status, "NtRemoveIoCompletionEx failed %08x\n", status );
+        ok( count == min( ARRAY_SIZE(info), COMPLETION_COUNT - i ), "got count %u\n", count );
+        for (j = 0; j < count; j++, i++)
+            ok( info[j].CompletionKey == i && U(info[j].IoStatusBlock).Status == i,
+                "%u: got key %lx status %08x\n", i, info[j].CompletionKey, U(info[j].IoStatusBlock).Status );
+        if (status) break;
+    }
+
+    status = pNtQueryIoCompletion( port, IoCompletionBasicInformation, &depth, sizeof(depth), NULL );
+    ok( !status, "NtQueryIoCompletion failed %08x\n", status );
+    ok( !depth, "got depth %u\n", depth );
+    status = pNtRemoveIoCompletionEx( port, info, ARRAY_SIZE(info), &count, &zero_timeout, FALSE );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+
+    /* wake up a thread blocked on the port */
+    thread = CreateThread( NULL, 0, completion_wait_thread, port, 0, NULL );
+    Sleep( 50 );
+    status = pNtSetIoCompletion( port, 0xdead, 0xbeef, STATUS_END_OF_FILE, 42 );
+    ok( !status, "NtSetIoCompletion failed %08x\n", status );
+    ok( !WaitForSingleObject( thread, 1000 ), "wait failed\n" );
+    CloseHandle( thread );
+
+    pNtClose( port );
+}
+
+#define CONCURRENT_PACKETS  1000
+#define CONCURRENT_THREADS  4
+
+static HANDLE concurrent_port;
+static LONG concurrent_received[CONCURRENT_THREADS][CONCURRENT_PACKETS];
+
+static DWORD WINAPI completion_producer_thread( void *arg )
+{
+    ULONG_PTR id = (ULONG_PTR)arg;
+    NTSTATUS status;
+    ULONG i;
+
+    for (i = 0; i < CONCURRENT_PACKETS; i++)
+    {
+        status = pNtSetIoCompletion( concurrent_port, id + 1, i, 0, 0 );
+        ok( !status, "NtSetIoCompletion failed %08x\n", status );
+    }
+    return 0;
+}
+
+static DWORD WINAPI completion_consumer_thread( void *arg )
+{
+    LONG last[CONCURRENT_THREADS];
+    IO_STATUS_BLOCK io;
+    ULONG_PTR key, value;
+    NTSTATUS status;
+
+    memset( last, 0xff, sizeof(last) );
+    for (;;)
+    {
+        status = pNtRemoveIoCompletion( concurrent_port, &key, &value, &io, NULL );
+        ok( !status, "NtRemoveIoCompletion failed %08x\n", status );
+        if (status || !key) break;
+        ok( key <= CONCURRENT_THREADS && value < CONCURRENT_PACKETS, "got key %lx value %lx\n", key, value );
+        if (key > CONCURRENT_THREADS || value >= CONCURRENT_PACKETS) break;
+        /* the packets of a given thread are seen in order */
+        ok( (LONG)value > last[key - 1], "got value %lu after %d\n", value, last[key - 1] );
+        last[key - 1] = value;
+        InterlockedIncrement( &concurrent_received[key - 1][value] );
+    }
+    return 0;
+}
+
+static void test_completion_concurrency(void)
+{
+    HANDLE producers[CONCURRENT_THREADS], consumers[CONCURRENT_THREADS];
+    NTSTATUS status;
+    ULONG i, j, depth;
+
+    status = pNtCreateIoCompletion( &concurrent_port, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( !status, "NtCreateIoCompletion failed %08x\n", status );
+
+    for (i = 0; i < CONCURRENT_THREADS; i++)
+        consumers[i] = CreateThread( NULL, 0, completion_consumer_thread, NULL, 0, NULL );
+    for (i = 0; i < CONCURRENT_THREADS; i++)
+        producers[i] = CreateThread( NULL, 0, completion_producer_thread, (void *)(ULONG_PTR)i, 0, NULL );
+
+    ok( !WaitForMultipleObjects( CONCURRENT_THREADS, producers, TRUE, 10000 ), "wait failed\n" );
+    /* a zero key tells the consumers to exit */
+    for (i = 0; i < CONCURRENT_THREADS; i++) pNtSetIoCompletion( concurrent_port, 0, 0, 0, 0 );
+    ok( !WaitForMultipleObjects( CONCURRENT_THREADS, consumers, TRUE, 10000 ), "wait failed\n" );
+
+    /* every packet is received exactly once */
+    for (i = 0; i < CONCURRENT_THREADS; i++)
+        for (j = 0; j < CONCURRENT_PACKETS; j++)
+            ok( concurrent_received[i][j] == 1, "packet %u of thread %u received %d times\n",
+                j, i, concurrent_received[i][j] );
+
+    status = pNtQueryIoCompletion( concurrent_port, IoCompletionBasicInformation, &depth, sizeof(depth), NULL );
+    ok( !status, "NtQueryIoCompletion failed %08x\n", status );
+    ok( !depth, "got depth %u\n", depth );
+
+    for (i = 0; i < CONCURRENT_THREADS; i++)
+    {
+        CloseHandle( producers[i] );
+        CloseHandle( consumers[i] );
+    }
+    pNtClose( concurrent_port );
+}
+
+START_TEST(sync)
+{
+    HMODULE ntdll = GetModuleHandleA( "ntdll.dll" );
+    char **argv;
+    int argc;
+
+#define GET_PROC(name) p##name = (void *)GetProcAddress( ntdll, #name )
+    GET_PROC( NtClose );
+    GET_PROC( NtCreateEvent );
+    GET_PROC( NtCreateIoCompletion );
+    GET_PROC( NtCreateMutant );
+    GET_PROC( NtCreateSemaphore );
+    GET_PROC( NtDuplicateObject );
+    GET_PROC( NtQueryEvent );
+    GET_PROC( NtQueryIoCompletion );
+    GET_PROC( NtQueryMutant );
+    GET_PROC( NtQuerySemaphore );
+    GET_PROC( NtReleaseMutant );
+    GET_PROC( NtReleaseSemaphore );
+    GET_PROC( NtRemoveIoCompletion );
+    GET_PROC( NtRemoveIoCompletionEx );
+    GET_PROC( NtResetEvent );
+    GET_PROC( NtSetEvent );
+    GET_PROC( NtSetIoCompletion );
+    GET_PROC( NtWaitForMultipleObjects );
+    GET_PROC( NtWaitForSingleObject );
+#undef GET_PROC
+
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3)
+    {
+        test_other_process_child( argv[2] );
+        return;
+    }
+
+    test_event();
+    test_semaphore();
+    test_mutant();
+    test_signal_wait();
+    test_alertable_wait();
+    test_other_process( argv[0] );
+    test_completion();
+    test_completion_concurrency();
+}
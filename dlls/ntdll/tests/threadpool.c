@@ -42,6 +42,7 @@ static VOID     (WINAPI *pTpReleasePool)(TP_POOL *);
 static VOID     (WINAPI *pTpReleaseTimer)(TP_TIMER *);
 static VOID     (WINAPI *pTpReleaseWork)(TP_WORK *);
 static VOID     (WINAPI *pTpSetPoolMaxThreads)(TP_POOL *,DWORD);
+static BOOL     (WINAPI *pTpSetPoolMinThreads)(TP_POOL *,DWORD);
 static VOID     (WINAPI *pTpSetTimer)(TP_TIMER *,LARGE_INTEGER *,LONG,LONG);
 static VOID     (WINAPI *pTpSetWait)(TP_WAIT *,HANDLE,LARGE_INTEGER *);
 static NTSTATUS (WINAPI *pTpSimpleTryPost)(PTP_SIMPLE_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
@@ -88,6 +89,7 @@ static BOOL init_threadpool(void)
     GET_PROC(TpReleaseWait);
     GET_PROC(TpReleaseWork);
     GET_PROC(TpSetPoolMaxThreads);
+    GET_PROC(TpSetPoolMinThreads);
     GET_PROC(TpSetTimer);
     GET_PROC(TpSetWait);
     GET_PROC(TpSimpleTryPost);
@@ -768,6 +770,107 @@ static void CALLBACK wait_release_cb(TP_CALLBACK_INSTANCE *instance, void *userd
     pTpReleaseWait(wait);
 }
 
+struct nested_work_info
+{
+    TP_WORK *child;
+    HANDLE done;
+    LONG budget;
+    LONG executed;
+    DWORD result;
+};
+
+static void CALLBACK nested_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct nested_work_info *info = userdata;
+
+    if (InterlockedDecrement(&info->budget) >= 0)
+        pTpPostWork(work);
+    if (InterlockedDecrement(&info->budget) >= 0)
+        pTpPostWork(work);
+
+    if (InterlockedIncrement(&info->executed) == 2000)
+        SetEvent(info->done);
+}
+
+static void CALLBACK nested_child_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct nested_work_info *info = userdata;
+    SetEvent(info->done);
+}
+
+static void CALLBACK nested_parent_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct nested_work_info *info = userdata;
+    pTpPostWork(info->child);
+    info->result = WaitForSingleObject(info->done, 1000);
+}
+
+static void test_tp_work_nested(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    struct nested_work_info info;
+    TP_WORK *work, *work2;
+    TP_POOL *pool;
+    NTSTATUS status;
+    DWORD result;
+
+    if (!pTpSetPoolMinThreads)
+    {
+        win_skip("TpSetPoolMinThreads not supported, skipping tests\n");
+        return;
+    }
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+    pTpSetPoolMaxThreads(pool, 2);
+    ok(pTpSetPoolMinThreads(pool, 2), "TpSetPoolMinThreads failed\n");
+
+    info.done = CreateEventA(NULL, FALSE, FALSE, NULL);
+    ok(info.done != NULL, "CreateEventA failed %u\n", GetLastError());
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+
+    /* work items posted from callbacks are all executed */
+    work = NULL;
+    status = pTpAllocWork(&work, nested_work_cb, &info, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    ok(work != NULL, "expected work != NULL\n");
+
+    info.budget = 1999;
+    info.executed = 0;
+    pTpPostWork(work);
+    result = WaitForSingleObject(info.done, 5000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    pTpWaitForWork(work, FALSE);
+    ok(info.executed == 2000, "expected 2000 callbacks, got %u\n", info.executed);
+    ok(info.budget < 0, "expected budget < 0, got %d\n", info.budget);
+    pTpReleaseWork(work);
+
+    /* a callback waiting for a work item it posted doesn't block it */
+    work = work2 = NULL;
+    status = pTpAllocWork(&work, nested_parent_cb, &info, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    status = pTpAllocWork(&work2, nested_child_cb, &info, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+
+    info.child = work2;
+    info.result = 0xdeadbeef;
+    pTpPostWork(work);
+    pTpWaitForWork(work, FALSE);
+    pTpWaitForWork(work2, FALSE);
+    ok(info.result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", info.result);
+
+    /* cleanup */
+    pTpReleaseWork(work);
+    pTpReleaseWork(work2);
+    pTpReleasePool(pool);
+    CloseHandle(info.done);
+}
+
 static void test_tp_group_wait(void)
 {
     TP_CALLBACK_ENVIRON environment;
@@ -2244,6 +2347,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_nested();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -111,8 +111,17 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#define THREADPOOL_MAX_LOCAL_QUEUES 64
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
+/* queue of threadpool objects with pending callbacks */
+struct threadpool_queue
+{
+    RTL_SRWLOCK             lock;
+    struct list             objects;    /* locked via .lock */
+    BOOL                    in_use;     /* local queues only, locked via pool->cs */
+};
+
 /* internal threadpool representation */
 struct threadpool
 {
@@ -120,18 +129,37 @@ struct threadpool
     LONG                    objcount;
     BOOL                    shutdown;
     CRITICAL_SECTION        cs;
-    /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
-    struct list             pools[3];
-    RTL_CONDITION_VARIABLE  update_event;
+    /* Pools of work items, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
+    struct threadpool_queue pools[3];
+    /* Local queues of the worker threads. Normal priority work items submitted
+     * from a worker thread are queued there and executed LIFO by their worker,
+     * other workers steal them from the other end when they run out of work. */
+    struct threadpool_queue local_queues[THREADPOOL_MAX_LOCAL_QUEUES];
+    LONG                    num_local_queues;
+    /* number of objects in all the queues */
+    LONG                    num_queued;
     /* information about worker threads, locked via .cs */
+    struct list             idle_workers;
+    LONG                    num_idle_workers;   /* also read without .cs */
     int                     max_workers;
     int                     min_workers;
     int                     num_workers;
-    int                     num_busy_workers;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
 
+/* internal worker thread representation */
+struct threadpool_worker
+{
+    TEB_ACTIVE_FRAME        frame;
+    struct threadpool       *pool;
+    struct threadpool_queue *queue;
+    /* information about idle workers, locked via .pool->cs */
+    struct list             idle_entry;
+    BOOL                    idle;
+    RTL_CONDITION_VARIABLE  wake_event;
+};
+
 enum threadpool_objtype
 {
     TP_OBJECT_TYPE_SIMPLE,
@@ -166,13 +194,16 @@ struct threadpool_object
     /* information about the group, locked via .group->cs */
     struct list             group_entry;
     BOOL                    is_group_member;
-    /* information about the pool, locked via .pool->cs */
+    /* information about the pool queue, locked via .queue->lock */
     struct list             pool_entry;
+    struct threadpool_queue *queue;
+    /* information about the pool, locked via .pool->cs, counters are updated atomically */
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
     LONG                    num_pending_callbacks;
     LONG                    num_running_callbacks;
     LONG                    num_associated_callbacks;
+    LONG                    num_waiters;
     /* arguments for callback */
     union
     {
@@ -1821,6 +1852,28 @@ static void tp_ioqueue_unlock( struct threadpool_object *io )
     RtlLeaveCriticalSection( &ioqueue.cs );
 }
 
+static void tp_queue_init( struct threadpool_queue *queue )
+{
+    RtlInitializeSRWLock( &queue->lock );
+    list_init( &queue->objects );
+    queue->in_use = FALSE;
+}
+
+/***********************************************************************
+ *           tp_worker_wake    (internal)
+ *
+ * Removes an idle worker thread from the idle list and wakes it up.
+ * Must be called with the pool lock held.
+ */
+static void tp_worker_wake( struct threadpool_worker *worker )
+{
+    assert( worker->idle );
+    list_remove( &worker->idle_entry );
+    worker->idle = FALSE;
+    InterlockedDecrement( &worker->pool->num_idle_workers );
+    RtlWakeConditionVariable( &worker->wake_event );
+}
+
 /***********************************************************************
  *           tp_threadpool_alloc    (internal)
  *
@@ -1844,13 +1897,17 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
 
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-        list_init( &pool->pools[i] );
-    RtlInitializeConditionVariable( &pool->update_event );
-
+        tp_queue_init( &pool->pools[i] );
+    for (i = 0; i < ARRAY_SIZE(pool->local_queues); ++i)
+        tp_queue_init( &pool->local_queues[i] );
+    pool->num_local_queues        = 0;
+    pool->num_queued              = 0;
+
+    list_init( &pool->idle_workers );
+    pool->num_idle_workers        = 0;
     pool->max_workers             = 500;
     pool->min_workers             = 0;
     pool->num_workers             = 0;
-    pool->num_busy_workers        = 0;
     pool->stack_info.StackReserve = nt->OptionalHeader.SizeOfStackReserve;
     pool->stack_info.StackCommit  = nt->OptionalHeader.SizeOfStackCommit;
 
@@ -1869,10 +1926,15 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
  */
 static void tp_threadpool_shutdown( struct threadpool *pool )
 {
+    struct list *ptr;
+
     assert( pool != default_threadpool );
 
+    RtlEnterCriticalSection( &pool->cs );
     pool->shutdown = TRUE;
-    RtlWakeAllConditionVariable( &pool->update_event );
+    while ((ptr = list_head( &pool->idle_workers )))
+        tp_worker_wake( LIST_ENTRY( ptr, struct threadpool_worker, idle_entry ) );
+    RtlLeaveCriticalSection( &pool->cs );
 }
 
 /***********************************************************************
@@ -1891,8 +1953,9 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
 
     assert( pool->shutdown );
     assert( !pool->objcount );
+    assert( !pool->num_queued );
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-        assert( list_empty( &pool->pools[i] ) );
+        assert( list_empty( &pool->pools[i].objects ) );
 
     pool->cs.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &pool->cs );
@@ -2073,11 +2136,13 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     object->is_group_member         = FALSE;
 
     memset( &object->pool_entry, 0, sizeof(object->pool_entry) );
+    object->queue                   = NULL;
     RtlInitializeConditionVariable( &object->finished_event );
     RtlInitializeConditionVariable( &object->group_finished_event );
     object->num_pending_callbacks   = 0;
     object->num_running_callbacks   = 0;
     object->num_associated_callbacks = 0;
+    object->num_waiters             = 0;
 
     if (environment)
     {
@@ -2131,10 +2196,114 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
         tp_object_release( object );
 }
 
-static void tp_object_prio_queue( struct threadpool_object *object )
+static TEB_ACTIVE_FRAME_CONTEXT threadpool_worker_context = { 0, "threadpool worker" };
+
+/* returns the worker thread state if called from a worker thread of the pool */
+static struct threadpool_worker *tp_get_current_worker( struct threadpool *pool )
+{
+    TEB_ACTIVE_FRAME *frame;
+
+    for (frame = RtlGetFrame(); frame; frame = frame->Previous)
+    {
+        if (frame->Context == &threadpool_worker_context)
+        {
+            struct threadpool_worker *worker = CONTAINING_RECORD( frame, struct threadpool_worker, frame );
+            return worker->pool == pool ? worker : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/***********************************************************************
+ *           tp_object_queue    (internal)
+ *
+ * Adds an object without pending callbacks to a pool queue. Normal
+ * priority objects submitted from a worker thread go to the local
+ * queue of that worker.
+ */
+static void tp_object_queue( struct threadpool_object *object )
+{
+    struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = &pool->pools[object->priority];
+    struct threadpool_worker *worker;
+
+    if (object->priority == TP_CALLBACK_PRIORITY_NORMAL &&
+        (worker = tp_get_current_worker( pool )) && worker->queue)
+        queue = worker->queue;
+
+    RtlAcquireSRWLockExclusive( &queue->lock );
+    list_add_tail( &queue->objects, &object->pool_entry );
+    object->queue = queue;
+    InterlockedIncrement( &pool->num_queued );
+    RtlReleaseSRWLockExclusive( &queue->lock );
+}
+
+/***********************************************************************
+ *           tp_queue_pop    (internal)
+ *
+ * Takes one pending callback of the object at one end of a queue. The
+ * object is moved to the other end if further callbacks are pending.
+ */
+static struct threadpool_object *tp_queue_pop( struct threadpool *pool, struct threadpool_queue *queue,
+                                               BOOL lifo )
+{
+    struct threadpool_object *object = NULL;
+    struct list *ptr;
+
+    if (list_empty( &queue->objects ))
+        return NULL;
+
+    RtlAcquireSRWLockExclusive( &queue->lock );
+
+    if ((ptr = lifo ? list_tail( &queue->objects ) : list_head( &queue->objects )))
+    {
+        object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
+        assert( object->num_pending_callbacks > 0 );
+
+        /* The callback has to be accounted as running before it stops being
+         * pending, otherwise object_is_finished could see neither of both. */
+        InterlockedIncrement( &object->num_associated_callbacks );
+        InterlockedIncrement( &object->num_running_callbacks );
+
+        list_remove( &object->pool_entry );
+        object->queue = NULL;
+        if (InterlockedDecrement( &object->num_pending_callbacks ))
+        {
+            if (lifo) list_add_head( &queue->objects, &object->pool_entry );
+            else list_add_tail( &queue->objects, &object->pool_entry );
+            object->queue = queue;
+        }
+        else InterlockedDecrement( &pool->num_queued );
+    }
+
+    RtlReleaseSRWLockExclusive( &queue->lock );
+    return object;
+}
+
+/***********************************************************************
+ *           tp_threadpool_wake_worker    (internal)
+ *
+ * Wakes up an idle worker thread after a callback was queued, or starts
+ * a new one if all of them are busy.
+ */
+static void tp_threadpool_wake_worker( struct threadpool *pool )
 {
-    ++object->pool->num_busy_workers;
-    list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
+    struct list *ptr;
+
+    /* The counters were updated with a full barrier after queuing, a worker
+     * thread going idle either sees the new callback or is seen as idle. */
+    if (!pool->num_idle_workers && pool->num_workers >= pool->max_workers)
+        return;
+
+    RtlEnterCriticalSection( &pool->cs );
+
+    if ((ptr = list_head( &pool->idle_workers )))
+        tp_worker_wake( LIST_ENTRY( ptr, struct threadpool_worker, idle_entry ) );
+    else if (pool->num_workers < pool->max_workers)
+        tp_new_worker_thread( pool );
+
+    RtlLeaveCriticalSection( &pool->cs );
 }
 
 /***********************************************************************
@@ -2146,35 +2315,24 @@ static void tp_object_prio_queue( struct threadpool_object *object )
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
-    NTSTATUS status = STATUS_UNSUCCESSFUL;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
-    RtlEnterCriticalSection( &pool->cs );
-
-    /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers &&
-        pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
-
-    /* Queue work item and increment refcount. */
-    InterlockedIncrement( &object->refcount );
-    if (!object->num_pending_callbacks++)
-        tp_object_prio_queue( object );
-
     /* Count how often the object was signaled. */
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
-        object->u.wait.signaled++;
-
-    /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
     {
-        assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        RtlEnterCriticalSection( &pool->cs );
+        object->u.wait.signaled++;
+        RtlLeaveCriticalSection( &pool->cs );
     }
 
-    RtlLeaveCriticalSection( &pool->cs );
+    /* Queue work item and increment refcount. */
+    InterlockedIncrement( &object->refcount );
+    if (InterlockedIncrement( &object->num_pending_callbacks ) == 1)
+        tp_object_queue( object );
+
+    tp_threadpool_wake_worker( pool );
 }
 
 /***********************************************************************
@@ -2185,18 +2343,35 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 static void tp_object_cancel( struct threadpool_object *object )
 {
     struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue;
     LONG pending_callbacks = 0;
+    BOOL removed = FALSE;
 
-    RtlEnterCriticalSection( &pool->cs );
-    if (object->num_pending_callbacks)
+    while (!removed)
     {
-        pending_callbacks = object->num_pending_callbacks;
-        object->num_pending_callbacks = 0;
-        list_remove( &object->pool_entry );
+        if (!(queue = object->queue))
+        {
+            /* The object is not queued, or is just being (re)queued by another thread. */
+            if (!object->num_pending_callbacks) break;
+            NtYieldExecution();
+            continue;
+        }
 
-        if (object->type == TP_OBJECT_TYPE_WAIT)
-            object->u.wait.signaled = 0;
+        RtlAcquireSRWLockExclusive( &queue->lock );
+        if (object->queue == queue)
+        {
+            list_remove( &object->pool_entry );
+            object->queue = NULL;
+            pending_callbacks = InterlockedExchange( &object->num_pending_callbacks, 0 );
+            InterlockedDecrement( &pool->num_queued );
+            removed = TRUE;
+        }
+        RtlReleaseSRWLockExclusive( &queue->lock );
     }
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (pending_callbacks && object->type == TP_OBJECT_TYPE_WAIT)
+        object->u.wait.signaled = 0;
     if (object->type == TP_OBJECT_TYPE_IO)
         object->u.io.pending_count = 0;
     RtlLeaveCriticalSection( &pool->cs );
@@ -2229,6 +2404,7 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
     struct threadpool *pool = object->pool;
 
     RtlEnterCriticalSection( &pool->cs );
+    InterlockedIncrement( &object->num_waiters );
     while (!object_is_finished( object, group_wait ))
     {
         if (group_wait)
@@ -2236,6 +2412,28 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
         else
             RtlSleepConditionVariableCS( &object->finished_event, &pool->cs, NULL );
     }
+    InterlockedDecrement( &object->num_waiters );
+    RtlLeaveCriticalSection( &pool->cs );
+}
+
+/***********************************************************************
+ *           tp_object_wake_waiters    (internal)
+ *
+ * Wakes up threads waiting in tp_object_wait after the running or
+ * associated callback counters were decremented.
+ */
+static void tp_object_wake_waiters( struct threadpool_object *object )
+{
+    struct threadpool *pool = object->pool;
+
+    if (!object->num_waiters)
+        return;
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (object_is_finished( object, TRUE ))
+        RtlWakeAllConditionVariable( &object->group_finished_event );
+    if (object_is_finished( object, FALSE ))
+        RtlWakeAllConditionVariable( &object->finished_event );
     RtlLeaveCriticalSection( &pool->cs );
 }
 
@@ -2296,18 +2494,38 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
-static struct list *threadpool_get_next_item( const struct threadpool *pool )
+/***********************************************************************
+ *           threadpool_get_next_item    (internal)
+ *
+ * Returns the next object to execute a callback for. High priority work
+ * items come first, followed by the local queue of the worker, normal
+ * priority work items, work items stolen from other workers, and low
+ * priority work items.
+ */
+static struct threadpool_object *threadpool_get_next_item( struct threadpool_worker *worker )
 {
-    struct list *ptr;
-    unsigned int i;
+    struct threadpool *pool = worker->pool;
+    struct threadpool_object *object;
+    unsigned int i, start, count;
 
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
+    if ((object = tp_queue_pop( pool, &pool->pools[TP_CALLBACK_PRIORITY_HIGH], FALSE )))
+        return object;
+    if (worker->queue && (object = tp_queue_pop( pool, worker->queue, TRUE )))
+        return object;
+    if ((object = tp_queue_pop( pool, &pool->pools[TP_CALLBACK_PRIORITY_NORMAL], FALSE )))
+        return object;
+
+    count = pool->num_local_queues;
+    start = worker->queue ? worker->queue - pool->local_queues : 0;
+    for (i = 1; i <= count; ++i)
     {
-        if ((ptr = list_head( &pool->pools[i] )))
-            break;
+        struct threadpool_queue *queue = &pool->local_queues[(start + i) % count];
+        if (queue == worker->queue) continue;
+        if ((object = tp_queue_pop( pool, queue, FALSE )))
+            return object;
     }
 
-    return ptr;
+    return tp_queue_pop( pool, &pool->pools[TP_CALLBACK_PRIORITY_LOW], FALSE );
 }
 
 /***********************************************************************
@@ -2317,47 +2535,62 @@ static void CALLBACK threadpool_worker_proc( void *param )
 {
     TP_CALLBACK_INSTANCE *callback_instance;
     struct threadpool_instance instance;
+    struct threadpool_object *object;
+    struct threadpool_worker worker;
     struct io_completion completion;
     struct threadpool *pool = param;
     TP_WAIT_RESULT wait_result = 0;
     LARGE_INTEGER timeout;
-    struct list *ptr;
     NTSTATUS status;
+    unsigned int i;
 
     TRACE( "starting worker thread for pool %p\n", pool );
 
+    worker.frame.Flags      = 0;
+    worker.frame.Context    = &threadpool_worker_context;
+    worker.pool             = pool;
+    worker.queue            = NULL;
+    worker.idle             = FALSE;
+    RtlInitializeConditionVariable( &worker.wake_event );
+
+    /* Workers without a free local queue only use the global ones. */
     RtlEnterCriticalSection( &pool->cs );
+    for (i = 0; i < ARRAY_SIZE(pool->local_queues); ++i)
+    {
+        if (pool->local_queues[i].in_use) continue;
+        worker.queue = &pool->local_queues[i];
+        worker.queue->in_use = TRUE;
+        if (i >= pool->num_local_queues) pool->num_local_queues = i + 1;
+        break;
+    }
+    RtlLeaveCriticalSection( &pool->cs );
+
+    RtlPushFrame( &worker.frame );
+
     for (;;)
     {
-        while ((ptr = threadpool_get_next_item( pool )))
+        while ((object = threadpool_get_next_item( &worker )))
         {
-            struct threadpool_object *object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
-            assert( object->num_pending_callbacks > 0 );
+            if (object->type == TP_OBJECT_TYPE_WAIT || object->type == TP_OBJECT_TYPE_IO)
+            {
+                RtlEnterCriticalSection( &pool->cs );
 
-            /* If further pending callbacks are queued, move the work item to
-             * the end of the pool list. Otherwise remove it from the pool. */
-            list_remove( &object->pool_entry );
-            if (--object->num_pending_callbacks)
-                tp_object_prio_queue( object );
+                /* For wait objects check if they were signaled or have timed out. */
+                if (object->type == TP_OBJECT_TYPE_WAIT)
+                {
+                    wait_result = object->u.wait.signaled ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+                    if (wait_result == WAIT_OBJECT_0) object->u.wait.signaled--;
+                }
+                else
+                {
+                    assert( object->u.io.completion_count );
+                    completion = object->u.io.completions[--object->u.io.completion_count];
+                    object->u.io.pending_count--;
+                }
 
-            /* For wait objects check if they were signaled or have timed out. */
-            if (object->type == TP_OBJECT_TYPE_WAIT)
-            {
-                wait_result = object->u.wait.signaled ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
-                if (wait_result == WAIT_OBJECT_0) object->u.wait.signaled--;
-            }
-            else if (object->type == TP_OBJECT_TYPE_IO)
-            {
-                assert( object->u.io.completion_count );
-                completion = object->u.io.completions[--object->u.io.completion_count];
-                object->u.io.pending_count--;
+                RtlLeaveCriticalSection( &pool->cs );
             }
 
-            /* Leave critical section and do the actual callback. */
-            object->num_associated_callbacks++;
-            object->num_running_callbacks++;
-            RtlLeaveCriticalSection( &pool->cs );
-
             /* Initialize threadpool instance struct. */
             callback_instance = (TP_CALLBACK_INSTANCE *)&instance;
             instance.object                     = object;
@@ -2460,10 +2693,6 @@ static void CALLBACK threadpool_worker_proc( void *param )
             }
 
         skip_cleanup:
-            RtlEnterCriticalSection( &pool->cs );
-            assert(pool->num_busy_workers);
-            pool->num_busy_workers--;
-
             /* Simple callbacks are automatically shutdown after execution. */
             if (object->type == TP_OBJECT_TYPE_SIMPLE)
             {
@@ -2471,40 +2700,63 @@ static void CALLBACK threadpool_worker_proc( void *param )
                 object->shutdown = TRUE;
             }
 
-            object->num_running_callbacks--;
-            if (object_is_finished( object, TRUE ))
-                RtlWakeAllConditionVariable( &object->group_finished_event );
-
+            InterlockedDecrement( &object->num_running_callbacks );
             if (instance.associated)
-            {
-                object->num_associated_callbacks--;
-                if (object_is_finished( object, FALSE ))
-                    RtlWakeAllConditionVariable( &object->finished_event );
-            }
+                InterlockedDecrement( &object->num_associated_callbacks );
+            tp_object_wake_waiters( object );
 
             tp_object_release( object );
         }
 
-        /* Shutdown worker thread if requested. */
-        if (pool->shutdown)
-            break;
+        RtlEnterCriticalSection( &pool->cs );
 
-        /* Wait for new tasks or until the timeout expires. A thread only terminates
-         * when no new tasks are available, and the number of threads can be
-         * decreased without violating the min_workers limit. An exception is when
-         * min_workers == 0, then objcount is used to detect if the last thread
-         * can be terminated. */
-        timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
-            (!pool->min_workers && !pool->objcount)))
+        /* Register as idle before looking at the queues one last time,
+         * tp_threadpool_wake_worker looks at the idle workers after queuing. */
+        list_add_tail( &pool->idle_workers, &worker.idle_entry );
+        worker.idle = TRUE;
+        InterlockedIncrement( &pool->num_idle_workers );
+
+        /* Wait for new tasks or until the timeout expires. */
+        status = STATUS_SUCCESS;
+        if (!pool->num_queued && !pool->shutdown)
         {
-            break;
+            timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+            status = RtlSleepConditionVariableCS( &worker.wake_event, &pool->cs, &timeout );
+        }
+        if (worker.idle)
+        {
+            list_remove( &worker.idle_entry );
+            worker.idle = FALSE;
+            InterlockedDecrement( &pool->num_idle_workers );
         }
+
+        if (!pool->num_queued)
+        {
+            /* Shutdown worker thread if requested. */
+            if (pool->shutdown)
+                break;
+
+            /* A thread only terminates when no new tasks are available, and the
+             * number of threads can be decreased without violating the min_workers
+             * limit. An exception is when min_workers == 0, then objcount is used
+             * to detect if the last thread can be terminated. */
+            if (status == STATUS_TIMEOUT && (pool->num_workers > max( pool->min_workers, 1 ) ||
+                (!pool->min_workers && !pool->objcount)))
+                break;
+        }
+
+        RtlLeaveCriticalSection( &pool->cs );
+    }
+    if (worker.queue)
+    {
+        assert( list_empty( &worker.queue->objects ) );
+        worker.queue->in_use = FALSE;
     }
     pool->num_workers--;
     RtlLeaveCriticalSection( &pool->cs );
 
+    RtlPopFrame( &worker.frame );
+
     TRACE( "terminating worker thread for pool %p\n", pool );
     tp_threadpool_release( pool );
     RtlExitUserThread( 0 );
@@ -2746,7 +2998,7 @@ NTSTATUS WINAPI TpCallbackMayRunLong( TP_CALLBACK_INSTANCE *instance )
     RtlEnterCriticalSection( &pool->cs );
 
     /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers)
+    if (!pool->num_idle_workers)
     {
         if (pool->num_workers < pool->max_workers)
         {
@@ -2825,7 +3077,6 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
 {
     struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
     struct threadpool_object *object = this->object;
-    struct threadpool *pool;
 
     TRACE( "%p\n", instance );
 
@@ -2838,14 +3089,8 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
     if (!this->associated)
         return;
 
-    pool = object->pool;
-    RtlEnterCriticalSection( &pool->cs );
-
-    object->num_associated_callbacks--;
-    if (object_is_finished( object, FALSE ))
-        RtlWakeAllConditionVariable( &object->finished_event );
-
-    RtlLeaveCriticalSection( &pool->cs );
+    InterlockedDecrement( &object->num_associated_callbacks );
+    tp_object_wake_waiters( object );
     this->associated = FALSE;
 }
 
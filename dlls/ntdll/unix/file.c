@@ -2467,6 +2467,269 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* cached listing of a directory, used to speed up case-insensitive lookups */
+struct dir_cache_entry
+{
+    struct dir_cache_entry *long_next;   /* next entry in the long name hash chain */
+    struct dir_cache_entry *short_next;  /* next entry in the short name hash chain */
+    unsigned int            index;       /* position in the directory */
+    unsigned int            long_len;    /* length of the long name */
+    unsigned int            short_len;   /* length of the short name, 0 if same as the long name */
+    WCHAR                   short_name[12];
+    const char             *unix_name;   /* Unix file name in host encoding */
+    WCHAR                   long_name[1];
+};
+
+struct dir_cache
+{
+    struct list              entry;       /* entry in the LRU list */
+    struct file_identity     id;          /* directory file identity */
+    ULONGLONG                mtime;       /* directory modification time when it was read */
+    time_t                   read_time;   /* time the listing was read */
+    BOOLEAN                  case_sensitive; /* result of get_dir_case_sensitivity */
+    BOOLEAN                  has_names;   /* whether the names have been read */
+    unsigned int             count;       /* number of entries */
+    unsigned int             hash_size;   /* size of the hash tables, a power of 2 */
+    struct dir_cache_entry **long_hash;   /* entries hashed by case-folded long name */
+    struct dir_cache_entry **short_hash;  /* entries hashed by case-folded short name */
+};
+
+#define MAX_DIR_CACHE_COUNT 64
+
+static struct list dir_cache_list = LIST_INIT( dir_cache_list );
+static unsigned int dir_cache_count;
+static pthread_mutex_t dir_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline ULONGLONG get_dir_mtime( const struct stat *st )
+{
+    ULONGLONG ret = (ULONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    ret += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    ret += st->st_mtimespec.tv_nsec;
+#endif
+    return ret;
+}
+
+static inline unsigned int hash_dir_cache_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len; i++) hash = hash * 65599 + towupper( name[i] );
+    return hash;
+}
+
+static void free_dir_cache( struct dir_cache *cache )
+{
+    struct dir_cache_entry *entry, *next;
+    unsigned int i;
+
+    if (cache->long_hash)
+    {
+        for (i = 0; i < cache->hash_size; i++)
+            for (entry = cache->long_hash[i]; entry; entry = next)
+            {
+                next = entry->long_next;
+                free( entry );
+            }
+    }
+    free( cache->long_hash );
+    free( cache->short_hash );
+    free( cache );
+}
+
+/* add an entry to the hash tables, growing them as needed */
+static BOOL add_dir_cache_entry( struct dir_cache *cache, const WCHAR *name, unsigned int len,
+                                 const char *unix_name )
+{
+    struct dir_cache_entry *entry, *next;
+    unsigned int i, hash, unix_len = strlen( unix_name ) + 1;
+
+    if (cache->count >= cache->hash_size)
+    {
+        unsigned int size = max( 64, cache->hash_size * 2 );
+        struct dir_cache_entry **long_hash = calloc( size, sizeof(*long_hash) );
+        struct dir_cache_entry **short_hash = calloc( size, sizeof(*short_hash) );
+
+        if (!long_hash || !short_hash)
+        {
+            free( long_hash );
+            free( short_hash );
+            return FALSE;
+        }
+        for (i = 0; i < cache->hash_size; i++)
+        {
+            for (entry = cache->long_hash[i]; entry; entry = next)
+            {
+                next = entry->long_next;
+                hash = hash_dir_cache_name( entry->long_name, entry->long_len ) & (size - 1);
+                entry->long_next = long_hash[hash];
+                long_hash[hash] = entry;
+            }
+            for (entry = cache->short_hash[i]; entry; entry = next)
+            {
+                next = entry->short_next;
+                hash = hash_dir_cache_name( entry->short_name, entry->short_len ) & (size - 1);
+                entry->short_next = short_hash[hash];
+                short_hash[hash] = entry;
+            }
+        }
+        free( cache->long_hash );
+        free( cache->short_hash );
+        cache->long_hash = long_hash;
+        cache->short_hash = short_hash;
+        cache->hash_size = size;
+    }
+
+    if (!(entry = malloc( offsetof( struct dir_cache_entry, long_name[0] ) + len * sizeof(WCHAR) + unix_len ))) return FALSE;
+    entry->index = cache->count++;
+    entry->long_len = len;
+    memcpy( entry->long_name, name, len * sizeof(WCHAR) );
+    entry->unix_name = (const char *)(entry->long_name + len);
+    memcpy( (char *)entry->unix_name, unix_name, unix_len );
+
+    hash = hash_dir_cache_name( name, len ) & (cache->hash_size - 1);
+    entry->long_next = cache->long_hash[hash];
+    cache->long_hash[hash] = entry;
+
+    entry->short_len = 0;
+    if (!is_legal_8dot3_name( name, len ))
+    {
+        entry->short_len = hash_short_file_name( name, len, entry->short_name );
+        hash = hash_dir_cache_name( entry->short_name, entry->short_len ) & (cache->hash_size - 1);
+        entry->short_next = cache->short_hash[hash];
+        cache->short_hash[hash] = entry;
+    }
+    return TRUE;
+}
+
+/* read the contents of a directory into a new cache entry */
+static struct dir_cache *read_dir_cache( const char *unix_name, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_cache *cache;
+    struct dirent *de;
+    DIR *dir;
+    int ret;
+
+    if (!(cache = calloc( 1, sizeof(*cache) ))) return NULL;
+    cache->id.dev = st->st_dev;
+    cache->id.ino = st->st_ino;
+    cache->mtime = get_dir_mtime( st );
+    cache->read_time = time( NULL );
+    cache->case_sensitive = get_dir_case_sensitivity( unix_name );
+
+    /* names are only needed to look for long names in case sensitive directories */
+    if (!cache->case_sensitive) return cache;
+
+    if (!(dir = opendir( unix_name ))) goto failed;
+    while ((de = readdir( dir )))
+    {
+        ret = ntdll_umbstowcs( de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN );
+        if (!add_dir_cache_entry( cache, buffer, ret, de->d_name ))
+        {
+            closedir( dir );
+            goto failed;
+        }
+    }
+    closedir( dir );
+    cache->has_names = TRUE;
+    return cache;
+
+failed:
+    free_dir_cache( cache );
+    return NULL;
+}
+
+/* look up a name in the cached listing, returning the first matching entry in directory order */
+static const struct dir_cache_entry *lookup_dir_cache( const struct dir_cache *cache, const WCHAR *name,
+                                                       unsigned int length, BOOLEAN is_name_8_dot_3 )
+{
+    const struct dir_cache_entry *entry, *ret = NULL;
+    unsigned int hash;
+
+    if (!cache->count) return NULL;
+    hash = hash_dir_cache_name( name, length ) & (cache->hash_size - 1);
+
+    for (entry = cache->long_hash[hash]; entry; entry = entry->long_next)
+    {
+        if (entry->long_len != length || wcsnicmp( entry->long_name, name, length )) continue;
+        if (!ret || entry->index < ret->index) ret = entry;
+    }
+    if (!is_name_8_dot_3) return ret;
+
+    for (entry = cache->short_hash[hash]; entry; entry = entry->short_next)
+    {
+        if (entry->short_len != length || wcsnicmp( entry->short_name, name, length )) continue;
+        if (!ret || entry->index < ret->index) ret = entry;
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           find_file_in_dir_cache
+ *
+ * Look for a file using the cached listing of its directory, refreshing it if
+ * the directory has been modified since it was read.
+ * unix_name contains the directory name, with the file name to be appended at pos.
+ * Returns 1 if found, 0 if not found, -1 if the directory needs to be searched directly.
+ */
+static int find_file_in_dir_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                   BOOLEAN is_name_8_dot_3 )
+{
+    const struct dir_cache_entry *entry;
+    struct dir_cache *cache;
+    struct stat st;
+    ULONGLONG mtime;
+    int ret = -1;
+
+    if (stat( unix_name, &st ) == -1 || !S_ISDIR( st.st_mode )) return -1;
+    mtime = get_dir_mtime( &st );
+
+    pthread_mutex_lock( &dir_cache_mutex );
+
+    LIST_FOR_EACH_ENTRY( cache, &dir_cache_list, struct dir_cache, entry )
+    {
+        if (cache->id.dev != st.st_dev || cache->id.ino != st.st_ino) continue;
+        list_remove( &cache->entry );
+        dir_cache_count--;
+        /* a listing read during the same second as the last modification may
+         * have missed later changes that didn't update the modification time */
+        if (cache->mtime == mtime && st.st_mtime < cache->read_time) goto found;
+        free_dir_cache( cache );
+        break;
+    }
+
+    if (!(cache = read_dir_cache( unix_name, &st ))) goto done;
+    if (dir_cache_count >= MAX_DIR_CACHE_COUNT)
+    {
+        struct dir_cache *old = LIST_ENTRY( list_tail( &dir_cache_list ), struct dir_cache, entry );
+        list_remove( &old->entry );
+        dir_cache_count--;
+        free_dir_cache( old );
+    }
+
+found:
+    list_add_head( &dir_cache_list, &cache->entry );
+    dir_cache_count++;
+
+    if (!cache->case_sensitive) ret = is_name_8_dot_3 ? -1 : 0;
+    else if (!cache->has_names) ret = -1;
+    else if ((entry = lookup_dir_cache( cache, name, length, is_name_8_dot_3 )))
+    {
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, entry->unix_name );
+        ret = 1;
+    }
+    else ret = 0;
+
+done:
+    pthread_mutex_unlock( &dir_cache_mutex );
+    return ret;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2509,6 +2772,12 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     is_name_8_dot_3 = is_name_8_dot_3 && length >= 8 && name[4] == '~';
 #endif
 
+    switch (find_file_in_dir_cache( unix_name, pos, name, length, is_name_8_dot_3 ))
+    {
+    case 1: goto success;
+    case 0: goto not_found;
+    }
+
     if (!is_name_8_dot_3 && !get_dir_case_sensitivity( unix_name )) goto not_found;
 
     /* now look for it through the directory */
@@ -6416,6 +6685,26 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
     case ObjectTypeInformation:
     {
         OBJECT_TYPE_INFORMATION *p = ptr;
+        const UNICODE_STRING *type;
+
+        if ((status = server_get_handle_info( handle, NULL, NULL, &type ))) break;
+        if (type)
+        {
+            if (sizeof(*p) + type->MaximumLength > len)
+            {
+                if (used_len) *used_len = sizeof(*p) + type->MaximumLength;
+                status = STATUS_INFO_LENGTH_MISMATCH;
+            }
+            else
+            {
+                p->TypeName.Buffer = (WCHAR *)(p + 1);
+                p->TypeName.Length = type->Length;
+                p->TypeName.MaximumLength = type->MaximumLength;
+                memcpy( p->TypeName.Buffer, type->Buffer, type->MaximumLength );
+                if (used_len) *used_len = sizeof(*p) + p->TypeName.MaximumLength;
+            }
+            break;
+        }
 
         SERVER_START_REQ( get_object_type )
         {
@@ -6453,23 +6742,16 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
     case ObjectDataInformation:
     {
         OBJECT_DATA_INFORMATION* p = ptr;
+        unsigned int flags;
 
         if (len < sizeof(*p)) return STATUS_INVALID_BUFFER_SIZE;
 
-        SERVER_START_REQ( set_handle_info )
+        if (!(status = server_get_handle_info( handle, NULL, &flags, NULL )))
         {
-            req->handle = wine_server_obj_handle( handle );
-            req->flags  = 0;
-            req->mask   = 0;
-            status = wine_server_call( req );
-            if (status == STATUS_SUCCESS)
-            {
-                p->InheritHandle = (reply->old_flags & HANDLE_FLAG_INHERIT) != 0;
-                p->ProtectFromClose = (reply->old_flags & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
-                if (used_len) *used_len = sizeof(*p);
-            }
+            p->InheritHandle = (flags & HANDLE_FLAG_INHERIT) != 0;
+            p->ProtectFromClose = (flags & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
+            if (used_len) *used_len = sizeof(*p);
         }
-        SERVER_END_REQ;
         break;
     }
 
@@ -6509,6 +6791,7 @@ NTSTATUS WINAPI NtSetInformationObject( HANDLE handle, OBJECT_INFORMATION_CLASS
             status = wine_server_call( req );
         }
         SERVER_END_REQ;
+        server_invalidate_handle_info( handle );
     break;
     }
 
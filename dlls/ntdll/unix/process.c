@@ -786,8 +786,14 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
     NTSTATUS status;
     BOOL success = FALSE;
     HANDLE file_handle, process_info = 0, process_handle = 0, thread_handle = 0;
-    struct object_attributes *objattr;
-    data_size_t attr_len;
+    struct object_attributes *objattr, *thread_objattr;
+    data_size_t attr_len, thread_attr_len;
+    struct __server_request_info batch[2];
+    struct server_batch_request batch_reqs[2];
+    struct new_process_request *process_req;
+    struct new_thread_request *thread_req;
+    const struct new_process_reply *process_reply;
+    const struct new_thread_reply *thread_reply;
     char *winedebug = NULL;
     startup_info_t *startup_info = NULL;
     ULONG startup_info_size, env_size;
@@ -842,6 +848,11 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
     env_size = get_env_size( params, &winedebug );
 
     if ((status = alloc_object_attributes( process_attr, &objattr, &attr_len ))) goto done;
+    if ((status = alloc_object_attributes( thread_attr, &thread_objattr, &thread_attr_len )))
+    {
+        free( objattr );
+        goto done;
+    }
 
     /* create the socket for the new process */
 
@@ -849,6 +860,7 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
     {
         status = STATUS_TOO_MANY_OPENED_FILES;
         free( objattr );
+        free( thread_objattr );
         goto done;
     }
 #ifdef SO_PASSCRED
@@ -862,32 +874,46 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
     server_send_fd( socketfd[1] );
     close( socketfd[1] );
 
-    /* create the process on the server side */
+    /* create the process and its first thread on the server side, in a single round trip */
+
+    memset( batch_reqs, 0, sizeof(batch_reqs) );
+    process_req = server_init_request( &batch[0], REQ_new_process );
+    process_req->parent_process = wine_server_obj_handle( parent );
+    process_req->inherit_all    = !!(process_flags & PROCESS_CREATE_FLAGS_INHERIT_HANDLES);
+    process_req->create_flags   = params->DebugFlags; /* hack: creation flags stored in DebugFlags for now */
+    process_req->socket_fd      = socketfd[1];
+    process_req->exe_file       = wine_server_obj_handle( file_handle );
+    process_req->access         = process_access;
+    process_req->cpu            = pe_info.cpu;
+    process_req->info_size      = startup_info_size;
+    wine_server_add_data( &batch[0], objattr, attr_len );
+    wine_server_add_data( &batch[0], startup_info, startup_info_size );
+    wine_server_add_data( &batch[0], params->Environment, env_size );
+
+    thread_req = server_init_request( &batch[1], REQ_new_thread );
+    thread_req->access     = thread_access;
+    thread_req->suspend    = !!(thread_flags & THREAD_CREATE_FLAGS_CREATE_SUSPENDED);
+    thread_req->request_fd = -1;
+    wine_server_add_data( &batch[1], thread_objattr, thread_attr_len );
+
+    batch_reqs[0].req = &batch[0];
+    batch_reqs[1].req = &batch[1];
+    batch_reqs[1].header.ref_index        = 1;  /* the process handle comes from new_process */
+    batch_reqs[1].header.ref_offset       = offsetof( struct new_thread_request, process );
+    batch_reqs[1].header.ref_reply_offset = offsetof( struct new_process_reply, handle );
+    status = server_call_batch( batch_reqs, 2 );
+    free( objattr );
+    free( thread_objattr );
 
-    SERVER_START_REQ( new_process )
+    process_reply = &batch[0].u.reply.new_process_reply;
+    thread_reply = &batch[1].u.reply.new_thread_reply;
+    process_info = wine_server_ptr_handle( process_reply->info );
+    if (!batch[0].u.reply.reply_header.error)
     {
-        req->parent_process = wine_server_obj_handle( parent );
-        req->inherit_all    = !!(process_flags & PROCESS_CREATE_FLAGS_INHERIT_HANDLES);
-        req->create_flags   = params->DebugFlags; /* hack: creation flags stored in DebugFlags for now */
-        req->socket_fd      = socketfd[1];
-        req->exe_file       = wine_server_obj_handle( file_handle );
-        req->access         = process_access;
-        req->cpu            = pe_info.cpu;
-        req->info_size      = startup_info_size;
-        wine_server_add_data( req, objattr, attr_len );
-        wine_server_add_data( req, startup_info, startup_info_size );
-        wine_server_add_data( req, params->Environment, env_size );
-        if (!(status = wine_server_call( req )))
-        {
-            process_handle = wine_server_ptr_handle( reply->handle );
-            id.UniqueProcess = ULongToHandle( reply->pid );
-        }
-        process_info = wine_server_ptr_handle( reply->info );
+        process_handle = wine_server_ptr_handle( process_reply->handle );
+        id.UniqueProcess = ULongToHandle( process_reply->pid );
     }
-    SERVER_END_REQ;
-    free( objattr );
-
-    if (status)
+    else
     {
         switch (status)
         {
@@ -901,25 +927,9 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
         }
         goto done;
     }
-
-    if ((status = alloc_object_attributes( thread_attr, &objattr, &attr_len ))) goto done;
-
-    SERVER_START_REQ( new_thread )
-    {
-        req->process    = wine_server_obj_handle( process_handle );
-        req->access     = thread_access;
-        req->suspend    = !!(thread_flags & THREAD_CREATE_FLAGS_CREATE_SUSPENDED);
-        req->request_fd = -1;
-        wine_server_add_data( req, objattr, attr_len );
-        if (!(status = wine_server_call( req )))
-        {
-            thread_handle = wine_server_ptr_handle( reply->handle );
-            id.UniqueThread = ULongToHandle( reply->tid );
-        }
-    }
-    SERVER_END_REQ;
-    free( objattr );
     if (status) goto done;
+    thread_handle = wine_server_ptr_handle( thread_reply->handle );
+    id.UniqueThread = ULongToHandle( thread_reply->tid );
 
     /* create the child process */
 
@@ -292,6 +292,80 @@ unsigned int CDECL wine_server_call( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           server_call_batch
+ *
+ * Perform several server calls in a single round trip. The requests are
+ * performed in order until one of them fails, and the status of the first
+ * failure is returned; the requests after it are not performed and get the
+ * same status. A request can use a handle returned by an earlier one through
+ * its batch header. Requests that wait or return a file descriptor can't be
+ * batched; the server only accepts the ones listed in is_batch_request_allowed()
+ * and fails the whole batch with STATUS_INVALID_PARAMETER otherwise.
+ */
+unsigned int server_call_batch( struct server_batch_request *batch, unsigned int count )
+{
+    data_size_t size = 0, reply_size = 0, pos = 0;
+    unsigned int i, j, done, ret;
+    char *data, *replies;
+
+    for (i = 0; i < count; i++)
+    {
+        const struct __server_request_info *req = batch[i].req;
+        size += sizeof(batch[i].header) + sizeof(req->u.req) +
+                ((req->u.req.request_header.request_size + 7) & ~7);
+        reply_size += sizeof(req->u.reply) + ((req->u.req.request_header.reply_size + 7) & ~7);
+    }
+    if (!(data = malloc( size + reply_size ))) return STATUS_NO_MEMORY;
+    replies = data + size;
+
+    for (i = 0; i < count; i++)
+    {
+        const struct __server_request_info *req = batch[i].req;
+
+        memcpy( data + pos, &batch[i].header, sizeof(batch[i].header) );
+        pos += sizeof(batch[i].header);
+        memcpy( data + pos, &req->u.req, sizeof(req->u.req) );
+        pos += sizeof(req->u.req);
+        for (j = 0; j < req->data_count; j++)
+        {
+            memcpy( data + pos, req->data[j].ptr, req->data[j].size );
+            pos += req->data[j].size;
+        }
+        while (pos & 7) data[pos++] = 0;
+    }
+
+    SERVER_START_REQ( batch_requests )
+    {
+        req->count = count;
+        wine_server_add_data( req, data, size );
+        wine_server_set_reply( req, replies, reply_size );
+        ret = wine_server_call( req );
+        done = reply->count;
+    }
+    SERVER_END_REQ;
+
+    for (i = pos = 0; i < done; i++)
+    {
+        struct __server_request_info *req = batch[i].req;
+
+        memcpy( &req->u.reply, replies + pos, sizeof(req->u.reply) );
+        pos += sizeof(req->u.reply);
+        if (req->u.reply.reply_header.reply_size)
+            memcpy( req->reply_data, replies + pos, req->u.reply.reply_header.reply_size );
+        pos += (req->u.reply.reply_header.reply_size + 7) & ~7;
+        if (!ret) ret = req->u.reply.reply_header.error;
+    }
+    for ( ; i < count; i++)
+    {
+        memset( &batch[i].req->u.reply, 0, sizeof(batch[i].req->u.reply) );
+        batch[i].req->u.reply.reply_header.error = ret;
+    }
+    free( data );
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -1044,6 +1118,307 @@ done:
 }
 
 
+/***********************************************************************
+ *           server_get_fast_sync_shm
+ *
+ * Map the shared memory holding the server's fast synchronization objects.
+ */
+fast_sync_t *server_get_fast_sync_shm(void)
+{
+    obj_handle_t fd_handle;
+    sigset_t sigset;
+    mem_size_t size = 0;
+    void *ptr;
+    int fd = -1;
+
+    /* the fd cache mutex serializes the fds received from the server */
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_fast_sync_shm )
+    {
+        if (!wine_server_call( req ))
+        {
+            size = reply->size;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    if (fd == -1) return NULL;
+    ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    return (ptr != MAP_FAILED) ? ptr : NULL;
+}
+
+
+/***********************************************************************
+ *           server_get_completion_shm
+ *
+ * Map the packet ring of a completion port, replacing the mapping at addr if set.
+ */
+completion_ring_t *server_get_completion_shm( HANDLE handle, void *addr, unsigned int *serial )
+{
+    obj_handle_t fd_handle;
+    sigset_t sigset;
+    mem_size_t size = 0;
+    void *ptr;
+    int fd = -1;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_completion_shm )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!wine_server_call( req ))
+        {
+            size    = reply->size;
+            *serial = reply->serial;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    if (fd == -1) return NULL;
+    if (size == sizeof(completion_ring_t))
+        ptr = mmap( addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | (addr ? MAP_FIXED : 0), fd, 0 );
+    else
+        ptr = MAP_FAILED;
+    close( fd );
+    return (ptr != MAP_FAILED) ? ptr : NULL;
+}
+
+
+/***********************************************************************/
+/* handle information cache */
+
+/* Handle access, flags and type never change while the handle is open,
+ * except through requests made by the process itself, which update the
+ * cache directly. Other changes (handles closed by the server or by
+ * another process) increment a generation counter shared with the server,
+ * and the whole cache is flushed when it changes.
+ *
+ * Each entry also has an epoch that is incremented whenever it is
+ * invalidated, so that an entry filled from a reply that raced with
+ * NtClose or with a flush is never stored. */
+
+union handle_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int access;        /* granted access */
+        unsigned int type  : 6;     /* index in handle_cache_types plus one, 0 if unset */
+        unsigned int flags : 2;     /* HANDLE_FLAG_* flags */
+        unsigned int epoch : 24;    /* incremented every time the entry is invalidated */
+    } s;
+};
+
+C_ASSERT( sizeof(union handle_cache_entry) == sizeof(union fd_cache_entry) );
+
+#define HANDLE_CACHE_MAX_TYPES  63
+
+static union handle_cache_entry *handle_cache[FD_CACHE_ENTRIES];
+static const volatile unsigned int *handle_cache_gen;
+static volatile unsigned int handle_cache_flushed_gen;  /* generation at the last flush */
+static pthread_once_t handle_cache_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t handle_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static UNICODE_STRING handle_cache_types[HANDLE_CACHE_MAX_TYPES];
+static unsigned int handle_cache_nb_types;
+
+static void init_handle_cache(void)
+{
+    obj_handle_t fd_handle;
+    sigset_t sigset;
+    mem_size_t size = 0;
+    void *ptr;
+    int fd = -1;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_handle_cache_shm )
+    {
+        if (!wine_server_call( req ))
+        {
+            size = reply->size;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    if (fd == -1) return;
+    ptr = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if (ptr != MAP_FAILED) handle_cache_gen = ptr;
+}
+
+/* return the index of a type name in the type table plus one, or 0 if it can't be added */
+static unsigned int get_handle_cache_type( const WCHAR *name, data_size_t len )
+{
+    unsigned int i;
+    sigset_t sigset;
+    WCHAR *str;
+
+    server_enter_uninterrupted_section( &handle_cache_mutex, &sigset );
+    for (i = 0; i < handle_cache_nb_types; i++)
+    {
+        if (handle_cache_types[i].Length == len && !memcmp( handle_cache_types[i].Buffer, name, len ))
+            break;
+    }
+    if (i == handle_cache_nb_types)
+    {
+        if (i < HANDLE_CACHE_MAX_TYPES && (str = malloc( len + sizeof(WCHAR) )))
+        {
+            memcpy( str, name, len );
+            str[len / sizeof(WCHAR)] = 0;
+            handle_cache_types[i].Buffer = str;
+            handle_cache_types[i].Length = len;
+            handle_cache_types[i].MaximumLength = len + sizeof(WCHAR);
+            handle_cache_nb_types++;
+        }
+        else i = ~0u;
+    }
+    server_leave_uninterrupted_section( &handle_cache_mutex, &sigset );
+    return i + 1;
+}
+
+/* return the cache entry of a handle, allocating a new block of entries if needed */
+static union handle_cache_entry *get_handle_cache_entry( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry >= FD_CACHE_ENTRIES) return NULL;
+
+    if (!handle_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = wine_anon_mmap( NULL, FD_CACHE_BLOCK_SIZE * sizeof(union handle_cache_entry),
+                                    PROT_READ | PROT_WRITE, 0 );
+        if (ptr == MAP_FAILED) return NULL;
+        if (InterlockedCompareExchangePointer( (void **)&handle_cache[entry], ptr, NULL ))
+            munmap( ptr, FD_CACHE_BLOCK_SIZE * sizeof(union handle_cache_entry) );
+    }
+    return &handle_cache[entry][idx];
+}
+
+/* clear a cache entry and increment its epoch */
+static void invalidate_handle_cache_entry( union handle_cache_entry *ptr )
+{
+    union handle_cache_entry old, new;
+
+    do
+    {
+        old.data = InterlockedCompareExchange64( &ptr->data, 0, 0 );
+        new.data = 0;
+        new.s.epoch = old.s.epoch + 1;
+    } while (InterlockedCompareExchange64( &ptr->data, new.data, old.data ) != old.data);
+}
+
+/* invalidate all the entries once the server has closed some of our handles */
+static void flush_handle_cache( unsigned int gen )
+{
+    unsigned int entry, idx;
+
+    for (entry = 0; entry < FD_CACHE_ENTRIES; entry++)
+    {
+        if (!handle_cache[entry]) continue;
+        for (idx = 0; idx < FD_CACHE_BLOCK_SIZE; idx++)
+            if (handle_cache[entry][idx].s.type) invalidate_handle_cache_entry( &handle_cache[entry][idx] );
+    }
+    /* only mark the cache as up to date once everything has been cleared */
+    handle_cache_flushed_gen = gen;
+}
+
+
+/***********************************************************************
+ *           server_get_handle_info
+ *
+ * Retrieve the granted access, handle flags and object type of a handle.
+ * The type is set to NULL if it can't be cached.
+ */
+NTSTATUS server_get_handle_info( HANDLE handle, unsigned int *access, unsigned int *flags,
+                                 const UNICODE_STRING **type )
+{
+    union handle_cache_entry *ptr = NULL, cache, old;
+    unsigned int gen = 0;
+    WCHAR name[64];
+    data_size_t len = 0;
+    NTSTATUS ret;
+
+    pthread_once( &handle_cache_once, init_handle_cache );
+
+    old.data = 0;
+    if (handle_cache_gen)
+    {
+        if ((gen = *handle_cache_gen) != handle_cache_flushed_gen) flush_handle_cache( gen );
+        if ((ptr = get_handle_cache_entry( handle )))
+        {
+            old.data = InterlockedCompareExchange64( &ptr->data, 0, 0 );
+            if (old.s.type)
+            {
+                cache = old;
+                goto done;
+            }
+        }
+    }
+
+    cache.data = 0;
+    SERVER_START_REQ( get_handle_info )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        wine_server_set_reply( req, name, sizeof(name) );
+        if (!(ret = wine_server_call( req )))
+        {
+            cache.s.access = reply->access;
+            cache.s.flags  = reply->flags;
+            len = wine_server_reply_size( reply );
+        }
+    }
+    SERVER_END_REQ;
+    if (ret) return ret;
+
+    if (ptr && len && (cache.s.type = get_handle_cache_type( name, len )))
+    {
+        /* don't store anything if the handle was closed while we were asking the server */
+        cache.s.epoch = old.s.epoch;
+        if (InterlockedCompareExchange64( &ptr->data, cache.data, old.data ) == old.data &&
+            *handle_cache_gen != gen)
+            invalidate_handle_cache_entry( ptr );
+    }
+
+done:
+    if (access) *access = cache.s.access;
+    if (flags) *flags = cache.s.flags;
+    if (type) *type = cache.s.type ? &handle_cache_types[cache.s.type - 1] : NULL;
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           server_get_handle_cache_gen
+ *
+ * Return the generation counter that the server increments when it closes
+ * handles of the process behind our back, or NULL if it isn't available.
+ */
+const volatile unsigned int *server_get_handle_cache_gen(void)
+{
+    pthread_once( &handle_cache_once, init_handle_cache );
+    return handle_cache_gen;
+}
+
+
+/***********************************************************************
+ *           server_invalidate_handle_info
+ *
+ * Remove a handle from the handle information cache.
+ */
+void server_invalidate_handle_info( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && handle_cache[entry])
+        invalidate_handle_cache_entry( &handle_cache[entry][idx] );
+}
+
+
 /***********************************************************************
  *           server_fd_to_handle
  */
@@ -1616,6 +1991,8 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
             {
                 int fd = remove_fd_from_cache( source );
                 if (fd != -1) close( fd );
+                fast_sync_close_handle( source );
+                server_invalidate_handle_info( source );
             }
         }
     }
@@ -1632,6 +2009,8 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     NTSTATUS ret;
     int fd = remove_fd_from_cache( handle );
 
+    fast_sync_close_handle( handle );
+    server_invalidate_handle_info( handle );
     SERVER_START_REQ( close_handle )
     {
         req->handle = wine_server_obj_handle( handle );
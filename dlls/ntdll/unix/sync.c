@@ -35,6 +35,9 @@
 #ifdef HAVE_SYS_SYSCALL_H
 #include <sys/syscall.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
@@ -68,6 +71,7 @@
 #include "windef.h"
 #include "winternl.h"
 #include "ddk/wdm.h"
+#include "wine/library.h"
 #include "wine/server.h"
 #include "wine/debug.h"
 #include "unix_private.h"
@@ -294,6 +298,558 @@ NTSTATUS alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_a
 }
 
 
+/***********************************************************************
+ * Fast synchronization objects
+ *
+ * When WINEFASTSYNC is set, the server keeps the state of the events,
+ * mutexes and semaphores created by the process in shared memory (see
+ * server/fast_sync.c). Operations that don't need to block are done here
+ * with atomic operations, as long as the server doesn't hold the object
+ * locked; anything else, including any use of objects created by other
+ * processes, goes to the server.
+ *
+ * The slot of each handle is cached along with the serial number of its
+ * object, which is checked on every use since slots are reused. The cache
+ * is flushed when the server closes some of our handles, and each entry
+ * has an epoch so that a reply that raced with NtClose is never stored.
+ */
+
+#define FAST_SYNC_ACCESS_QUERY   0x1  /* EVENT_QUERY_STATE, SEMAPHORE_QUERY_STATE, MUTANT_QUERY_STATE */
+#define FAST_SYNC_ACCESS_MODIFY  0x2  /* EVENT_MODIFY_STATE, SEMAPHORE_MODIFY_STATE */
+#define FAST_SYNC_ACCESS_WAIT    0x4  /* SYNCHRONIZE */
+
+union fast_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int index  : 16;  /* index in the shared memory, 0 if not a fast object */
+        unsigned int type   : 3;   /* enum fast_sync_type */
+        unsigned int access : 3;   /* FAST_SYNC_ACCESS_* flags */
+        unsigned int valid  : 1;   /* entry has been filled */
+        unsigned int epoch  : 9;   /* incremented every time the entry is invalidated */
+        unsigned int serial;       /* serial number of the object */
+    } s;
+};
+
+C_ASSERT( sizeof(union fast_sync_cache_entry) == sizeof(LONG64) );
+
+/* owner and recursion count of a mutex, updated together */
+union fast_mutex_state
+{
+    LONG64 data;
+    struct
+    {
+        int          owner;        /* fast_sync_t state */
+        unsigned int count;        /* fast_sync_t count */
+    } s;
+};
+
+C_ASSERT( FIELD_OFFSET( fast_sync_t, count ) == FIELD_OFFSET( fast_sync_t, state ) + sizeof(int) );
+C_ASSERT( !(sizeof(fast_sync_t) % sizeof(LONG64)) );
+
+#define FAST_SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(union fast_sync_cache_entry))
+#define FAST_SYNC_CACHE_ENTRIES     128
+
+static union fast_sync_cache_entry *fast_sync_cache[FAST_SYNC_CACHE_ENTRIES];
+static fast_sync_t *fast_sync_shm;
+static const volatile unsigned int *fast_sync_handle_gen;
+static volatile unsigned int fast_sync_flushed_gen;  /* handle generation at the last flush */
+static pthread_once_t fast_sync_once = PTHREAD_ONCE_INIT;
+
+static void init_fast_sync(void)
+{
+    const char *env = getenv( "WINEFASTSYNC" );
+
+    if (!env || !atoi( env )) return;
+    /* without it we can't know when the server closes our handles */
+    if (!(fast_sync_handle_gen = server_get_handle_cache_gen())) return;
+    fast_sync_shm = server_get_fast_sync_shm();
+}
+
+static inline unsigned int fast_sync_handle_to_index( HANDLE handle, unsigned int *entry )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    *entry = idx / FAST_SYNC_CACHE_BLOCK_SIZE;
+    return idx % FAST_SYNC_CACHE_BLOCK_SIZE;
+}
+
+/* clear a cache entry and increment its epoch */
+static void invalidate_fast_sync_entry( union fast_sync_cache_entry *ptr )
+{
+    union fast_sync_cache_entry old, new;
+
+    do
+    {
+        old.data = InterlockedCompareExchange64( &ptr->data, 0, 0 );
+        new.data = 0;
+        new.s.epoch = old.s.epoch + 1;
+    } while (InterlockedCompareExchange64( &ptr->data, new.data, old.data ) != old.data);
+}
+
+/* invalidate all the entries once the server has closed some of our handles */
+static void flush_fast_sync_cache( unsigned int gen )
+{
+    unsigned int entry, idx;
+
+    for (entry = 0; entry < FAST_SYNC_CACHE_ENTRIES; entry++)
+    {
+        if (!fast_sync_cache[entry]) continue;
+        for (idx = 0; idx < FAST_SYNC_CACHE_BLOCK_SIZE; idx++)
+            if (fast_sync_cache[entry][idx].s.valid) invalidate_fast_sync_entry( &fast_sync_cache[entry][idx] );
+    }
+    /* only mark the cache as up to date once everything has been cleared */
+    fast_sync_flushed_gen = gen;
+}
+
+/* return the shared state of an object, or NULL if the request has to go to the server */
+static fast_sync_t *get_fast_sync_obj( HANDLE handle, unsigned int access, enum fast_sync_type *type )
+{
+    unsigned int entry, idx, gen;
+    union fast_sync_cache_entry *ptr, cache;
+    fast_sync_t *obj;
+
+    pthread_once( &fast_sync_once, init_fast_sync );
+    if (!fast_sync_shm) return NULL;
+
+    if ((gen = *fast_sync_handle_gen) != fast_sync_flushed_gen) flush_fast_sync_cache( gen );
+
+    idx = fast_sync_handle_to_index( handle, &entry );
+    if (entry >= FAST_SYNC_CACHE_ENTRIES) return NULL;
+
+    if (!fast_sync_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = wine_anon_mmap( NULL, FAST_SYNC_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry),
+                                    PROT_READ | PROT_WRITE, 0 );
+        if (ptr == MAP_FAILED) return NULL;
+        if (InterlockedCompareExchangePointer( (void **)&fast_sync_cache[entry], ptr, NULL ))
+            munmap( ptr, FAST_SYNC_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry) );
+    }
+    ptr = &fast_sync_cache[entry][idx];
+
+    cache.data = InterlockedCompareExchange64( &ptr->data, 0, 0 );
+    if (!cache.s.valid)
+    {
+        union fast_sync_cache_entry old = cache;
+        NTSTATUS ret;
+
+        SERVER_START_REQ( get_fast_sync )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(ret = wine_server_call( req )))
+            {
+                cache.s.index  = reply->index;
+                cache.s.type   = reply->type;
+                cache.s.access = (reply->access & (FAST_SYNC_ACCESS_QUERY | FAST_SYNC_ACCESS_MODIFY)) |
+                                 ((reply->access & SYNCHRONIZE) ? FAST_SYNC_ACCESS_WAIT : 0);
+                cache.s.valid  = 1;
+                cache.s.serial = reply->serial;
+            }
+        }
+        SERVER_END_REQ;
+        /* let the server report invalid handles */
+        if (ret) return NULL;
+        /* don't store anything if the handle was closed while we were asking the server */
+        if (InterlockedCompareExchange64( &ptr->data, cache.data, old.data ) != old.data) return NULL;
+        if (*fast_sync_handle_gen != gen)
+        {
+            invalidate_fast_sync_entry( ptr );
+            return NULL;
+        }
+    }
+
+    if (!cache.s.index || (cache.s.access & access) != access) return NULL;
+    obj = &fast_sync_shm[cache.s.index];
+    /* the slot has been reused if the handle was closed behind our back */
+    if (*(volatile unsigned int *)&obj->serial != cache.s.serial)
+    {
+        invalidate_fast_sync_entry( ptr );
+        return NULL;
+    }
+    *type = cache.s.type;
+    return obj;
+}
+
+/***********************************************************************
+ *           fast_sync_close_handle
+ */
+void fast_sync_close_handle( HANDLE handle )
+{
+    unsigned int entry, idx = fast_sync_handle_to_index( handle, &entry );
+
+    if (entry < FAST_SYNC_CACHE_ENTRIES && fast_sync_cache[entry])
+        invalidate_fast_sync_entry( &fast_sync_cache[entry][idx] );
+}
+
+static inline int get_fast_sync_state( const fast_sync_t *obj )
+{
+    return *(volatile const int *)&obj->state;
+}
+
+static inline BOOL update_fast_sync_state( fast_sync_t *obj, int old_state, int new_state )
+{
+    return InterlockedCompareExchange( (LONG *)&obj->state, new_state, old_state ) == old_state;
+}
+
+/* wake up the threads that are blocked in the server after a state change */
+static void fast_sync_wake( HANDLE handle, fast_sync_t *obj )
+{
+    if (!*(volatile unsigned int *)&obj->waiters) return;
+
+    SERVER_START_REQ( fast_sync_wake )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
+static NTSTATUS fast_set_event( HANDLE handle, int new_state, LONG *prev_state )
+{
+    enum fast_sync_type type;
+    fast_sync_t *obj;
+    int state;
+
+    if (!(obj = get_fast_sync_obj( handle, FAST_SYNC_ACCESS_MODIFY, &type ))) return STATUS_NOT_IMPLEMENTED;
+    if (type != FAST_SYNC_AUTO_EVENT && type != FAST_SYNC_MANUAL_EVENT) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        state = get_fast_sync_state( obj );
+        if (state & FAST_SYNC_LOCKED) return STATUS_NOT_IMPLEMENTED;
+    } while (!update_fast_sync_state( obj, state, new_state ));
+
+    if (new_state) fast_sync_wake( handle, obj );
+    if (prev_state) *prev_state = state;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    enum fast_sync_type type;
+    fast_sync_t *obj;
+    int state;
+
+    if (!(obj = get_fast_sync_obj( handle, FAST_SYNC_ACCESS_MODIFY, &type ))) return STATUS_NOT_IMPLEMENTED;
+    if (type != FAST_SYNC_SEMAPHORE) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        state = get_fast_sync_state( obj );
+        if (state & FAST_SYNC_LOCKED) return STATUS_NOT_IMPLEMENTED;
+        if (count > obj->count - state) return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+    } while (!update_fast_sync_state( obj, state, state + count ));
+
+    fast_sync_wake( handle, obj );
+    if (previous) *previous = state;
+    return STATUS_SUCCESS;
+}
+
+static inline union fast_mutex_state get_fast_mutex_state( fast_sync_t *obj )
+{
+    union fast_mutex_state state;
+
+    state.data = InterlockedCompareExchange64( (LONG64 *)&obj->state, 0, 0 );
+    return state;
+}
+
+static inline BOOL update_fast_mutex_state( fast_sync_t *obj, union fast_mutex_state old_state,
+                                            union fast_mutex_state new_state )
+{
+    return InterlockedCompareExchange64( (LONG64 *)&obj->state, new_state.data, old_state.data ) == old_state.data;
+}
+
+/* The owner of a mutex is only changed by the server, which keeps track of
+ * the mutexes owned by each thread; only the recursion count is updated here. */
+static NTSTATUS fast_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    union fast_mutex_state state, new_state;
+    enum fast_sync_type type;
+    fast_sync_t *obj;
+
+    if (!(obj = get_fast_sync_obj( handle, 0, &type ))) return STATUS_NOT_IMPLEMENTED;
+    if (type != FAST_SYNC_MUTEX) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        state = get_fast_mutex_state( obj );
+        if (state.s.owner & FAST_SYNC_LOCKED) return STATUS_NOT_IMPLEMENTED;
+        if (state.s.owner != GetCurrentThreadId()) return STATUS_MUTANT_NOT_OWNED;
+        if (state.s.count <= 1) return STATUS_NOT_IMPLEMENTED;
+        new_state.s.owner = state.s.owner;
+        new_state.s.count = state.s.count - 1;
+    } while (!update_fast_mutex_state( obj, state, new_state ));
+
+    if (prev_count) *prev_count = 1 - state.s.count;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_grab_mutex( fast_sync_t *obj )
+{
+    union fast_mutex_state state, new_state;
+
+    do
+    {
+        state = get_fast_mutex_state( obj );
+        if (state.s.owner & FAST_SYNC_LOCKED) return STATUS_NOT_IMPLEMENTED;
+        if (state.s.owner != GetCurrentThreadId())
+        {
+            /* abandoned mutexes are reported by the server */
+            if (!state.s.owner || (state.s.owner & FAST_SYNC_ABANDONED)) return STATUS_NOT_IMPLEMENTED;
+            return STATUS_TIMEOUT;
+        }
+        if (state.s.count >= MAXLONG) return STATUS_NOT_IMPLEMENTED;
+        new_state.s.owner = state.s.owner;
+        new_state.s.count = state.s.count + 1;
+    } while (!update_fast_mutex_state( obj, state, new_state ));
+
+    return STATUS_WAIT_0;
+}
+
+/* try to satisfy a wait without blocking; return STATUS_TIMEOUT if the object isn't signaled */
+static NTSTATUS fast_try_wait( fast_sync_t *obj, enum fast_sync_type type )
+{
+    int state, new_state;
+
+    if (type == FAST_SYNC_MUTEX) return fast_grab_mutex( obj );
+
+    do
+    {
+        state = get_fast_sync_state( obj );
+        if (state & FAST_SYNC_LOCKED) return STATUS_NOT_IMPLEMENTED;
+
+        switch (type)
+        {
+        case FAST_SYNC_MANUAL_EVENT:
+            return state ? STATUS_WAIT_0 : STATUS_TIMEOUT;
+        case FAST_SYNC_AUTO_EVENT:
+            if (!state) return STATUS_TIMEOUT;
+            new_state = 0;
+            break;
+        case FAST_SYNC_SEMAPHORE:
+            if (!state) return STATUS_TIMEOUT;
+            new_state = state - 1;
+            break;
+        default:
+            return STATUS_NOT_IMPLEMENTED;
+        }
+    } while (!update_fast_sync_state( obj, state, new_state ));
+
+    return STATUS_WAIT_0;
+}
+
+static NTSTATUS fast_wait_any( DWORD count, const HANDLE *handles, BOOLEAN alertable,
+                               const LARGE_INTEGER *timeout )
+{
+    enum fast_sync_type types[MAXIMUM_WAIT_OBJECTS];
+    fast_sync_t *objs[MAXIMUM_WAIT_OBJECTS];
+    NTSTATUS ret;
+    DWORD i;
+
+    /* pending user APCs have to be run by the server before the objects are checked */
+    if (alertable) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+        if (!(objs[i] = get_fast_sync_obj( handles[i], FAST_SYNC_ACCESS_WAIT, &types[i] )))
+            return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((ret = fast_try_wait( objs[i], types[i] )) == STATUS_WAIT_0) return STATUS_WAIT_0 + i;
+        if (ret != STATUS_TIMEOUT) return ret;
+    }
+
+    /* blocking waits are handled by the server */
+    if (timeout && !timeout->QuadPart) return STATUS_TIMEOUT;
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+
+/***********************************************************************
+ * Completion rings
+ *
+ * With fast synchronization, the packets of a completion port are queued
+ * in a ring shared with the other users of the port (see
+ * server/completion.c), so that they can be added and removed without a
+ * server call. The server is only involved to block, to wake up blocked
+ * threads, and for the packets that it queued itself.
+ *
+ * Rings are mapped through a port handle on first use, and remembered for
+ * the slot of the port along with its serial number. When the slot gets
+ * reused, the ring of the new port is mapped over the old one, so that a
+ * thread still using a closed port never touches unmapped memory.
+ */
+
+#define COMPLETION_MAP_SIZE   65536  /* number of fast_sync slots */
+#define COMPLETION_RING_SPIN  1000   /* attempts without progress before asking the server */
+
+struct completion_map
+{
+    completion_ring_t *ring;      /* mapped ring, reused for the next port in the slot */
+    unsigned int       serial;    /* serial number of the port, 0 if unknown */
+    BOOL               mapped;    /* whether ring belongs to the port */
+};
+
+static struct completion_map *completion_maps;
+static pthread_mutex_t completion_map_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t completion_once = PTHREAD_ONCE_INIT;
+
+static void init_completion_maps(void)
+{
+    completion_maps = calloc( COMPLETION_MAP_SIZE, sizeof(*completion_maps) );
+}
+
+/* ask the server for the ring of a port */
+static void map_completion_ring( HANDLE handle, struct completion_map *map, unsigned int serial )
+{
+    completion_ring_t *ring;
+    unsigned int ring_serial = 0;
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &completion_map_mutex, &sigset );
+    if (map->serial != serial)
+    {
+        map->serial = 0;
+        if ((ring = server_get_completion_shm( handle, map->ring, &ring_serial ))) map->ring = ring;
+        /* the handle has been closed and reused if the serial doesn't match */
+        if (!ring || ring_serial == serial)
+        {
+            map->mapped = (ring != NULL);
+            InterlockedExchange( (LONG *)&map->serial, serial );
+        }
+    }
+    server_leave_uninterrupted_section( &completion_map_mutex, &sigset );
+}
+
+/* return the shared ring of a completion port, or NULL if the request has to go to the server */
+static completion_ring_t *get_completion_ring( HANDLE handle, unsigned int access, fast_sync_t **ret_obj )
+{
+    enum fast_sync_type type;
+    struct completion_map *map;
+    unsigned int serial;
+    fast_sync_t *obj;
+
+    if (!(obj = get_fast_sync_obj( handle, access, &type ))) return NULL;
+    if (type != FAST_SYNC_COMPLETION) return NULL;
+
+    pthread_once( &completion_once, init_completion_maps );
+    if (!completion_maps) return NULL;
+
+    serial = *(volatile unsigned int *)&obj->serial;
+    map = &completion_maps[obj - fast_sync_shm];
+    if (*(volatile unsigned int *)&map->serial != serial)
+    {
+        /* the server only gives the ring to handles that can modify the port */
+        if (!(access & FAST_SYNC_ACCESS_MODIFY)) return NULL;
+        map_completion_ring( handle, map, serial );
+        if (*(volatile unsigned int *)&map->serial != serial) return NULL;
+    }
+    if (!map->mapped) return NULL;
+    *ret_obj = obj;
+    return map->ring;
+}
+
+/* add a packet to the ring; return FALSE if it has to go to the server */
+static BOOL completion_ring_add( completion_ring_t *ring, ULONG_PTR key, ULONG_PTR value,
+                                 NTSTATUS status, SIZE_T information )
+{
+    unsigned int pos = *(volatile unsigned int *)&ring->tail, seq, prev, i;
+    completion_entry_t *entry;
+
+    /* packets queued in the server have to be removed first */
+    if (*(volatile unsigned int *)&ring->disabled || *(volatile unsigned int *)&ring->overflow) return FALSE;
+
+    for (i = 0; i < COMPLETION_RING_SPIN; i++)
+    {
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        seq = *(volatile unsigned int *)&entry->seq;
+        if (seq == pos)
+        {
+            if ((prev = InterlockedCompareExchange( (LONG *)&ring->tail, pos + 1, pos )) == pos) break;
+            pos = prev;
+        }
+        else if ((int)(seq - pos) < 0) return FALSE;  /* full, or the entry is still being read */
+        else pos = *(volatile unsigned int *)&ring->tail;
+    }
+    if (i == COMPLETION_RING_SPIN) return FALSE;
+
+    entry->ckey        = key;
+    entry->cvalue      = value;
+    entry->status      = status;
+    entry->information = information;
+    InterlockedExchange( (LONG *)&entry->seq, pos + 1 );
+
+    /* if the server disabled the ring in the meantime, take the packet back unless it has been claimed */
+    if (*(volatile unsigned int *)&ring->disabled &&
+        InterlockedCompareExchange( (LONG *)&entry->seq, pos + 2, pos + 1 ) == pos + 1)
+        return FALSE;
+    return TRUE;
+}
+
+/* remove a packet from the ring; return STATUS_PENDING if it is empty,
+ * and STATUS_UNSUCCESSFUL if it doesn't make progress */
+static NTSTATUS completion_ring_remove( completion_ring_t *ring, completion_entry_t *ret )
+{
+    unsigned int pos = *(volatile unsigned int *)&ring->head, seq, head, spin = 0;
+    completion_entry_t *entry;
+
+    for (;;)
+    {
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        seq = *(volatile unsigned int *)&entry->seq;
+        if (seq == pos + 1)
+        {
+            if (InterlockedCompareExchange( (LONG *)&entry->seq, pos + 2, pos + 1 ) == pos + 1) break;
+        }
+        else if (*(volatile unsigned int *)&ring->tail == pos) return STATUS_PENDING;
+
+        /* another thread is adding or removing the packet */
+        if ((head = *(volatile unsigned int *)&ring->head) != pos)
+        {
+            pos = head;
+            spin = 0;
+        }
+        else if (++spin == COMPLETION_RING_SPIN) return STATUS_UNSUCCESSFUL;
+        else NtYieldExecution();
+    }
+    InterlockedCompareExchange( (LONG *)&ring->head, pos + 1, pos );
+    *ret = *entry;
+    InterlockedExchange( (LONG *)&entry->seq, pos + COMPLETION_RING_SIZE );
+    return STATUS_SUCCESS;
+}
+
+/* remove a packet from the ring or from the server queue; return STATUS_PENDING if there is none */
+static NTSTATUS remove_completion_packet( HANDLE handle, completion_ring_t *ring, completion_entry_t *entry )
+{
+    BOOL ring_stalled = FALSE;
+    NTSTATUS status;
+
+    if (ring && !*(volatile unsigned int *)&ring->disabled)
+    {
+        status = completion_ring_remove( ring, entry );
+        if (status == STATUS_SUCCESS) return STATUS_SUCCESS;
+        if (status == STATUS_PENDING && !*(volatile unsigned int *)&ring->overflow) return STATUS_PENDING;
+        /* go through the server this time, it disables the ring if it stays stuck */
+        ring_stalled = (status == STATUS_UNSUCCESSFUL);
+    }
+
+    SERVER_START_REQ( remove_completion )
+    {
+        req->handle       = wine_server_obj_handle( handle );
+        req->ring_stalled = ring_stalled;
+        if (!(status = wine_server_call( req )))
+        {
+            entry->ckey        = reply->ckey;
+            entry->cvalue      = reply->cvalue;
+            entry->information = reply->information;
+            entry->status      = reply->status;
+        }
+    }
+    SERVER_END_REQ;
+    return status;
+}
+
+
 static NTSTATUS validate_open_object_attributes( const OBJECT_ATTRIBUTES *attr )
 {
     if (!attr || attr->Length != sizeof(*attr)) return STATUS_INVALID_PARAMETER;
@@ -369,6 +925,8 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 {
     NTSTATUS ret;
     SEMAPHORE_BASIC_INFORMATION *out = info;
+    enum fast_sync_type type;
+    fast_sync_t *obj;
 
     TRACE("(%p, %u, %p, %u, %p)\n", handle, class, info, len, ret_len);
 
@@ -380,6 +938,14 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 
     if (len != sizeof(SEMAPHORE_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((obj = get_fast_sync_obj( handle, FAST_SYNC_ACCESS_QUERY, &type )) && type == FAST_SYNC_SEMAPHORE)
+    {
+        out->CurrentCount = get_fast_sync_state( obj ) & ~FAST_SYNC_LOCKED;
+        out->MaximumCount = obj->count;
+        if (ret_len) *ret_len = sizeof(SEMAPHORE_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -402,6 +968,8 @@ NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, ULONG *previous
 {
     NTSTATUS ret;
 
+    if ((ret = fast_release_semaphore( handle, count, previous )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -475,6 +1043,8 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
 {
     NTSTATUS ret;
 
+    if ((ret = fast_set_event( handle, 1, prev_state )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -494,6 +1064,8 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, LONG *prev_state )
 {
     NTSTATUS ret;
 
+    if ((ret = fast_set_event( handle, 0, prev_state )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -543,6 +1115,8 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 {
     NTSTATUS ret;
     EVENT_BASIC_INFORMATION *out = info;
+    enum fast_sync_type type;
+    fast_sync_t *obj;
 
     TRACE("(%p, %u, %p, %u, %p)\n", handle, class, info, len, ret_len);
 
@@ -555,6 +1129,15 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 
     if (len != sizeof(EVENT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((obj = get_fast_sync_obj( handle, FAST_SYNC_ACCESS_QUERY, &type )) &&
+        (type == FAST_SYNC_AUTO_EVENT || type == FAST_SYNC_MANUAL_EVENT))
+    {
+        out->EventType  = (type == FAST_SYNC_MANUAL_EVENT) ? NotificationEvent : SynchronizationEvent;
+        out->EventState = get_fast_sync_state( obj ) & ~FAST_SYNC_LOCKED;
+        if (ret_len) *ret_len = sizeof(EVENT_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_event )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -628,6 +1211,8 @@ NTSTATUS WINAPI NtReleaseMutant( HANDLE handle, LONG *prev_count )
 {
     NTSTATUS ret;
 
+    if ((ret = fast_release_mutex( handle, prev_count )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( release_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -647,6 +1232,8 @@ NTSTATUS WINAPI NtQueryMutant( HANDLE handle, MUTANT_INFORMATION_CLASS class,
 {
     NTSTATUS ret;
     MUTANT_BASIC_INFORMATION *out = info;
+    enum fast_sync_type type;
+    fast_sync_t *obj;
 
     TRACE("(%p, %u, %p, %u, %p)\n", handle, class, info, len, ret_len);
 
@@ -658,6 +1245,18 @@ NTSTATUS WINAPI NtQueryMutant( HANDLE handle, MUTANT_INFORMATION_CLASS class,
 
     if (len != sizeof(MUTANT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((obj = get_fast_sync_obj( handle, FAST_SYNC_ACCESS_QUERY, &type )) && type == FAST_SYNC_MUTEX)
+    {
+        int state = get_fast_sync_state( obj ) & ~FAST_SYNC_LOCKED;
+        int owner = state & ~FAST_SYNC_ABANDONED;
+
+        out->CurrentCount   = 1 - (owner ? obj->count : 0);
+        out->OwnedByCaller  = (owner == GetCurrentThreadId());
+        out->AbandonedState = !!(state & FAST_SYNC_ABANDONED);
+        if (ret_len) *ret_len = sizeof(MUTANT_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1061,9 +1660,13 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if (wait_any && (ret = fast_wait_any( count, handles, alertable, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1397,10 +2000,19 @@ NTSTATUS WINAPI NtOpenIoCompletion( HANDLE *handle, ACCESS_MASK access, const OB
 NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value,
                                    NTSTATUS status, SIZE_T count )
 {
+    completion_ring_t *ring;
+    fast_sync_t *obj;
     NTSTATUS ret;
 
     TRACE( "(%p, %lx, %lx, %x, %lx)\n", handle, key, value, status, count );
 
+    if ((ring = get_completion_ring( handle, FAST_SYNC_ACCESS_MODIFY, &obj )) &&
+        completion_ring_add( ring, key, value, status, count ))
+    {
+        fast_sync_wake( handle, obj );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( add_completion )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -1421,25 +2033,25 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *value,
                                       IO_STATUS_BLOCK *io, LARGE_INTEGER *timeout )
 {
+    completion_ring_t *ring;
+    completion_entry_t entry;
+    fast_sync_t *obj;
     NTSTATUS status;
 
     TRACE( "(%p, %p, %p, %p, %p)\n", handle, key, value, io, timeout );
 
+    ring = get_completion_ring( handle, FAST_SYNC_ACCESS_MODIFY, &obj );
     for (;;)
     {
-        SERVER_START_REQ( remove_completion )
+        if (!(status = remove_completion_packet( handle, ring, &entry )))
         {
-            req->handle = wine_server_obj_handle( handle );
-            if (!(status = wine_server_call( req )))
-            {
-                *key            = reply->ckey;
-                *value          = reply->cvalue;
-                io->Information = reply->information;
-                io->u.Status    = reply->status;
-            }
+            *key            = entry.ckey;
+            *value          = entry.cvalue;
+            io->Information = entry.information;
+            io->u.Status    = entry.status;
         }
-        SERVER_END_REQ;
         if (status != STATUS_PENDING) return status;
+        if (ring && timeout && !timeout->QuadPart) return STATUS_TIMEOUT;
         status = NtWaitForSingleObject( handle, FALSE, timeout );
         if (status != WAIT_OBJECT_0) return status;
     }
@@ -1452,28 +2064,24 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+    completion_ring_t *ring;
+    completion_entry_t entry;
+    fast_sync_t *obj;
     NTSTATUS status;
     ULONG i = 0;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, count, written, timeout, alertable );
 
+    ring = get_completion_ring( handle, FAST_SYNC_ACCESS_MODIFY, &obj );
     for (;;)
     {
         while (i < count)
         {
-            SERVER_START_REQ( remove_completion )
-            {
-                req->handle = wine_server_obj_handle( handle );
-                if (!(status = wine_server_call( req )))
-                {
-                    info[i].CompletionKey             = reply->ckey;
-                    info[i].CompletionValue           = reply->cvalue;
-                    info[i].IoStatusBlock.Information = reply->information;
-                    info[i].IoStatusBlock.u.Status    = reply->status;
-                }
-            }
-            SERVER_END_REQ;
-            if (status != STATUS_SUCCESS) break;
+            if ((status = remove_completion_packet( handle, ring, &entry ))) break;
+            info[i].CompletionKey             = entry.ckey;
+            info[i].CompletionValue           = entry.cvalue;
+            info[i].IoStatusBlock.Information = entry.information;
+            info[i].IoStatusBlock.u.Status    = entry.status;
             ++i;
         }
         if (i || status != STATUS_PENDING)
@@ -1481,6 +2089,11 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
             if (status == STATUS_PENDING) status = STATUS_SUCCESS;
             break;
         }
+        if (ring && timeout && !timeout->QuadPart && !alertable)
+        {
+            status = STATUS_TIMEOUT;
+            break;
+        }
         status = NtWaitForSingleObject( handle, alertable, timeout );
         if (status != WAIT_OBJECT_0) break;
     }
@@ -1506,8 +2119,21 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE handle, IO_COMPLETION_INFORMATION_CL
     case IoCompletionBasicInformation:
     {
         ULONG *info = buffer;
+        completion_ring_t *ring;
+        fast_sync_t *obj;
+
         if (ret_len) *ret_len = sizeof(*info);
-        if (len == sizeof(*info))
+        if (len != sizeof(*info)) status = STATUS_INFO_LENGTH_MISMATCH;
+        else if ((ring = get_completion_ring( handle, FAST_SYNC_ACCESS_QUERY, &obj )) &&
+                 !*(volatile unsigned int *)&ring->disabled)
+        {
+            unsigned int head = *(volatile unsigned int *)&ring->head;
+            unsigned int depth = *(volatile unsigned int *)&ring->tail - head;
+
+            *info = min( depth, COMPLETION_RING_SIZE ) + *(volatile unsigned int *)&ring->overflow;
+            status = STATUS_SUCCESS;
+        }
+        else
         {
             SERVER_START_REQ( query_completion )
             {
@@ -1516,7 +2142,6 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE handle, IO_COMPLETION_INFORMATION_CL
             }
             SERVER_END_REQ;
         }
-        else status = STATUS_INFO_LENGTH_MISMATCH;
         break;
     }
     default:
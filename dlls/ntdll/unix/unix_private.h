@@ -159,7 +159,15 @@ extern NTSTATUS exec_wineloader( char **argv, int socketfd, const pe_image_info_
 extern void start_server( BOOL debug ) DECLSPEC_HIDDEN;
 extern ULONG_PTR get_image_address(void) DECLSPEC_HIDDEN;
 
+/* request of a batch, see server_call_batch() */
+struct server_batch_request
+{
+    struct __server_request_info *req;     /* request to perform */
+    struct batch_request_header   header;  /* optional reference to a handle returned by an earlier request */
+};
+
 extern unsigned int server_call_unlocked( void *req_ptr ) DECLSPEC_HIDDEN;
+extern unsigned int server_call_batch( struct server_batch_request *batch, unsigned int count ) DECLSPEC_HIDDEN;
 extern void server_enter_uninterrupted_section( pthread_mutex_t *mutex, sigset_t *sigset ) DECLSPEC_HIDDEN;
 extern void server_leave_uninterrupted_section( pthread_mutex_t *mutex, sigset_t *sigset ) DECLSPEC_HIDDEN;
 extern unsigned int server_select( const select_op_t *select_op, data_size_t size, UINT flags,
@@ -171,6 +179,12 @@ extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *
                                               apc_result_t *result ) DECLSPEC_HIDDEN;
 extern int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options ) DECLSPEC_HIDDEN;
+extern fast_sync_t *server_get_fast_sync_shm(void) DECLSPEC_HIDDEN;
+extern completion_ring_t *server_get_completion_shm( HANDLE handle, void *addr, unsigned int *serial ) DECLSPEC_HIDDEN;
+extern NTSTATUS server_get_handle_info( HANDLE handle, unsigned int *access, unsigned int *flags,
+                                       const UNICODE_STRING **type ) DECLSPEC_HIDDEN;
+extern const volatile unsigned int *server_get_handle_cache_gen(void) DECLSPEC_HIDDEN;
+extern void server_invalidate_handle_info( HANDLE handle ) DECLSPEC_HIDDEN;
 extern void server_init_process(void) DECLSPEC_HIDDEN;
 extern size_t server_init_thread( void *entry_point, BOOL *suspend ) DECLSPEC_HIDDEN;
 extern int server_pipe( int fd[2] ) DECLSPEC_HIDDEN;
@@ -185,6 +199,7 @@ extern NTSTATUS set_thread_context( HANDLE handle, const context_t *context, BOO
 extern NTSTATUS get_thread_context( HANDLE handle, context_t *context, unsigned int flags, BOOL *self ) DECLSPEC_HIDDEN;
 extern NTSTATUS alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
                                          data_size_t *ret_len ) DECLSPEC_HIDDEN;
+extern void fast_sync_close_handle( HANDLE handle ) DECLSPEC_HIDDEN;
 
 extern void virtual_init(void) DECLSPEC_HIDDEN;
 extern NTSTATUS virtual_map_ntdll( int fd, void **module ) DECLSPEC_HIDDEN;
@@ -253,6 +268,15 @@ extern void WINAPI call_user_exception_dispatcher( EXCEPTION_RECORD *rec, CONTEX
 #define SECS_1601_TO_1970  ((369 * 365 + 89) * (ULONGLONG)86400)
 #define TICKS_1601_TO_1970 (SECS_1601_TO_1970 * TICKSPERSEC)
 
+/* initialize a request to be performed outside of SERVER_START_REQ, e.g. in a batch */
+static inline void *server_init_request( struct __server_request_info *req, enum request type )
+{
+    memset( &req->u.req, 0, sizeof(req->u.req) );
+    req->u.req.request_header.req = type;
+    req->data_count = 0;
+    return &req->u.req;
+}
+
 static inline const char *debugstr_us( const UNICODE_STRING *us )
 {
     if (!us) return "<null>";
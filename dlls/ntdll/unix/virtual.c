@@ -1979,10 +1979,13 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
  *           map_image_into_view
  *
  * Map an executable (PE format) image into an existing view.
+ * If reloc_fd is valid, the sections are mapped from that copy of the image,
+ * already relocated to the view base by the server.
  * virtual_mutex must be held by caller.
  */
 static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_base,
-                                     SIZE_T header_size, ULONG image_flags, int shared_fd, BOOL removable )
+                                     SIZE_T header_size, ULONG image_flags, int shared_fd,
+                                     int reloc_fd, BOOL removable )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
@@ -2003,7 +2006,8 @@ static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_
 
     fstat( fd, &st );
     header_size = min( header_size, st.st_size );
-    if ((status = map_pe_header( view->base, header_size, fd, &removable ))) return status;
+    if ((status = map_pe_header( view->base, header_size, reloc_fd != -1 ? reloc_fd : fd, &removable )))
+        return status;
 
     status = STATUS_INVALID_IMAGE_FORMAT;  /* generic error */
     dos = (IMAGE_DOS_HEADER *)ptr;
@@ -2110,6 +2114,19 @@ static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_
                         sec->PointerToRawData, sec->SizeOfRawData,
                         sec->Misc.VirtualSize, sec->Characteristics );
 
+        if (reloc_fd != -1)
+        {
+            /* the relocated copy is laid out like the image, relocations past the raw data included */
+            if (!map_size) continue;
+            if (map_file_into_view( view, reloc_fd, sec->VirtualAddress, map_size, sec->VirtualAddress,
+                                    VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) != STATUS_SUCCESS)
+            {
+                ERR_(module)( "Could not map relocated section %.8s\n", sec->Name );
+                return status;
+            }
+            continue;
+        }
+
         if (!sec->PointerToRawData || !file_size) continue;
 
         /* Note: if the section is not aligned properly map_file_into_view will magically
@@ -2190,9 +2207,10 @@ NTSTATUS CDECL virtual_map_section( HANDLE handle, PVOID *addr_ptr, unsigned sho
     void *base;
     int unix_handle = -1, needs_close;
     int shared_fd = -1, shared_needs_close = 0;
+    int reloc_fd = -1, reloc_needs_close = 0;
     unsigned int vprot, sec_flags;
     struct file_view *view;
-    HANDLE shared_file;
+    HANDLE shared_file, reloc_file = 0;
     LARGE_INTEGER offset;
     sigset_t sigset;
 
@@ -2263,8 +2281,23 @@ NTSTATUS CDECL virtual_map_section( HANDLE handle, PVOID *addr_ptr, unsigned sho
         if (res) res = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits_64 );
         if (res) goto done;
 
+        /* map the pages relocated by the server, to share them with other processes using the same base */
+        if (view->base != base && (image_info->image_charact & IMAGE_FILE_DLL))
+        {
+            SERVER_START_REQ( get_image_reloc_file )
+            {
+                req->handle = wine_server_obj_handle( handle );
+                req->base   = wine_server_client_ptr( view->base );
+                if (!wine_server_call( req )) reloc_file = wine_server_ptr_handle( reply->file );
+            }
+            SERVER_END_REQ;
+            if (reloc_file && server_get_unix_fd( reloc_file, FILE_READ_DATA, &reloc_fd,
+                                                  &reloc_needs_close, NULL, NULL ))
+                reloc_fd = -1;
+        }
+
         res = map_image_into_view( view, unix_handle, base, image_info->header_size,
-                                   image_info->image_flags, shared_fd, needs_close );
+                                   image_info->image_flags, shared_fd, reloc_fd, needs_close );
     }
     else
     {
@@ -2330,6 +2363,8 @@ done:
     if (needs_close) close( unix_handle );
     if (shared_needs_close) close( shared_fd );
     if (shared_file) NtClose( shared_file );
+    if (reloc_needs_close) close( reloc_fd );
+    if (reloc_file) NtClose( reloc_file );
     return res;
 }
 
@@ -2472,7 +2507,7 @@ NTSTATUS virtual_map_ntdll( int fd, void **module )
         ERR( "couldn't load ntdll at preferred address %p\n", base );
     if (status) return status;
     *module = view->base;
-    return map_image_into_view( view, fd, base, nt.OptionalHeader.SizeOfHeaders, 0, -1, FALSE );
+    return map_image_into_view( view, fd, base, nt.OptionalHeader.SizeOfHeaders, 0, -1, -1, FALSE );
 }
 
 
@@ -3893,8 +3928,9 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
         {
             p->VirtualAttributes.Valid = !(vprot & VPROT_GUARD) && (vprot & 0x0f) && (pagemap >> 63);
             p->VirtualAttributes.Shared = !is_view_valloc( view ) && ((pagemap >> 61) & 1);
+            /* only whether the page is mapped exclusively is known, not the exact count */
             if (p->VirtualAttributes.Shared && p->VirtualAttributes.Valid)
-                p->VirtualAttributes.ShareCount = 1; /* FIXME */
+                p->VirtualAttributes.ShareCount = ((pagemap >> 56) & 1) ? 1 : 2;
             if (p->VirtualAttributes.Valid)
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
         }
@@ -331,7 +331,9 @@ BOOL WINAPI SetForegroundWindow( HWND hwnd )
  */
 HWND WINAPI GetActiveWindow(void)
 {
-    HWND ret = 0;
+    HWND focus, capture, ret = 0;
+
+    if (get_shared_thread_input( &focus, &ret, &capture )) return ret;
 
     SERVER_START_REQ( get_thread_input )
     {
@@ -348,7 +350,9 @@ HWND WINAPI GetActiveWindow(void)
  */
 HWND WINAPI GetFocus(void)
 {
-    HWND ret = 0;
+    HWND active, capture, ret = 0;
+
+    if (get_shared_thread_input( &ret, &active, &capture )) return ret;
 
     SERVER_START_REQ( get_thread_input )
     {
@@ -366,7 +366,9 @@ BOOL WINAPI DECLSPEC_HOTPATCH ReleaseCapture(void)
  */
 HWND WINAPI GetCapture(void)
 {
-    HWND ret = 0;
+    HWND focus, active, ret = 0;
+
+    if (get_shared_thread_input( &focus, &active, &ret )) return ret;
 
     SERVER_START_REQ( get_thread_input )
     {
@@ -452,6 +454,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
  */
 DWORD WINAPI GetQueueStatus( UINT flags )
 {
+    UINT wake_bits, changed_bits, wake_mask, changed_mask;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -462,6 +465,11 @@ DWORD WINAPI GetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* the server is only needed to clear the changed bits */
+    if (get_shared_queue_bits( &wake_bits, &changed_bits, &wake_mask, &changed_mask ) &&
+        !(changed_bits & flags))
+        return MAKELONG( 0, wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -478,10 +486,14 @@ DWORD WINAPI GetQueueStatus( UINT flags )
  */
 BOOL WINAPI GetInputState(void)
 {
+    UINT wake_bits, changed_bits, wake_mask, changed_mask;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if (get_shared_queue_bits( &wake_bits, &changed_bits, &wake_mask, &changed_mask ))
+        return wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
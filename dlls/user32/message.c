@@ -2641,6 +2641,259 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/* sections holding the queue and window state of the desktops used by the process,
+ * see server/user.c; threads refer to the section of their desktop by its index + 1 */
+#define MAX_USER_SHM_SECTIONS 8
+#define USER_SHM_SECTION_FAILED 0xffff
+
+static struct
+{
+    unsigned int      id;   /* unique id of the section */
+    const user_shm_t *ptr;  /* mapped section */
+} user_shm_sections[MAX_USER_SHM_SECTIONS];
+static unsigned int nb_user_shm_sections;
+
+/***********************************************************************
+ *           get_user_shm
+ *
+ * Get the section holding the shared user state of the current thread desktop,
+ * mapping it into the process if needed. Returns NULL if it isn't available.
+ */
+const user_shm_t *get_user_shm(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    unsigned int i, id = 0;
+    HANDLE handle = 0;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    NTSTATUS status;
+
+    if (thread_info->user_shm_section == USER_SHM_SECTION_FAILED) return NULL;
+    if (thread_info->user_shm_section) return user_shm_sections[thread_info->user_shm_section - 1].ptr;
+
+    SERVER_START_REQ( get_user_shm )
+    {
+        if (!wine_server_call( req ))
+        {
+            handle = wine_server_ptr_handle( reply->handle );
+            id = reply->id;
+        }
+    }
+    SERVER_END_REQ;
+    if (!handle)
+    {
+        thread_info->user_shm_section = USER_SHM_SECTION_FAILED;
+        return NULL;
+    }
+
+    USER_Lock();
+    for (i = 0; i < nb_user_shm_sections; i++) if (user_shm_sections[i].id == id) break;
+    if (i == nb_user_shm_sections && i < MAX_USER_SHM_SECTIONS)
+    {
+        status = NtMapViewOfSection( handle, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                                     ViewShare, 0, PAGE_READONLY );
+        if (!status)
+        {
+            user_shm_sections[i].id = id;
+            user_shm_sections[i].ptr = ptr;
+            nb_user_shm_sections++;
+        }
+        else
+        {
+            WARN( "failed to map the shared user state, status %x\n", status );
+            i = MAX_USER_SHM_SECTIONS;
+        }
+    }
+    USER_Unlock();
+    NtClose( handle );
+
+    if (i >= MAX_USER_SHM_SECTIONS)
+    {
+        thread_info->user_shm_section = USER_SHM_SECTION_FAILED;
+        return NULL;
+    }
+    thread_info->user_shm_section = i + 1;
+    return user_shm_sections[i].ptr;
+}
+
+
+/***********************************************************************
+ *           get_server_queue_handle
+ *
+ * Get a handle to the server message queue for the current thread.
+ */
+static HANDLE get_server_queue_handle(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    UINT shm_index = 0;
+    HANDLE ret;
+
+    if (!(ret = thread_info->server_queue))
+    {
+        SERVER_START_REQ( get_msg_queue )
+        {
+            wine_server_call( req );
+            ret = wine_server_ptr_handle( reply->handle );
+            shm_index = reply->shm_index;
+        }
+        SERVER_END_REQ;
+        thread_info->server_queue = ret;
+        if (!ret) ERR( "Cannot get server thread queue\n" );
+        if (shm_index && get_user_shm()) thread_info->queue_shm_index = shm_index;
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           get_shared_queue_bits
+ *
+ * Read the wake bits and masks of the current thread queue without a server call.
+ * Fails if the queue has not been created yet.
+ */
+BOOL get_shared_queue_bits( UINT *wake_bits, UINT *changed_bits, UINT *wake_mask, UINT *changed_mask )
+{
+    UINT index = get_user_thread_info()->queue_shm_index;
+    const user_shm_t *user_shm;
+    const queue_shm_t *shm;
+    unsigned int i, seq;
+
+    if (!index || !(user_shm = get_user_shm())) return FALSE;
+    shm = &user_shm->queues[index];
+
+    for (i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        seq = shm_read_begin( &shm->seq );
+        /* the entry is cleared if the queue isn't published in the section of the thread desktop */
+        if (!shm->input) return FALSE;
+        *wake_bits    = shm->wake_bits;
+        *changed_bits = shm->changed_bits;
+        *wake_mask    = shm->wake_mask;
+        *changed_mask = shm->changed_mask;
+        if (shm_read_end( &shm->seq, seq )) return TRUE;
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           get_shared_thread_input
+ *
+ * Read the focus, active and capture windows of the current thread input
+ * without a server call. Fails if the queue has not been created yet.
+ */
+BOOL get_shared_thread_input( HWND *focus, HWND *active, HWND *capture )
+{
+    UINT index = get_user_thread_info()->queue_shm_index;
+    const user_shm_t *user_shm;
+    const input_shm_t *input_shm;
+    const queue_shm_t *shm;
+    unsigned int i, seq, input_seq, input;
+    BOOL ret;
+
+    if (!index || !(user_shm = get_user_shm())) return FALSE;
+    shm = &user_shm->queues[index];
+
+    for (i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        /* the queue entry is updated whenever the thread input changes */
+        seq = shm_read_begin( &shm->seq );
+        if (!(input = shm->input)) return FALSE;
+        input_shm = &user_shm->inputs[input];
+        input_seq = shm_read_begin( &input_shm->seq );
+        *focus   = wine_server_ptr_handle( input_shm->focus );
+        *active  = wine_server_ptr_handle( input_shm->active );
+        *capture = wine_server_ptr_handle( input_shm->capture );
+        ret = shm_read_end( &input_shm->seq, input_seq );
+        if (shm_read_end( &shm->seq, seq ) && ret) return TRUE;
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           are_active_hooks_current
+ *
+ * Check that the hooks of the desktop didn't change since the server last
+ * returned the active hooks of the current thread.
+ */
+static BOOL are_active_hooks_current(void)
+{
+    UINT index = get_user_thread_info()->queue_shm_index;
+    const user_shm_t *user_shm;
+    const queue_shm_t *shm;
+    unsigned int i, seq, hooks_gen;
+
+    if (!index || !(user_shm = get_user_shm())) return FALSE;
+    shm = &user_shm->queues[index];
+
+    for (i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        seq = shm_read_begin( &shm->seq );
+        hooks_gen = shm->hooks_gen;
+        if (shm_read_end( &shm->seq, seq ))
+            return hooks_gen == __atomic_load_n( &user_shm->hooks_gen, __ATOMIC_ACQUIRE );
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           is_queue_idle
+ *
+ * Check from the shared queue state whether a get_message call would find
+ * nothing to return and change nothing in the server queue.
+ */
+static BOOL is_queue_idle( HWND hwnd, UINT first, UINT last, UINT flags,
+                           UINT wake_mask, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    UINT filter = flags >> 16, clear_bits = 0, signal_bits = QS_SENDMESSAGE;
+    UINT wake_bits, changed_bits, shm_wake_mask, shm_changed_mask;
+
+    /* the server signals the idle event in that case */
+    if (hwnd == (HWND)-1) return FALSE;
+    /* the server fails the call for invalid windows, only trust our own */
+    if (hwnd && hwnd != (HWND)1)
+    {
+        WND *win = WIN_GetPtr( hwnd );
+
+        if (!win || win == WND_OTHER_PROCESS || win == WND_DESKTOP) return FALSE;
+        WIN_ReleasePtr( win );
+    }
+    if (!thread_info->server_queue) get_server_queue_handle();
+    /* keep updating the last get message time, so that the queue isn't considered hung */
+    if (GetTickCount() - thread_info->last_getmsg_time >= 3000) return FALSE;
+    if (!get_shared_queue_bits( &wake_bits, &changed_bits, &shm_wake_mask, &shm_changed_mask ))
+        return FALSE;
+    if (shm_wake_mask != wake_mask || shm_changed_mask != changed_mask) return FALSE;
+    /* the server returns the active hooks, make sure ours are still valid */
+    if (!are_active_hooks_current()) return FALSE;
+
+    if (!filter) filter = QS_ALLINPUT;
+    if (filter & QS_POSTMESSAGE)
+    {
+        clear_bits |= QS_POSTMESSAGE | QS_HOTKEY | QS_TIMER;
+        if (!first && last == ~0U) clear_bits |= QS_ALLPOSTMESSAGE;
+        signal_bits |= QS_POSTMESSAGE | QS_ALLPOSTMESSAGE | QS_HOTKEY | QS_TIMER;
+    }
+    if (filter & QS_INPUT)
+    {
+        clear_bits |= QS_INPUT;
+        signal_bits |= QS_INPUT;
+    }
+    if (filter & QS_PAINT)
+    {
+        clear_bits |= QS_PAINT;
+        signal_bits |= QS_PAINT;
+    }
+    if (filter & QS_TIMER) signal_bits |= QS_TIMER;
+    if (filter & QS_HOTKEY) signal_bits |= QS_HOTKEY;
+
+    return !(changed_bits & clear_bits) && !(wake_bits & signal_bits);
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2671,6 +2924,15 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
 
         thread_info->msg_source = prev_source;
 
+        if (!hw_id && is_queue_idle( hwnd, first, last, flags,
+                                     changed_mask & (QS_SENDMESSAGE | QS_SMRESULT), changed_mask ))
+        {
+            HeapFree( GetProcessHeap(), 0, buffer );
+            thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+            thread_info->changed_mask = changed_mask;
+            return 0;
+        }
+
         SERVER_START_REQ( get_message )
         {
             req->flags     = flags;
@@ -2699,6 +2961,8 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
         }
         SERVER_END_REQ;
 
+        thread_info->last_getmsg_time = GetTickCount();
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
@@ -2904,31 +3168,6 @@ static inline void process_sent_messages(void)
 }
 
 
-/***********************************************************************
- *           get_server_queue_handle
- *
- * Get a handle to the server message queue for the current thread.
- */
-static HANDLE get_server_queue_handle(void)
-{
-    struct user_thread_info *thread_info = get_user_thread_info();
-    HANDLE ret;
-
-    if (!(ret = thread_info->server_queue))
-    {
-        SERVER_START_REQ( get_msg_queue )
-        {
-            wine_server_call( req );
-            ret = wine_server_ptr_handle( reply->handle );
-        }
-        SERVER_END_REQ;
-        thread_info->server_queue = ret;
-        if (!ret) ERR( "Cannot get server thread queue\n" );
-    }
-    return ret;
-}
-
-
 /***********************************************************************
  *           wait_message_reply
  *
@@ -2977,12 +3216,22 @@ static DWORD wait_objects( DWORD count, const HANDLE *handles, DWORD timeout,
                            DWORD wake_mask, DWORD changed_mask, DWORD flags )
 {
     struct user_thread_info *thread_info = get_user_thread_info();
+    UINT wake_bits, changed_bits, shm_wake_mask, shm_changed_mask;
     DWORD ret;
 
     assert( count );  /* we must have at least the server queue */
 
     flush_window_surfaces( TRUE );
 
+    /* the server may already have the right masks, for instance after a timeout */
+    if ((thread_info->wake_mask != wake_mask || thread_info->changed_mask != changed_mask) &&
+        get_shared_queue_bits( &wake_bits, &changed_bits, &shm_wake_mask, &shm_changed_mask ) &&
+        shm_wake_mask == wake_mask && shm_changed_mask == changed_mask)
+    {
+        thread_info->wake_mask = wake_mask;
+        thread_info->changed_mask = changed_mask;
+    }
+
     if (thread_info->wake_mask != wake_mask || thread_info->changed_mask != changed_mask)
     {
         SERVER_START_REQ( set_queue_mask )
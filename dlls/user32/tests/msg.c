@@ -12579,6 +12579,67 @@ static const struct message WmStopQuitSeq[] = {
     { 0 }
 };
 
+static DWORD WINAPI post_thread_message_proc(void *arg)
+{
+    PostThreadMessageA((DWORD)(DWORD_PTR)arg, WM_USER + 1, 0, 0);
+    return 0;
+}
+
+static void test_queue_status_polling(void)
+{
+    HANDLE thread;
+    DWORD status, tid;
+    HWND hwnd;
+    BOOL ret;
+    MSG msg;
+
+    hwnd = CreateWindowA("TestWindowClass", "QueueStatus", WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+                         10, 10, 200, 200, NULL, NULL, NULL, NULL);
+    ok(hwnd != NULL, "expected hwnd != NULL\n");
+    flush_events();
+
+    /* repeated polls of an empty queue */
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "expected PeekMessage to fail, got message %04x\n", msg.message);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == 0, "expected 0, got %08x\n", status);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "expected PeekMessage to fail, got message %04x\n", msg.message);
+
+    /* a message posted by another thread must be seen by the next poll */
+    thread = CreateThread(NULL, 0, post_thread_message_proc, ULongToPtr(GetCurrentThreadId()), 0, &tid);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "got %08x\n", status);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == MAKELONG(0, QS_POSTMESSAGE), "got %08x\n", status);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(ret && msg.message == WM_USER + 1, "expected WM_USER + 1, got %d %04x\n", ret, msg.message);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "expected WM_USER + 1, got %d %04x\n", ret, msg.message);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "expected PeekMessage to fail, got message %04x\n", msg.message);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == 0, "expected 0, got %08x\n", status);
+
+    /* focus, active and capture windows */
+    SetFocus(hwnd);
+    ok(GetFocus() == hwnd, "expected focus %p, got %p\n", hwnd, GetFocus());
+    SetCapture(hwnd);
+    ok(GetCapture() == hwnd, "expected capture %p, got %p\n", hwnd, GetCapture());
+    ReleaseCapture();
+    ok(GetCapture() == 0, "expected no capture, got %p\n", GetCapture());
+    SetFocus(0);
+    ok(GetFocus() == 0, "expected no focus, got %p\n", GetFocus());
+    SetFocus(hwnd);
+    DestroyWindow(hwnd);
+    ok(GetFocus() != hwnd, "focus still on destroyed window\n");
+    ok(GetActiveWindow() != hwnd, "destroyed window still active\n");
+    flush_events();
+}
+
 static void test_quit_message(void)
 {
     MSG msg;
@@ -18020,6 +18081,7 @@ START_TEST(msg)
     test_SendMessageTimeout();
     test_edit_messages();
     test_quit_message();
+    test_queue_status_polling();
     test_notify_message();
     test_SetActiveWindow();
     test_restore_messages();
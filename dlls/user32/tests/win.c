@@ -11753,7 +11753,8 @@ static void other_process_proc(HWND hwnd)
 {
     HANDLE window_ready_event, test_done_event;
     WINDOWPLACEMENT wp;
-    DWORD ret;
+    DWORD ret, tid, pid;
+    RECT rect;
 
     window_ready_event = OpenEventA(EVENT_ALL_ACCESS, FALSE, "test_opw_window");
     ok(!!window_ready_event, "OpenEvent failed.\n");
@@ -11767,6 +11768,25 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#x.\n", ret);
     ok(wp.showCmd == SW_SHOWNORMAL, "Unexpected showCmd %#x.\n", wp.showCmd);
     ok(!wp.flags, "Unexpected flags %#x.\n", wp.flags);
+
+    ok(IsWindow(hwnd), "IsWindow failed.\n");
+    ok(IsWindow((HWND)(ULONG_PTR)LOWORD(hwnd)), "IsWindow failed for the truncated handle.\n");
+    tid = GetWindowThreadProcessId(hwnd, &pid);
+    ok(tid && tid != GetCurrentThreadId(), "Unexpected tid %#x.\n", tid);
+    ok(pid && pid != GetCurrentProcessId(), "Unexpected pid %#x.\n", pid);
+    ok(!GetParent(hwnd), "Unexpected parent %p.\n", GetParent(hwnd));
+    ok(GetAncestor(hwnd, GA_PARENT) == GetDesktopWindow(), "Unexpected ancestor %p.\n",
+       GetAncestor(hwnd, GA_PARENT));
+    ret = GetWindowLongA(hwnd, GWL_STYLE);
+    ok((ret & (WS_POPUP | WS_VISIBLE)) == (WS_POPUP | WS_VISIBLE), "Unexpected style %#x.\n", ret);
+    ret = GetWindowRect(hwnd, &rect);
+    ok(ret, "Unexpected ret %#x.\n", ret);
+    ok(rect.left == 100 && rect.top == 100 && rect.right == 200 && rect.bottom == 200,
+       "Unexpected window rect %s.\n", wine_dbgstr_rect(&rect));
+    ret = GetClientRect(hwnd, &rect);
+    ok(ret, "Unexpected ret %#x.\n", ret);
+    ok(!rect.left && !rect.top && rect.right == 100 && rect.bottom == 100,
+       "Unexpected client rect %s.\n", wine_dbgstr_rect(&rect));
     SetEvent(test_done_event);
 
     /* SW_SHOWMAXIMIZED */
@@ -29,6 +29,7 @@
 #include "winreg.h"
 #include "winternl.h"
 #include "wine/heap.h"
+#include "wine/server.h"
 #include "wine/unicode.h"
 
 #define GET_WORD(ptr)  (*(const WORD *)(ptr))
@@ -203,6 +204,9 @@ struct user_thread_info
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     struct rawinput_thread_data  *rawinput;               /* RawInput thread local data / buffer */
+    WORD                          queue_shm_index;        /* Index of the shared queue state */
+    WORD                          user_shm_section;       /* Section of the thread desktop shared state */
+    DWORD                         last_getmsg_time;       /* Time of last get_message server call */
 };
 
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
@@ -235,6 +239,22 @@ static inline BOOL is_broadcast( HWND hwnd )
     return (hwnd == HWND_BROADCAST || hwnd == HWND_TOPMOST);
 }
 
+/* entries of the shared user state are protected by a sequence count,
+ * retry reading them a few times before falling back to a server call */
+#define SHM_READ_RETRIES 64
+
+static inline unsigned int shm_read_begin( const unsigned int *seq )
+{
+    return __atomic_load_n( seq, __ATOMIC_ACQUIRE );
+}
+
+/* check that an entry was not being modified while it was read */
+static inline BOOL shm_read_end( const unsigned int *seq, unsigned int start )
+{
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return !(start & 1) && __atomic_load_n( seq, __ATOMIC_RELAXED ) == start;
+}
+
 extern HMODULE user32_module DECLSPEC_HIDDEN;
 
 struct dce;
@@ -265,6 +285,10 @@ extern LRESULT call_current_hook( HHOOK hhook, INT code, WPARAM wparam, LPARAM l
 extern DWORD get_input_codepage( void ) DECLSPEC_HIDDEN;
 extern BOOL map_wparam_AtoW( UINT message, WPARAM *wparam, enum wm_char_mapping mapping ) DECLSPEC_HIDDEN;
 extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags ) DECLSPEC_HIDDEN;
+extern const user_shm_t *get_user_shm(void) DECLSPEC_HIDDEN;
+extern BOOL get_shared_queue_bits( UINT *wake_bits, UINT *changed_bits,
+                                   UINT *wake_mask, UINT *changed_mask ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_thread_input( HWND *focus, HWND *active, HWND *capture ) DECLSPEC_HIDDEN;
 extern LRESULT MSG_SendInternalMessageTimeout( DWORD dest_pid, DWORD dest_tid,
                                                UINT msg, WPARAM wparam, LPARAM lparam,
                                                UINT flags, UINT timeout, PDWORD_PTR res_ptr ) DECLSPEC_HIDDEN;
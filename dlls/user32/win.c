@@ -704,6 +704,268 @@ UINT win_set_flags( HWND hwnd, UINT set_mask, UINT clear_mask )
 }
 
 
+/* windows of other processes are published by the server in the shared user
+ * state of their desktop, see server/window.c; all the entries are covered by
+ * a single sequence count so that walking up the parent chain gives a
+ * consistent result */
+#define MAX_SHARED_WINDOW_DEPTH 256
+
+/* find the shared entry of a window, with the same handle checks as the server */
+static const window_shm_t *find_shared_window( const user_shm_t *shm, user_handle_t handle )
+{
+    const window_shm_t *entry;
+    unsigned int index = ((handle & 0xffff) - FIRST_USER_HANDLE) >> 1;
+    unsigned int generation = handle >> 16;
+
+    if (index >= USER_SHM_MAX_WINDOWS) return NULL;
+    entry = &shm->windows[index];
+    if (!entry->handle) return NULL;
+    if (generation && generation != 0xffff && generation != entry->handle >> 16) return NULL;
+    return entry;
+}
+
+
+/***********************************************************************
+ *           get_shared_window
+ *
+ * Read the published state of a window without a server call. Fails if it
+ * can't be read, or if the window isn't on the desktop of the current thread.
+ */
+static BOOL get_shared_window( HWND hwnd, window_shm_t *info )
+{
+    const user_shm_t *shm = get_user_shm();
+    const window_shm_t *entry;
+    unsigned int i, seq;
+    BOOL ret;
+
+    if (!shm) return FALSE;
+
+    for (i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        seq = shm_read_begin( &shm->window_seq );
+        if ((ret = (entry = find_shared_window( shm, wine_server_user_handle( hwnd ) )) != NULL))
+            *info = *entry;
+        if (shm_read_end( &shm->window_seq, seq )) return ret;
+    }
+    return FALSE;
+}
+
+
+static BOOL read_shared_window_rects( const user_shm_t *shm, user_handle_t handle, enum coords_relative relative,
+                                      UINT dpi, RECT *window_rect, RECT *client_rect )
+{
+    const window_shm_t *win, *parent;
+    RECT rect;
+    int depth;
+
+    if (!(win = find_shared_window( shm, handle ))) return FALSE;
+    if (win->dpi != dpi) return FALSE;  /* let the server do the scaling */
+
+    SetRect( window_rect, win->window.left, win->window.top, win->window.right, win->window.bottom );
+    SetRect( client_rect, win->client.left, win->client.top, win->client.right, win->client.bottom );
+
+    switch (relative)
+    {
+    case COORDS_CLIENT:
+        rect = *client_rect;
+        OffsetRect( window_rect, -rect.left, -rect.top );
+        OffsetRect( client_rect, -rect.left, -rect.top );
+        if (win->ex_style & WS_EX_LAYOUTRTL) mirror_rect( &rect, window_rect );
+        return TRUE;
+    case COORDS_WINDOW:
+        rect = *window_rect;
+        OffsetRect( window_rect, -rect.left, -rect.top );
+        OffsetRect( client_rect, -rect.left, -rect.top );
+        if (win->ex_style & WS_EX_LAYOUTRTL) mirror_rect( &rect, client_rect );
+        return TRUE;
+    case COORDS_PARENT:
+        if (!win->parent) return TRUE;
+        if (!(parent = find_shared_window( shm, win->parent ))) return FALSE;
+        if (parent->ex_style & WS_EX_LAYOUTRTL)
+        {
+            SetRect( &rect, parent->client.left, parent->client.top,
+                     parent->client.right, parent->client.bottom );
+            mirror_rect( &rect, window_rect );
+            mirror_rect( &rect, client_rect );
+        }
+        return TRUE;
+    case COORDS_SCREEN:
+        for (depth = 0; win->parent; depth++)
+        {
+            if (depth >= MAX_SHARED_WINDOW_DEPTH) return FALSE;
+            if (!(parent = find_shared_window( shm, win->parent ))) return FALSE;
+            if (!parent->parent) break;  /* desktop window */
+            OffsetRect( window_rect, parent->client.left, parent->client.top );
+            OffsetRect( client_rect, parent->client.left, parent->client.top );
+            win = parent;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           get_shared_window_rects
+ *
+ * Compute the rectangles of a window of another process without a server call.
+ * Fails if the server has to be asked instead.
+ */
+static BOOL get_shared_window_rects( HWND hwnd, enum coords_relative relative,
+                                     RECT *window_rect, RECT *client_rect )
+{
+    const user_shm_t *shm = get_user_shm();
+    UINT dpi = get_thread_dpi();
+    unsigned int i, seq;
+    BOOL ret;
+
+    if (!shm) return FALSE;
+
+    for (i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        seq = shm_read_begin( &shm->window_seq );
+        ret = read_shared_window_rects( shm, wine_server_user_handle( hwnd ), relative,
+                                        dpi, window_rect, client_rect );
+        if (shm_read_end( &shm->window_seq, seq )) return ret;
+    }
+    return FALSE;
+}
+
+
+/* list of windows built from the shared window state */
+struct shared_window_list
+{
+    HWND        *handles;
+    unsigned int count;
+    unsigned int size;
+    unsigned int visited;  /* number of windows visited, bounds the walk on inconsistent data */
+};
+
+static BOOL add_shared_window_to_list( struct shared_window_list *list, user_handle_t handle )
+{
+    HWND *new_handles;
+
+    if (list->count + 1 >= list->size)
+    {
+        if (!(new_handles = HeapReAlloc( GetProcessHeap(), 0, list->handles,
+                                         list->size * 2 * sizeof(HWND) ))) return FALSE;
+        list->handles = new_handles;
+        list->size *= 2;
+    }
+    list->handles[list->count++] = wine_server_ptr_handle( handle );
+    return TRUE;
+}
+
+/* same checks as is_point_in_window in the server; returns -1 if the server has to be asked */
+static int is_point_in_shared_window( const window_shm_t *win, int x, int y, UINT dpi, UINT monitor_dpi )
+{
+    if (!(win->style & WS_VISIBLE)) return 0;
+    if ((win->style & (WS_POPUP|WS_CHILD|WS_DISABLED)) == (WS_CHILD|WS_DISABLED)) return 0;
+    if ((win->ex_style & (WS_EX_LAYERED|WS_EX_TRANSPARENT)) == (WS_EX_LAYERED|WS_EX_TRANSPARENT)) return 0;
+    /* let the server do the scaling */
+    if ((dpi ? dpi : monitor_dpi) != (win->dpi ? win->dpi : monitor_dpi)) return -1;
+    if (x < win->visible.left || x >= win->visible.right || y < win->visible.top || y >= win->visible.bottom)
+        return 0;
+    if (win->has_region) return -1;
+    return 1;
+}
+
+/* same as get_window_children_from_point in the server */
+static BOOL add_shared_children_from_point( const user_shm_t *shm, const window_shm_t *parent, int x, int y,
+                                            UINT monitor_dpi, int depth, struct shared_window_list *list )
+{
+    const window_shm_t *child;
+    user_handle_t handle;
+    int ret;
+
+    if (depth >= MAX_SHARED_WINDOW_DEPTH) return FALSE;
+
+    for (handle = parent->first_child; handle; handle = child->next_sibling)
+    {
+        if (++list->visited > USER_SHM_MAX_WINDOWS) return FALSE;
+        if (!(child = find_shared_window( shm, handle ))) return FALSE;
+        if ((ret = is_point_in_shared_window( child, x, y, parent->dpi, monitor_dpi )) == -1) return FALSE;
+        if (!ret) continue;
+
+        /* if point is in client area, and window is not minimized or disabled, check children */
+        if (!(child->style & (WS_MINIMIZE|WS_DISABLED)) &&
+            x >= child->client.left && x < child->client.right &&
+            y >= child->client.top && y < child->client.bottom)
+        {
+            if (!add_shared_children_from_point( shm, child, x - child->client.left, y - child->client.top,
+                                                 monitor_dpi, depth + 1, list ))
+                return FALSE;
+        }
+        if (!add_shared_window_to_list( list, handle )) return FALSE;
+    }
+    return TRUE;
+}
+
+/* same as all_windows_from_point in the server, for the desktop window */
+static BOOL list_shared_windows_from_point( const user_shm_t *shm, HWND desktop, POINT pt, UINT dpi,
+                                            struct shared_window_list *list )
+{
+    const window_shm_t *win;
+    UINT monitor_dpi;
+    int ret;
+
+    if (!(win = find_shared_window( shm, wine_server_user_handle( desktop ) ))) return FALSE;
+    monitor_dpi = win->dpi ? win->dpi : USER_DEFAULT_SCREEN_DPI;
+
+    if ((ret = is_point_in_shared_window( win, pt.x, pt.y, dpi, monitor_dpi )) != 1) return !ret;
+    if (!(win->style & (WS_MINIMIZE|WS_DISABLED)) &&
+        pt.x >= win->client.left && pt.x < win->client.right &&
+        pt.y >= win->client.top && pt.y < win->client.bottom)
+    {
+        if (!add_shared_children_from_point( shm, win, pt.x, pt.y, monitor_dpi, 0, list )) return FALSE;
+    }
+    return add_shared_window_to_list( list, win->handle );
+}
+
+
+/***********************************************************************
+ *           get_shared_children_from_point
+ *
+ * Get the list of windows that can contain a point, in screen coordinates,
+ * from the shared window state without a server call. Fails if the server
+ * has to be asked instead. The returned list must be freed by the caller;
+ * it is NULL if no window contains the point.
+ */
+BOOL get_shared_children_from_point( POINT pt, HWND **ret )
+{
+    const user_shm_t *shm = get_user_shm();
+    struct shared_window_list list;
+    HWND desktop = GetDesktopWindow();
+    UINT dpi = get_thread_dpi();
+    unsigned int i, seq;
+    BOOL ok;
+
+    if (!shm) return FALSE;
+
+    list.size = 128;
+    if (!(list.handles = HeapAlloc( GetProcessHeap(), 0, list.size * sizeof(HWND) ))) return FALSE;
+
+    for (i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        list.count = list.visited = 0;
+        seq = shm_read_begin( &shm->window_seq );
+        ok = list_shared_windows_from_point( shm, desktop, pt, dpi, &list );
+        if (!shm_read_end( &shm->window_seq, seq )) continue;
+        if (!ok) break;
+        if (!list.count)
+        {
+            HeapFree( GetProcessHeap(), 0, list.handles );
+            list.handles = NULL;
+        }
+        else list.handles[list.count] = 0;
+        *ret = list.handles;
+        return TRUE;
+    }
+    HeapFree( GetProcessHeap(), 0, list.handles );
+    return FALSE;
+}
+
+
 /***********************************************************************
  *           WIN_GetFullHandle
  *
@@ -733,6 +995,10 @@ HWND WIN_GetFullHandle( HWND hwnd )
     }
     else  /* may belong to another process */
     {
+        window_shm_t info;
+
+        if (get_shared_window( hwnd, &info )) return wine_server_ptr_handle( info.handle );
+
         SERVER_START_REQ( get_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -939,6 +1205,17 @@ BOOL WIN_GetRectangles( HWND hwnd, enum coords_relative relative, RECT *rectWind
     }
 
 other_process:
+    {
+        RECT window_rect, client_rect;
+
+        if (get_shared_window_rects( hwnd, relative, &window_rect, &client_rect ))
+        {
+            if (rectWindow) *rectWindow = window_rect;
+            if (rectClient) *rectClient = client_rect;
+            return TRUE;
+        }
+    }
+
     SERVER_START_REQ( get_window_rectangles )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2354,11 +2631,15 @@ static LONG_PTR WIN_GetWindowLong( HWND hwnd, INT offset, UINT size, BOOL unicod
 
     if (wndPtr == WND_OTHER_PROCESS)
     {
+        window_shm_t info;
+
         if (offset == GWLP_WNDPROC)
         {
             SetLastError( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE) && get_shared_window( hwnd, &info ))
+            return offset == GWL_STYLE ? (LONG)info.style : (LONG)info.ex_style;
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -3003,6 +3284,7 @@ INT WINAPI GetWindowTextLengthW( HWND hwnd )
  */
 BOOL WINAPI IsWindow( HWND hwnd )
 {
+    window_shm_t info;
     WND *ptr;
     BOOL ret;
 
@@ -3016,6 +3298,7 @@ BOOL WINAPI IsWindow( HWND hwnd )
     }
 
     /* check other processes */
+    if (get_shared_window( hwnd, &info )) return TRUE;
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -3031,6 +3314,7 @@ BOOL WINAPI IsWindow( HWND hwnd )
  */
 DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
 {
+    window_shm_t info;
     WND *ptr;
     DWORD tid = 0;
 
@@ -3050,6 +3334,11 @@ DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
     }
 
     /* check other processes */
+    if (get_shared_window( hwnd, &info ))
+    {
+        if (process) *process = info.pid;
+        return info.tid;
+    }
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -3080,7 +3369,16 @@ HWND WINAPI GetParent( HWND hwnd )
     if (wndPtr == WND_DESKTOP) return 0;
     if (wndPtr == WND_OTHER_PROCESS)
     {
-        LONG style = GetWindowLongW( hwnd, GWL_STYLE );
+        window_shm_t info;
+        LONG style;
+
+        if (get_shared_window( hwnd, &info ))
+        {
+            if (info.style & WS_POPUP) retvalue = wine_server_ptr_handle( info.owner );
+            else if (info.style & WS_CHILD) retvalue = wine_server_ptr_handle( info.parent );
+            return retvalue;
+        }
+        style = GetWindowLongW( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
@@ -3129,6 +3427,9 @@ HWND WINAPI GetAncestor( HWND hwnd, UINT type )
         }
         else /* need to query the server */
         {
+            window_shm_t info;
+
+            if (get_shared_window( hwnd, &info )) return wine_server_ptr_handle( info.parent );
             SERVER_START_REQ( get_window_tree )
             {
                 req->handle = wine_server_user_handle( hwnd );
@@ -249,6 +249,8 @@ static HWND *list_children_from_point( HWND hwnd, POINT pt )
     HWND *list;
     int i, size = 128;
 
+    if (hwnd == GetDesktopWindow() && get_shared_children_from_point( pt, &list )) return list;
+
     for (;;)
     {
         int count = 0;
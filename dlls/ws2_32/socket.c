@@ -1197,6 +1197,23 @@ static DWORD sock_is_blocking(SOCKET s, BOOL *ret)
     return err;
 }
 
+/* re-enable FD_READ and get the blocking mode in the same server call */
+static DWORD sock_enable_read(SOCKET s, BOOL *blocking)
+{
+    DWORD err;
+    SERVER_START_REQ( enable_socket_event )
+    {
+        req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
+        req->mask   = FD_READ;
+        req->sstate = 0;
+        req->cstate = 0;
+        err = NtStatusToWSAError( wine_server_call( req ));
+        *blocking = (reply->state & FD_WINE_NONBLOCKING) == 0;
+    }
+    SERVER_END_REQ;
+    return err;
+}
+
 static unsigned int _get_sock_mask(SOCKET s)
 {
     unsigned int ret;
@@ -5716,9 +5733,11 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         return 0;
     }
 
-    if ((err = sock_is_blocking( s, &is_blocking ))) goto error;
-
-    if ( is_blocking )
+    /* a send that went through entirely doesn't depend on the blocking mode */
+    if (n == totalLength)
+        bytes_sent = n;
+    else if ((err = sock_is_blocking( s, &is_blocking ))) goto error;
+    else if ( is_blocking )
     {
         /* On a blocking non-overlapped stream socket,
          * sending blocks until the entire buffer is sent. */
@@ -8174,7 +8193,8 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
         if (n != -1) break;
 
-        if ((err = sock_is_blocking( s, &is_blocking ))) goto error;
+        /* FD_READ has to be re-enabled anyway if the socket is non-blocking */
+        if ((err = sock_enable_read( s, &is_blocking ))) goto error;
 
         if ( is_blocking )
         {
@@ -8203,7 +8223,6 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         }
         else
         {
-            _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
             err = WSAEWOULDBLOCK;
             goto error;
         }
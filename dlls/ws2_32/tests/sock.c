@@ -6693,6 +6693,66 @@ static DWORD CALLBACK write_watch_thread( void *arg )
     return 0;
 }
 
+static void test_recv_event_select(void)
+{
+    SOCKET src, dst;
+    WSAEVENT event;
+    u_long nonblocking = 1;
+    char buffer[16];
+    DWORD ret;
+    int i;
+
+    if (tcp_socketpair(&src, &dst))
+    {
+        ok(0, "creating socket pair failed, skipping test\n");
+        return;
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+        ret = send(src, "x", 1, 0);
+        ok(ret == 1, "send returned %d, error %d\n", ret, WSAGetLastError());
+        ret = recv(dst, buffer, sizeof(buffer), 0);
+        ok(ret == 1, "recv returned %d, error %d\n", ret, WSAGetLastError());
+    }
+
+    ret = ioctlsocket(dst, FIONBIO, &nonblocking);
+    ok(!ret, "ioctlsocket failed, error %d\n", WSAGetLastError());
+    WSASetLastError(0xdeadbeef);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "recv returned %d\n", ret);
+    ok(WSAGetLastError() == WSAEWOULDBLOCK, "got error %d\n", WSAGetLastError());
+
+    /* the server has to report events once they are selected */
+    event = WSACreateEvent();
+    ret = WSAEventSelect(dst, event, FD_READ);
+    ok(!ret, "WSAEventSelect failed, error %d\n", WSAGetLastError());
+    ret = WaitForSingleObject(event, 100);
+    ok(ret == WAIT_TIMEOUT, "got %d\n", ret);
+
+    ret = send(src, "y", 1, 0);
+    ok(ret == 1, "send returned %d, error %d\n", ret, WSAGetLastError());
+    ret = WaitForSingleObject(event, 1000);
+    ok(ret == WAIT_OBJECT_0, "got %d\n", ret);
+    ResetEvent(event);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == 1, "recv returned %d, error %d\n", ret, WSAGetLastError());
+
+    ret = send(src, "z", 1, 0);
+    ok(ret == 1, "send returned %d, error %d\n", ret, WSAGetLastError());
+    ret = WaitForSingleObject(event, 1000);
+    ok(ret == WAIT_OBJECT_0, "got %d\n", ret);
+
+    nonblocking = 0;
+    ret = ioctlsocket(dst, FIONBIO, &nonblocking);
+    ok(ret == SOCKET_ERROR, "ioctlsocket returned %d\n", ret);
+    ok(WSAGetLastError() == WSAEINVAL, "got error %d\n", WSAGetLastError());
+
+    WSACloseEvent(event);
+    closesocket(src);
+    closesocket(dst);
+}
+
 static void test_write_watch(void)
 {
     SOCKET src, dest;
@@ -11402,6 +11462,7 @@ START_TEST( sock )
     test_WSASendTo();
     test_WSARecv();
     test_WSAPoll();
+    test_recv_event_select();
     test_write_watch();
     test_iocp();
 
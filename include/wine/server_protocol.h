@@ -1492,6 +1492,93 @@ struct open_semaphore_reply
 
 
 
+typedef struct
+{
+    int          state;
+    unsigned int count;
+    unsigned int type;
+    unsigned int waiters;
+    unsigned int serial;
+    unsigned int __pad;
+} fast_sync_t;
+enum fast_sync_type
+{
+    FAST_SYNC_NONE,
+    FAST_SYNC_AUTO_EVENT,
+    FAST_SYNC_MANUAL_EVENT,
+    FAST_SYNC_SEMAPHORE,
+    FAST_SYNC_MUTEX,
+    FAST_SYNC_COMPLETION
+};
+#define FAST_SYNC_LOCKED    0x80000000
+#define FAST_SYNC_ABANDONED 0x40000000
+
+
+typedef struct
+{
+    unsigned int seq;
+    unsigned int status;
+    apc_param_t  ckey;
+    apc_param_t  cvalue;
+    apc_param_t  information;
+} completion_entry_t;
+
+#define COMPLETION_RING_SIZE 1024
+
+
+typedef struct
+{
+    unsigned int head;
+    unsigned int overflow;
+    unsigned int disabled;
+    unsigned int __pad1[13];
+    unsigned int tail;
+    unsigned int __pad2[15];
+    completion_entry_t entries[COMPLETION_RING_SIZE];
+} completion_ring_t;
+
+
+struct get_fast_sync_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_fast_sync_shm_reply
+{
+    struct reply_header __header;
+    mem_size_t   size;
+};
+
+
+
+struct get_fast_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_fast_sync_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    unsigned int type;
+    unsigned int access;
+    unsigned int serial;
+};
+
+
+
+struct fast_sync_wake_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct fast_sync_wake_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -1793,6 +1880,8 @@ struct enable_socket_event_request
 struct enable_socket_event_reply
 {
     struct reply_header __header;
+    unsigned int state;
+    char __pad_12[4];
 };
 
 struct set_socket_deferred_request
@@ -2146,6 +2235,21 @@ struct get_mapping_info_reply
 
 
 
+struct get_image_reloc_file_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    client_ptr_t base;
+};
+struct get_image_reloc_file_reply
+{
+    struct reply_header __header;
+    obj_handle_t file;
+    char __pad_12[4];
+};
+
+
+
 struct map_view_request
 {
     struct request_header __header;
@@ -2825,8 +2929,79 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
+    unsigned int shm_index;
+};
+
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   input;
+    unsigned int   wake_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_bits;
+    unsigned int   changed_mask;
+    unsigned int   hooks_gen;
+    unsigned int   __pad;
+} queue_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    user_handle_t  focus;
+    user_handle_t  capture;
+    user_handle_t  active;
+} input_shm_t;
+
+
+typedef struct
+{
+    user_handle_t  handle;
+    user_handle_t  parent;
+    user_handle_t  owner;
+    thread_id_t    tid;
+    process_id_t   pid;
+    unsigned int   style;
+    unsigned int   ex_style;
+    unsigned int   dpi;
+    rectangle_t    window;
+    rectangle_t    client;
+    rectangle_t    visible;
+    user_handle_t  first_child;
+    user_handle_t  next_sibling;
+    unsigned int   has_region;
+    unsigned int   __pad;
+} window_shm_t;
+
+#define USER_SHM_MAX_ENTRIES 16384
+#define USER_SHM_MAX_WINDOWS ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
+
+
+typedef struct
+{
+    queue_shm_t    queues[USER_SHM_MAX_ENTRIES];
+    input_shm_t    inputs[USER_SHM_MAX_ENTRIES];
+    unsigned int   window_seq;
+    unsigned int   hooks_gen;
+    unsigned int   __pad[14];
+    window_shm_t   windows[USER_SHM_MAX_WINDOWS];
+} user_shm_t;
+
+
+struct get_user_shm_request
+{
+    struct request_header __header;
     char __pad_12[4];
 };
+struct get_user_shm_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    unsigned int   id;
+    mem_size_t     size;
+};
 
 
 
@@ -4945,6 +5120,34 @@ struct get_object_type_reply
 
 
 
+struct get_handle_info_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+};
+struct get_handle_info_reply
+{
+    struct reply_header __header;
+    unsigned int   access;
+    unsigned int   flags;
+    /* VARARG(type,unicode_str); */
+};
+
+
+
+struct get_handle_cache_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_handle_cache_shm_reply
+{
+    struct reply_header __header;
+    mem_size_t     size;
+};
+
+
+
 struct unlink_object_request
 {
     struct request_header __header;
@@ -5210,6 +5413,8 @@ struct remove_completion_request
 {
     struct request_header __header;
     obj_handle_t handle;
+    int          ring_stalled;
+    char __pad_20[4];
 };
 struct remove_completion_reply
 {
@@ -5237,6 +5442,21 @@ struct query_completion_reply
 
 
 
+struct get_completion_shm_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct get_completion_shm_reply
+{
+    struct reply_header __header;
+    mem_size_t    size;
+    unsigned int  serial;
+    char __pad_20[4];
+};
+
+
+
 struct set_completion_info_request
 {
     struct request_header __header;
@@ -5573,6 +5793,58 @@ struct resume_process_reply
 };
 
 
+#define NB_LATENCY_BUCKETS 24
+
+struct request_stats
+{
+    unsigned int req;
+    unsigned int count;
+    timeout_t    time;
+    unsigned int latency[NB_LATENCY_BUCKETS];
+};
+
+
+struct get_request_stats_request
+{
+    struct request_header __header;
+    process_id_t pid;
+};
+struct get_request_stats_reply
+{
+    struct reply_header __header;
+    data_size_t  total;
+    /* VARARG(stats,request_stats); */
+    char __pad_12[4];
+};
+
+
+
+struct batch_request_header
+{
+    unsigned int   ref_index;
+    data_size_t    ref_offset;
+    data_size_t    ref_reply_offset;
+    unsigned int   __pad;
+};
+
+
+
+
+struct batch_requests_request
+{
+    struct request_header __header;
+    unsigned int   count;
+    /* VARARG(requests,bytes); */
+};
+struct batch_requests_reply
+{
+    struct reply_header __header;
+    unsigned int   count;
+    /* VARARG(replies,bytes); */
+    char __pad_12[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5617,6 +5889,9 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_fast_sync_shm,
+    REQ_get_fast_sync,
+    REQ_fast_sync_wake,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5655,6 +5930,7 @@ enum request
     REQ_create_mapping,
     REQ_open_mapping,
     REQ_get_mapping_info,
+    REQ_get_image_reloc_file,
     REQ_map_view,
     REQ_unmap_view,
     REQ_get_mapping_committed_range,
@@ -5698,6 +5974,7 @@ enum request
     REQ_empty_atom_table,
     REQ_init_atom_table,
     REQ_get_msg_queue,
+    REQ_get_user_shm,
     REQ_set_queue_fd,
     REQ_set_queue_mask,
     REQ_get_queue_status,
@@ -5821,6 +6098,8 @@ enum request
     REQ_query_symlink,
     REQ_get_object_info,
     REQ_get_object_type,
+    REQ_get_handle_info,
+    REQ_get_handle_cache_shm,
     REQ_unlink_object,
     REQ_get_token_impersonation_level,
     REQ_allocate_locally_unique_id,
@@ -5840,6 +6119,7 @@ enum request
     REQ_add_completion,
     REQ_remove_completion,
     REQ_query_completion,
+    REQ_get_completion_shm,
     REQ_set_completion_info,
     REQ_add_fd_completion,
     REQ_set_fd_completion_mode,
@@ -5862,6 +6142,8 @@ enum request
     REQ_terminate_job,
     REQ_suspend_process,
     REQ_resume_process,
+    REQ_get_request_stats,
+    REQ_batch_requests,
     REQ_NB_REQUESTS
 };
 
@@ -5911,6 +6193,9 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_fast_sync_shm_request get_fast_sync_shm_request;
+    struct get_fast_sync_request get_fast_sync_request;
+    struct fast_sync_wake_request fast_sync_wake_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -5949,6 +6234,7 @@ union generic_request
     struct create_mapping_request create_mapping_request;
     struct open_mapping_request open_mapping_request;
     struct get_mapping_info_request get_mapping_info_request;
+    struct get_image_reloc_file_request get_image_reloc_file_request;
     struct map_view_request map_view_request;
     struct unmap_view_request unmap_view_request;
     struct get_mapping_committed_range_request get_mapping_committed_range_request;
@@ -5992,6 +6278,7 @@ union generic_request
     struct empty_atom_table_request empty_atom_table_request;
     struct init_atom_table_request init_atom_table_request;
     struct get_msg_queue_request get_msg_queue_request;
+    struct get_user_shm_request get_user_shm_request;
     struct set_queue_fd_request set_queue_fd_request;
     struct set_queue_mask_request set_queue_mask_request;
     struct get_queue_status_request get_queue_status_request;
@@ -6115,6 +6402,8 @@ union generic_request
     struct query_symlink_request query_symlink_request;
     struct get_object_info_request get_object_info_request;
     struct get_object_type_request get_object_type_request;
+    struct get_handle_info_request get_handle_info_request;
+    struct get_handle_cache_shm_request get_handle_cache_shm_request;
     struct unlink_object_request unlink_object_request;
     struct get_token_impersonation_level_request get_token_impersonation_level_request;
     struct allocate_locally_unique_id_request allocate_locally_unique_id_request;
@@ -6134,6 +6423,7 @@ union generic_request
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
     struct query_completion_request query_completion_request;
+    struct get_completion_shm_request get_completion_shm_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
     struct set_fd_completion_mode_request set_fd_completion_mode_request;
@@ -6156,6 +6446,8 @@ union generic_request
     struct terminate_job_request terminate_job_request;
     struct suspend_process_request suspend_process_request;
     struct resume_process_request resume_process_request;
+    struct get_request_stats_request get_request_stats_request;
+    struct batch_requests_request batch_requests_request;
 };
 union generic_reply
 {
@@ -6203,6 +6495,9 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_fast_sync_shm_reply get_fast_sync_shm_reply;
+    struct get_fast_sync_reply get_fast_sync_reply;
+    struct fast_sync_wake_reply fast_sync_wake_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6241,6 +6536,7 @@ union generic_reply
     struct create_mapping_reply create_mapping_reply;
     struct open_mapping_reply open_mapping_reply;
     struct get_mapping_info_reply get_mapping_info_reply;
+    struct get_image_reloc_file_reply get_image_reloc_file_reply;
     struct map_view_reply map_view_reply;
     struct unmap_view_reply unmap_view_reply;
     struct get_mapping_committed_range_reply get_mapping_committed_range_reply;
@@ -6284,6 +6580,7 @@ union generic_reply
     struct empty_atom_table_reply empty_atom_table_reply;
     struct init_atom_table_reply init_atom_table_reply;
     struct get_msg_queue_reply get_msg_queue_reply;
+    struct get_user_shm_reply get_user_shm_reply;
     struct set_queue_fd_reply set_queue_fd_reply;
     struct set_queue_mask_reply set_queue_mask_reply;
     struct get_queue_status_reply get_queue_status_reply;
@@ -6407,6 +6704,8 @@ union generic_reply
     struct query_symlink_reply query_symlink_reply;
     struct get_object_info_reply get_object_info_reply;
     struct get_object_type_reply get_object_type_reply;
+    struct get_handle_info_reply get_handle_info_reply;
+    struct get_handle_cache_shm_reply get_handle_cache_shm_reply;
     struct unlink_object_reply unlink_object_reply;
     struct get_token_impersonation_level_reply get_token_impersonation_level_reply;
     struct allocate_locally_unique_id_reply allocate_locally_unique_id_reply;
@@ -6426,6 +6725,7 @@ union generic_reply
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
     struct query_completion_reply query_completion_reply;
+    struct get_completion_shm_reply get_completion_shm_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
     struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
@@ -6448,11 +6748,13 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
     struct suspend_process_reply suspend_process_reply;
     struct resume_process_reply resume_process_reply;
+    struct get_request_stats_reply get_request_stats_reply;
+    struct batch_requests_reply batch_requests_reply;
 };
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 626
+#define SERVER_PROTOCOL_VERSION 640
 
 /* ### protocol_version end ### */
 
@@ -26,11 +26,33 @@
  *    + completion handle is waitable, while native isn't
  */
 
+/*
+ * When fast synchronization is enabled (see fast_sync.c), each port also
+ * gets a completion_ring_t in its own shared memory, which is only given to
+ * processes holding a handle with IO_COMPLETION_MODIFY_STATE access. Clients
+ * add and remove packets there directly, and only call the server to block
+ * or when the ring is full. The ring is a bounded multi-producer
+ * multi-consumer queue: the entry at position pos can be filled when its
+ * sequence number is pos, and claimed by a consumer when it is pos + 1; the
+ * consumer sets it to pos + 2 while reading it, then to
+ * pos + COMPLETION_RING_SIZE for the next round.
+ *
+ * The ring is written by the clients only, so the server never relies on
+ * its contents: packets added by the server always go to the server queue,
+ * and the overflow field tells clients about them. The ring state is only
+ * used as a hint to wake up waiting threads. If the ring stays stuck for a
+ * while, for instance because a thread died while adding a packet, the
+ * server disables the ring and moves the packets it can claim to its queue.
+ */
+
 #include "config.h"
 #include "wine/port.h"
 
+#include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -45,9 +67,13 @@
 
 struct completion
 {
-    struct object  obj;
-    struct list    queue;
-    unsigned int   depth;
+    struct object      obj;
+    struct list        queue;
+    unsigned int       depth;    /* number of packets in the server queue */
+    completion_ring_t *ring;     /* shared packet ring, or NULL */
+    int                ring_fd;  /* file descriptor of the ring memory */
+    unsigned int       stall_head; /* ring head when a client first reported it stalled */
+    timeout_t          stall_time; /* time of that report, 0 if none */
 };
 
 static void completion_dump( struct object*, int );
@@ -61,8 +87,8 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     completion_dump,           /* dump */
     completion_get_type,       /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    fast_sync_add_queue,       /* add_queue */
+    fast_sync_remove_queue,    /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
     no_signal,                 /* signal */
@@ -88,6 +114,125 @@ struct comp_msg
     unsigned int  status;
 };
 
+/* each ring uses a file descriptor in the server */
+#define COMPLETION_MAX_RINGS 256
+
+/* how long a ring may stay stalled before the server stops using it */
+#define COMPLETION_RING_STALL_TIMEOUT TICKS_PER_SEC
+
+static unsigned int nb_rings;
+
+/* give a shared ring to a new completion port, if fast synchronization is enabled */
+static void alloc_completion_ring( struct completion *completion )
+{
+    completion_ring_t *ring;
+    unsigned int i;
+    void *ptr;
+    int fd;
+
+    if (!is_fast_sync_enabled() || nb_rings >= COMPLETION_MAX_RINGS) return;
+
+    if ((fd = create_temp_file( sizeof(*ring) )) == -1) return;
+    ptr = mmap( NULL, sizeof(*ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        close( fd );
+        return;
+    }
+    if (!alloc_fast_sync( &completion->obj, FAST_SYNC_COMPLETION, 0, 0 ))
+    {
+        munmap( ptr, sizeof(*ring) );
+        close( fd );
+        return;
+    }
+
+    ring = ptr;
+    for (i = 0; i < COMPLETION_RING_SIZE; i++) ring->entries[i].seq = i;
+    completion->ring    = ring;
+    completion->ring_fd = fd;
+    nb_rings++;
+}
+
+static void free_completion_ring( struct completion *completion )
+{
+    munmap( completion->ring, sizeof(*completion->ring) );
+    close( completion->ring_fd );
+    completion->ring    = NULL;
+    completion->ring_fd = -1;
+    nb_rings--;
+}
+
+/* check if the ring may hold packets; this is only a hint since clients can write anything there */
+static int ring_signaled( completion_ring_t *ring )
+{
+    return __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST ) != __atomic_load_n( &ring->head, __ATOMIC_SEQ_CST );
+}
+
+static unsigned int ring_depth( completion_ring_t *ring )
+{
+    unsigned int head = __atomic_load_n( &ring->head, __ATOMIC_SEQ_CST );
+    unsigned int depth = __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST ) - head;
+    return min( depth, COMPLETION_RING_SIZE );
+}
+
+static void set_overflow( struct completion *completion )
+{
+    if (completion->ring) __atomic_store_n( &completion->ring->overflow, completion->depth, __ATOMIC_SEQ_CST );
+}
+
+/* stop using the ring, and move the packets that are ready to the front of the server queue */
+static void disable_ring( struct completion *completion )
+{
+    completion_ring_t *ring = completion->ring;
+    struct list *prev = &completion->queue;
+    unsigned int i, pos, seq, head, count;
+    completion_entry_t *entry;
+    struct comp_msg *msg = NULL;
+
+    /* clients check this after publishing a packet, and take it back if nobody claimed it */
+    __atomic_store_n( &ring->disabled, 1, __ATOMIC_SEQ_CST );
+
+    head = __atomic_load_n( &ring->head, __ATOMIC_SEQ_CST );
+    count = __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST ) - head;
+    count = min( count, COMPLETION_RING_SIZE );
+    for (i = 0; i < count; i++)
+    {
+        if (!msg && !(msg = mem_alloc( sizeof(*msg) ))) break;
+        pos = head + i;
+        seq = pos + 1;
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        /* claim the entry like a consumer would; a single attempt, since the value may be anything */
+        if (!__atomic_compare_exchange_n( &entry->seq, &seq, pos + 2, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+            continue;
+        msg->ckey        = entry->ckey;
+        msg->cvalue      = entry->cvalue;
+        msg->status      = entry->status;
+        msg->information = entry->information;
+        list_add_after( prev, &msg->queue_entry );
+        prev = &msg->queue_entry;
+        msg = NULL;
+        completion->depth++;
+    }
+    free( msg );
+    free_completion_ring( completion );
+    wake_up( &completion->obj, 0 );
+}
+
+/* a client gave up on the ring; contention can cause that too, so only
+ * disable it if its head hasn't moved for a while, e.g. because a thread
+ * died in the middle of adding a packet */
+static void ring_stalled( struct completion *completion )
+{
+    unsigned int head = __atomic_load_n( &completion->ring->head, __ATOMIC_SEQ_CST );
+
+    if (!completion->stall_time || head != completion->stall_head)
+    {
+        completion->stall_head = head;
+        completion->stall_time = current_time;
+    }
+    else if (current_time - completion->stall_time >= COMPLETION_RING_STALL_TIMEOUT)
+        disable_ring( completion );
+}
 static void completion_destroy( struct object *obj)
 {
     struct completion *completion = (struct completion *) obj;
@@ -97,6 +242,7 @@ static void completion_destroy( struct object *obj)
     {
         free( tmp );
     }
+    if (completion->ring) free_completion_ring( completion );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -104,7 +250,8 @@ static void completion_dump( struct object *obj, int verbose )
     struct completion *completion = (struct completion *) obj;
 
     assert( obj->ops == &completion_ops );
-    fprintf( stderr, "Completion depth=%u\n", completion->depth );
+    fprintf( stderr, "Completion depth=%u ring=%u\n", completion->depth,
+             completion->ring ? ring_depth( completion->ring ) : 0 );
 }
 
 static struct object_type *completion_get_type( struct object *obj )
@@ -118,7 +265,7 @@ static int completion_signaled( struct object *obj, struct wait_queue_entry *ent
 {
     struct completion *completion = (struct completion *)obj;
 
-    return !list_empty( &completion->queue );
+    return !list_empty( &completion->queue ) || (completion->ring && ring_signaled( completion->ring ));
 }
 
 static unsigned int completion_map_access( struct object *obj, unsigned int access )
@@ -142,6 +289,10 @@ static struct completion *create_completion( struct object *root, const struct u
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->ring  = NULL;
+            completion->ring_fd = -1;
+            completion->stall_time = 0;
+            alloc_completion_ring( completion );
         }
     }
 
@@ -156,9 +307,9 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct comp_msg *msg;
 
-    if (!msg)
+    if (!(msg = mem_alloc( sizeof( *msg ) )))
         return;
 
     msg->ckey = ckey;
@@ -168,6 +319,7 @@ void add_completion( struct completion *completion, apc_param_t ckey, apc_param_
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
+    set_overflow( completion );
     wake_up( &completion->obj, 1 );
 }
 
@@ -222,6 +374,8 @@ DECL_HANDLER(remove_completion)
 
     if (!completion) return;
 
+    if (completion->ring && req->ring_stalled) ring_stalled( completion );
+
     entry = list_head( &completion->queue );
     if (!entry)
         set_error( STATUS_PENDING );
@@ -229,6 +383,7 @@ DECL_HANDLER(remove_completion)
     {
         list_remove( entry );
         completion->depth--;
+        set_overflow( completion );
         msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
         reply->ckey = msg->ckey;
         reply->cvalue = msg->cvalue;
@@ -248,6 +403,24 @@ DECL_HANDLER(query_completion)
     if (!completion) return;
 
     reply->depth = completion->depth;
+    if (completion->ring) reply->depth += ring_depth( completion->ring );
 
     release_object( completion );
 }
+
+/* map the ring of a completion port into the client */
+DECL_HANDLER(get_completion_shm)
+{
+    struct completion *completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+
+    if (!completion) return;
+
+    if (!completion->ring) set_error( STATUS_NOT_IMPLEMENTED );
+    else
+    {
+        reply->serial = get_fast_sync_serial( &completion->obj );
+        reply->size   = sizeof(*completion->ring);
+        send_client_fd( current->process, completion->ring_fd, 0 );
+    }
+    release_object( completion );
+}
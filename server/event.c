@@ -41,7 +41,7 @@ struct event
     struct object  obj;             /* object header */
     struct list    kernel_object;   /* list of kernel object pointers */
     int            manual_reset;    /* is it a manual reset event? */
-    int            signaled;        /* event has been signaled */
+    int            signaled;        /* event has been signaled (unless kept in shared memory) */
 };
 
 static void event_dump( struct object *obj, int verbose );
@@ -57,8 +57,8 @@ static const struct object_ops event_ops =
     sizeof(struct event),      /* size */
     event_dump,                /* dump */
     event_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    fast_sync_add_queue,       /* add_queue */
+    fast_sync_remove_queue,    /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
     event_signal,              /* signal */
@@ -124,6 +124,8 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             list_init( &event->kernel_object );
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+            alloc_fast_sync( &event->obj, manual_reset ? FAST_SYNC_MANUAL_EVENT : FAST_SYNC_AUTO_EVENT,
+                             initial_state, 0 );
         }
     }
     return event;
@@ -134,24 +136,49 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
     return (struct event *)get_handle_obj( process, handle, access, &event_ops );
 }
 
+static int get_event_state( struct event *event )
+{
+    fast_sync_t *slot;
+    int state;
+
+    if (!event->obj.fast_sync) return event->signaled;
+    slot = lock_fast_sync( &event->obj );
+    state = get_fast_sync_state( slot ) != 0;
+    unlock_fast_sync( &event->obj );
+    return state;
+}
+
+static void set_event_state( struct event *event, int state )
+{
+    if (event->obj.fast_sync)
+    {
+        set_fast_sync_state( lock_fast_sync( &event->obj ), state );
+        unlock_fast_sync( &event->obj );
+    }
+    else event->signaled = state;
+}
+
 void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    /* keep clients from consuming the pulse */
+    if (event->obj.fast_sync) lock_fast_sync( &event->obj );
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    set_event_state( event, 0 );
+    if (event->obj.fast_sync) unlock_fast_sync( &event->obj );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    set_event_state( event, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
@@ -159,7 +186,7 @@ static void event_dump( struct object *obj, int verbose )
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     fprintf( stderr, "Event manual=%d signaled=%d\n",
-             event->manual_reset, event->signaled );
+             event->manual_reset, get_event_state( event ) );
 }
 
 static struct object_type *event_get_type( struct object *obj )
@@ -173,7 +200,7 @@ static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    return get_event_state( event );
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -181,7 +208,7 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    if (!event->manual_reset) set_event_state( event, 0 );
 }
 
 static unsigned int event_map_access( struct object *obj, unsigned int access )
@@ -322,7 +349,8 @@ DECL_HANDLER(event_op)
     struct event *event;
 
     if (!(event = get_event_obj( current->process, req->handle, EVENT_MODIFY_STATE ))) return;
-    reply->state = event->signaled;
+    if (event->obj.fast_sync) lock_fast_sync( &event->obj );
+    reply->state = get_event_state( event );
     switch(req->op)
     {
     case PULSE_EVENT:
@@ -338,6 +366,7 @@ DECL_HANDLER(event_op)
         set_error( STATUS_INVALID_PARAMETER );
         break;
     }
+    if (event->obj.fast_sync) unlock_fast_sync( &event->obj );
     release_object( event );
 }
 
@@ -349,7 +378,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = get_event_state( event );
 
     release_object( event );
 }
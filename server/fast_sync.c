@@ -0,0 +1,329 @@
+/*
+ * Server-side shared memory synchronization objects
+ *
+ * Copyright (C) 2020 the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When WINEFASTSYNC is set in the environment of the server, the state of
+ * events, mutexes and semaphores is kept in an array of fast_sync_t mapped
+ * into the client. Clients update it with atomic operations as long as
+ * the FAST_SYNC_LOCKED bit is clear, and fall back to a server request
+ * otherwise. The server sets that bit while it evaluates or satisfies a
+ * wait, so that the state cannot change between the signaled() and
+ * satisfied() calls. Blocking waits are still done in the server; the
+ * waiters field tells clients that they need to wake them up.
+ *
+ * Each process has its own array, which holds the objects that it created
+ * and is only mapped into that process. Other processes using the same
+ * objects go through the server, which reads and updates the state in the
+ * creator's array. Since a client can write anything there, the server
+ * never relies on the values it reads back: they are validated by the
+ * object code, and the server keeps its own count of the locks it holds.
+ *
+ * Slots are reused once their object is destroyed, so each slot also holds
+ * the serial number of its object. Clients cache it along with the slot
+ * index, and check it before using the slot.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "object.h"
+#include "file.h"
+#include "handle.h"
+#include "process.h"
+#include "thread.h"
+#include "request.h"
+
+#define FAST_SYNC_MAX_SLOTS 16384  /* per process */
+
+/* server side information about a slot, which clients can't modify */
+struct fast_sync_info
+{
+    unsigned int        lock_count;   /* nesting count of server locks */
+    enum fast_sync_type type;         /* type of the object using the slot */
+    unsigned int        serial;       /* serial number of the object using the slot */
+};
+
+struct fast_sync_area
+{
+    unsigned int           refcount;          /* one for the process, plus one per slot in use */
+    int                    fd;                /* file descriptor of the shared memory */
+    fast_sync_t           *slots;             /* shared array of objects, slot 0 is unused */
+    struct fast_sync_info *info;              /* server side information for each slot */
+    unsigned int          *free_slots;        /* stack of freed slot indices */
+    unsigned int           nb_free_slots;
+    unsigned int           next_unused_slot;
+};
+
+static int fast_sync_enabled = -1;  /* -1 if not initialized yet */
+static unsigned int next_serial;
+
+static const mem_size_t fast_sync_shm_size = FAST_SYNC_MAX_SLOTS * sizeof(fast_sync_t);
+
+static int init_fast_sync(void)
+{
+    const char *env = getenv( "WINEFASTSYNC" );
+
+    fast_sync_enabled = env && atoi( env );
+    return fast_sync_enabled;
+}
+
+/* check if fast synchronization is enabled */
+int is_fast_sync_enabled(void)
+{
+    if (fast_sync_enabled == -1) init_fast_sync();
+    return fast_sync_enabled;
+}
+
+static void free_fast_sync_area( struct fast_sync_area *area )
+{
+    if (area->slots) munmap( area->slots, fast_sync_shm_size );
+    if (area->fd != -1) close( area->fd );
+    free( area->info );
+    free( area->free_slots );
+    free( area );
+}
+
+/* return the shared memory of the objects created by a process, allocating it if needed */
+static struct fast_sync_area *get_fast_sync_area( struct process *process )
+{
+    struct fast_sync_area *area;
+    void *ptr;
+
+    if (process->fast_sync) return process->fast_sync;
+    if (!is_fast_sync_enabled()) return NULL;
+
+    if (!(area = mem_alloc( sizeof(*area) ))) return NULL;
+    area->refcount         = 1;
+    area->slots            = NULL;
+    area->nb_free_slots    = 0;
+    area->next_unused_slot = 1;
+    area->info             = calloc( FAST_SYNC_MAX_SLOTS, sizeof(*area->info) );
+    area->free_slots       = malloc( FAST_SYNC_MAX_SLOTS * sizeof(*area->free_slots) );
+
+    if ((area->fd = create_temp_file( fast_sync_shm_size )) == -1) goto failed;
+    ptr = mmap( NULL, fast_sync_shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, area->fd, 0 );
+    if (ptr == MAP_FAILED) goto failed;
+    area->slots = ptr;
+    if (!area->info || !area->free_slots) goto failed;
+    return process->fast_sync = area;
+
+failed:
+    free_fast_sync_area( area );
+    return NULL;
+}
+
+static void release_fast_sync_area( struct fast_sync_area *area )
+{
+    if (!--area->refcount) free_fast_sync_area( area );
+}
+
+/* release the shared memory of a destroyed process; objects still using it keep it alive */
+void free_process_fast_sync( struct process *process )
+{
+    if (!process->fast_sync) return;
+    release_fast_sync_area( process->fast_sync );
+    process->fast_sync = NULL;
+}
+
+/* allocate a shared slot for a new object in the array of the current process;
+ * return 0 if fast synchronization is not available */
+int alloc_fast_sync( struct object *obj, enum fast_sync_type type, int state, unsigned int count )
+{
+    struct fast_sync_area *area;
+    unsigned int index;
+    fast_sync_t *slot;
+
+    if (!current || !(area = get_fast_sync_area( current->process ))) return 0;
+
+    if (area->nb_free_slots) index = area->free_slots[--area->nb_free_slots];
+    else if (area->next_unused_slot < FAST_SYNC_MAX_SLOTS) index = area->next_unused_slot++;
+    else return 0;
+
+    if (!++next_serial) next_serial++;  /* 0 is never a valid serial */
+
+    area->info[index].type   = type;
+    area->info[index].serial = next_serial;
+    slot = &area->slots[index];
+    slot->count   = count;
+    slot->type    = type;
+    slot->waiters = 0;
+    __atomic_store_n( &slot->state, state, __ATOMIC_SEQ_CST );
+    __atomic_store_n( &slot->serial, next_serial, __ATOMIC_SEQ_CST );
+
+    area->refcount++;
+    obj->fast_sync      = index;
+    obj->fast_sync_area = area;
+    return 1;
+}
+
+/* release the shared slot of a destroyed object */
+void free_fast_sync( struct object *obj )
+{
+    struct fast_sync_area *area = obj->fast_sync_area;
+    fast_sync_t *slot = &area->slots[obj->fast_sync];
+
+    assert( !area->info[obj->fast_sync].lock_count );
+    area->info[obj->fast_sync].type   = FAST_SYNC_NONE;
+    area->info[obj->fast_sync].serial = 0;
+    __atomic_store_n( &slot->serial, 0, __ATOMIC_SEQ_CST );
+    slot->type = FAST_SYNC_NONE;
+    __atomic_store_n( &slot->state, 0, __ATOMIC_SEQ_CST );
+    area->free_slots[area->nb_free_slots++] = obj->fast_sync;
+    obj->fast_sync      = 0;
+    obj->fast_sync_area = NULL;
+    release_fast_sync_area( area );
+}
+
+/* return the serial number of the object using a slot */
+unsigned int get_fast_sync_serial( struct object *obj )
+{
+    return obj->fast_sync_area->info[obj->fast_sync].serial;
+}
+
+/* prevent clients from modifying the state of an object; calls can be nested */
+fast_sync_t *lock_fast_sync( struct object *obj )
+{
+    struct fast_sync_area *area = obj->fast_sync_area;
+    fast_sync_t *slot = &area->slots[obj->fast_sync];
+
+    assert( obj->fast_sync );
+    /* the client may have set the bit itself, our own count is what matters */
+    if (!area->info[obj->fast_sync].lock_count++)
+        __atomic_fetch_or( &slot->state, FAST_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+    return slot;
+}
+
+void unlock_fast_sync( struct object *obj )
+{
+    struct fast_sync_area *area = obj->fast_sync_area;
+    fast_sync_t *slot = &area->slots[obj->fast_sync];
+
+    assert( area->info[obj->fast_sync].lock_count );
+    if (!--area->info[obj->fast_sync].lock_count)
+        __atomic_and_fetch( &slot->state, ~FAST_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+}
+
+/* read the state of a locked object; the caller has to validate it */
+int get_fast_sync_state( const fast_sync_t *slot )
+{
+    return __atomic_load_n( &slot->state, __ATOMIC_SEQ_CST ) & ~FAST_SYNC_LOCKED;
+}
+
+/* update the state of a locked object */
+void set_fast_sync_state( fast_sync_t *slot, int state )
+{
+    __atomic_store_n( &slot->state, state | FAST_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+}
+
+/* add a thread to the wait queue of a fast synchronization object */
+int fast_sync_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    add_queue( obj, entry );
+    if (obj->fast_sync)
+        __atomic_store_n( &obj->fast_sync_area->slots[obj->fast_sync].waiters, 1, __ATOMIC_SEQ_CST );
+    return 1;
+}
+
+/* remove a thread from the wait queue of a fast synchronization object */
+void fast_sync_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    if (obj->fast_sync && list_count( &obj->wait_queue ) == 1)
+        __atomic_store_n( &obj->fast_sync_area->slots[obj->fast_sync].waiters, 0, __ATOMIC_SEQ_CST );
+    remove_queue( obj, entry );
+}
+
+/* map the objects created by the process into the client */
+DECL_HANDLER(get_fast_sync_shm)
+{
+    struct fast_sync_area *area;
+
+    if (!(area = get_fast_sync_area( current->process )))
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    reply->size = fast_sync_shm_size;
+    send_client_fd( current->process, area->fd, 0 );
+}
+
+/* retrieve the shared slot of an object */
+DECL_HANDLER(get_fast_sync)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    /* objects created by other processes are not mapped into this one */
+    if (obj->fast_sync && obj->fast_sync_area == current->process->fast_sync)
+    {
+        reply->index  = obj->fast_sync;
+        reply->type   = obj->fast_sync_area->info[obj->fast_sync].type;
+        reply->access = get_handle_access( current->process, req->handle );
+        reply->serial = obj->fast_sync_area->info[obj->fast_sync].serial;
+    }
+    release_object( obj );
+}
+
+/* return the access needed to wake up the waiters of an object, 0 if not allowed */
+static unsigned int get_fast_sync_wake_access( struct object *obj )
+{
+    if (!obj->fast_sync) return 0;
+
+    /* the client needs the same access as for the update that it made */
+    switch (obj->fast_sync_area->info[obj->fast_sync].type)
+    {
+    case FAST_SYNC_AUTO_EVENT:
+    case FAST_SYNC_MANUAL_EVENT:
+        return EVENT_MODIFY_STATE;
+    case FAST_SYNC_SEMAPHORE:
+        return SEMAPHORE_MODIFY_STATE;
+    case FAST_SYNC_COMPLETION:
+        return IO_COMPLETION_MODIFY_STATE;
+    default:  /* mutexes are only released to other threads by the server */
+        return 0;
+    }
+}
+
+/* wake up the threads waiting on an object after a client-side update */
+DECL_HANDLER(fast_sync_wake)
+{
+    struct object *obj;
+    unsigned int access;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    if (!(access = get_fast_sync_wake_access( obj )))
+        set_error( STATUS_OBJECT_TYPE_MISMATCH );
+    else if ((get_handle_access( current->process, req->handle ) & access) != access)
+        set_error( STATUS_ACCESS_DENIED );
+    else  /* a completion packet can only be removed by one thread */
+        wake_up( obj, obj->fast_sync_area->info[obj->fast_sync].type == FAST_SYNC_COMPLETION ? 1 : 0 );
+    release_object( obj );
+}
@@ -597,7 +597,9 @@ static inline void main_loop_epoll(void)
         if (!active_users) break;  /* last user removed by a timeout */
         if (epoll_fd == -1) break;  /* an error occurred with epoll */
 
+        unlock_server();
         ret = epoll_wait( epoll_fd, events, ARRAY_SIZE( events ), timeout );
+        lock_server();
         set_current_time();
 
         /* put the events into the pollfd array first, like poll does */
@@ -702,6 +704,7 @@ static inline void main_loop_epoll(void)
         if (!active_users) break;  /* last user removed by a timeout */
         if (kqueue_fd == -1) break;  /* an error occurred with kqueue */
 
+        unlock_server();
         if (timeout != -1)
         {
             struct timespec ts;
@@ -711,6 +714,7 @@ static inline void main_loop_epoll(void)
             ret = kevent( kqueue_fd, NULL, 0, events, ARRAY_SIZE( events ), &ts );
         }
         else ret = kevent( kqueue_fd, NULL, 0, events, ARRAY_SIZE( events ), NULL );
+        lock_server();
 
         set_current_time();
 
@@ -806,6 +810,7 @@ static inline void main_loop_epoll(void)
         if (!active_users) break;  /* last user removed by a timeout */
         if (port_fd == -1) break;  /* an error occurred with event completion */
 
+        unlock_server();
         if (timeout != -1)
         {
             struct timespec ts;
@@ -815,6 +820,7 @@ static inline void main_loop_epoll(void)
             ret = port_getn( port_fd, events, ARRAY_SIZE( events ), &nget, &ts );
         }
         else ret = port_getn( port_fd, events, ARRAY_SIZE( events ), &nget, NULL );
+        lock_server();
 
 	if (ret == -1) break;  /* an error occurred with event completion */
 
@@ -986,7 +992,9 @@ void main_loop(void)
 
         if (!active_users) break;  /* last user removed by a timeout */
 
+        unlock_server();
         ret = poll( pollfd, nb_users, timeout );
+        lock_server();
         set_current_time();
 
         if (ret > 0)
@@ -172,8 +172,10 @@ extern struct file *get_mapping_file( struct process *process, client_ptr_t base
 extern const pe_image_info_t *get_mapping_image_info( struct process *process, client_ptr_t base );
 extern void free_mapped_views( struct process *process );
 extern int get_page_size(void);
+extern int create_temp_file( file_pos_t size );
 extern struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                                 unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_shared_mapping( mem_size_t size, void **ptr );
 
 /* device functions */
 
@@ -27,12 +27,15 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
 #include "windef.h"
 #include "winternl.h"
 
+#include "file.h"
 #include "handle.h"
 #include "process.h"
 #include "thread.h"
@@ -53,6 +56,8 @@ struct handle_table
     int                  last;        /* last used entry */
     int                  free;        /* first entry that may be free */
     struct handle_entry *entries;     /* handle entries */
+    int                  cache_fd;    /* fd of the client handle cache generation */
+    unsigned int        *cache_gen;   /* generation shared with the client handle cache */
 };
 
 static struct handle_table *global_table;
@@ -187,6 +192,14 @@ static void handle_table_destroy( struct object *obj )
         if (obj) release_object_from_handle( obj );
     }
     free( table->entries );
+    if (table->cache_gen) munmap( table->cache_gen, sizeof(*table->cache_gen) );
+    if (table->cache_fd != -1) close( table->cache_fd );
+}
+
+/* invalidate the information the client has cached about its handles */
+static void invalidate_handle_cache( struct handle_table *table )
+{
+    if (table && table->cache_gen) __atomic_add_fetch( table->cache_gen, 1, __ATOMIC_SEQ_CST );
 }
 
 /* close all the process handles and free the handle table */
@@ -210,6 +223,8 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
     table->count   = count;
     table->last    = -1;
     table->free    = 0;
+    table->cache_fd  = -1;
+    table->cache_gen = NULL;
     if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
     release_object( table );
     return NULL;
@@ -384,7 +399,7 @@ struct handle_table *copy_handle_table( struct process *process, struct process
 }
 
 /* close a handle and decrement the refcount of the associated object */
-unsigned int close_handle( struct process *process, obj_handle_t handle )
+static unsigned int do_close_handle( struct process *process, obj_handle_t handle )
 {
     struct handle_table *table;
     struct handle_entry *entry;
@@ -402,6 +417,15 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     return STATUS_SUCCESS;
 }
 
+/* close a handle without the client knowing about it */
+unsigned int close_handle( struct process *process, obj_handle_t handle )
+{
+    unsigned int ret = do_close_handle( process, handle );
+
+    if (!ret && !handle_is_global( handle )) invalidate_handle_cache( process->handles );
+    return ret;
+}
+
 /* retrieve the object corresponding to one of the magic pseudo-handles */
 static inline struct object *get_magic_handle( obj_handle_t handle )
 {
@@ -571,6 +595,7 @@ obj_handle_t duplicate_handle( struct process *src, obj_handle_t src_handle, str
             if (attr & OBJ_INHERIT) access |= RESERVED_INHERIT;
             entry->access = access;
             res = src_handle;
+            invalidate_handle_cache( src->handles );
         }
         else
             res = alloc_handle_entry( dst, obj, access, attr );
@@ -622,7 +647,7 @@ unsigned int get_handle_table_count( struct process *process )
 /* close a handle */
 DECL_HANDLER(close_handle)
 {
-    unsigned int err = close_handle( current->process, req->handle );
+    unsigned int err = do_close_handle( current->process, req->handle );
     set_error( err );
 }
 
@@ -653,7 +678,12 @@ DECL_HANDLER(dup_handle)
         }
         /* close the handle no matter what happened */
         if ((req->options & DUP_HANDLE_CLOSE_SOURCE) && (src != dst || req->src_handle != reply->handle))
-            reply->closed = !close_handle( src, req->src_handle );
+        {
+            if (src == current->process)  /* the client updates its cache itself */
+                reply->closed = !do_close_handle( src, req->src_handle );
+            else
+                reply->closed = !close_handle( src, req->src_handle );
+        }
         reply->self = (src == current->process);
         release_object( src );
     }
@@ -674,6 +704,52 @@ DECL_HANDLER(get_object_info)
     release_object( obj );
 }
 
+/* query the handle information cached on the client side */
+DECL_HANDLER(get_handle_info)
+{
+    struct object *obj;
+    struct object_type *type;
+    const WCHAR *name;
+    data_size_t len;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    reply->access = get_handle_access( current->process, req->handle );
+    reply->flags  = set_handle_flags( current->process, req->handle, 0, 0 );
+    if ((type = obj->ops->get_type( obj )))
+    {
+        if ((name = get_object_name( (struct object *)type, &len )))
+            set_reply_data( name, min( len, get_reply_max_size() ));
+        release_object( type );
+    }
+    release_object( obj );
+}
+
+/* map the handle cache generation into the client */
+DECL_HANDLER(get_handle_cache_shm)
+{
+    struct handle_table *table = current->process->handles;
+    void *ptr;
+    int fd;
+
+    if (!table) return;
+    if (table->cache_fd == -1)
+    {
+        if ((fd = create_temp_file( sizeof(*table->cache_gen) )) == -1) return;
+        ptr = mmap( NULL, sizeof(*table->cache_gen), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        if (ptr == MAP_FAILED)
+        {
+            file_set_error();
+            close( fd );
+            return;
+        }
+        table->cache_fd  = fd;
+        table->cache_gen = ptr;
+    }
+    reply->size = sizeof(*table->cache_gen);
+    send_client_fd( current->process, table->cache_fd, 0 );
+}
+
 DECL_HANDLER(set_security_object)
 {
     data_size_t sd_size = get_req_data_size();
@@ -126,6 +126,13 @@ static struct hook_table *get_global_hooks( struct thread *thread )
     return table;
 }
 
+/* let the threads of a desktop know that their active hooks may have changed, see get_message */
+static void hooks_changed( struct desktop *desktop )
+{
+    if (desktop->shm)
+        __atomic_store_n( &desktop->shm->hooks_gen, desktop->shm->hooks_gen + 1, __ATOMIC_RELEASE );
+}
+
 /* create a new hook and add it to the specified table */
 static struct hook *add_hook( struct desktop *desktop, struct thread *thread, int index, int global )
 {
@@ -150,6 +157,7 @@ static struct hook *add_hook( struct desktop *desktop, struct thread *thread, in
     hook->index  = index;
     list_add_head( &table->hooks[index], &hook->chain );
     if (thread) thread->desktop_users++;
+    hooks_changed( desktop );
     return hook;
 }
 
@@ -324,7 +332,8 @@ static void release_hook_chain( struct hook_table *table, int index )
 void remove_thread_hooks( struct thread *thread )
 {
     struct hook_table *global_hooks = get_global_hooks( thread );
-    int index;
+    struct desktop *desktop;
+    int index, removed = 0;
 
     if (!global_hooks) return;
 
@@ -335,10 +344,19 @@ void remove_thread_hooks( struct thread *thread )
         while (hook)
         {
             struct hook *next = HOOK_ENTRY( list_next( &global_hooks->hooks[index], &hook->chain ) );
-            if (hook->thread == thread) remove_hook( hook );
+            if (hook->thread == thread)
+            {
+                remove_hook( hook );
+                removed = 1;
+            }
             hook = next;
         }
     }
+    if (removed && (desktop = get_thread_desktop( thread, 0 )))
+    {
+        hooks_changed( desktop );
+        release_object( desktop );
+    }
 }
 
 /* get a bitmap of active hooks in a hook table */
@@ -477,6 +495,7 @@ done:
 /* remove a window hook */
 DECL_HANDLER(remove_hook)
 {
+    struct desktop *desktop;
     struct hook *hook;
 
     if (req->handle)
@@ -501,6 +520,11 @@ DECL_HANDLER(remove_hook)
         }
     }
     remove_hook( hook );
+    if ((desktop = get_thread_desktop( current, 0 )))
+    {
+        hooks_changed( desktop );
+        release_object( desktop );
+    }
     reply->active_hooks = get_active_hooks();
 }
 
@@ -40,6 +40,8 @@
 /* command-line options */
 int debug_level = 0;
 int foreground = 0;
+int nb_worker_threads = 0;
+static int show_request_stats = 0;
 timeout_t master_socket_timeout = 3 * -TICKS_PER_SEC;  /* master socket timeout, default is 3 seconds */
 const char *server_argv0;
 
@@ -54,6 +56,8 @@ static void usage( FILE *fh )
     fprintf(fh, "   -h,    --help            display this help message\n");
     fprintf(fh, "   -k[n], --kill[=n]        kill the current wineserver, optionally with signal n\n");
     fprintf(fh, "   -p[n], --persistent[=n]  make server persistent, optionally for n seconds\n");
+    fprintf(fh, "   -s,    --stats           print request statistics on exit\n");
+    fprintf(fh, "   -t n,  --threads=n       handle read-only requests on n worker threads\n");
     fprintf(fh, "   -v,    --version         display version information and exit\n");
     fprintf(fh, "   -w,    --wait            wait until the current wineserver terminates\n");
     fprintf(fh, "\n");
@@ -70,6 +74,8 @@ static void parse_args( int argc, char *argv[] )
         {"help",        0, NULL, 'h'},
         {"kill",        2, NULL, 'k'},
         {"persistent",  2, NULL, 'p'},
+        {"stats",       0, NULL, 's'},
+        {"threads",     1, NULL, 't'},
         {"version",     0, NULL, 'v'},
         {"wait",        0, NULL, 'w'},
         { NULL,         0, NULL, 0}
@@ -77,7 +83,7 @@ static void parse_args( int argc, char *argv[] )
 
     server_argv0 = argv[0];
 
-    while ((optc = getopt_long( argc, argv, "d::fhk::p::vw", long_options, NULL )) != -1)
+    while ((optc = getopt_long( argc, argv, "d::fhk::p::st:vw", long_options, NULL )) != -1)
     {
         switch(optc)
         {
@@ -106,6 +112,12 @@ static void parse_args( int argc, char *argv[] )
                 else
                     master_socket_timeout = TIMEOUT_INFINITE;
                 break;
+            case 's':
+                show_request_stats = 1;
+                break;
+            case 't':
+                nb_worker_threads = atoi( optarg );
+                break;
             case 'v':
                 fprintf( stderr, "%s\n", PACKAGE_STRING );
                 exit(0);
@@ -141,10 +153,12 @@ int main( int argc, char *argv[] )
     open_master_socket();
 
     if (debug_level) fprintf( stderr, "wineserver: starting (pid=%ld)\n", (long) getpid() );
+    if (show_request_stats) atexit( dump_request_stats );
     set_current_time();
     init_signals();
     init_directories();
     init_registry();
+    start_request_workers();
     main_loop();
     return 0;
 }
@@ -120,6 +120,48 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* copy of a PE image relocated to a given base address, laid out as it is mapped in memory */
+struct reloc_map
+{
+    struct object   obj;             /* object header */
+    struct fd      *fd;              /* file descriptor of the mapped PE file */
+    client_ptr_t    base;            /* base address the image is relocated to */
+    struct file    *file;            /* temp file holding the relocated image */
+    struct list     entry;           /* entry in global relocated maps list */
+    struct stat     st;              /* status of the PE file when the copy was made */
+};
+
+/* images larger than this are left to the client loader, to bound the time spent in the request */
+#define RELOC_MAP_MAX_SIZE (16 * 1024 * 1024)
+
+static void reloc_map_dump( struct object *obj, int verbose );
+static void reloc_map_destroy( struct object *obj );
+
+static const struct object_ops reloc_map_ops =
+{
+    sizeof(struct reloc_map),  /* size */
+    reloc_map_dump,            /* dump */
+    no_get_type,               /* get_type */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    no_map_access,             /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_kernel_obj_list,        /* get_kernel_obj_list */
+    no_close_handle,           /* close_handle */
+    reloc_map_destroy          /* destroy */
+};
+
+static struct list reloc_map_list = LIST_INIT( reloc_map_list );
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -127,6 +169,7 @@ struct memory_view
     struct fd      *fd;              /* fd for mapped file */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct reloc_map *reloc;         /* relocated copy of the PE image */
     pe_image_info_t image;           /* image info (for PE image mapping) */
     unsigned int    flags;           /* SEC_* flags */
     client_ptr_t    base;            /* view base address (in process addr space) */
@@ -143,6 +186,7 @@ struct mapping
     pe_image_info_t image;           /* image info (for PE image mapping) */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct reloc_map *reloc;         /* last relocated copy of the PE image */
 };
 
 static void mapping_dump( struct object *obj, int verbose );
@@ -222,6 +266,22 @@ static void shared_map_destroy( struct object *obj )
     list_remove( &shared->entry );
 }
 
+static void reloc_map_dump( struct object *obj, int verbose )
+{
+    struct reloc_map *reloc = (struct reloc_map *)obj;
+    fprintf( stderr, "Relocated mapping fd=%p base=%08x%08x file=%p\n", reloc->fd,
+             (unsigned int)(reloc->base >> 32), (unsigned int)reloc->base, reloc->file );
+}
+
+static void reloc_map_destroy( struct object *obj )
+{
+    struct reloc_map *reloc = (struct reloc_map *)obj;
+
+    release_object( reloc->fd );
+    release_object( reloc->file );
+    list_remove( &reloc->entry );
+}
+
 /* extend a file beyond the current end of file */
 static int grow_file( int unix_fd, file_pos_t new_size )
 {
@@ -264,7 +324,7 @@ static int check_current_dir_for_exec(void)
 }
 
 /* create a temp file for anonymous mappings */
-static int create_temp_file( file_pos_t size )
+int create_temp_file( file_pos_t size )
 {
     static int temp_dir_fd = -1;
     char tmpfn[] = "anonmap.XXXXXX";
@@ -318,6 +378,7 @@ static void free_memory_view( struct memory_view *view )
     if (view->fd) release_object( view->fd );
     if (view->committed) release_object( view->committed );
     if (view->shared) release_object( view->shared );
+    if (view->reloc) release_object( view->reloc );
     list_remove( &view->entry );
     free( view );
 }
@@ -527,6 +588,217 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     return 0;
 }
 
+/* read image data from a file, a partial sector at EOF is not an error */
+static int read_image_data( int fd, char *buffer, size_t size, off_t pos )
+{
+    size_t toread = size;
+
+    while (toread)
+    {
+        long res = pread( fd, buffer + size - toread, toread, pos );
+        if (!res && toread < 0x200) break;
+        if (res <= 0) return 0;
+        toread -= res;
+        pos += res;
+    }
+    return 1;
+}
+
+/* apply the base relocations to an image laid out in memory */
+static int relocate_image( char *ptr, mem_size_t size, const IMAGE_DATA_DIRECTORY *dir, file_pos_t delta )
+{
+    const IMAGE_BASE_RELOCATION *rel;
+    const USHORT *relocs;
+    mem_size_t pos, end, offset;
+    unsigned int i, count;
+
+    if (dir->VirtualAddress >= size || dir->Size > size - dir->VirtualAddress) return 0;
+
+    for (pos = dir->VirtualAddress, end = pos + dir->Size; pos + sizeof(*rel) <= end; pos += rel->SizeOfBlock)
+    {
+        rel = (const IMAGE_BASE_RELOCATION *)(ptr + pos);
+        if (!rel->SizeOfBlock) break;
+        if (rel->SizeOfBlock < sizeof(*rel) || rel->SizeOfBlock > end - pos) return 0;
+        if (rel->VirtualAddress >= size) return 0;
+
+        relocs = (const USHORT *)(rel + 1);
+        count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+        for (i = 0; i < count; i++)
+        {
+            offset = rel->VirtualAddress + (relocs[i] & 0xfff);
+            switch (relocs[i] >> 12)
+            {
+            case IMAGE_REL_BASED_ABSOLUTE:
+                break;
+            case IMAGE_REL_BASED_HIGH:
+                if (offset + sizeof(short) > size) return 0;
+                *(short *)(ptr + offset) += HIWORD(delta);
+                break;
+            case IMAGE_REL_BASED_LOW:
+                if (offset + sizeof(short) > size) return 0;
+                *(short *)(ptr + offset) += LOWORD(delta);
+                break;
+            case IMAGE_REL_BASED_HIGHLOW:
+                if (offset + sizeof(int) > size) return 0;
+                *(int *)(ptr + offset) += delta;
+                break;
+            case IMAGE_REL_BASED_DIR64:
+                if (offset + sizeof(INT64) > size) return 0;
+                *(INT64 *)(ptr + offset) += delta;
+                break;
+            default:
+                /* leave the machine specific types to the client loader */
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* allocate and fill the temp file for a PE image mapping relocated to a new base */
+static struct reloc_map *build_reloc_mapping( struct mapping *mapping, client_ptr_t base,
+                                              const struct stat *st )
+{
+    IMAGE_SECTION_HEADER sec[96];
+    IMAGE_DOS_HEADER *dos;
+    IMAGE_FILE_HEADER *hdr;
+    IMAGE_OPTIONAL_HEADER32 *opt32;
+    IMAGE_OPTIONAL_HEADER64 *opt64;
+    IMAGE_DATA_DIRECTORY *dir;
+    struct reloc_map *reloc = NULL;
+    struct file *file;
+    mem_size_t size = mapping->image.map_size;
+    size_t header_size, map_size, file_size, pos;
+    off_t file_start;
+    unsigned int i;
+    int unix_fd, reloc_fd;
+    char *ptr;
+
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1) return NULL;
+    header_size = min( mapping->image.header_size, size );
+
+    if ((reloc_fd = create_temp_file( size )) == -1) return NULL;
+    if (!(file = create_file_for_fd( reloc_fd, FILE_GENERIC_READ|FILE_GENERIC_WRITE, 0 ))) return NULL;
+    if ((ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, reloc_fd, 0 )) == MAP_FAILED)
+    {
+        release_object( file );
+        return NULL;
+    }
+
+    /* locate the headers */
+
+    if (!read_image_data( unix_fd, ptr, header_size, 0 )) goto done;
+    dos = (IMAGE_DOS_HEADER *)ptr;
+    pos = dos->e_lfanew + sizeof(DWORD);
+    if (dos->e_lfanew >= header_size || pos + sizeof(*hdr) > header_size) goto done;
+    hdr = (IMAGE_FILE_HEADER *)(ptr + pos);
+    pos += sizeof(*hdr);
+    if (pos + hdr->SizeOfOptionalHeader + hdr->NumberOfSections * sizeof(*sec) > header_size) goto done;
+    if (hdr->NumberOfSections > ARRAY_SIZE( sec )) goto done;
+    memcpy( sec, ptr + pos + hdr->SizeOfOptionalHeader, hdr->NumberOfSections * sizeof(*sec) );
+
+    opt32 = (IMAGE_OPTIONAL_HEADER32 *)(ptr + pos);
+    opt64 = (IMAGE_OPTIONAL_HEADER64 *)(ptr + pos);
+    switch (opt32->Magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        if (hdr->SizeOfOptionalHeader < sizeof(*opt32)) goto done;
+        if (opt32->NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) goto done;
+        if (base > 0xffffffff) goto done;
+        dir = &opt32->DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        if (hdr->SizeOfOptionalHeader < sizeof(*opt64)) goto done;
+        if (opt64->NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) goto done;
+        dir = &opt64->DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        break;
+    default:
+        goto done;
+    }
+    /* nothing to share if the image doesn't need relocating */
+    if (!dir->VirtualAddress || !dir->Size) goto done;
+
+    /* copy the sections to their virtual address */
+
+    for (i = 0; i < hdr->NumberOfSections; i++)
+    {
+        get_section_sizes( &sec[i], &map_size, &file_start, &file_size );
+        if (sec[i].VirtualAddress >= size || map_size > size - sec[i].VirtualAddress) goto done;
+        if (!sec[i].PointerToRawData || !file_size) continue;
+        if (!read_image_data( unix_fd, ptr + sec[i].VirtualAddress, file_size, file_start )) goto done;
+    }
+
+    if (!relocate_image( ptr, size, dir, base - mapping->image.base )) goto done;
+
+    /* the loader checks the header base to find out whether the image still needs relocating */
+    if (opt32->Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) opt64->ImageBase = base;
+    else opt32->ImageBase = base;
+
+    if (!(reloc = alloc_object( &reloc_map_ops ))) goto done;
+    reloc->fd = (struct fd *)grab_object( mapping->fd );
+    reloc->base = base;
+    reloc->file = (struct file *)grab_object( file );
+    reloc->st = *st;
+    list_add_head( &reloc_map_list, &reloc->entry );
+
+done:
+    munmap( ptr, size );
+    release_object( file );
+    return reloc;
+}
+
+/* check that the PE file didn't change since a relocated copy was made from it */
+static int is_reloc_map_current( const struct reloc_map *reloc, const struct stat *st )
+{
+    if (reloc->st.st_size != st->st_size) return 0;
+    if (reloc->st.st_mtime != st->st_mtime || reloc->st.st_ctime != st->st_ctime) return 0;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    if (reloc->st.st_mtim.tv_nsec != st->st_mtim.tv_nsec) return 0;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    if (reloc->st.st_mtimespec.tv_nsec != st->st_mtimespec.tv_nsec) return 0;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_CTIM
+    if (reloc->st.st_ctim.tv_nsec != st->st_ctim.tv_nsec) return 0;
+#elif defined(HAVE_STRUCT_STAT_ST_CTIMESPEC)
+    if (reloc->st.st_ctimespec.tv_nsec != st->st_ctimespec.tv_nsec) return 0;
+#endif
+    return 1;
+}
+
+/* find or build the relocated copy of a PE image mapping for a given base address */
+static struct reloc_map *get_reloc_mapping( struct mapping *mapping, client_ptr_t base )
+{
+    struct reloc_map *reloc, *next;
+    struct stat st;
+    int unix_fd;
+
+    if (!(mapping->flags & SEC_IMAGE) || !mapping->fd) return NULL;
+    if (base == mapping->image.base || (base & page_mask)) return NULL;
+    /* the loader only relocates dlls, executables are loaded at their preferred base */
+    if (!(mapping->image.image_charact & IMAGE_FILE_DLL)) return NULL;
+    if (mapping->image.image_charact & IMAGE_FILE_RELOCS_STRIPPED) return NULL;
+    if (mapping->image.image_flags & (IMAGE_FLAGS_ImageMappedFlat | IMAGE_FLAGS_ComPlusILOnly)) return NULL;
+    /* relocations in shared sections would have to be applied to the shared data */
+    if (mapping->shared) return NULL;
+    if (mapping->image.map_size > RELOC_MAP_MAX_SIZE) return NULL;
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1 || fstat( unix_fd, &st ) == -1) return NULL;
+
+    LIST_FOR_EACH_ENTRY_SAFE( reloc, next, &reloc_map_list, struct reloc_map, entry )
+    {
+        if (!is_same_file_fd( reloc->fd, mapping->fd )) continue;
+        if (!is_reloc_map_current( reloc, &st ))
+        {
+            /* the file was modified, don't hand out the old copy anymore */
+            list_remove( &reloc->entry );
+            list_init( &reloc->entry );
+            continue;
+        }
+        if (reloc->base == base) return (struct reloc_map *)grab_object( reloc );
+    }
+
+    return build_reloc_mapping( mapping, base, &st );
+}
+
 /* load the CLR header from its section */
 static int load_clr_header( IMAGE_COR20_HEADER *hdr, size_t va, size_t size, int unix_fd,
                             IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
@@ -803,6 +1075,7 @@ static struct mapping *create_mapping( struct object *root, const struct unicode
     mapping->size        = size;
     mapping->fd          = NULL;
     mapping->shared      = NULL;
+    mapping->reloc       = NULL;
     mapping->committed   = NULL;
 
     if (!(mapping->flags = get_mapping_flags( handle, flags ))) goto error;
@@ -942,6 +1215,7 @@ static void mapping_destroy( struct object *obj )
     if (mapping->fd) release_object( mapping->fd );
     if (mapping->committed) release_object( mapping->committed );
     if (mapping->shared) release_object( mapping->shared );
+    if (mapping->reloc) release_object( mapping->reloc );
 }
 
 static enum server_fd_type mapping_get_fd_type( struct fd *fd )
@@ -972,6 +1246,22 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     return &mapping->obj;
 }
 
+/* create an anonymous section shared between the server and the clients */
+struct object *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( NULL, NULL, 0, size, SEC_COMMIT, 0,
+                                    FILE_READ_DATA | FILE_WRITE_DATA, NULL ))) return NULL;
+    *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (*ptr == MAP_FAILED)
+    {
+        release_object( mapping );
+        return NULL;
+    }
+    return &mapping->obj;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
@@ -1031,6 +1321,24 @@ DECL_HANDLER(get_mapping_info)
     release_object( mapping );
 }
 
+/* get a copy of an image mapping relocated to a given base address */
+DECL_HANDLER(get_image_reloc_file)
+{
+    struct mapping *mapping;
+    struct reloc_map *reloc;
+
+    if (!(mapping = get_mapping_obj( current->process, req->handle, SECTION_MAP_READ ))) return;
+
+    if ((reloc = get_reloc_mapping( mapping, req->base )))
+    {
+        /* keep it around until the view is mapped */
+        if (mapping->reloc) release_object( mapping->reloc );
+        mapping->reloc = reloc;
+        reply->file = alloc_handle( current->process, reloc->file, GENERIC_READ, 0 );
+    }
+    release_object( mapping );
+}
+
 /* add a memory view in the current process */
 DECL_HANDLER(map_view)
 {
@@ -1079,9 +1387,12 @@ DECL_HANDLER(map_view)
         view->fd        = !is_fd_removable( mapping->fd ) ? (struct fd *)grab_object( mapping->fd ) : NULL;
         view->committed = mapping->committed ? (struct ranges *)grab_object( mapping->committed ) : NULL;
         view->shared    = mapping->shared ? (struct shared_map *)grab_object( mapping->shared ) : NULL;
+        view->reloc     = NULL;
         if (mapping->flags & SEC_IMAGE)
         {
             view->image = mapping->image;
+            if (mapping->reloc && mapping->reloc->base == view->base)
+                view->reloc = (struct reloc_map *)grab_object( mapping->reloc );
             if (view->base != mapping->image.base) set_error( STATUS_IMAGE_NOT_AT_BASE );
         }
         list_add_tail( &current->process->views, &view->entry );
@@ -58,8 +58,8 @@ static const struct object_ops mutex_ops =
     sizeof(struct mutex),      /* size */
     mutex_dump,                /* dump */
     mutex_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    fast_sync_add_queue,       /* add_queue */
+    fast_sync_remove_queue,    /* remove_queue */
     mutex_signaled,            /* signaled */
     mutex_satisfied,           /* satisfied */
     mutex_signal,              /* signal */
@@ -77,14 +77,62 @@ static const struct object_ops mutex_ops =
 };
 
 
+/* return the thread id of the mutex owner, or 0 if not owned; clients never
+ * change the owner of a mutex kept in shared memory, only its recursion count */
+static thread_id_t get_mutex_owner( struct mutex *mutex )
+{
+    return mutex->owner ? mutex->owner->id : 0;
+}
+
+/* read the recursion count of a mutex kept in shared memory; the client may have
+ * stored anything there, but an owned mutex has to be released at least once */
+static unsigned int get_fast_mutex_count( struct mutex *mutex, const fast_sync_t *slot )
+{
+    unsigned int count = __atomic_load_n( &slot->count, __ATOMIC_SEQ_CST );
+
+    if (!mutex->owner) return 0;
+    return count ? min( count, MAXLONG ) : 1;
+}
+
+static unsigned int get_mutex_count( struct mutex *mutex )
+{
+    unsigned int count;
+
+    if (!mutex->obj.fast_sync) return mutex->count;
+    count = get_fast_mutex_count( mutex, lock_fast_sync( &mutex->obj ));
+    unlock_fast_sync( &mutex->obj );
+    return count;
+}
+
+static int is_mutex_abandoned( struct mutex *mutex )
+{
+    fast_sync_t *slot;
+    int abandoned;
+
+    if (!mutex->obj.fast_sync) return mutex->abandoned;
+    slot = lock_fast_sync( &mutex->obj );
+    abandoned = !!(get_fast_sync_state( slot ) & FAST_SYNC_ABANDONED);
+    unlock_fast_sync( &mutex->obj );
+    return abandoned;
+}
+
 /* grab a mutex for a given thread */
 static void do_grab( struct mutex *mutex, struct thread *thread )
 {
-    assert( !mutex->count || (mutex->owner == thread) );
+    assert( !mutex->owner || (mutex->owner == thread) );
+
+    if (mutex->obj.fast_sync)
+    {
+        fast_sync_t *slot = lock_fast_sync( &mutex->obj );
 
-    if (!mutex->count++)  /* FIXME: avoid wrap-around */
+        slot->count = get_fast_mutex_count( mutex, slot ) + 1;  /* FIXME: avoid wrap-around */
+        set_fast_sync_state( slot, thread->id );
+        unlock_fast_sync( &mutex->obj );
+    }
+    else mutex->count++;  /* FIXME: avoid wrap-around */
+
+    if (!mutex->owner)
     {
-        assert( !mutex->owner );
         mutex->owner = thread;
         list_add_head( &thread->mutex_list, &mutex->entry );
     }
@@ -93,13 +141,39 @@ static void do_grab( struct mutex *mutex, struct thread *thread )
 /* release a mutex once the recursion count is 0 */
 static void do_release( struct mutex *mutex )
 {
-    assert( !mutex->count );
+    if (mutex->obj.fast_sync)
+    {
+        fast_sync_t *slot = lock_fast_sync( &mutex->obj );
+        slot->count = 0;
+        set_fast_sync_state( slot, mutex->abandoned ? FAST_SYNC_ABANDONED : 0 );
+        mutex->abandoned = 0;
+        unlock_fast_sync( &mutex->obj );
+    }
+    else assert( !mutex->count );
+
     /* remove the mutex from the thread list of owned mutexes */
     list_remove( &mutex->entry );
     mutex->owner = NULL;
     wake_up( &mutex->obj, 0 );
 }
 
+/* decrement the recursion count of an owned mutex, return the previous count */
+static unsigned int release_mutex_once( struct mutex *mutex )
+{
+    unsigned int prev;
+
+    if (mutex->obj.fast_sync)
+    {
+        fast_sync_t *slot = lock_fast_sync( &mutex->obj );
+        prev = get_fast_mutex_count( mutex, slot );
+        slot->count = prev - 1;
+        if (prev == 1) do_release( mutex );
+        unlock_fast_sync( &mutex->obj );
+    }
+    else if ((prev = mutex->count--) == 1) do_release( mutex );
+    return prev;
+}
+
 static struct mutex *create_mutex( struct object *root, const struct unicode_str *name,
                                    unsigned int attr, int owned, const struct security_descriptor *sd )
 {
@@ -113,6 +187,7 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
+            alloc_fast_sync( &mutex->obj, FAST_SYNC_MUTEX, 0, 0 );
             if (owned) do_grab( mutex, current );
         }
     }
@@ -137,7 +212,7 @@ static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    fprintf( stderr, "Mutex count=%u owner=%04x\n", get_mutex_count( mutex ), get_mutex_owner( mutex ) );
 }
 
 static struct object_type *mutex_get_type( struct object *obj )
@@ -150,17 +225,23 @@ static struct object_type *mutex_get_type( struct object *obj )
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    thread_id_t owner;
+
     assert( obj->ops == &mutex_ops );
-    return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
+    owner = get_mutex_owner( mutex );
+    return (!owner || owner == get_wait_queue_thread( entry )->id);
 }
 
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    int abandoned;
+
     assert( obj->ops == &mutex_ops );
 
+    abandoned = is_mutex_abandoned( mutex );
     do_grab( mutex, get_wait_queue_thread( entry ));
-    if (mutex->abandoned) make_wait_abandoned( entry );
+    if (abandoned) make_wait_abandoned( entry );
     mutex->abandoned = 0;
 }
 
@@ -183,12 +264,12 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
-    if (!mutex->count || (mutex->owner != current))
+    if (get_mutex_owner( mutex ) != current->id)
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
         return 0;
     }
-    if (!--mutex->count) do_release( mutex );
+    release_mutex_once( mutex );
     return 1;
 }
 
@@ -197,7 +278,7 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
-    if (!mutex->count) return;
+    if (!mutex->owner) return;
     mutex->count = 0;
     do_release( mutex );
 }
@@ -243,12 +324,8 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
-        else
-        {
-            reply->prev_count = mutex->count;
-            if (!--mutex->count) do_release( mutex );
-        }
+        if (get_mutex_owner( mutex ) != current->id) set_error( STATUS_MUTANT_NOT_OWNED );
+        else reply->prev_count = release_mutex_once( mutex );
         release_object( mutex );
     }
 }
@@ -261,9 +338,9 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        reply->count = get_mutex_count( mutex );
+        reply->owned = (get_mutex_owner( mutex ) == current->id);
+        reply->abandoned = is_mutex_abandoned( mutex );
 
         release_object( mutex );
     }
@@ -197,6 +197,8 @@ void *alloc_object( const struct object_ops *ops )
         obj->ops          = ops;
         obj->name         = NULL;
         obj->sd           = NULL;
+        obj->fast_sync    = 0;
+        obj->fast_sync_area = NULL;
         list_init( &obj->wait_queue );
 #ifdef DEBUG_OBJECTS
         list_add_head( &object_list, &obj->obj_list );
@@ -209,6 +211,7 @@ void *alloc_object( const struct object_ops *ops )
 /* free an object once it has been destroyed */
 static void free_object( struct object *obj )
 {
+    if (obj->fast_sync) free_fast_sync( obj );
     free( obj->sd );
 #ifdef DEBUG_OBJECTS
     list_remove( &obj->obj_list );
@@ -412,7 +415,7 @@ struct object *grab_object( void *ptr )
 {
     struct object *obj = (struct object *)ptr;
     assert( obj->refcount < INT_MAX );
-    obj->refcount++;
+    __atomic_add_fetch( &obj->refcount, 1, __ATOMIC_RELAXED );
     return obj;
 }
 
@@ -421,7 +424,7 @@ void release_object( void *ptr )
 {
     struct object *obj = (struct object *)ptr;
     assert( obj->refcount );
-    if (!--obj->refcount)
+    if (!__atomic_sub_fetch( &obj->refcount, 1, __ATOMIC_ACQ_REL ))
     {
         assert( !obj->handle_count );
         /* if the refcount is 0, nobody can be in the wait queue */
@@ -43,6 +43,7 @@ struct file;
 struct wait_queue_entry;
 struct async;
 struct async_queue;
+struct fast_sync_area;
 struct winstation;
 struct object_type;
 
@@ -105,6 +106,8 @@ struct object
     struct list               wait_queue;
     struct object_name       *name;
     struct security_descriptor *sd;
+    unsigned int              fast_sync;   /* index of the shared state, or 0 */
+    struct fast_sync_area    *fast_sync_area; /* shared memory holding that state */
 #ifdef DEBUG_OBJECTS
     struct list               obj_list;
 #endif
@@ -195,6 +198,45 @@ extern void reset_event( struct event *event );
 
 extern void abandon_mutexes( struct thread *thread );
 
+/* fast synchronization functions */
+
+extern int is_fast_sync_enabled(void);
+extern void free_process_fast_sync( struct process *process );
+extern int alloc_fast_sync( struct object *obj, enum fast_sync_type type, int state, unsigned int count );
+extern void free_fast_sync( struct object *obj );
+extern unsigned int get_fast_sync_serial( struct object *obj );
+extern fast_sync_t *lock_fast_sync( struct object *obj );
+extern void unlock_fast_sync( struct object *obj );
+extern int get_fast_sync_state( const fast_sync_t *slot );
+extern void set_fast_sync_state( fast_sync_t *slot, int state );
+extern int fast_sync_add_queue( struct object *obj, struct wait_queue_entry *entry );
+extern void fast_sync_remove_queue( struct object *obj, struct wait_queue_entry *entry );
+
+/* server locking
+ *
+ * All the server state (objects, handle tables, wait queues, timeouts,
+ * poll arrays) is protected by a single read/write lock. The main thread
+ * holds it exclusively at all times, except while it is blocked waiting
+ * for events, so everything called from the main loop can keep ignoring it.
+ *
+ * When request worker threads are enabled, the requests listed in
+ * is_concurrent_request() are handed to them, and their handlers run with
+ * the lock held shared. Such handlers must not modify anything besides
+ * the error, request and reply fields of the current thread. Taking and
+ * releasing object references is allowed: refcounts are updated
+ * atomically, and the last reference to an object that is reachable from
+ * a handle can only be released with the lock held exclusively.
+ *
+ * The lock order is:
+ *   1. the server lock
+ *   2. the worker queue mutex (request.c)
+ * Fast synchronization slots are only locked with the server lock held
+ * exclusively, and the request statistics are only updated atomically.
+ */
+
+extern void lock_server(void);
+extern void unlock_server(void);
+
 /* serial functions */
 
 int get_serial_async_timeout(struct object *obj, int type, int count);
@@ -253,6 +295,7 @@ extern struct object *create_symlink( struct object *root, const struct unicode_
   /* command-line options */
 extern int debug_level;
 extern int foreground;
+extern int nb_worker_threads;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
 
@@ -538,6 +538,8 @@ struct process *create_process( int fd, struct process *parent, int inherit_all,
     process->trace_data      = 0;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
+    process->req_stats       = NULL;
+    process->fast_sync       = NULL;
     list_init( &process->kernel_object );
     list_init( &process->thread_list );
     list_init( &process->locks );
@@ -636,6 +638,8 @@ static void process_destroy( struct object *obj )
     if (process->id) free_ptid( process->id );
     if (process->token) release_object( process->token );
     free( process->dir_cache );
+    free( process->req_stats );
+    free_process_fast_sync( process );
 }
 
 /* dump a process on stdout for debugging purposes */
@@ -867,6 +871,19 @@ static void kill_all_processes(void)
     }
 }
 
+/* print the request statistics of all running processes */
+void dump_process_request_stats(void)
+{
+    struct process *process;
+
+    LIST_FOR_EACH_ENTRY( process, &process_list, struct process, entry )
+    {
+        if (!process->req_stats) continue;
+        fprintf( stderr, "wineserver: request latencies in microseconds, process %04x\n", process->id );
+        print_request_stats( process->req_stats );
+    }
+}
+
 /* kill all processes being attached to a console renderer */
 void kill_console_processes( struct thread *renderer, int exit_code )
 {
@@ -98,6 +98,8 @@ struct process
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
     struct list          kernel_object;   /* list of kernel object pointers */
+    struct request_stats *req_stats;      /* request statistics, allocated on first request */
+    struct fast_sync_area *fast_sync;     /* shared state of the synchronization objects it created */
 };
 
 #define CPU_FLAG(cpu) (1 << (cpu))
@@ -126,6 +128,7 @@ extern void suspend_process( struct process *process );
 extern void resume_process( struct process *process );
 extern void kill_process( struct process *process, int violent_death );
 extern void kill_console_processes( struct thread *renderer, int exit_code );
+extern void dump_process_request_stats(void);
 extern void kill_debugged_processes( struct thread *debugger, int exit_code );
 extern void detach_debugged_processes( struct thread *debugger );
 extern void enum_processes( int (*cb)(struct process*, void*), void *user);
@@ -114,6 +114,7 @@ struct thread_input
     int                    cursor_count;  /* cursor show count */
     struct list            msg_list;      /* list of hardware messages */
     unsigned char          keystate[256]; /* state of each key */
+    unsigned int           shm_index;     /* index of the shared state, 0 if none */
 };
 
 struct msg_queue
@@ -140,6 +141,8 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    unsigned int           hooks_gen;       /* desktop hooks generation when active hooks were last returned */
+    unsigned int           shm_index;       /* index of the shared state, 0 if none */
 };
 
 struct hotkey
@@ -225,9 +228,88 @@ static const struct object_ops thread_input_ops =
 /* pointer to input structure of foreground thread */
 static unsigned int last_input_time;
 
+/*
+ * The wake bits and masks of each queue, and the focus, active and capture
+ * windows of each thread input, are published in the shared user section
+ * of their desktop (see user.c), so that clients can poll them without a
+ * server round trip. The entry indices are unique across all the desktops.
+ */
+struct shm_entries
+{
+    unsigned int nb_free;                    /* number of freed entries */
+    unsigned int next_unused;                /* first entry that was never used */
+    unsigned int free[USER_SHM_MAX_ENTRIES]; /* stack of freed entries */
+};
+
+static struct shm_entries queue_entries = { 0, 1 };
+static struct shm_entries input_entries = { 0, 1 };
+
 static void queue_hardware_message( struct desktop *desktop, struct message *msg, int always_queue );
 static void free_message( struct message *msg );
 
+/* allocate a shared entry; return 0 if none is available */
+static unsigned int alloc_shm_entry( struct shm_entries *entries )
+{
+    if (entries->nb_free) return entries->free[--entries->nb_free];
+    if (entries->next_unused < USER_SHM_MAX_ENTRIES) return entries->next_unused++;
+    return 0;
+}
+
+static void free_shm_entry( struct shm_entries *entries, unsigned int index )
+{
+    if (index) entries->free[entries->nb_free++] = index;
+}
+
+/* publish the focus, active and capture windows of a thread input */
+static void update_input_shm( struct thread_input *input )
+{
+    user_shm_t *user_shm;
+    input_shm_t *shm;
+
+    if (!input->shm_index || !(user_shm = get_desktop_shm( input->desktop ))) return;
+    shm = &user_shm->inputs[input->shm_index];
+    begin_shm_write( &shm->seq );
+    shm->focus   = input->focus;
+    shm->capture = input->capture;
+    shm->active  = input->active;
+    end_shm_write( &shm->seq );
+}
+
+/* publish the wake bits and masks of a queue */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    user_shm_t *user_shm;
+    queue_shm_t *shm;
+
+    if (!queue->shm_index || !(user_shm = get_desktop_shm( queue->input->desktop ))) return;
+    shm = &user_shm->queues[queue->shm_index];
+    begin_shm_write( &shm->seq );
+    shm->input        = queue->input->shm_index;
+    shm->wake_bits    = queue->wake_bits;
+    shm->wake_mask    = queue->wake_mask;
+    shm->changed_bits = queue->changed_bits;
+    shm->changed_mask = queue->changed_mask;
+    shm->hooks_gen    = queue->hooks_gen;
+    end_shm_write( &shm->seq );
+}
+
+/* remove a queue from the shared user section of a desktop it no longer belongs to */
+static void clear_queue_shm( struct msg_queue *queue, struct desktop *desktop )
+{
+    queue_shm_t *shm;
+
+    if (!queue->shm_index || !desktop->shm) return;
+    shm = &desktop->shm->queues[queue->shm_index];
+    begin_shm_write( &shm->seq );
+    shm->input        = 0;
+    shm->wake_bits    = 0;
+    shm->wake_mask    = 0;
+    shm->changed_bits = 0;
+    shm->changed_mask = 0;
+    shm->hooks_gen    = 0;
+    end_shm_write( &shm->seq );
+}
+
 /* set the caret window in a given thread input */
 static void set_caret_window( struct thread_input *input, user_handle_t win )
 {
@@ -260,12 +342,15 @@ static struct thread_input *create_thread_input( struct thread *thread )
         list_init( &input->msg_list );
         set_caret_window( input, 0 );
         memset( input->keystate, 0, sizeof(input->keystate) );
+        input->shm_index = 0;
 
         if (!(input->desktop = get_thread_desktop( thread, 0 /* FIXME: access rights */ )))
         {
             release_object( input );
             return NULL;
         }
+        input->shm_index = alloc_shm_entry( &input_entries );
+        update_input_shm( input );
     }
     return input;
 }
@@ -300,11 +385,14 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->hooks_gen       = 0;
+        queue->shm_index       = alloc_shm_entry( &queue_entries );
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        update_queue_shm( queue );
 
         thread->queue = queue;
     }
@@ -333,11 +421,13 @@ static int assign_thread_input( struct thread *thread, struct thread_input *new_
     }
     if (queue->input)
     {
+        if (queue->input->desktop != new_input->desktop) clear_queue_shm( queue, queue->input->desktop );
         queue->input->cursor_count -= queue->cursor_count;
         release_object( queue->input );
     }
     queue->input = (struct thread_input *)grab_object( new_input );
     new_input->cursor_count += queue->cursor_count;
+    update_queue_shm( queue );
     return 1;
 }
 
@@ -474,6 +564,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shm( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -482,6 +573,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shm( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -991,6 +1083,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_queue_shm( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -1029,6 +1122,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    free_shm_entry( &queue_entries, queue->shm_index );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1058,6 +1152,7 @@ static void thread_input_destroy( struct object *obj )
         if (input->desktop->foreground_input == input) set_foreground_input( input->desktop, NULL );
         release_object( input->desktop );
     }
+    free_shm_entry( &input_entries, input->shm_index );
 }
 
 /* fix the thread input data when a window is destroyed */
@@ -1071,6 +1166,7 @@ static inline void thread_input_cleanup_window( struct msg_queue *queue, user_ha
     if (window == input->menu_owner) input->menu_owner = 0;
     if (window == input->move_size) input->move_size = 0;
     if (window == input->caret) set_caret_window( input, 0 );
+    update_input_shm( input );
 }
 
 /* check if the specified window can be set in the input data of a given queue */
@@ -1122,6 +1218,7 @@ int attach_thread_input( struct thread *thread_from, struct thread *thread_to )
     {
         if (!input->focus) input->focus = thread_from->queue->input->focus;
         if (!input->active) input->active = thread_from->queue->input->active;
+        update_input_shm( input );
     }
 
     ret = assign_thread_input( thread_from, input );
@@ -1156,6 +1253,8 @@ void detach_thread_input( struct thread *thread_from )
             }
             release_object( thread );
         }
+        update_input_shm( input );
+        update_input_shm( old_input );
         assign_thread_input( thread_from, input );
         release_object( input );
     }
@@ -2287,10 +2386,16 @@ DECL_HANDLER(get_msg_queue)
     struct msg_queue *queue = get_current_queue();
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    reply->shm_index = 0;
+    if (queue)
+    {
+        reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+        reply->shm_index = queue->shm_index;
+    }
 }
 
 
+
 /* set the file descriptor associated to the current thread queue */
 DECL_HANDLER(set_queue_fd)
 {
@@ -2333,6 +2438,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_queue_shm( queue );
     }
 }
 
@@ -2346,6 +2452,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shm( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2512,6 +2619,13 @@ DECL_HANDLER(get_message)
     queue->last_get_msg = current_time;
     if (!filter) filter = QS_ALLINPUT;
 
+    /* let the client know which hooks generation its active hooks are from */
+    if (queue->input->desktop->shm && queue->hooks_gen != queue->input->desktop->shm->hooks_gen)
+    {
+        queue->hooks_gen = queue->input->desktop->shm->hooks_gen;
+        update_queue_shm( queue );
+    }
+
     /* first check for sent messages */
     if ((ptr = list_head( &queue->msg_list[SEND_MESSAGE] )))
     {
@@ -2528,6 +2642,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shm( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2582,6 +2697,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_queue_shm( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -3051,6 +3167,7 @@ DECL_HANDLER(set_focus_window)
     {
         reply->previous = queue->input->focus;
         queue->input->focus = get_user_full_handle( req->handle );
+        update_input_shm( queue->input );
     }
 }
 
@@ -3067,6 +3184,7 @@ DECL_HANDLER(set_active_window)
         {
             reply->previous = queue->input->active;
             queue->input->active = get_user_full_handle( req->handle );
+            update_input_shm( queue->input );
         }
         else set_error( STATUS_INVALID_HANDLE );
     }
@@ -3094,6 +3212,7 @@ DECL_HANDLER(set_capture_window)
         input->menu_owner = (req->flags & CAPTURE_MENU) ? input->capture : 0;
         input->move_size = (req->flags & CAPTURE_MOVESIZE) ? input->capture : 0;
         reply->full_handle = input->capture;
+        update_input_shm( input );
     }
 }
 
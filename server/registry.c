@@ -34,6 +34,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -48,6 +49,7 @@
 #include "security.h"
 
 #include "winternl.h"
+#include "wine/rbtree.h"
 
 struct notify
 {
@@ -59,24 +61,32 @@ struct notify
     struct process   *process;  /* process in which the hkey is valid */
 };
 
+/* position of the last enumerated entry of a tree, to make sequential enumeration O(1) */
+struct tree_cursor
+{
+    struct wine_rb_entry *entry;   /* last enumerated entry, or NULL */
+    int                   index;   /* index of that entry */
+};
+
 /* a registry key */
 struct key
 {
-    struct object     obj;         /* object header */
-    WCHAR            *name;        /* key name */
-    WCHAR            *class;       /* key class */
-    unsigned short    namelen;     /* length of key name */
-    unsigned short    classlen;    /* length of class name */
-    struct key       *parent;      /* parent key */
-    int               last_subkey; /* last in use subkey */
-    int               nb_subkeys;  /* count of allocated subkeys */
-    struct key      **subkeys;     /* subkeys array */
-    int               last_value;  /* last in use value */
-    int               nb_values;   /* count of allocated values in array */
-    struct key_value *values;      /* values array */
-    unsigned int      flags;       /* flags */
-    timeout_t         modif;       /* last modification time */
-    struct list       notify_list; /* list of notifications */
+    struct object        obj;           /* object header */
+    WCHAR               *name;          /* key name */
+    WCHAR               *class;         /* key class */
+    unsigned short       namelen;       /* length of key name */
+    unsigned short       classlen;      /* length of class name */
+    struct key          *parent;        /* parent key */
+    struct wine_rb_entry entry;         /* entry in the parent subkeys tree */
+    struct wine_rb_tree  subkeys;       /* subkeys tree, sorted by name */
+    int                  nb_subkeys;    /* count of subkeys */
+    struct tree_cursor   subkey_cursor; /* last enumerated subkey */
+    struct wine_rb_tree  values;        /* values tree, sorted by name */
+    int                  nb_values;     /* count of values */
+    struct tree_cursor   value_cursor;  /* last enumerated value */
+    unsigned int         flags;         /* flags */
+    timeout_t            modif;         /* last modification time */
+    struct list          notify_list;   /* list of notifications */
 };
 
 /* key flags */
@@ -90,6 +100,7 @@ struct key
 /* a key value */
 struct key_value
 {
+    struct wine_rb_entry entry; /* entry in the key values tree */
     WCHAR            *name;    /* value name */
     unsigned short    namelen; /* length of value name */
     unsigned int      type;    /* value type */
@@ -97,9 +108,6 @@ struct key_value
     void             *data;    /* pointer to value data */
 };
 
-#define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
-#define MIN_VALUES   8   /* min. number of allocated values per key */
-
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
 
@@ -117,18 +125,31 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( const struct key *key, const struct unicode_str *name );
+static char *get_registry_file_cache_path( struct file *file );
+static int load_registry_cache( struct key *key, const char *path );
+static void save_registry_cache( const struct key *key, const char *path );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    FILE        *journal;        /* journal of the changes since the last save */
+    const struct key *last_key;  /* last key written to the journal */
+    timeout_t    last_modif;     /* modification time written along with last_key */
+    long         journal_size;   /* size of the journal file */
+    long         saved_size;     /* size of the registry file at the last save */
+    int          journal_valid;  /* journal contains all the changes since the last save */
 };
 
+/* the journal is merged into the registry file once it reaches that size, or half the file size */
+#define MIN_JOURNAL_COMPACT_SIZE (256 * 1024)
+
 #define MAX_SAVE_BRANCH_INFO 3
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
+static int use_registry_cache;  /* keep a binary cache of the registry files */
 
 
 /* information about a file being loaded */
@@ -141,6 +162,7 @@ struct file_load_info
     int         line;     /* current input line */
     WCHAR      *tmp;      /* temp buffer to use while parsing input */
     size_t      tmplen;   /* length of temp buffer */
+    int         journal;  /* loading a journal of changes */
 };
 
 
@@ -254,30 +276,208 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* dump the name and options of a key to a text file */
+static void dump_key_header( const struct key *key, const struct key *base, FILE *f )
+{
+    fprintf( f, "\n[" );
+    if (key != base) dump_path( key, base, f );
+    fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
+    fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
+    if (key->class)
+    {
+        fprintf( f, "#class=\"" );
+        dump_strW( key->class, key->classlen, f, "\"\"" );
+        fprintf( f, "\"\n" );
+    }
+    if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+}
+
+/* count the subkeys that are saved along with a key */
+static unsigned int count_saved_subkeys( const struct key *key )
+{
+    struct key *subkey;
+    unsigned int count = 0;
+
+    WINE_RB_FOR_EACH_ENTRY( subkey, &key->subkeys, struct key, entry )
+        if (!(subkey->flags & KEY_VOLATILE)) count++;
+    return count;
+}
+
 /* save a registry and all its subkeys to a text file */
 static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
 {
-    int i;
+    struct key_value *value;
+    struct key *subkey;
 
     if (key->flags & KEY_VOLATILE) return;
-    /* save key if it has either some values or no subkeys, or needs special options */
+    /* save key if it has either some values or no saved subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
-    if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
+    if (key->nb_values || !count_saved_subkeys( key ) || key->class || (key->flags & KEY_SYMLINK))
+    {
+        dump_key_header( key, base, f );
+        WINE_RB_FOR_EACH_ENTRY( value, &key->values, struct key_value, entry )
+            dump_value( value, f );
+    }
+    WINE_RB_FOR_EACH_ENTRY( subkey, &key->subkeys, struct key, entry )
+        save_subkeys( subkey, base, f );
+}
+
+/*
+ * Changes to the saved branches are appended to a journal file next to the
+ * registry file, using the same text format. Keys are deleted with a
+ * "[-key]" line and values with a "name"=- line, like in REGEDIT files.
+ * The journal is replayed when the branch is loaded, and the periodic save
+ * only rewrites the whole registry file once the journal gets too large.
+ */
+
+/* build the name of a file associated to a registry file */
+static char *get_branch_file_name( const char *path, const char *ext )
+{
+    char *name;
+
+    if ((name = malloc( strlen( path ) + strlen( ext ) + 1 )))
+    {
+        strcpy( name, path );
+        strcat( name, ext );
+    }
+    return name;
+}
+
+/* find the saved branch that contains a key */
+static struct save_branch_info *get_key_branch( const struct key *key )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return NULL;
+    for ( ; key; key = key->parent)
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key == key) return &save_branch_info[i];
+    return NULL;
+}
+
+/* get the journal of the branch containing a key, and write the key name if needed */
+static FILE *get_journal( const struct key *key, struct save_branch_info **ret_branch )
+{
+    static const char header[] = "WINE REGISTRY Version 2\n;; Changes to apply to ";
+    struct save_branch_info *branch = get_key_branch( key );
+    char *name;
+    int fd;
+
+    if (!branch || !branch->journal_valid) return NULL;
+
+    if (!branch->journal)
     {
-        fprintf( f, "\n[" );
-        if (key != base) dump_path( key, base, f );
-        fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
-        fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
-        if (key->class)
+        if (!(name = get_branch_file_name( branch->path, ".journal" ))) goto failed;
+        if (fchdir( config_dir_fd ) == -1)
         {
-            fprintf( f, "#class=\"" );
-            dump_strW( key->class, key->classlen, f, "\"\"" );
-            fprintf( f, "\"\n" );
+            free( name );
+            goto failed;
+        }
+        fd = open( name, O_WRONLY | O_CREAT | O_APPEND, 0666 );
+        if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+        free( name );
+        if (fd == -1) goto failed;
+        if (!(branch->journal = fdopen( fd, "a" )))
+        {
+            close( fd );
+            goto failed;
         }
-        if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
-        for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
+        if (!(branch->journal_size = lseek( fd, 0, SEEK_END )))
+            fprintf( branch->journal, "%s%s\n", header, branch->path );
+        branch->last_key = NULL;
+    }
+    if (branch->last_key != key || branch->last_modif != key->modif)
+    {
+        dump_key_header( key, branch->key, branch->journal );
+        branch->last_key = key;
+        branch->last_modif = key->modif;
+    }
+    *ret_branch = branch;
+    return branch->journal;
+
+failed:
+    /* fall back to saving the whole branch */
+    branch->journal_valid = 0;
+    return NULL;
+}
+
+/* flush a journal record to disk */
+static void flush_journal( struct save_branch_info *branch )
+{
+    if (fflush( branch->journal ) || (branch->journal_size = ftell( branch->journal )) == -1)
+        branch->journal_valid = 0;
+}
+
+/* record the creation of a key, and the new modification time of its parent, in the journal */
+static void journal_key( const struct key *key )
+{
+    struct save_branch_info *branch = get_key_branch( key );
+
+    if (branch && key != branch->key && !get_journal( key->parent, &branch )) return;
+    if (get_journal( key, &branch )) flush_journal( branch );
+}
+
+/* record the deletion of a key in the journal */
+static void journal_delete_key( const struct key *key )
+{
+    struct save_branch_info *branch = get_key_branch( key );
+
+    if (!branch || key == branch->key || !get_journal( key->parent, &branch )) return;
+    fputs( "\n[-", branch->journal );
+    dump_path( key, branch->key, branch->journal );
+    fputs( "]\n", branch->journal );
+    branch->last_key = NULL;
+    flush_journal( branch );
+}
+
+/* record the new contents of a value in the journal */
+static void journal_value( const struct key *key, const struct key_value *value )
+{
+    struct save_branch_info *branch;
+
+    if (!get_journal( key, &branch )) return;
+    dump_value( value, branch->journal );
+    flush_journal( branch );
+}
+
+/* record the deletion of a value in the journal */
+static void journal_delete_value( const struct key *key, const struct key_value *value )
+{
+    struct save_branch_info *branch;
+
+    if (!get_journal( key, &branch )) return;
+    if (value->namelen)
+    {
+        fputc( '\"', branch->journal );
+        dump_strW( value->name, value->namelen, branch->journal, "\"\"" );
+        fputs( "\"=-\n", branch->journal );
+    }
+    else fputs( "@=-\n", branch->journal );
+    flush_journal( branch );
+}
+
+/* the changes to a branch can't be journaled, the whole branch will be saved */
+static void invalidate_journal( const struct key *key )
+{
+    struct save_branch_info *branch = get_key_branch( key );
+
+    if (branch) branch->journal_valid = 0;
+}
+
+/* remove the journal once the branch has been saved */
+static void reset_journal( struct save_branch_info *branch )
+{
+    char *name;
+
+    if (branch->journal) fclose( branch->journal );
+    branch->journal = NULL;
+    branch->journal_size = 0;
+    branch->journal_valid = 1;
+    if ((name = get_branch_file_name( branch->path, ".journal" )))
+    {
+        unlink( name );
+        free( name );
     }
-    for (i = 0; i <= key->last_subkey; i++) save_subkeys( key->subkeys[i], base, f );
 }
 
 static void dump_operation( const struct key *key, const struct key_value *value, const char *op )
@@ -402,27 +602,33 @@ static int key_close_handle( struct object *obj, struct process *process, obj_ha
     return 1;  /* ok to close */
 }
 
+static void destroy_value( struct wine_rb_entry *entry, void *context )
+{
+    struct key_value *value = WINE_RB_ENTRY_VALUE( entry, struct key_value, entry );
+
+    free( value->name );
+    free( value->data );
+    free( value );
+}
+
+static void release_subkey( struct wine_rb_entry *entry, void *context )
+{
+    struct key *subkey = WINE_RB_ENTRY_VALUE( entry, struct key, entry );
+
+    subkey->parent = NULL;
+    release_object( subkey );
+}
+
 static void key_destroy( struct object *obj )
 {
-    int i;
     struct list *ptr;
     struct key *key = (struct key *)obj;
     assert( obj->ops == &key_ops );
 
     free( key->name );
     free( key->class );
-    for (i = 0; i <= key->last_value; i++)
-    {
-        free( key->values[i].name );
-        free( key->values[i].data );
-    }
-    free( key->values );
-    for (i = 0; i <= key->last_subkey; i++)
-    {
-        key->subkeys[i]->parent = NULL;
-        release_object( key->subkeys[i] );
-    }
-    free( key->subkeys );
+    wine_rb_destroy( &key->values, destroy_value, NULL );
+    wine_rb_destroy( &key->subkeys, release_subkey, NULL );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -471,6 +677,59 @@ static struct unicode_str *get_path_token( const struct unicode_str *path, struc
     return token;
 }
 
+/* compare a name with the name of a subkey or value, the same way as Windows sorts them */
+static int compare_name( const struct unicode_str *str, const WCHAR *name, data_size_t namelen )
+{
+    int res = memicmp_strW( str->str, name, min( str->len, namelen ));
+    if (!res) res = (int)str->len - (int)namelen;
+    return res;
+}
+
+static int compare_subkey( const void *name, const struct wine_rb_entry *entry )
+{
+    const struct key *key = WINE_RB_ENTRY_VALUE( entry, const struct key, entry );
+    return compare_name( name, key->name, key->namelen );
+}
+
+static int compare_value( const void *name, const struct wine_rb_entry *entry )
+{
+    const struct key_value *value = WINE_RB_ENTRY_VALUE( entry, const struct key_value, entry );
+    return compare_name( name, value->name, value->namelen );
+}
+
+/* return the entry at a given index of a tree holding count entries */
+/* the position is remembered in the cursor, so that enumerating in order is O(1) per entry */
+static struct wine_rb_entry *get_tree_entry( const struct wine_rb_tree *tree, int count,
+                                             struct tree_cursor *cursor, int index )
+{
+    struct wine_rb_entry *entry;
+    int pos;
+
+    if (index < 0 || index >= count) return NULL;
+
+    if (cursor->entry && abs( index - cursor->index ) <= min( index, count - 1 - index ))
+    {
+        entry = cursor->entry;
+        pos = cursor->index;
+    }
+    else if (index <= count - 1 - index)
+    {
+        entry = wine_rb_head( tree->root );
+        pos = 0;
+    }
+    else
+    {
+        entry = wine_rb_tail( tree->root );
+        pos = count - 1;
+    }
+    for ( ; pos < index; pos++) entry = wine_rb_next( entry );
+    for ( ; pos > index; pos--) entry = wine_rb_prev( entry );
+
+    cursor->entry = entry;
+    cursor->index = index;
+    return entry;
+}
+
 /* allocate a key object */
 static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
 {
@@ -482,13 +741,13 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->namelen     = name->len;
         key->classlen    = 0;
         key->flags       = 0;
-        key->last_subkey = -1;
         key->nb_subkeys  = 0;
-        key->subkeys     = NULL;
         key->nb_values   = 0;
-        key->last_value  = -1;
-        key->values      = NULL;
         key->modif       = modif;
+        key->subkey_cursor.entry = NULL;
+        key->value_cursor.entry  = NULL;
+        wine_rb_init( &key->subkeys, compare_subkey );
+        wine_rb_init( &key->values, compare_value );
         key->parent      = NULL;
         list_init( &key->notify_list );
         if (name->len && !(key->name = memdup( name->str, name->len )))
@@ -514,12 +773,12 @@ static void make_dirty( struct key *key )
 /* mark a key and all its subkeys as clean (not modified) */
 static void make_clean( struct key *key )
 {
-    int i;
+    struct key *subkey;
 
     if (key->flags & KEY_VOLATILE) return;
     if (!(key->flags & KEY_DIRTY)) return;
     key->flags &= ~KEY_DIRTY;
-    for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
+    WINE_RB_FOR_EACH_ENTRY( subkey, &key->subkeys, struct key, entry ) make_clean( subkey );
 }
 
 /* go through all the notifications and send them if necessary */
@@ -549,54 +808,24 @@ static void touch_key( struct key *key, unsigned int change )
         check_notify( k, change, 0 );
 }
 
-/* try to grow the array of subkeys; return 1 if OK, 0 on error */
-static int grow_subkeys( struct key *key )
-{
-    struct key **new_subkeys;
-    int nb_subkeys;
-
-    if (key->nb_subkeys)
-    {
-        nb_subkeys = key->nb_subkeys + (key->nb_subkeys / 2);  /* grow by 50% */
-        if (!(new_subkeys = realloc( key->subkeys, nb_subkeys * sizeof(*new_subkeys) )))
-        {
-            set_error( STATUS_NO_MEMORY );
-            return 0;
-        }
-    }
-    else
-    {
-        nb_subkeys = MIN_SUBKEYS;
-        if (!(new_subkeys = mem_alloc( nb_subkeys * sizeof(*new_subkeys) ))) return 0;
-    }
-    key->subkeys    = new_subkeys;
-    key->nb_subkeys = nb_subkeys;
-    return 1;
-}
-
-/* allocate a subkey for a given key, and return its index */
-static struct key *alloc_subkey( struct key *parent, const struct unicode_str *name,
-                                 int index, timeout_t modif )
+/* allocate a subkey for a given key; the name must not exist yet */
+static struct key *alloc_subkey( struct key *parent, const struct unicode_str *name, timeout_t modif )
 {
     struct key *key;
-    int i;
 
     if (name->len > MAX_NAME_LEN * sizeof(WCHAR))
     {
         set_error( STATUS_INVALID_PARAMETER );
         return NULL;
     }
-    if (parent->last_subkey + 1 == parent->nb_subkeys)
-    {
-        /* need to grow the array */
-        if (!grow_subkeys( parent )) return NULL;
-    }
     if ((key = alloc_key( name, modif )) != NULL)
     {
+        struct unicode_str key_name = { key->name, key->namelen };
+
         key->parent = parent;
-        for (i = ++parent->last_subkey; i > index; i--)
-            parent->subkeys[i] = parent->subkeys[i-1];
-        parent->subkeys[index] = key;
+        wine_rb_put( &parent->subkeys, &key_name, &key->entry );
+        parent->nb_subkeys++;
+        parent->subkey_cursor.entry = NULL;
         if (is_wow6432node( key->name, key->namelen ) && !is_wow6432node( parent->name, parent->namelen ))
             parent->flags |= KEY_WOW64;
     }
@@ -604,71 +833,35 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
 }
 
 /* free a subkey of a given key */
-static void free_subkey( struct key *parent, int index )
+static void free_subkey( struct key *parent, struct key *key )
 {
-    struct key *key;
-    int i, nb_subkeys;
+    assert( key->parent == parent );
 
-    assert( index >= 0 );
-    assert( index <= parent->last_subkey );
-
-    key = parent->subkeys[index];
-    for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
-    parent->last_subkey--;
+    wine_rb_remove( &parent->subkeys, &key->entry );
+    parent->nb_subkeys--;
+    parent->subkey_cursor.entry = NULL;
     key->flags |= KEY_DELETED;
     key->parent = NULL;
     if (is_wow6432node( key->name, key->namelen )) parent->flags &= ~KEY_WOW64;
     release_object( key );
-
-    /* try to shrink the array */
-    nb_subkeys = parent->nb_subkeys;
-    if (nb_subkeys > MIN_SUBKEYS && parent->last_subkey < nb_subkeys / 2)
-    {
-        struct key **new_subkeys;
-        nb_subkeys -= nb_subkeys / 3;  /* shrink by 33% */
-        if (nb_subkeys < MIN_SUBKEYS) nb_subkeys = MIN_SUBKEYS;
-        if (!(new_subkeys = realloc( parent->subkeys, nb_subkeys * sizeof(*new_subkeys) ))) return;
-        parent->subkeys = new_subkeys;
-        parent->nb_subkeys = nb_subkeys;
-    }
 }
 
-/* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+/* find the named child of a given key */
+static struct key *find_subkey( const struct key *key, const struct unicode_str *name )
 {
-    int i, min, max, res;
-    data_size_t len;
-
-    min = 0;
-    max = key->last_subkey;
-    while (min <= max)
-    {
-        i = (min + max) / 2;
-        len = min( key->subkeys[i]->namelen, name->len );
-        res = memicmp_strW( key->subkeys[i]->name, name->str, len );
-        if (!res) res = key->subkeys[i]->namelen - name->len;
-        if (!res)
-        {
-            *index = i;
-            return key->subkeys[i];
-        }
-        if (res > 0) max = i - 1;
-        else min = i + 1;
-    }
-    *index = min;  /* this is where we should insert it */
-    return NULL;
+    struct wine_rb_entry *entry = wine_rb_get( &key->subkeys, name );
+    return entry ? WINE_RB_ENTRY_VALUE( entry, struct key, entry ) : NULL;
 }
 
 /* return the wow64 variant of the key, or the key itself if none */
 static struct key *find_wow64_subkey( struct key *key, const struct unicode_str *name )
 {
     static const struct unicode_str wow6432node_str = { wow6432node, sizeof(wow6432node) };
-    int index;
 
     if (!(key->flags & KEY_WOW64)) return key;
     if (!is_wow6432node( name->str, name->len ))
     {
-        key = find_subkey( key, &wow6432node_str, &index );
+        key = find_subkey( key, &wow6432node_str );
         assert( key );  /* if KEY_WOW64 is set we must find it */
     }
     return key;
@@ -680,11 +873,10 @@ static struct key *follow_symlink( struct key *key, int iteration )
 {
     struct unicode_str path, token;
     struct key_value *value;
-    int index;
 
     if (iteration > 16) return NULL;
     if (!(key->flags & KEY_SYMLINK)) return key;
-    if (!(value = find_value( key, &symlink_str, &index ))) return NULL;
+    if (!(value = find_value( key, &symlink_str ))) return NULL;
 
     path.str = value->data;
     path.len = (value->len / sizeof(WCHAR)) * sizeof(WCHAR);
@@ -698,7 +890,7 @@ static struct key *follow_symlink( struct key *key, int iteration )
     if (!get_path_token( &path, &token )) return NULL;
     while (token.len)
     {
-        if (!(key = find_subkey( key, &token, &index ))) break;
+        if (!(key = find_subkey( key, &token ))) break;
         if (!(key = follow_symlink( key, iteration + 1 ))) break;
         get_path_token( &path, &token );
     }
@@ -708,7 +900,7 @@ static struct key *follow_symlink( struct key *key, int iteration )
 /* open a key until we find an element that doesn't exist */
 /* helper for open_key and create_key */
 static struct key *open_key_prefix( struct key *key, const struct unicode_str *name,
-                                    unsigned int access, struct unicode_str *token, int *index )
+                                    unsigned int access, struct unicode_str *token )
 {
     token->str = NULL;
     if (!get_path_token( name, token )) return NULL;
@@ -716,13 +908,13 @@ static struct key *open_key_prefix( struct key *key, const struct unicode_str *n
     while (token->len)
     {
         struct key *subkey;
-        if (!(subkey = find_subkey( key, token, index )))
+        if (!(subkey = find_subkey( key, token )))
         {
             if ((key->flags & KEY_WOWSHARE) && !(access & KEY_WOW64_64KEY))
             {
                 /* try in the 64-bit parent */
                 key = key->parent;
-                subkey = find_subkey( key, token, index );
+                subkey = find_subkey( key, token );
             }
         }
         if (!subkey) break;
@@ -743,10 +935,9 @@ static struct key *open_key_prefix( struct key *key, const struct unicode_str *n
 static struct key *open_key( struct key *key, const struct unicode_str *name, unsigned int access,
                              unsigned int attributes )
 {
-    int index;
     struct unicode_str token;
 
-    if (!(key = open_key_prefix( key, name, access, &token, &index ))) return NULL;
+    if (!(key = open_key_prefix( key, name, access, &token ))) return NULL;
 
     if (token.len)
     {
@@ -770,11 +961,10 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
                                unsigned int access, unsigned int attributes,
                                const struct security_descriptor *sd, int *created )
 {
-    int index;
     struct unicode_str token, next;
 
     *created = 0;
-    if (!(key = open_key_prefix( key, name, access, &token, &index ))) return NULL;
+    if (!(key = open_key_prefix( key, name, access, &token ))) return NULL;
 
     if (!token.len)  /* the key already exists */
     {
@@ -810,7 +1000,7 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
     }
     *created = 1;
     make_dirty( key );
-    if (!(key = alloc_subkey( key, &token, index, current_time ))) return NULL;
+    if (!(key = alloc_subkey( key, &token, current_time ))) return NULL;
 
     if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
     if (options & REG_OPTION_VOLATILE) key->flags |= KEY_VOLATILE;
@@ -827,6 +1017,7 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
         if (!(key->class = memdup( class->str, key->classlen ))) key->classlen = 0;
     }
     touch_key( key->parent, REG_NOTIFY_CHANGE_NAME );
+    journal_key( key );
     grab_object( key );
     return key;
 }
@@ -835,7 +1026,6 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
 static struct key *create_key_recursive( struct key *key, const struct unicode_str *name, timeout_t modif )
 {
     struct key *base;
-    int index;
     struct unicode_str token;
 
     token.str = NULL;
@@ -843,7 +1033,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
     while (token.len)
     {
         struct key *subkey;
-        if (!(subkey = find_subkey( key, &token, &index ))) break;
+        if (!(subkey = find_subkey( key, &token ))) break;
         key = subkey;
         if (!(key = follow_symlink( key, 0 )))
         {
@@ -855,16 +1045,15 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 
     if (token.len)
     {
-        if (!(key = alloc_subkey( key, &token, index, modif ))) return NULL;
+        if (!(key = alloc_subkey( key, &token, modif ))) return NULL;
         base = key;
         for (;;)
         {
             get_path_token( name, &token );
             if (!token.len) break;
-            /* we know the index is always 0 in a new key */
-            if (!(key = alloc_subkey( key, &token, 0, modif )))
+            if (!(key = alloc_subkey( key, &token, modif )))
             {
-                free_subkey( base, index );
+                free_subkey( base->parent, base );
                 return NULL;
             }
         }
@@ -875,25 +1064,28 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 }
 
 /* query information about a key or a subkey */
-static void enum_key( const struct key *key, int index, int info_class,
+static void enum_key( struct key *key, int index, int info_class,
                       struct enum_key_reply *reply )
 {
     static const WCHAR backslash[] = { '\\' };
-    int i;
     data_size_t len, namelen, classlen;
     data_size_t max_subkey = 0, max_class = 0;
     data_size_t max_value = 0, max_data = 0;
+    struct key_value *value;
+    struct key *subkey;
     const struct key *k;
     char *data;
 
     if (index != -1)  /* -1 means use the specified key directly */
     {
-        if ((index < 0) || (index > key->last_subkey))
+        struct wine_rb_entry *entry;
+
+        if (!(entry = get_tree_entry( &key->subkeys, key->nb_subkeys, &key->subkey_cursor, index )))
         {
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
-        key = key->subkeys[index];
+        key = WINE_RB_ENTRY_VALUE( entry, struct key, entry );
     }
 
     namelen = key->namelen;
@@ -919,15 +1111,15 @@ static void enum_key( const struct key *key, int index, int info_class,
         break;
     case KeyFullInformation:
     case KeyCachedInformation:
-        for (i = 0; i <= key->last_subkey; i++)
+        WINE_RB_FOR_EACH_ENTRY( subkey, &key->subkeys, struct key, entry )
         {
-            if (key->subkeys[i]->namelen > max_subkey) max_subkey = key->subkeys[i]->namelen;
-            if (key->subkeys[i]->classlen > max_class) max_class = key->subkeys[i]->classlen;
+            if (subkey->namelen > max_subkey) max_subkey = subkey->namelen;
+            if (subkey->classlen > max_class) max_class = subkey->classlen;
         }
-        for (i = 0; i <= key->last_value; i++)
+        WINE_RB_FOR_EACH_ENTRY( value, &key->values, struct key_value, entry )
         {
-            if (key->values[i].namelen > max_value) max_value = key->values[i].namelen;
-            if (key->values[i].len > max_data) max_data = key->values[i].len;
+            if (value->namelen > max_value) max_value = value->namelen;
+            if (value->len > max_data) max_data = value->len;
         }
         reply->max_subkey = max_subkey;
         reply->max_class  = max_class;
@@ -942,8 +1134,8 @@ static void enum_key( const struct key *key, int index, int info_class,
         set_error( STATUS_INVALID_PARAMETER );
         return;
     }
-    reply->subkeys = key->last_subkey + 1;
-    reply->values  = key->last_value + 1;
+    reply->subkeys = key->nb_subkeys;
+    reply->values  = key->nb_values;
     reply->modif   = key->modif;
     reply->total   = namelen + classlen;
 
@@ -983,7 +1175,6 @@ static void enum_key( const struct key *key, int index, int info_class,
 /* delete a key and its values */
 static int delete_key( struct key *key, int recurse )
 {
-    int index;
     struct key *parent = key->parent;
 
     /* must find parent and index */
@@ -994,101 +1185,66 @@ static int delete_key( struct key *key, int recurse )
     }
     assert( parent );
 
-    while (recurse && (key->last_subkey>=0))
-        if (0 > delete_key(key->subkeys[key->last_subkey], 1))
+    while (recurse && key->nb_subkeys)
+        if (0 > delete_key( WINE_RB_ENTRY_VALUE( wine_rb_tail( key->subkeys.root ), struct key, entry ), 1 ))
             return -1;
 
-    for (index = 0; index <= parent->last_subkey; index++)
-        if (parent->subkeys[index] == key) break;
-    assert( index <= parent->last_subkey );
-
     /* we can only delete a key that has no subkeys */
-    if (key->last_subkey >= 0)
+    if (key->nb_subkeys)
     {
         set_error( STATUS_ACCESS_DENIED );
         return -1;
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
-    free_subkey( parent, index );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
+    journal_delete_key( key );
+    free_subkey( parent, key );
     return 0;
 }
 
-/* try to grow the array of values; return 1 if OK, 0 on error */
-static int grow_values( struct key *key )
+/* remove a value from its key and free it */
+static void free_value( struct key *key, struct key_value *value )
 {
-    struct key_value *new_val;
-    int nb_values;
-
-    if (key->nb_values)
-    {
-        nb_values = key->nb_values + (key->nb_values / 2);  /* grow by 50% */
-        if (!(new_val = realloc( key->values, nb_values * sizeof(*new_val) )))
-        {
-            set_error( STATUS_NO_MEMORY );
-            return 0;
-        }
-    }
-    else
-    {
-        nb_values = MIN_VALUES;
-        if (!(new_val = mem_alloc( nb_values * sizeof(*new_val) ))) return 0;
-    }
-    key->values = new_val;
-    key->nb_values = nb_values;
-    return 1;
+    wine_rb_remove( &key->values, &value->entry );
+    key->nb_values--;
+    key->value_cursor.entry = NULL;
+    destroy_value( &value->entry, NULL );
 }
 
-/* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+/* find the named value of a given key */
+static struct key_value *find_value( const struct key *key, const struct unicode_str *name )
 {
-    int i, min, max, res;
-    data_size_t len;
-
-    min = 0;
-    max = key->last_value;
-    while (min <= max)
-    {
-        i = (min + max) / 2;
-        len = min( key->values[i].namelen, name->len );
-        res = memicmp_strW( key->values[i].name, name->str, len );
-        if (!res) res = key->values[i].namelen - name->len;
-        if (!res)
-        {
-            *index = i;
-            return &key->values[i];
-        }
-        if (res > 0) max = i - 1;
-        else min = i + 1;
-    }
-    *index = min;  /* this is where we should insert it */
-    return NULL;
+    struct wine_rb_entry *entry = wine_rb_get( &key->values, name );
+    return entry ? WINE_RB_ENTRY_VALUE( entry, struct key_value, entry ) : NULL;
 }
 
-/* insert a new value; the index must have been returned by find_value */
-static struct key_value *insert_value( struct key *key, const struct unicode_str *name, int index )
+/* insert a new value; the name must not exist yet */
+static struct key_value *insert_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    WCHAR *new_name = NULL;
-    int i;
+    struct unicode_str value_name;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
         set_error( STATUS_NAME_TOO_LONG );
         return NULL;
     }
-    if (key->last_value + 1 == key->nb_values)
+    if (!(value = mem_alloc( sizeof(*value) ))) return NULL;
+    value->name = NULL;
+    if (name->len && !(value->name = memdup( name->str, name->len )))
     {
-        if (!grow_values( key )) return NULL;
+        free( value );
+        return NULL;
     }
-    if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
-    for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
-    value = &key->values[index];
-    value->name    = new_name;
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    value_name.str = value->name;
+    value_name.len = value->namelen;
+    wine_rb_put( &key->values, &value_name, &value->entry );
+    key->nb_values++;
+    key->value_cursor.entry = NULL;
     return value;
 }
 
@@ -1098,9 +1254,8 @@ static void set_value( struct key *key, const struct unicode_str *name,
 {
     struct key_value *value;
     void *ptr = NULL;
-    int index;
 
-    if ((value = find_value( key, name, &index )))
+    if ((value = find_value( key, name )))
     {
         /* check if the new value is identical to the existing one */
         if (value->type == type && value->len == len &&
@@ -1125,7 +1280,7 @@ static void set_value( struct key *key, const struct unicode_str *name,
 
     if (!value)
     {
-        if (!(value = insert_value( key, name, index )))
+        if (!(value = insert_value( key, name )))
         {
             free( ptr );
             return;
@@ -1137,6 +1292,7 @@ static void set_value( struct key *key, const struct unicode_str *name,
     value->len   = len;
     value->data  = ptr;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
+    journal_value( key, value );
     if (debug_level > 1) dump_operation( key, value, "Set" );
 }
 
@@ -1144,9 +1300,8 @@ static void set_value( struct key *key, const struct unicode_str *name,
 static void get_value( struct key *key, const struct unicode_str *name, int *type, data_size_t *len )
 {
     struct key_value *value;
-    int index;
 
-    if ((value = find_value( key, name, &index )))
+    if ((value = find_value( key, name )))
     {
         *type = value->type;
         *len  = value->len;
@@ -1163,15 +1318,17 @@ static void get_value( struct key *key, const struct unicode_str *name, int *typ
 /* enumerate a key value */
 static void enum_value( struct key *key, int i, int info_class, struct enum_key_value_reply *reply )
 {
+    struct wine_rb_entry *entry;
     struct key_value *value;
 
-    if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
+    if (!(entry = get_tree_entry( &key->values, key->nb_values, &key->value_cursor, i )))
+        set_error( STATUS_NO_MORE_ENTRIES );
     else
     {
         void *data;
         data_size_t namelen, maxlen;
 
-        value = &key->values[i];
+        value = WINE_RB_ENTRY_VALUE( entry, struct key_value, entry );
         reply->type = value->type;
         namelen = value->namelen;
 
@@ -1215,31 +1372,16 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    int i, index, nb_values;
 
-    if (!(value = find_value( key, name, &index )))
+    if (!(value = find_value( key, name )))
     {
         set_error( STATUS_OBJECT_NAME_NOT_FOUND );
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
-    free( value->name );
-    free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
-    key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
-
-    /* try to shrink the array */
-    nb_values = key->nb_values;
-    if (nb_values > MIN_VALUES && key->last_value < nb_values / 2)
-    {
-        struct key_value *new_val;
-        nb_values -= nb_values / 3;  /* shrink by 33% */
-        if (nb_values < MIN_VALUES) nb_values = MIN_VALUES;
-        if (!(new_val = realloc( key->values, nb_values * sizeof(*new_val) ))) return;
-        key->values = new_val;
-        key->nb_values = nb_values;
-    }
+    journal_delete_value( key, value );
+    free_value( key, value );
 }
 
 /* get the registry key corresponding to an hkey handle */
@@ -1449,7 +1591,8 @@ static int load_key_option( struct key *key, const char *buffer, struct file_loa
             else if (*p >= 'a' && *p <= 'f') modif = (modif << 4) | (*p - 'a' + 10);
             else break;
         }
-        update_key_time( key, modif );
+        if (info->journal) key->modif = modif;
+        else update_key_time( key, modif );
     }
     if (!strncmp( buffer, "#class=", 7 ))
     {
@@ -1489,39 +1632,34 @@ static int parse_hex( unsigned char *dest, data_size_t *len, const char *buffer
     return p - buffer;
 }
 
-/* parse a value name and create the corresponding value */
-static struct key_value *parse_value_name( struct key *key, const char *buffer, data_size_t *len,
-                                           struct file_load_info *info )
+/* parse a value name; the returned name points to the temp buffer */
+static int parse_value_name( const char *buffer, struct unicode_str *name, data_size_t *len,
+                             struct file_load_info *info )
 {
-    struct key_value *value;
-    struct unicode_str name;
-    int index;
-
-    if (!get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) return NULL;
-    name.str = info->tmp;
-    name.len = info->tmplen;
+    if (!get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) return 0;
+    name->str = info->tmp;
+    name->len = info->tmplen;
     if (buffer[0] == '@')
     {
-        name.len = 0;
+        name->len = 0;
         *len = 1;
     }
     else
     {
-        int r = parse_strW( info->tmp, &name.len, buffer + 1, '\"' );
+        int r = parse_strW( info->tmp, &name->len, buffer + 1, '\"' );
         if (r == -1) goto error;
         *len = r + 1; /* for initial quote */
-        name.len -= sizeof(WCHAR);  /* terminating null */
+        name->len -= sizeof(WCHAR);  /* terminating null */
     }
     while (isspace(buffer[*len])) (*len)++;
     if (buffer[*len] != '=') goto error;
     (*len)++;
     while (isspace(buffer[*len])) (*len)++;
-    if (!(value = find_value( key, &name, &index ))) value = insert_value( key, &name, index );
-    return value;
+    return 1;
 
  error:
     file_read_error( "Malformed value name", info );
-    return NULL;
+    return 0;
 }
 
 /* load a value from the input file */
@@ -1532,8 +1670,15 @@ static int load_value( struct key *key, const char *buffer, struct file_load_inf
     int res, type, parse_type;
     data_size_t maxlen, len;
     struct key_value *value;
+    struct unicode_str name;
 
-    if (!(value = parse_value_name( key, buffer, &len, info ))) return 0;
+    if (!parse_value_name( buffer, &name, &len, info )) return 0;
+    if (info->journal && buffer[len] == '-')  /* deleted value */
+    {
+        if ((value = find_value( key, &name ))) free_value( key, value );
+        return 1;
+    }
+    if (!(value = find_value( key, &name )) && !(value = insert_value( key, &name ))) return 0;
     if (!(res = get_data_type( buffer + len, &type, &parse_type ))) goto error;
     buffer += len + res;
 
@@ -1592,6 +1737,32 @@ static int load_value( struct key *key, const char *buffer, struct file_load_inf
     return 0;
 }
 
+/* delete a key listed in a journal */
+static void load_deleted_key( struct key *base, const char *buffer, struct file_load_info *info )
+{
+    struct unicode_str path, token;
+    struct key *key = base;
+    data_size_t len;
+
+    if (!get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) return;
+    len = info->tmplen;
+    if (parse_strW( info->tmp, &len, buffer, ']' ) == -1)
+    {
+        file_read_error( "Malformed key", info );
+        return;
+    }
+    path.str = info->tmp;
+    path.len = len - sizeof(WCHAR);
+    token.str = NULL;
+    if (!get_path_token( &path, &token )) return;
+    while (key && token.len)
+    {
+        key = find_subkey( key, &token );
+        get_path_token( &path, &token );
+    }
+    if (key && key != base) delete_key( key, 1 );
+}
+
 /* return the length (in path elements) of name that is part of the key name */
 /* for instance if key is USER\foo\bar and name is foo\bar\baz, return 2 */
 static int get_prefix_len( struct key *key, const char *name, struct file_load_info *info )
@@ -1621,7 +1792,7 @@ static int get_prefix_len( struct key *key, const char *name, struct file_load_i
 
 /* load all the keys from the input file */
 /* prefix_len is the number of key name prefixes to skip, or -1 for autodetection */
-static void load_keys( struct key *key, const char *filename, FILE *f, int prefix_len )
+static void load_keys( struct key *key, const char *filename, FILE *f, int prefix_len, int journal )
 {
     struct key *subkey = NULL;
     struct file_load_info info;
@@ -1633,6 +1804,7 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     info.len    = 4;
     info.tmplen = 4;
     info.line   = 0;
+    info.journal = journal;
     if (!(info.buffer = mem_alloc( info.len ))) return;
     if (!(info.tmp = mem_alloc( info.tmplen )))
     {
@@ -1658,6 +1830,12 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
             {
                 update_key_time( subkey, modif );
                 release_object( subkey );
+                subkey = NULL;
+            }
+            if (journal && p[1] == '-')
+            {
+                load_deleted_key( key, p + 2, &info );
+                break;
             }
             if (prefix_len == -1) prefix_len = get_prefix_len( key, p + 1, &info );
             if (!(subkey = load_key( key, p + 1, prefix_len, &info, &modif )))
@@ -1695,9 +1873,20 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
 static void load_registry( struct key *key, obj_handle_t handle )
 {
     struct file *file;
+    char *path;
     int fd;
 
     if (!(file = get_file_obj( current->process, handle, FILE_READ_DATA ))) return;
+    if ((path = get_registry_file_cache_path( file )))
+    {
+        int loaded = load_registry_cache( key, path );
+        free( path );
+        if (loaded)
+        {
+            release_object( file );
+            return;
+        }
+    }
     fd = dup( get_file_unix_fd( file ) );
     release_object( file );
     if (fd != -1)
@@ -1705,35 +1894,319 @@ static void load_registry( struct key *key, obj_handle_t handle )
         FILE *f = fdopen( fd, "r" );
         if (f)
         {
-            load_keys( key, NULL, f, -1 );
+            load_keys( key, NULL, f, -1, 0 );
             fclose( f );
         }
         else file_set_error();
     }
 }
 
+/*
+ * When WINEREGCACHE is set, a binary image of each saved branch is kept
+ * next to its registry file, tagged with the size, modification time and
+ * inode of that file. At startup the image is mapped and turned directly
+ * into keys and values instead of parsing the text file. The text file
+ * remains the reference: the cache is ignored as soon as it doesn't match.
+ * Files written by RegSaveKey get a cache too, which RegLoadKey uses.
+ */
+
+#define REGISTRY_CACHE_MAGIC   "WINEREGC"
+#define REGISTRY_CACHE_VERSION 2
+
+struct cache_header
+{
+    char             magic[8];     /* REGISTRY_CACHE_MAGIC */
+    unsigned int     version;      /* REGISTRY_CACHE_VERSION */
+    unsigned int     prefix_type;  /* prefix architecture */
+    unsigned __int64 file_size;    /* size of the registry file */
+    unsigned __int64 file_mtime;   /* modification time of the registry file in nanoseconds */
+    unsigned __int64 file_ino;     /* inode of the registry file */
+};
+
+struct cache_key
+{
+    timeout_t        modif;        /* last modification time */
+    unsigned int     flags;        /* key flags */
+    unsigned short   namelen;      /* length of key name */
+    unsigned short   classlen;     /* length of class name */
+    unsigned int     nb_values;    /* count of values */
+    unsigned int     nb_subkeys;   /* count of subkeys */
+    /* followed by the name and class, then the values and the subkeys */
+};
+
+struct cache_value
+{
+    unsigned int     type;         /* value type */
+    data_size_t      len;          /* value data length in bytes */
+    unsigned short   namelen;      /* length of value name */
+    unsigned short   __pad;
+    /* followed by the name and data */
+};
+
+/* return the modification time of a file in nanoseconds, as precisely as the platform allows */
+static unsigned __int64 get_file_mtime( const struct stat *st )
+{
+    unsigned __int64 mtime = (unsigned __int64)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime += st->st_mtimespec.tv_nsec;
+#endif
+    return mtime;
+}
+
+/* get the name of a registry file opened by the client, to look for its cache */
+static char *get_registry_file_cache_path( struct file *file )
+{
+    struct fd *fd;
+    char *path;
+
+    if (!use_registry_cache || !(fd = get_obj_fd( (struct object *)file ))) return NULL;
+    path = dup_fd_name( fd, "" );
+    release_object( fd );
+    return path;
+}
+
+/* all records are aligned on 8 bytes */
+static inline size_t cache_record_size( size_t size )
+{
+    return (size + 7) & ~7;
+}
+
+/* write a key and all its subkeys to the cache */
+static void save_cache_key( const struct key *key, FILE *f )
+{
+    static const char padding[8];
+    struct cache_key cache_key;
+    struct cache_value cache_value;
+    struct key_value *value;
+    struct key *subkey;
+    size_t size;
+
+    cache_key.modif      = key->modif;
+    cache_key.flags      = key->flags & KEY_SYMLINK;
+    cache_key.namelen    = key->namelen;
+    cache_key.classlen   = key->classlen;
+    cache_key.nb_values  = key->nb_values;
+    cache_key.nb_subkeys = count_saved_subkeys( key );
+
+    size = sizeof(cache_key) + key->namelen + key->classlen;
+    fwrite( &cache_key, sizeof(cache_key), 1, f );
+    if (key->namelen) fwrite( key->name, key->namelen, 1, f );
+    if (key->classlen) fwrite( key->class, key->classlen, 1, f );
+    fwrite( padding, 1, cache_record_size( size ) - size, f );
+
+    WINE_RB_FOR_EACH_ENTRY( value, &key->values, struct key_value, entry )
+    {
+        cache_value.type    = value->type;
+        cache_value.len     = value->len;
+        cache_value.namelen = value->namelen;
+        cache_value.__pad   = 0;
+        size = sizeof(cache_value) + value->namelen + value->len;
+        fwrite( &cache_value, sizeof(cache_value), 1, f );
+        if (value->namelen) fwrite( value->name, value->namelen, 1, f );
+        if (value->len) fwrite( value->data, value->len, 1, f );
+        fwrite( padding, 1, cache_record_size( size ) - size, f );
+    }
+
+    WINE_RB_FOR_EACH_ENTRY( subkey, &key->subkeys, struct key, entry )
+        if (!(subkey->flags & KEY_VOLATILE)) save_cache_key( subkey, f );
+}
+
+/* write the cache of a branch whose registry file has just been written or loaded */
+static void save_registry_cache( const struct key *key, const char *path )
+{
+    struct cache_header header;
+    struct stat st;
+    char *name, *tmp;
+    int ret;
+    FILE *f;
+
+    if (!use_registry_cache || stat( path, &st ) == -1 || !S_ISREG( st.st_mode )) return;
+    if (!(name = get_branch_file_name( path, ".cache" ))) return;
+    if (!(tmp = get_branch_file_name( path, ".cache.tmp" )))
+    {
+        free( name );
+        return;
+    }
+    if ((f = fopen( tmp, "w" )))
+    {
+        memset( &header, 0, sizeof(header) );
+        memcpy( header.magic, REGISTRY_CACHE_MAGIC, sizeof(header.magic) );
+        header.version     = REGISTRY_CACHE_VERSION;
+        header.prefix_type = prefix_type;
+        header.file_size   = st.st_size;
+        header.file_mtime  = get_file_mtime( &st );
+        header.file_ino    = st.st_ino;
+        fwrite( &header, sizeof(header), 1, f );
+        save_cache_key( key, f );
+        ret = !ferror( f );
+        if (fclose( f )) ret = 0;
+        if (!ret || rename( tmp, name ) == -1) unlink( tmp );
+    }
+    free( tmp );
+    free( name );
+}
+
+/* load a key and its subkeys from the cache; only validate the data if key is NULL */
+static int load_cache_key( struct key *key, const char **ptr, const char *end )
+{
+    const struct cache_key *cache_key = (const struct cache_key *)*ptr;
+    const struct cache_value *cache_value;
+    struct key_value *value;
+    struct key *subkey;
+    struct unicode_str name;
+    const char *p = *ptr;
+    unsigned int i;
+
+    if (end - p < sizeof(*cache_key)) return 0;
+    if ((cache_key->namelen | cache_key->classlen) & 1) return 0;
+    if (end - p - sizeof(*cache_key) < cache_key->namelen + cache_key->classlen) return 0;
+    if (key)
+    {
+        key->modif = cache_key->modif;
+        key->flags |= cache_key->flags & KEY_SYMLINK;
+        if (cache_key->classlen)
+        {
+            free( key->class );
+            if (!(key->class = memdup( p + sizeof(*cache_key) + cache_key->namelen, cache_key->classlen )))
+                return 0;
+            key->classlen = cache_key->classlen;
+        }
+    }
+    p += cache_record_size( sizeof(*cache_key) + cache_key->namelen + cache_key->classlen );
+
+    for (i = 0; i < cache_key->nb_values; i++)
+    {
+        cache_value = (const struct cache_value *)p;
+        if (p > end || end - p < sizeof(*cache_value)) return 0;
+        if (cache_value->namelen & 1) return 0;
+        if (end - p - sizeof(*cache_value) < (size_t)cache_value->namelen + cache_value->len) return 0;
+        if (key)
+        {
+            name.str = (const WCHAR *)(cache_value + 1);
+            name.len = cache_value->namelen;
+            if (!(value = find_value( key, &name )) && !(value = insert_value( key, &name ))) return 0;
+            free( value->data );
+            value->type = cache_value->type;
+            value->len  = cache_value->len;
+            value->data = NULL;
+            if (value->len && !(value->data = memdup( p + sizeof(*cache_value) + name.len, value->len )))
+                value->len = 0;
+        }
+        p += cache_record_size( sizeof(*cache_value) + (size_t)cache_value->namelen + cache_value->len );
+    }
+
+    for (i = 0; i < cache_key->nb_subkeys; i++)
+    {
+        const struct cache_key *cache_subkey = (const struct cache_key *)p;
+
+        if (p > end || end - p < sizeof(*cache_subkey) || !cache_subkey->namelen) return 0;
+        subkey = NULL;
+        if (key)
+        {
+            name.str = (const WCHAR *)(cache_subkey + 1);
+            name.len = cache_subkey->namelen;
+            if (!(subkey = find_subkey( key, &name )) && !(subkey = alloc_subkey( key, &name, 0 )))
+                return 0;
+        }
+        if (!load_cache_key( subkey, &p, end )) return 0;
+    }
+    *ptr = p;
+    return 1;
+}
+
+/* load a branch from its cache if it matches the registry file */
+static int load_registry_cache( struct key *key, const char *path )
+{
+    const struct cache_header *header;
+    const char *ptr, *end;
+    struct stat st, cache_st;
+    void *base;
+    char *name;
+    int fd, ret = 0;
+
+    if (!use_registry_cache || stat( path, &st ) == -1) return 0;
+    if (!(name = get_branch_file_name( path, ".cache" ))) return 0;
+    fd = open( name, O_RDONLY );
+    free( name );
+    if (fd == -1) return 0;
+    if (fstat( fd, &cache_st ) == -1 || cache_st.st_size < sizeof(*header))
+    {
+        close( fd );
+        return 0;
+    }
+    base = mmap( NULL, cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (base == MAP_FAILED) return 0;
+
+    header = base;
+    end = (const char *)base + cache_st.st_size;
+    ptr = (const char *)(header + 1);
+    if (!memcmp( header->magic, REGISTRY_CACHE_MAGIC, sizeof(header->magic) ) &&
+        header->version == REGISTRY_CACHE_VERSION &&
+        header->file_size == st.st_size &&
+        header->file_mtime == get_file_mtime( &st ) &&
+        header->file_ino == st.st_ino &&
+        (prefix_type == PREFIX_UNKNOWN || header->prefix_type == prefix_type) &&
+        load_cache_key( NULL, &ptr, end ) && ptr == end)
+    {
+        prefix_type = header->prefix_type;
+        ptr = (const char *)(header + 1);
+        ret = load_cache_key( key, &ptr, end );
+    }
+    munmap( base, cache_st.st_size );
+    return ret;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    struct save_branch_info *branch;
+    struct stat st;
+    char *journal_name;
+    FILE *f, *journal;
+    int loaded;
 
-    if ((f = fopen( filename, "r" )))
+    if (!(loaded = load_registry_cache( key, filename )) && (f = fopen( filename, "r" )))
     {
-        load_keys( key, filename, f, 0 );
+        loaded = 1;
+        load_keys( key, filename, f, 0, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
             return 1;
         }
+        save_registry_cache( key, filename );
     }
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    branch = &save_branch_info[save_branch_count++];
+    branch->path = filename;
+    branch->key = (struct key *)grab_object( key );
+    branch->journal = NULL;
+    branch->journal_size = 0;
+    branch->saved_size = stat( filename, &st ) ? 0 : st.st_size;
+    branch->journal_valid = 1;
     make_object_static( &key->obj );
-    return (f != NULL);
+
+    /* replay the changes that were not saved yet */
+    if ((journal_name = get_branch_file_name( filename, ".journal" )))
+    {
+        branch->journal_valid = 0;  /* don't journal the replayed changes */
+        if ((journal = fopen( journal_name, "r" )))
+        {
+            load_keys( key, journal_name, journal, 0, 1 );
+            fclose( journal );
+            clear_error();
+            make_dirty( key );
+        }
+        branch->journal_valid = 1;
+        free( journal_name );
+    }
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const SID *sid, struct unicode_str *path )
@@ -1800,6 +2273,8 @@ void init_registry(void)
 
     if (fchdir( config_dir_fd ) == -1) fatal_error( "chdir to config dir: %s\n", strerror( errno ));
 
+    if ((p = getenv( "WINEREGCACHE" ))) use_registry_cache = atoi( p );
+
     /* create the root key */
     root_key = alloc_key( &root_name, current_time );
     assert( root_key );
@@ -1892,10 +2367,12 @@ static void save_all_subkeys( struct key *key, FILE *f )
 static void save_registry( struct key *key, obj_handle_t handle )
 {
     struct file *file;
+    char *path;
     int fd;
 
     if (!(file = get_file_obj( current->process, handle, FILE_WRITE_DATA ))) return;
     fd = dup( get_file_unix_fd( file ) );
+    path = get_registry_file_cache_path( file );
     release_object( file );
     if (fd != -1)
     {
@@ -1904,6 +2381,7 @@ static void save_registry( struct key *key, obj_handle_t handle )
         {
             save_all_subkeys( key, f );
             if (fclose( f )) file_set_error();
+            else if (path) save_registry_cache( key, path );
         }
         else
         {
@@ -1911,11 +2389,14 @@ static void save_registry( struct key *key, obj_handle_t handle )
             close( fd );
         }
     }
+    free( path );
 }
 
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+static int save_branch( struct save_branch_info *branch )
 {
+    struct key *key = branch->key;
+    const char *path = branch->path;
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
@@ -1983,10 +2464,24 @@ static int save_branch( struct key *key, const char *path )
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
+    if (ret)
+    {
+        make_clean( key );
+        reset_journal( branch );
+        save_registry_cache( key, path );
+        branch->saved_size = stat( path, &st ) ? 0 : st.st_size;
+    }
     return ret;
 }
 
+/* check if the changes to a branch need to be merged into the registry file */
+static int needs_compaction( const struct save_branch_info *branch )
+{
+    if (!(branch->key->flags & KEY_DIRTY)) return 0;
+    if (!branch->journal_valid) return 1;
+    return branch->journal_size >= max( MIN_JOURNAL_COMPACT_SIZE, branch->saved_size / 2 );
+}
+
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
@@ -1995,7 +2490,7 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        if (needs_compaction( &save_branch_info[i] )) save_branch( &save_branch_info[i] );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2015,7 +2510,7 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
@@ -2219,6 +2714,7 @@ DECL_HANDLER(load_registry)
         if ((key = create_key( parent, &name, NULL, 0, KEY_WOW64_64KEY, 0, sd, &dummy )))
         {
             load_registry( key, req->file );
+            invalidate_journal( key );
             release_object( key );
         }
         release_object( parent );
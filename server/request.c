@@ -27,6 +27,7 @@
 #ifdef HAVE_PWD_H
 #include <pwd.h>
 #endif
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -122,9 +123,67 @@ static const struct fd_ops master_socket_fd_ops =
     NULL                           /* reselect_async */
 };
 
+#define MAX_WORKER_THREADS 64
 
-struct thread *current = NULL;  /* thread handling the current request */
-unsigned int global_error = 0;  /* global error code for when no thread is current */
+static struct request_stats request_stats[REQ_NB_REQUESTS];  /* statistics for all processes */
+
+struct worker_pipe
+{
+    struct object        obj;        /* object header */
+    struct fd           *fd;         /* file descriptor of the read side */
+    int                  pipe_write; /* unix fd of the write side */
+};
+
+static void worker_pipe_dump( struct object *obj, int verbose );
+static void worker_pipe_destroy( struct object *obj );
+static void worker_pipe_poll_event( struct fd *fd, int event );
+
+static const struct object_ops worker_pipe_ops =
+{
+    sizeof(struct worker_pipe),    /* size */
+    worker_pipe_dump,              /* dump */
+    no_get_type,                   /* get_type */
+    no_add_queue,                  /* add_queue */
+    NULL,                          /* remove_queue */
+    NULL,                          /* signaled */
+    NULL,                          /* satisfied */
+    no_signal,                     /* signal */
+    no_get_fd,                     /* get_fd */
+    no_map_access,                 /* map_access */
+    default_get_sd,                /* get_sd */
+    default_set_sd,                /* set_sd */
+    no_lookup_name,                /* lookup_name */
+    no_link_name,                  /* link_name */
+    NULL,                          /* unlink_name */
+    no_open_file,                  /* open_file */
+    no_kernel_obj_list,            /* get_kernel_obj_list */
+    no_close_handle,               /* close_handle */
+    worker_pipe_destroy            /* destroy */
+};
+
+static const struct fd_ops worker_pipe_fd_ops =
+{
+    NULL,                          /* get_poll_events */
+    worker_pipe_poll_event,        /* poll_event */
+    NULL,                          /* flush */
+    NULL,                          /* get_fd_type */
+    NULL,                          /* ioctl */
+    NULL,                          /* queue_async */
+    NULL                           /* reselect_async */
+};
+
+static pthread_rwlock_t server_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;
+static struct list worker_queue = LIST_INIT( worker_queue );  /* threads waiting for a worker */
+static struct list worker_done = LIST_INIT( worker_done );    /* threads whose reply has been sent */
+static struct worker_pipe *worker_pipe;  /* pipe used to notify the main thread */
+static int worker_notified;              /* has the main thread already been notified? */
+static __thread int is_worker_thread;
+
+
+__thread struct thread *current = NULL;  /* thread handling the current request */
+__thread unsigned int global_error = 0;  /* global error code for when no thread is current */
 timeout_t server_start_time = 0;  /* server startup time */
 char *server_dir = NULL;   /* server directory */
 int server_dir_fd = -1;    /* file descriptor for the server dir */
@@ -251,46 +310,321 @@ void write_reply( struct thread *thread )
         fatal_protocol_error( thread, "reply write: %s\n", strerror( errno ));
 }
 
+/* write a reply to a thread, return the number of bytes written */
+static int write_client_reply( struct thread *thread, const union generic_reply *reply )
+{
+    struct iovec vec[2];
+
+    if (!thread->reply_size)
+        return write( get_unix_fd( thread->reply_fd ), reply, sizeof(*reply) );
+
+    vec[0].iov_base = (void *)reply;
+    vec[0].iov_len  = sizeof(*reply);
+    vec[1].iov_base = thread->reply_data;
+    vec[1].iov_len  = thread->reply_size;
+    return writev( get_unix_fd( thread->reply_fd ), vec, 2 );
+}
+
+/* update the thread state once its reply has been written */
+static void reply_written( struct thread *thread, int ret, int err )
+{
+    if (ret >= (int)sizeof(union generic_reply))
+    {
+        if ((thread->reply_towrite = thread->reply_size - (ret - sizeof(union generic_reply))))
+        {
+            /* couldn't write it all, wait for POLLOUT */
+            set_fd_events( thread->reply_fd, POLLOUT );
+            set_fd_events( thread->request_fd, 0 );
+            return;
+        }
+        free( thread->reply_data );
+        thread->reply_data = NULL;
+    }
+    else if (ret >= 0)
+        fatal_protocol_error( thread, "partial write %d\n", ret );
+    else if (err == EPIPE)
+        kill_thread( thread, 0 );  /* normal death */
+    else
+        fatal_protocol_error( thread, "reply write: %s\n", strerror( err ));
+}
+
 /* send a reply to the current thread */
 static void send_reply( union generic_reply *reply )
 {
-    int ret;
+    int ret = write_client_reply( current, reply );
+    reply_written( current, ret, errno );
+}
+
+static void add_request_stats( struct request_stats *stats, timeout_t time, unsigned int bucket )
+{
+    __atomic_add_fetch( &stats->count, 1, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &stats->time, time, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &stats->latency[bucket], 1, __ATOMIC_RELAXED );
+}
 
-    if (!current->reply_size)
+/* update the statistics of a request type, globally and for the client process */
+static void record_request_stats( struct process *process, enum request req, timeout_t start )
+{
+    struct request_stats *stats = process->req_stats;
+    timeout_t time = monotonic_counter() - start;
+    unsigned int bucket = 0;
+
+    while (bucket < NB_LATENCY_BUCKETS - 1 && (time >> (bucket + 1))) bucket++;
+    add_request_stats( &request_stats[req], time, bucket );
+
+    /* this can run on worker threads too, so the array is installed atomically */
+    if (!stats)
     {
-        if ((ret = write( get_unix_fd( current->reply_fd ),
-                          reply, sizeof(*reply) )) != sizeof(*reply)) goto error;
+        struct request_stats *expected = NULL;
+
+        if (!(stats = calloc( REQ_NB_REQUESTS, sizeof(*stats) ))) return;
+        if (!__atomic_compare_exchange_n( &process->req_stats, &expected, stats, 0,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+        {
+            free( stats );
+            stats = expected;
+        }
     }
-    else
+    add_request_stats( &stats[req], time, bucket );
+}
+
+/* print a table of request statistics */
+void print_request_stats( const struct request_stats *stats )
+{
+    enum request req;
+    unsigned int i;
+
+    for (req = 0; req < REQ_NB_REQUESTS; req++)
     {
-        struct iovec vec[2];
+        if (!stats[req].count) continue;
+        fprintf( stderr, "  %-32s %10u calls %12.2f avg  ", get_request_name( req ),
+                 stats[req].count, stats[req].time / 10.0 / stats[req].count );
+        for (i = 0; i < NB_LATENCY_BUCKETS; i++)
+            if (stats[req].latency[i])
+                fprintf( stderr, " <%g:%u", (2 << i) / 10.0, stats[req].latency[i] );
+        fputc( '\n', stderr );
+    }
+}
+
+/* print the request statistics, for all processes and for each running process */
+void dump_request_stats(void)
+{
+    fprintf( stderr, "wineserver: request latencies in microseconds, all processes\n" );
+    print_request_stats( request_stats );
+    dump_process_request_stats();
+}
 
-        vec[0].iov_base = (void *)reply;
-        vec[0].iov_len  = sizeof(*reply);
-        vec[1].iov_base = current->reply_data;
-        vec[1].iov_len  = current->reply_size;
+/* retrieve the request statistics */
+DECL_HANDLER(get_request_stats)
+{
+    const struct request_stats *stats = request_stats;
+    struct request_stats *ptr;
+    struct process *process = NULL;
+    enum request i;
 
-        if ((ret = writev( get_unix_fd( current->reply_fd ), vec, 2 )) < sizeof(*reply)) goto error;
+    if (req->pid)
+    {
+        if (!(process = get_process_from_id( req->pid ))) return;
+        stats = process->req_stats;
+    }
+
+    reply->total = 0;
+    if (stats)
+        for (i = 0; i < REQ_NB_REQUESTS; i++) if (stats[i].count) reply->total++;
 
-        if ((current->reply_towrite = current->reply_size - (ret - sizeof(*reply))))
+    if (reply->total * sizeof(*ptr) > get_reply_max_size())
+        set_error( STATUS_BUFFER_TOO_SMALL );
+    else if (reply->total && (ptr = set_reply_data_size( reply->total * sizeof(*ptr) )))
+    {
+        for (i = 0; i < REQ_NB_REQUESTS; i++)
         {
-            /* couldn't write it all, wait for POLLOUT */
-            set_fd_events( current->reply_fd, POLLOUT );
-            set_fd_events( current->request_fd, 0 );
+            if (!stats[i].count) continue;
+            *ptr = stats[i];
+            ptr->req = i;
+            ptr++;
+        }
+    }
+    if (process) release_object( process );
+}
+
+/* check if a request can be part of a batch; it must not block or send a fd to the client */
+static int is_batch_request_allowed( enum request type )
+{
+    switch (type)
+    {
+    case REQ_new_process:
+    case REQ_new_thread:
+    case REQ_get_new_process_info:
+    case REQ_close_handle:
+    case REQ_dup_handle:
+    case REQ_set_handle_info:
+    case REQ_get_handle_info:
+    case REQ_get_object_info:
+    case REQ_get_object_type:
+    case REQ_create_event:
+    case REQ_open_event:
+    case REQ_create_mutex:
+    case REQ_open_mutex:
+    case REQ_create_semaphore:
+    case REQ_open_semaphore:
+    case REQ_create_file:
+    case REQ_open_file_object:
+    case REQ_create_mapping:
+    case REQ_open_mapping:
+    case REQ_get_mapping_info:
+    case REQ_create_key:
+    case REQ_open_key:
+    case REQ_get_key_value:
+    case REQ_set_key_value:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* check the sizes and the types of all the requests of a batch before performing any of them */
+static int validate_batch_requests( const char *data, data_size_t size, unsigned int count )
+{
+    struct request_header header;
+    data_size_t pos = 0;
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (pos > size || size - pos < sizeof(struct batch_request_header) + sizeof(union generic_request))
+            return 0;
+        memcpy( &header, data + pos + sizeof(struct batch_request_header), sizeof(header) );
+        pos += sizeof(struct batch_request_header) + sizeof(union generic_request);
+        if (header.request_size > size - pos || !is_batch_request_allowed( header.req )) return 0;
+        pos = (pos + header.request_size + 7) & ~7;
+    }
+    return 1;
+}
+
+/* perform a batch of requests, see the batch_requests definition in protocol.def */
+DECL_HANDLER(batch_requests)
+{
+    struct thread *thread = current;
+    const char *data = get_req_data();
+    data_size_t size = get_req_data_size(), pos = 0;
+    data_size_t reply_max = get_reply_max_size(), reply_pos = 0;
+    union generic_request outer_req = thread->req;
+    void *outer_data = thread->req_data;
+    unsigned int count = req->count;  /* req points to the current request, which is replaced below */
+    unsigned int status = STATUS_SUCCESS;
+    data_size_t *reply_offsets;
+    char *replies = NULL;
+    unsigned int i;
+
+    if (count > size / (sizeof(struct batch_request_header) + sizeof(union generic_request)) ||
+        !validate_batch_requests( data, size, count ))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (!(reply_offsets = mem_alloc( count * sizeof(*reply_offsets) + 1 ))) return;
+    if (reply_max && !(replies = calloc( 1, reply_max )))
+    {
+        free( reply_offsets );
+        set_error( STATUS_NO_MEMORY );
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        const struct batch_request_header *header = (const struct batch_request_header *)(data + pos);
+        union generic_request sub_req;
+        union generic_reply sub_reply;
+        enum request type;
+        obj_handle_t handle;
+
+        if (pos > size || size - pos < sizeof(*header) + sizeof(sub_req))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        memcpy( &sub_req, header + 1, sizeof(sub_req) );
+        pos += sizeof(*header) + sizeof(sub_req);
+        type = sub_req.request_header.req;
+        if (sub_req.request_header.request_size > size - pos)
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        /* replace a handle by the one returned by an earlier request */
+        if (header->ref_index)
+        {
+            if (header->ref_index > i ||
+                header->ref_offset > sizeof(sub_req) - sizeof(handle) ||
+                header->ref_reply_offset > sizeof(sub_reply) - sizeof(handle))
+            {
+                status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+            memcpy( &handle, replies + reply_offsets[header->ref_index - 1] + header->ref_reply_offset,
+                    sizeof(handle) );
+            memcpy( (char *)&sub_req + header->ref_offset, &handle, sizeof(handle) );
+        }
+
+        thread->req = sub_req;
+        thread->req_data = (void *)(data + pos);
+        thread->reply_size = 0;
+        thread->reply_data = NULL;
+        clear_error();
+        memset( &sub_reply, 0, sizeof(sub_reply) );
+
+        if (debug_level) trace_request();
+        req_handlers[type]( &thread->req, &sub_reply );
+
+        if (!current)  /* the thread has been killed */
+        {
+            free( thread->reply_data );
+            thread->reply_data = NULL;
+            thread->reply_size = 0;
+            thread->req = outer_req;
+            thread->req_data = outer_data;
+            free( reply_offsets );
+            free( replies );
             return;
         }
+
+        sub_reply.reply_header.error = thread->error;
+        sub_reply.reply_header.reply_size = thread->reply_size;
+        if (debug_level) trace_reply( type, &sub_reply );
+
+        if (sizeof(sub_reply) + ((thread->reply_size + 7) & ~7) > reply_max - reply_pos)
+        {
+            free( thread->reply_data );
+            thread->reply_data = NULL;
+            status = STATUS_BUFFER_OVERFLOW;
+            break;
+        }
+        reply_offsets[i] = reply_pos;
+        memcpy( replies + reply_pos, &sub_reply, sizeof(sub_reply) );
+        if (thread->reply_size)
+            memcpy( replies + reply_pos + sizeof(sub_reply), thread->reply_data, thread->reply_size );
+        reply_pos += sizeof(sub_reply) + ((thread->reply_size + 7) & ~7);
+        free( thread->reply_data );
+        thread->reply_data = NULL;
+
+        pos = (pos + sub_req.request_header.request_size + 7) & ~7;
+        if (sub_reply.reply_header.error)
+        {
+            i++;
+            break;
+        }
     }
-    free( current->reply_data );
-    current->reply_data = NULL;
-    return;
 
- error:
-    if (ret >= 0)
-        fatal_protocol_error( current, "partial write %d\n", ret );
-    else if (errno == EPIPE)
-        kill_thread( current, 0 );  /* normal death */
-    else
-        fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
+    thread->req = outer_req;
+    thread->req_data = outer_data;
+    thread->reply_size = 0;
+    set_error( status );
+
+    reply->count = i;
+    if (reply_pos) set_reply_data_ptr( replies, reply_pos );
+    else free( replies );
+    free( reply_offsets );
 }
 
 /* call a request handler */
@@ -298,6 +632,8 @@ static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    struct process *process = thread->process;
+    timeout_t start = thread->req_start;
 
     current = thread;
     current->reply_size = 0;
@@ -327,6 +663,213 @@ static void call_req_handler( struct thread *thread )
         }
     }
     current = NULL;
+    if (req < REQ_NB_REQUESTS) record_request_stats( process, req, start );
+}
+
+/* requests that only read the server state, see the locking notes in object.h */
+static int is_concurrent_request( enum request req )
+{
+    switch (req)
+    {
+    case REQ_get_handle_fd:
+    case REQ_get_process_info:
+    case REQ_get_process_vm_counters:
+    case REQ_get_thread_info:
+    case REQ_get_thread_times:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* call a request handler from a worker thread, with the server lock held shared */
+static void call_worker_req_handler( struct thread *thread )
+{
+    union generic_reply reply;
+    enum request req = thread->req.request_header.req;
+
+    current = thread;
+    current->reply_size = 0;
+    clear_error();
+    memset( &reply, 0, sizeof(reply) );
+
+    req_handlers[req]( &current->req, &reply );
+
+    reply.reply_header.error = current->error;
+    reply.reply_header.reply_size = current->reply_size;
+    thread->worker_ret = write_client_reply( thread, &reply );
+    thread->worker_errno = errno;
+    current = NULL;
+    record_request_stats( thread->process, req, thread->req_start );
+}
+
+static void *worker_thread( void *arg )
+{
+    struct thread *thread;
+    struct list *ptr;
+    char dummy = 0;
+
+    is_worker_thread = 1;
+    for (;;)
+    {
+        pthread_mutex_lock( &worker_mutex );
+        while (!(ptr = list_head( &worker_queue ))) pthread_cond_wait( &worker_cond, &worker_mutex );
+        list_remove( ptr );
+        pthread_mutex_unlock( &worker_mutex );
+        thread = LIST_ENTRY( ptr, struct thread, worker_entry );
+
+        pthread_rwlock_rdlock( &server_lock );
+        if (thread->reply_fd) call_worker_req_handler( thread );
+        pthread_mutex_lock( &worker_mutex );
+        list_add_tail( &worker_done, &thread->worker_entry );
+        if (!worker_notified)
+        {
+            worker_notified = 1;
+            write( worker_pipe->pipe_write, &dummy, 1 );
+        }
+        pthread_mutex_unlock( &worker_mutex );
+        pthread_rwlock_unlock( &server_lock );
+    }
+    return NULL;
+}
+
+/* hand a request over to the worker threads if possible */
+static int queue_worker_request( struct thread *thread )
+{
+    if (!nb_worker_threads || debug_level) return 0;
+    if (!is_concurrent_request( thread->req.request_header.req )) return 0;
+
+    /* stop reading requests until the reply has been sent */
+    set_fd_events( thread->request_fd, 0 );
+    grab_object( thread );
+    pthread_mutex_lock( &worker_mutex );
+    list_add_tail( &worker_queue, &thread->worker_entry );
+    pthread_cond_signal( &worker_cond );
+    pthread_mutex_unlock( &worker_mutex );
+    return 1;
+}
+
+/* complete a request handled by a worker thread */
+static void finish_worker_request( struct thread *thread )
+{
+    free( thread->req_data );
+    thread->req_data = NULL;
+    if (thread->reply_fd)
+    {
+        set_fd_events( thread->request_fd, POLLIN );
+        if (thread->worker_kill)
+        {
+            kill_process( thread->process, thread->worker_kill - 1 );
+            thread->worker_kill = 0;
+        }
+        else reply_written( thread, thread->worker_ret, thread->worker_errno );
+    }
+    release_object( thread );
+}
+
+static void worker_pipe_dump( struct object *obj, int verbose )
+{
+    struct worker_pipe *pipe = (struct worker_pipe *)obj;
+    assert( obj->ops == &worker_pipe_ops );
+    fprintf( stderr, "Worker pipe fd=%p\n", pipe->fd );
+}
+
+static void worker_pipe_destroy( struct object *obj )
+{
+    struct worker_pipe *pipe = (struct worker_pipe *)obj;
+    assert( obj->ops == &worker_pipe_ops );
+    if (pipe->fd) release_object( pipe->fd );
+    close( pipe->pipe_write );
+}
+
+static void worker_pipe_poll_event( struct fd *fd, int event )
+{
+    struct list done = LIST_INIT( done ), *ptr;
+    char buffer[16];
+
+    read( get_unix_fd( fd ), buffer, sizeof(buffer) );
+
+    pthread_mutex_lock( &worker_mutex );
+    list_move_tail( &done, &worker_done );
+    worker_notified = 0;
+    pthread_mutex_unlock( &worker_mutex );
+
+    while ((ptr = list_head( &done )))
+    {
+        list_remove( ptr );
+        finish_worker_request( LIST_ENTRY( ptr, struct thread, worker_entry ));
+    }
+}
+
+/* start the request worker threads */
+void start_request_workers(void)
+{
+    sigset_t sigset, old_sigset;
+    pthread_t thread;
+    int i, fd[2];
+    int count = min( nb_worker_threads, MAX_WORKER_THREADS );
+
+    nb_worker_threads = 0;
+    if (count <= 0) return;
+
+    if (debug_level)
+    {
+        fprintf( stderr, "wineserver: request worker threads are not used in debug mode\n" );
+        return;
+    }
+    if (pipe( fd ) == -1) return;
+    if (!(worker_pipe = alloc_object( &worker_pipe_ops )))
+    {
+        close( fd[0] );
+        close( fd[1] );
+        return;
+    }
+    worker_pipe->pipe_write = fd[1];
+    fcntl( fd[1], F_SETFL, O_NONBLOCK );
+    if (!(worker_pipe->fd = create_anonymous_fd( &worker_pipe_fd_ops, fd[0], &worker_pipe->obj, 0 )))
+    {
+        release_object( worker_pipe );
+        worker_pipe = NULL;
+        return;
+    }
+    set_fd_events( worker_pipe->fd, POLLIN );
+    make_object_static( &worker_pipe->obj );
+
+    /* the main thread owns the server lock except while it waits for events */
+    pthread_rwlock_wrlock( &server_lock );
+
+    /* signals are handled by the main thread */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    for (i = 0; i < count; i++)
+    {
+        if (pthread_create( &thread, NULL, worker_thread, NULL )) break;
+        pthread_detach( thread );
+    }
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+    nb_worker_threads = i;
+}
+
+/* acquire the server lock after waiting for events */
+void lock_server(void)
+{
+    if (nb_worker_threads) pthread_rwlock_wrlock( &server_lock );
+}
+
+/* release the server lock before waiting for events */
+void unlock_server(void)
+{
+    if (nb_worker_threads) pthread_rwlock_unlock( &server_lock );
+}
+
+/* handle a request once it has been completely read */
+static void handle_request( struct thread *thread )
+{
+    thread->req_start = monotonic_counter();
+    if (queue_worker_request( thread )) return;
+    call_req_handler( thread );
+    free( thread->req_data );
+    thread->req_data = NULL;
 }
 
 /* read a request from a thread */
@@ -341,7 +884,7 @@ void read_request( struct thread *thread )
         if (!(thread->req_toread = thread->req.request_header.request_size))
         {
             /* no data, handle request at once */
-            call_req_handler( thread );
+            handle_request( thread );
             return;
         }
         if (!(thread->req_data = malloc( thread->req_toread )))
@@ -362,9 +905,7 @@ void read_request( struct thread *thread )
         if (ret <= 0) break;
         if (!(thread->req_toread -= ret))
         {
-            call_req_handler( thread );
-            free( thread->req_data );
-            thread->req_data = NULL;
+            handle_request( thread );
             return;
         }
     }
@@ -470,7 +1011,7 @@ int send_client_fd( struct process *process, int fd, obj_handle_t handle )
 {
     struct iovec vec;
     struct msghdr msghdr;
-    int ret;
+    int ret, violent = 0;
 
 #ifdef HAVE_STRUCT_MSGHDR_MSG_ACCRIGHTS
     msghdr.msg_accrightslen = sizeof(fd);
@@ -507,18 +1048,21 @@ int send_client_fd( struct process *process, int fd, obj_handle_t handle )
     if (ret >= 0)
     {
         fprintf( stderr, "Protocol error: process %04x: partial sendmsg %d\n", process->id, ret );
-        kill_process( process, 1 );
-    }
-    else if (errno == EPIPE)
-    {
-        kill_process( process, 0 );
+        violent = 1;
     }
-    else
+    else if (errno != EPIPE)
     {
         fprintf( stderr, "Protocol error: process %04x: ", process->id );
         perror( "sendmsg" );
-        kill_process( process, 1 );
+        violent = 1;
+    }
+
+    if (is_worker_thread)  /* let the main thread kill it */
+    {
+        assert( process == current->process );
+        current->worker_kill = violent + 1;
     }
+    else kill_process( process, violent );
     return -1;
 }
 
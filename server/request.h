@@ -63,8 +63,13 @@ extern int kill_lock_owner( int sig );
 extern char *server_dir;
 extern int server_dir_fd, config_dir_fd;
 
+extern void start_request_workers(void);
+extern void print_request_stats( const struct request_stats *stats );
+extern void dump_request_stats(void);
+
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern const char *get_request_name( enum request req );
 
 /* get current tick count to return to client */
 static inline unsigned int get_tick_count(void)
@@ -161,6 +166,9 @@ DECL_HANDLER(create_semaphore);
 DECL_HANDLER(release_semaphore);
 DECL_HANDLER(query_semaphore);
 DECL_HANDLER(open_semaphore);
+DECL_HANDLER(get_fast_sync_shm);
+DECL_HANDLER(get_fast_sync);
+DECL_HANDLER(fast_sync_wake);
 DECL_HANDLER(create_file);
 DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
@@ -199,6 +207,7 @@ DECL_HANDLER(read_change);
 DECL_HANDLER(create_mapping);
 DECL_HANDLER(open_mapping);
 DECL_HANDLER(get_mapping_info);
+DECL_HANDLER(get_image_reloc_file);
 DECL_HANDLER(map_view);
 DECL_HANDLER(unmap_view);
 DECL_HANDLER(get_mapping_committed_range);
@@ -242,6 +251,7 @@ DECL_HANDLER(set_atom_information);
 DECL_HANDLER(empty_atom_table);
 DECL_HANDLER(init_atom_table);
 DECL_HANDLER(get_msg_queue);
+DECL_HANDLER(get_user_shm);
 DECL_HANDLER(set_queue_fd);
 DECL_HANDLER(set_queue_mask);
 DECL_HANDLER(get_queue_status);
@@ -365,6 +375,8 @@ DECL_HANDLER(open_symlink);
 DECL_HANDLER(query_symlink);
 DECL_HANDLER(get_object_info);
 DECL_HANDLER(get_object_type);
+DECL_HANDLER(get_handle_info);
+DECL_HANDLER(get_handle_cache_shm);
 DECL_HANDLER(unlink_object);
 DECL_HANDLER(get_token_impersonation_level);
 DECL_HANDLER(allocate_locally_unique_id);
@@ -384,6 +396,7 @@ DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
 DECL_HANDLER(query_completion);
+DECL_HANDLER(get_completion_shm);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
 DECL_HANDLER(set_fd_completion_mode);
@@ -406,6 +419,8 @@ DECL_HANDLER(get_job_info);
 DECL_HANDLER(terminate_job);
 DECL_HANDLER(suspend_process);
 DECL_HANDLER(resume_process);
+DECL_HANDLER(get_request_stats);
+DECL_HANDLER(batch_requests);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -454,6 +469,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_release_semaphore,
     (req_handler)req_query_semaphore,
     (req_handler)req_open_semaphore,
+    (req_handler)req_get_fast_sync_shm,
+    (req_handler)req_get_fast_sync,
+    (req_handler)req_fast_sync_wake,
     (req_handler)req_create_file,
     (req_handler)req_open_file_object,
     (req_handler)req_alloc_file_handle,
@@ -492,6 +510,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_create_mapping,
     (req_handler)req_open_mapping,
     (req_handler)req_get_mapping_info,
+    (req_handler)req_get_image_reloc_file,
     (req_handler)req_map_view,
     (req_handler)req_unmap_view,
     (req_handler)req_get_mapping_committed_range,
@@ -535,6 +554,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_empty_atom_table,
     (req_handler)req_init_atom_table,
     (req_handler)req_get_msg_queue,
+    (req_handler)req_get_user_shm,
     (req_handler)req_set_queue_fd,
     (req_handler)req_set_queue_mask,
     (req_handler)req_get_queue_status,
@@ -658,6 +678,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_query_symlink,
     (req_handler)req_get_object_info,
     (req_handler)req_get_object_type,
+    (req_handler)req_get_handle_info,
+    (req_handler)req_get_handle_cache_shm,
     (req_handler)req_unlink_object,
     (req_handler)req_get_token_impersonation_level,
     (req_handler)req_allocate_locally_unique_id,
@@ -677,6 +699,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
     (req_handler)req_query_completion,
+    (req_handler)req_get_completion_shm,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
     (req_handler)req_set_fd_completion_mode,
@@ -699,6 +722,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_terminate_job,
     (req_handler)req_suspend_process,
     (req_handler)req_resume_process,
+    (req_handler)req_get_request_stats,
+    (req_handler)req_batch_requests,
 };
 
 C_ASSERT( sizeof(abstime_t) == 8 );
@@ -1000,6 +1025,18 @@ C_ASSERT( FIELD_OFFSET(struct open_semaphore_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_semaphore_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_semaphore_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_semaphore_reply) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_shm_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_fast_sync_shm_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_fast_sync_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, index) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, type) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, access) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, serial) == 20 );
+C_ASSERT( sizeof(struct get_fast_sync_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct fast_sync_wake_request, handle) == 12 );
+C_ASSERT( sizeof(struct fast_sync_wake_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, sharing) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, create) == 20 );
@@ -1105,6 +1142,8 @@ C_ASSERT( FIELD_OFFSET(struct enable_socket_event_request, mask) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enable_socket_event_request, sstate) == 20 );
 C_ASSERT( FIELD_OFFSET(struct enable_socket_event_request, cstate) == 24 );
 C_ASSERT( sizeof(struct enable_socket_event_request) == 32 );
+C_ASSERT( FIELD_OFFSET(struct enable_socket_event_reply, state) == 8 );
+C_ASSERT( sizeof(struct enable_socket_event_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_socket_deferred_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_socket_deferred_request, deferred) == 16 );
 C_ASSERT( sizeof(struct set_socket_deferred_request) == 24 );
@@ -1228,6 +1267,11 @@ C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, size) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, flags) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, shared_file) == 20 );
 C_ASSERT( sizeof(struct get_mapping_info_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_file_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_file_request, base) == 16 );
+C_ASSERT( sizeof(struct get_image_reloc_file_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_file_reply, file) == 8 );
+C_ASSERT( sizeof(struct get_image_reloc_file_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, mapping) == 12 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, base) == 24 );
@@ -1423,7 +1467,13 @@ C_ASSERT( FIELD_OFFSET(struct init_atom_table_reply, table) == 8 );
 C_ASSERT( sizeof(struct init_atom_table_reply) == 16 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, shm_index) == 12 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
+C_ASSERT( sizeof(struct get_user_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_user_shm_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_user_shm_reply, id) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_user_shm_reply, size) == 16 );
+C_ASSERT( sizeof(struct get_user_shm_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_mask_request, wake_mask) == 12 );
@@ -2158,6 +2208,14 @@ C_ASSERT( FIELD_OFFSET(struct get_object_type_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_object_type_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_object_type_reply, total) == 8 );
 C_ASSERT( sizeof(struct get_object_type_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_info_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_handle_info_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_info_reply, access) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_info_reply, flags) == 12 );
+C_ASSERT( sizeof(struct get_handle_info_reply) == 16 );
+C_ASSERT( sizeof(struct get_handle_cache_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_cache_shm_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_handle_cache_shm_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct unlink_object_request, handle) == 12 );
 C_ASSERT( sizeof(struct unlink_object_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_token_impersonation_level_request, handle) == 12 );
@@ -2241,7 +2299,8 @@ C_ASSERT( FIELD_OFFSET(struct add_completion_request, information) == 32 );
 C_ASSERT( FIELD_OFFSET(struct add_completion_request, status) == 40 );
 C_ASSERT( sizeof(struct add_completion_request) == 48 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_request, handle) == 12 );
-C_ASSERT( sizeof(struct remove_completion_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct remove_completion_request, ring_stalled) == 16 );
+C_ASSERT( sizeof(struct remove_completion_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, ckey) == 8 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
@@ -2251,6 +2310,11 @@ C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
 C_ASSERT( sizeof(struct query_completion_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_shm_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_completion_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_shm_reply, size) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_shm_reply, serial) == 16 );
+C_ASSERT( sizeof(struct get_completion_shm_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, ckey) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, chandle) == 24 );
@@ -2347,6 +2411,14 @@ C_ASSERT( FIELD_OFFSET(struct suspend_process_request, handle) == 12 );
 C_ASSERT( sizeof(struct suspend_process_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct resume_process_request, handle) == 12 );
 C_ASSERT( sizeof(struct resume_process_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_request, pid) == 12 );
+C_ASSERT( sizeof(struct get_request_stats_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_reply, total) == 8 );
+C_ASSERT( sizeof(struct get_request_stats_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct batch_requests_request, count) == 12 );
+C_ASSERT( sizeof(struct batch_requests_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct batch_requests_reply, count) == 8 );
+C_ASSERT( sizeof(struct batch_requests_reply) == 16 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
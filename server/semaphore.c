@@ -39,7 +39,7 @@
 struct semaphore
 {
     struct object  obj;    /* object header */
-    unsigned int   count;  /* current count */
+    unsigned int   count;  /* current count (unless kept in shared memory) */
     unsigned int   max;    /* maximum possible count */
 };
 
@@ -55,8 +55,8 @@ static const struct object_ops semaphore_ops =
     sizeof(struct semaphore),      /* size */
     semaphore_dump,                /* dump */
     semaphore_get_type,            /* get_type */
-    add_queue,                     /* add_queue */
-    remove_queue,                  /* remove_queue */
+    fast_sync_add_queue,           /* add_queue */
+    fast_sync_remove_queue,        /* remove_queue */
     semaphore_signaled,            /* signaled */
     semaphore_satisfied,           /* satisfied */
     semaphore_signal,              /* signal */
@@ -92,38 +92,69 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+            alloc_fast_sync( &sem->obj, FAST_SYNC_SEMAPHORE, initial, max );
         }
     }
     return sem;
 }
 
+static unsigned int get_semaphore_count( struct semaphore *sem )
+{
+    fast_sync_t *slot;
+    unsigned int count;
+
+    if (!sem->obj.fast_sync) return sem->count;
+    slot = lock_fast_sync( &sem->obj );
+    count = get_fast_sync_state( slot );
+    unlock_fast_sync( &sem->obj );
+    /* the client may have stored anything there */
+    return min( count, sem->max );
+}
+
+static void set_semaphore_count( struct semaphore *sem, unsigned int count )
+{
+    if (sem->obj.fast_sync)
+    {
+        set_fast_sync_state( lock_fast_sync( &sem->obj ), count );
+        unlock_fast_sync( &sem->obj );
+    }
+    else sem->count = count;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
-    if (prev) *prev = sem->count;
-    if (sem->count + count < sem->count || sem->count + count > sem->max)
+    unsigned int current_count;
+    int ret = 1;
+
+    if (sem->obj.fast_sync) lock_fast_sync( &sem->obj );
+    current_count = get_semaphore_count( sem );
+    if (prev) *prev = current_count;
+    if (current_count + count < current_count || current_count + count > sem->max)
     {
         set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
-        return 0;
+        ret = 0;
     }
-    else if (sem->count)
+    else if (current_count && !sem->obj.fast_sync)
     {
         /* there cannot be any thread to wake up if the count is != 0 */
         sem->count += count;
     }
     else
     {
-        sem->count = count;
-        wake_up( &sem->obj, count );
+        /* with shared memory, clients may have raised the count without waking anybody */
+        set_semaphore_count( sem, current_count + count );
+        wake_up( &sem->obj, current_count ? 0 : count );
     }
-    return 1;
+    if (sem->obj.fast_sync) unlock_fast_sync( &sem->obj );
+    return ret;
 }
 
 static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d\n", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d\n", get_semaphore_count( sem ), sem->max );
 }
 
 static struct object_type *semaphore_get_type( struct object *obj )
@@ -137,15 +168,17 @@ static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entr
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    return (sem->count > 0);
+    return (get_semaphore_count( sem ) > 0);
 }
 
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
+    unsigned int count;
+
     assert( obj->ops == &semaphore_ops );
-    assert( sem->count );
-    sem->count--;
+    /* don't trust the shared count, a client may have changed it while it was locked */
+    if ((count = get_semaphore_count( sem ))) set_semaphore_count( sem, count - 1 );
 }
 
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access )
@@ -224,7 +257,7 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
+        reply->current = get_semaphore_count( sem );
         reply->max = sem->max;
         release_object( sem );
     }
@@ -1297,6 +1297,7 @@ DECL_HANDLER(enable_socket_event)
     sock->state |= req->sstate;
     sock->state &= ~req->cstate;
     if ( sock->type != SOCK_STREAM ) sock->state &= ~STREAM_FLAG_MASK;
+    reply->state = sock->state;
 
     sock_reselect( sock );
 
@@ -76,6 +76,7 @@ struct thread_wait
     int                     count;      /* count of objects */
     int                     flags;
     int                     abandoned;
+    int                     locked;     /* shared objects are locked until the end of the wait */
     enum select_op          select;
     client_ptr_t            key;        /* wait key for keyed events */
     client_ptr_t            cookie;     /* magic cookie to return to client */
@@ -227,6 +228,10 @@ static inline void init_thread_structure( struct thread *thread )
     thread->req_toread      = 0;
     thread->reply_data      = NULL;
     thread->reply_towrite   = 0;
+    thread->req_start       = 0;
+    thread->worker_ret      = 0;
+    thread->worker_errno    = 0;
+    thread->worker_kill     = 0;
     thread->request_fd      = NULL;
     thread->reply_fd        = NULL;
     thread->wait_fd         = NULL;
@@ -720,6 +725,27 @@ void make_wait_abandoned( struct wait_queue_entry *entry )
     entry->wait->abandoned = 1;
 }
 
+/* keep clients from changing the state of the wait objects until the wait is finished */
+static void lock_wait_objects( struct thread_wait *wait )
+{
+    struct wait_queue_entry *entry;
+    int i;
+
+    for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+        if (entry->obj->fast_sync) lock_fast_sync( entry->obj );
+    wait->locked = 1;
+}
+
+static void unlock_wait_objects( struct thread_wait *wait )
+{
+    struct wait_queue_entry *entry;
+    int i;
+
+    for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+        if (entry->obj->fast_sync) unlock_fast_sync( entry->obj );
+    wait->locked = 0;
+}
+
 /* finish waiting */
 static unsigned int end_wait( struct thread *thread, unsigned int status )
 {
@@ -744,6 +770,7 @@ static unsigned int end_wait( struct thread *thread, unsigned int status )
         }
         if (wait->abandoned) status += STATUS_ABANDONED_WAIT_0;
     }
+    if (wait->locked) unlock_wait_objects( wait );
     for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
         entry->obj->ops->remove_queue( entry->obj, entry );
     if (wait->user) remove_timeout_user( wait->user );
@@ -769,6 +796,7 @@ static int wait_on( const select_op_t *select_op, unsigned int count, struct obj
     wait->user    = NULL;
     wait->when = when;
     wait->abandoned = 0;
+    wait->locked = 0;
     current->wait = wait;
 
     for (i = 0, entry = wait->queues; i < count; i++, entry++)
@@ -819,6 +847,9 @@ static int check_wait( struct thread *thread )
     /* Suspended threads may not acquire locks, but they can run system APCs */
     if (thread->process->suspend + thread->suspend > 0) return -1;
 
+    /* the objects stay locked until end_wait() if the wait is satisfied */
+    if (!wait->locked) lock_wait_objects( wait );
+
     if (wait->select == SELECT_WAIT_ALL)
     {
         int not_ok = 0;
@@ -837,6 +868,7 @@ static int check_wait( struct thread *thread )
     if ((wait->flags & SELECT_ALERTABLE) && !list_empty(&thread->user_apc)) return STATUS_USER_APC;
     if (wait->when >= 0 && wait->when <= current_time) return STATUS_TIMEOUT;
     if (wait->when < 0 && -wait->when <= monotonic_time) return STATUS_TIMEOUT;
+    unlock_wait_objects( wait );
     return -1;
 }
 
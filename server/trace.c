@@ -1269,6 +1269,24 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_request_stats( const char *prefix, data_size_t size )
+{
+    const struct request_stats *stats;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*stats))
+    {
+        stats = cur_data;
+        fprintf( stderr, "{req=%u,count=%u,", stats->req, stats->count );
+        dump_uint64( "time=", (const unsigned __int64 *)&stats->time );
+        fputc( '}', stderr );
+        size -= sizeof(*stats);
+        remove_data( sizeof(*stats) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 typedef void (*dump_func)( const void *req );
 
 /* Everything below this line is generated automatically by tools/make_requests */
@@ -1800,6 +1818,33 @@ static void dump_open_semaphore_reply( const struct open_semaphore_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_fast_sync_shm_request( const struct get_fast_sync_shm_request *req )
+{
+}
+
+static void dump_get_fast_sync_shm_reply( const struct get_fast_sync_shm_reply *req )
+{
+    dump_uint64( " size=", &req->size );
+}
+
+static void dump_get_fast_sync_request( const struct get_fast_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fast_sync_reply( const struct get_fast_sync_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+    fprintf( stderr, ", type=%08x", req->type );
+    fprintf( stderr, ", access=%08x", req->access );
+    fprintf( stderr, ", serial=%08x", req->serial );
+}
+
+static void dump_fast_sync_wake_request( const struct fast_sync_wake_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_create_file_request( const struct create_file_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2009,6 +2054,11 @@ static void dump_enable_socket_event_request( const struct enable_socket_event_r
     fprintf( stderr, ", cstate=%08x", req->cstate );
 }
 
+static void dump_enable_socket_event_reply( const struct enable_socket_event_reply *req )
+{
+    fprintf( stderr, " state=%08x", req->state );
+}
+
 static void dump_set_socket_deferred_request( const struct set_socket_deferred_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -2241,6 +2291,17 @@ static void dump_get_mapping_info_reply( const struct get_mapping_info_reply *re
     dump_varargs_pe_image_info( ", image=", cur_size );
 }
 
+static void dump_get_image_reloc_file_request( const struct get_image_reloc_file_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    dump_uint64( ", base=", &req->base );
+}
+
+static void dump_get_image_reloc_file_reply( const struct get_image_reloc_file_reply *req )
+{
+    fprintf( stderr, " file=%04x", req->file );
+}
+
 static void dump_map_view_request( const struct map_view_request *req )
 {
     fprintf( stderr, " mapping=%04x", req->mapping );
@@ -2658,6 +2719,18 @@ static void dump_get_msg_queue_request( const struct get_msg_queue_request *req
 static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", shm_index=%08x", req->shm_index );
+}
+
+static void dump_get_user_shm_request( const struct get_user_shm_request *req )
+{
+}
+
+static void dump_get_user_shm_reply( const struct get_user_shm_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", id=%08x", req->id );
+    dump_uint64( ", size=", &req->size );
 }
 
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
@@ -4118,6 +4191,27 @@ static void dump_get_object_type_reply( const struct get_object_type_reply *req
     dump_varargs_unicode_str( ", type=", cur_size );
 }
 
+static void dump_get_handle_info_request( const struct get_handle_info_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_handle_info_reply( const struct get_handle_info_reply *req )
+{
+    fprintf( stderr, " access=%08x", req->access );
+    fprintf( stderr, ", flags=%08x", req->flags );
+    dump_varargs_unicode_str( ", type=", cur_size );
+}
+
+static void dump_get_handle_cache_shm_request( const struct get_handle_cache_shm_request *req )
+{
+}
+
+static void dump_get_handle_cache_shm_reply( const struct get_handle_cache_shm_reply *req )
+{
+    dump_uint64( " size=", &req->size );
+}
+
 static void dump_unlink_object_request( const struct unlink_object_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4288,6 +4382,7 @@ static void dump_add_completion_request( const struct add_completion_request *re
 static void dump_remove_completion_request( const struct remove_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", ring_stalled=%d", req->ring_stalled );
 }
 
 static void dump_remove_completion_reply( const struct remove_completion_reply *req )
@@ -4308,6 +4403,17 @@ static void dump_query_completion_reply( const struct query_completion_reply *re
     fprintf( stderr, " depth=%08x", req->depth );
 }
 
+static void dump_get_completion_shm_request( const struct get_completion_shm_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_completion_shm_reply( const struct get_completion_shm_reply *req )
+{
+    dump_uint64( " size=", &req->size );
+    fprintf( stderr, ", serial=%08x", req->serial );
+}
+
 static void dump_set_completion_info_request( const struct set_completion_info_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4496,6 +4602,29 @@ static void dump_resume_process_request( const struct resume_process_request *re
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_request_stats_request( const struct get_request_stats_request *req )
+{
+    fprintf( stderr, " pid=%04x", req->pid );
+}
+
+static void dump_get_request_stats_reply( const struct get_request_stats_reply *req )
+{
+    fprintf( stderr, " total=%u", req->total );
+    dump_varargs_request_stats( ", stats=", cur_size );
+}
+
+static void dump_batch_requests_request( const struct batch_requests_request *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    dump_varargs_bytes( ", requests=", cur_size );
+}
+
+static void dump_batch_requests_reply( const struct batch_requests_reply *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    dump_varargs_bytes( ", replies=", cur_size );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_exec_process_request,
@@ -4539,6 +4668,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_request,
     (dump_func)dump_query_semaphore_request,
     (dump_func)dump_open_semaphore_request,
+    (dump_func)dump_get_fast_sync_shm_request,
+    (dump_func)dump_get_fast_sync_request,
+    (dump_func)dump_fast_sync_wake_request,
     (dump_func)dump_create_file_request,
     (dump_func)dump_open_file_object_request,
     (dump_func)dump_alloc_file_handle_request,
@@ -4577,6 +4709,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_mapping_request,
     (dump_func)dump_open_mapping_request,
     (dump_func)dump_get_mapping_info_request,
+    (dump_func)dump_get_image_reloc_file_request,
     (dump_func)dump_map_view_request,
     (dump_func)dump_unmap_view_request,
     (dump_func)dump_get_mapping_committed_range_request,
@@ -4620,6 +4753,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_empty_atom_table_request,
     (dump_func)dump_init_atom_table_request,
     (dump_func)dump_get_msg_queue_request,
+    (dump_func)dump_get_user_shm_request,
     (dump_func)dump_set_queue_fd_request,
     (dump_func)dump_set_queue_mask_request,
     (dump_func)dump_get_queue_status_request,
@@ -4743,6 +4877,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_query_symlink_request,
     (dump_func)dump_get_object_info_request,
     (dump_func)dump_get_object_type_request,
+    (dump_func)dump_get_handle_info_request,
+    (dump_func)dump_get_handle_cache_shm_request,
     (dump_func)dump_unlink_object_request,
     (dump_func)dump_get_token_impersonation_level_request,
     (dump_func)dump_allocate_locally_unique_id_request,
@@ -4762,6 +4898,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
     (dump_func)dump_query_completion_request,
+    (dump_func)dump_get_completion_shm_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
     (dump_func)dump_set_fd_completion_mode_request,
@@ -4784,6 +4921,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_terminate_job_request,
     (dump_func)dump_suspend_process_request,
     (dump_func)dump_resume_process_request,
+    (dump_func)dump_get_request_stats_request,
+    (dump_func)dump_batch_requests_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -4829,6 +4968,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_reply,
     (dump_func)dump_query_semaphore_reply,
     (dump_func)dump_open_semaphore_reply,
+    (dump_func)dump_get_fast_sync_shm_reply,
+    (dump_func)dump_get_fast_sync_reply,
+    NULL,
     (dump_func)dump_create_file_reply,
     (dump_func)dump_open_file_object_reply,
     (dump_func)dump_alloc_file_handle_reply,
@@ -4846,7 +4988,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_socket_event_reply,
     (dump_func)dump_get_socket_info_reply,
-    NULL,
+    (dump_func)dump_enable_socket_event_reply,
     NULL,
     (dump_func)dump_alloc_console_reply,
     NULL,
@@ -4867,6 +5009,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_mapping_reply,
     (dump_func)dump_open_mapping_reply,
     (dump_func)dump_get_mapping_info_reply,
+    (dump_func)dump_get_image_reloc_file_reply,
     NULL,
     NULL,
     (dump_func)dump_get_mapping_committed_range_reply,
@@ -4910,6 +5053,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_init_atom_table_reply,
     (dump_func)dump_get_msg_queue_reply,
+    (dump_func)dump_get_user_shm_reply,
     NULL,
     (dump_func)dump_set_queue_mask_reply,
     (dump_func)dump_get_queue_status_reply,
@@ -5033,6 +5177,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_query_symlink_reply,
     (dump_func)dump_get_object_info_reply,
     (dump_func)dump_get_object_type_reply,
+    (dump_func)dump_get_handle_info_reply,
+    (dump_func)dump_get_handle_cache_shm_reply,
     NULL,
     (dump_func)dump_get_token_impersonation_level_reply,
     (dump_func)dump_allocate_locally_unique_id_reply,
@@ -5052,6 +5198,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_remove_completion_reply,
     (dump_func)dump_query_completion_reply,
+    (dump_func)dump_get_completion_shm_reply,
     NULL,
     NULL,
     NULL,
@@ -5074,6 +5221,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     NULL,
+    (dump_func)dump_get_request_stats_reply,
+    (dump_func)dump_batch_requests_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -5119,6 +5268,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "release_semaphore",
     "query_semaphore",
     "open_semaphore",
+    "get_fast_sync_shm",
+    "get_fast_sync",
+    "fast_sync_wake",
     "create_file",
     "open_file_object",
     "alloc_file_handle",
@@ -5157,6 +5309,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "create_mapping",
     "open_mapping",
     "get_mapping_info",
+    "get_image_reloc_file",
     "map_view",
     "unmap_view",
     "get_mapping_committed_range",
@@ -5200,6 +5353,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "empty_atom_table",
     "init_atom_table",
     "get_msg_queue",
+    "get_user_shm",
     "set_queue_fd",
     "set_queue_mask",
     "get_queue_status",
@@ -5323,6 +5477,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "query_symlink",
     "get_object_info",
     "get_object_type",
+    "get_handle_info",
+    "get_handle_cache_shm",
     "unlink_object",
     "get_token_impersonation_level",
     "allocate_locally_unique_id",
@@ -5342,6 +5498,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "add_completion",
     "remove_completion",
     "query_completion",
+    "get_completion_shm",
     "set_completion_info",
     "add_fd_completion",
     "set_fd_completion_mode",
@@ -5364,6 +5521,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "terminate_job",
     "suspend_process",
     "resume_process",
+    "get_request_stats",
+    "batch_requests",
 };
 
 static const struct
@@ -5593,3 +5752,8 @@ void trace_reply( enum request req, const union generic_reply *reply )
     else fprintf( stderr, "%04x: %d() = %s\n",
                   current->id, req, get_status_name(current->error) );
 }
+
+const char *get_request_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : "?";
+}
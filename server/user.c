@@ -18,7 +18,23 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "handle.h"
 #include "thread.h"
+#include "file.h"
 #include "user.h"
 #include "request.h"
 
@@ -34,6 +50,18 @@ static struct user_handle *freelist;
 static int nb_handles;
 static int allocated_handles;
 
+/*
+ * The state of queues, thread inputs and windows that clients query most often
+ * is published in a section that they map read-only, so that they can read it
+ * without a server round trip. Each desktop has its own section, which only
+ * holds the objects of that desktop and is only handed out to its threads.
+ * The entries are protected by sequence numbers which are odd while the server
+ * updates them; readers retry if a sequence number is odd or if it changed
+ * while they were reading. Only the server main thread writes to them.
+ */
+static unsigned int user_shm_last_id;  /* id of the last allocated section */
+static int user_shm_failed;
+
 static struct user_handle *handle_to_entry( user_handle_t handle )
 {
     unsigned short generation;
@@ -193,3 +221,51 @@ DECL_HANDLER(free_user_handle)
     else
         set_error( STATUS_INVALID_HANDLE );
 }
+
+
+/* get the shared user section of a desktop, allocating it if needed; return NULL if not available */
+user_shm_t *get_desktop_shm( struct desktop *desktop )
+{
+    void *ptr;
+
+    if (desktop->shm) return desktop->shm;
+    if (user_shm_failed) return NULL;
+    if (!(desktop->shm_mapping = create_shared_mapping( sizeof(*desktop->shm), &ptr )))
+    {
+        fprintf( stderr, "wineserver: could not allocate the shared user state\n" );
+        user_shm_failed = 1;
+        clear_error();
+        return NULL;
+    }
+    desktop->shm = ptr;
+    desktop->shm_id = ++user_shm_last_id;
+    return desktop->shm;
+}
+
+/* free the shared user section of a desktop */
+void free_desktop_shm( struct desktop *desktop )
+{
+    if (!desktop->shm) return;
+    munmap( desktop->shm, sizeof(*desktop->shm) );
+    release_object( desktop->shm_mapping );
+    desktop->shm = NULL;
+    desktop->shm_mapping = NULL;
+}
+
+
+/* get the section holding the shared user state of the current thread desktop */
+DECL_HANDLER(get_user_shm)
+{
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (get_desktop_shm( desktop ))
+    {
+        reply->handle = alloc_handle_no_access_check( current->process, desktop->shm_mapping,
+                                                      SECTION_QUERY | SECTION_MAP_READ, 0 );
+        reply->id     = desktop->shm_id;
+        reply->size   = sizeof(*desktop->shm);
+    }
+    else set_error( STATUS_NOT_SUPPORTED );
+    release_object( desktop );
+}
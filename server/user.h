@@ -77,8 +77,28 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    struct object       *shm_mapping;      /* section holding the shared user state */
+    user_shm_t          *shm;              /* shared user state, see user.c */
+    unsigned int         shm_id;           /* unique id of the shared user state */
 };
 
+/* shared user state functions */
+
+extern user_shm_t *get_desktop_shm( struct desktop *desktop );
+extern void free_desktop_shm( struct desktop *desktop );
+
+/* start updating an entry of the shared user section; the sequence number is odd until the update ends */
+static inline void begin_shm_write( unsigned int *seq )
+{
+    __atomic_store_n( seq, *seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+static inline void end_shm_write( unsigned int *seq )
+{
+    __atomic_store_n( seq, *seq + 1, __ATOMIC_RELEASE );
+}
+
 /* user handles functions */
 
 extern user_handle_t alloc_user_handle( void *ptr, enum user_object type );
@@ -172,6 +172,61 @@ static inline struct window *get_last_child( struct window *win )
     return ptr ? LIST_ENTRY( ptr, struct window, entry ) : NULL;
 }
 
+/* get the entry of a window in the shared user section of its desktop */
+static inline window_shm_t *get_window_shm( user_shm_t *user_shm, user_handle_t handle )
+{
+    return &user_shm->windows[((handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+}
+
+/* publish the tree position, owner and geometry of a window to the clients */
+static void update_window_shm( struct window *win )
+{
+    struct window *child, *next;
+    user_shm_t *user_shm;
+    window_shm_t *shm;
+
+    if (get_user_object( win->handle, USER_WINDOW ) != win) return;  /* being destroyed */
+    if (!(user_shm = get_desktop_shm( win->desktop ))) return;
+
+    shm = get_window_shm( user_shm, win->handle );
+    begin_shm_write( &user_shm->window_seq );
+    shm->handle   = win->handle;
+    shm->parent   = win->parent ? win->parent->handle : 0;
+    shm->owner    = win->owner;
+    shm->tid      = win->thread ? get_thread_id( win->thread ) : 0;
+    shm->pid      = win->thread ? get_process_id( win->thread->process ) : 0;
+    shm->style    = win->style;
+    shm->ex_style = win->ex_style;
+    shm->dpi      = win->dpi;
+    shm->window   = win->window_rect;
+    shm->client   = win->client_rect;
+    shm->visible  = win->visible_rect;
+    shm->first_child  = (child = get_first_child( win )) ? child->handle : 0;
+    shm->next_sibling = win->is_linked && (next = get_next_window( win )) ? next->handle : 0;
+    shm->has_region   = win->win_region != NULL;
+    end_shm_write( &user_shm->window_seq );
+}
+
+/* get the window whose shared entry links to a window in the z-order: its previous sibling, or its parent */
+static struct window *get_window_shm_link( struct window *win )
+{
+    struct window *prev;
+
+    if (!win->parent || !win->is_linked) return NULL;
+    return (prev = get_prev_window( win )) ? prev : win->parent;
+}
+
+/* remove a destroyed window from the shared user section */
+static void clear_window_shm( struct window *win )
+{
+    user_shm_t *user_shm = win->desktop->shm;
+
+    if (!user_shm) return;
+    begin_shm_write( &user_shm->window_seq );
+    memset( get_window_shm( user_shm, win->handle ), 0, sizeof(window_shm_t) );
+    end_shm_write( &user_shm->window_seq );
+}
+
 /* set the PAINT_PIXEL_FORMAT_CHILD flag on all the parents */
 /* note: we never reset the flag, it's just a heuristic */
 static inline void update_pixel_format_flags( struct window *win )
@@ -241,12 +296,14 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_window_shm( get_window_shm_link( win ) );
+    update_window_shm( win );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
 static int set_parent_window( struct window *win, struct window *parent )
 {
-    struct window *ptr;
+    struct window *ptr, *old_link = get_window_shm_link( win );
 
     /* make sure parent is not a child of window */
     for (ptr = parent; ptr; ptr = ptr->parent)
@@ -283,6 +340,8 @@ static int set_parent_window( struct window *win, struct window *parent )
         list_add_head( &win->parent->unlinked, &win->entry );
         win->is_linked = 0;
     }
+    if (old_link) update_window_shm( old_link );
+    update_window_shm( win );
     return 1;
 }
 
@@ -421,6 +480,7 @@ static void detach_window_thread( struct window *win )
     /* destroyed when the desktop ref count reaches zero */
     release_object( win->desktop );
     win->thread = NULL;
+    update_window_shm( win );
 }
 
 /* get the process owning the top window of a given desktop */
@@ -548,6 +608,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     }
 
     current->desktop_users++;
+    update_window_shm( win );
     return win;
 
 failed:
@@ -1699,9 +1760,16 @@ static void set_window_pos( struct window *win, struct window *previous,
     win->visible_rect = *visible_rect;
     win->surface_rect = *surface_rect;
     win->client_rect  = *client_rect;
-    if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
+    if (!(swp_flags & SWP_NOZORDER) && win->parent)
+    {
+        struct window *old_link = get_window_shm_link( win );
+
+        link_window( win, previous );
+        if (old_link) update_window_shm( old_link );
+    }
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_window_shm( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1716,6 +1784,7 @@ static void set_window_pos( struct window *win, struct window *previous,
             offset_rect( &child->visible_rect, new_size - old_size, 0 );
             offset_rect( &child->surface_rect, new_size - old_size, 0 );
             offset_rect( &child->client_rect, new_size - old_size, 0 );
+            update_window_shm( child );
         }
     }
 
@@ -1857,6 +1926,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    update_window_shm( win );
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1873,11 +1943,14 @@ static void set_window_region( struct window *win, struct region *region, int re
 /* destroy a window */
 void destroy_window( struct window *win )
 {
+    struct window *old_link;
+
     /* hide the window */
     if (is_visible(win))
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        update_window_shm( win );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1902,8 +1975,11 @@ void destroy_window( struct window *win )
     free_hotkeys( win->desktop, win->handle );
     cleanup_clipboard_window( win->desktop, win->handle );
     free_user_handle( win->handle );
+    clear_window_shm( win );
     destroy_properties( win );
+    old_link = get_window_shm_link( win );
     list_remove( &win->entry );
+    if (old_link) update_window_shm( old_link );
     if (is_desktop_window(win))
     {
         struct desktop *desktop = win->desktop;
@@ -1965,6 +2041,7 @@ DECL_HANDLER(create_window)
         win->dpi_awareness = req->awareness;
         win->dpi = req->dpi;
     }
+    update_window_shm( win );
 
     reply->handle    = win->handle;
     reply->parent    = win->parent ? win->parent->handle : 0;
@@ -2027,6 +2104,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->top_window );
         }
     }
 
@@ -2039,6 +2117,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->msg_window );
         }
     }
 
@@ -2074,6 +2153,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_window_shm( win );
 }
 
 
@@ -2148,6 +2228,7 @@ DECL_HANDLER(set_window_info)
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) update_window_shm( win );
 }
 
 
@@ -2668,8 +2749,13 @@ DECL_HANDLER(update_window_zorder)
         /* making sure to not violate the topmost rule */
         if (!(ptr->ex_style & WS_EX_TOPMOST) || (win->ex_style & WS_EX_TOPMOST))
         {
+            struct window *old_link = get_window_shm_link( win );
+
             list_remove( &win->entry );
             list_add_before( &ptr->entry, &win->entry );
+            if (old_link) update_window_shm( old_link );
+            if ((ptr = get_window_shm_link( win ))) update_window_shm( ptr );
+            update_window_shm( win );
         }
         break;
     }